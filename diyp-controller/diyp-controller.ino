@@ -34,6 +34,12 @@
       * weight(), tarre(), level(), empty()
       * hx711
 
+    * wifiManager - Non-blocking Wifi connection with retry backoff and configuration AP
+    * telemetry - Store-and-forward buffer of the machine state, published to MQTT
+    * startupProcess - Non-blocking startup sequence run from the loop: logo, factory reset check, Wifi and MQTT
+    * warmRestart - Resume heating after a watchdog or software reset (state in no-init RAM)
+    * brownOut - Persist counters and last errors to flash when the supply fails (BOD33 interrupt)
+
 */
 
 #include <Arduino.h>
@@ -51,27 +57,29 @@
 #include "dp_brew.h"
 #include "dp_heater.h"
 #include "dp_pump.h"
+#include "dp_brew_switch.h"
+#include "dp_brownout.h"
+#include "dp_restart.h"
+#include "dp_startup.h"
 
 #include "dp_serial.h"
 #include "dp_wifi.h"
 #include "dp_mqtt.h"
+#include "dp_telemetry.h"
+#include "dp_power.h"
 
 
 /**
  * @brief setup code
- * initialize all objects and state
+ * initialize the safety critical objects and state, so the boiler is controlled from the first loop pass.
+ * The logo, factory reset check and network are handled by the startupProcess from the loop.
  */
 void setup()
 {
   int result = 0;
-  
-  delay(1000);
-  dpSerial.send(__DATE__ " " __TIME__);
-  statusLed.color(ColorLed::WHITE);
 
-  encoder.start();
-  display.init();
-  display.logo(__DATE__, __TIME__);
+  warmRestart.init(); // first: determine reset cause and check the no-init state block
+  dpSerial.send(__DATE__ " " __TIME__);
 
   if ((result = settings.load()) < 0)
   {
@@ -84,41 +92,30 @@ void setup()
     dpSerial.send("Load settings OK, result=");
   dpSerial.send(result); 
 
-  dpSerial.send(encoder.button_count());
-  if (encoder.button_count() > 3)
-  {
-    dpSerial.send("button pressed 4x at startup: perform factory reset of settings");
-    settings.defaults();
-    dpSerial.send(settings.save());
-  }
-
-  dpSerial.send_settings();
-
-  display.custom_chars(custom_chars_spinner);
-
-  boilerController.init(); // moved this out of the constructor, because the arduino just bricked if called earlier. Not sure why though...
-
+  boilerController.init(); // starts the RTD conversions and the watchdog. Moved this out of the constructor, because the arduino just bricked if called earlier. Not sure why though...
   settings.apply();
-
-  dpSerial.send("INIT DONE");
-  
   heaterDevice.pwm_period(1.0); // [sec]
   boilerController.off();
 
-  if (settings.wifiMode() != WIFI_MODE_OFF)
+  brownOut.init(); // restore counters saved at the last power loss
+  warmRestart.restore(); // resume heating after a watchdog or software reset
+
+  statusLed.color(ColorLed::WHITE);
+  encoder.start();
+  display.init();
+
+  if (brownOut.restored())
   {
-    if (settings.wifiMode() == WIFI_MODE_AP)
-    {
-      wifi_erase();
-      settings.wifiMode(WIFI_MODE_ON);
-      settings.save();
-    }
-    menu_wifi("starting");
-    wifi_setup();
-    wifi_loop();
-    delay(1000);
+    dpSerial.send("Restored power-loss record, shots=");
+    dpSerial.send((int)brownOut.last()->shotCounter);
+  }
+  if (warmRestart.is_warm())
+  {
+    dpSerial.send("Warm restart, reset cause: ");
+    dpSerial.send(warmRestart.get_reset_cause_text());
   }
-  mqttDevice.init();
+  dpSerial.send_settings();
+  dpSerial.send("INIT DONE");
 }
 
 // Output the state to serial port
@@ -153,38 +150,10 @@ void print_state()
   }
 }
 
-// Send the state to MQTT
+// Store the state in the telemetry buffer (at a rate depending on the state), it is published to MQTT by telemetry.run()
 void send_state()
 {
-  static unsigned long prev_time = millis();
-  if (time_since(prev_time) > 5000)
-  {
-    mqttDevice.write("t_set", boilerController.set_temp());
-    mqttDevice.write("t_act", boilerController.act_temp());
-    mqttDevice.write("h_pwr", heaterDevice.power());
-    mqttDevice.write("h_avg", heaterDevice.average());
-    mqttDevice.write("r_lvl", reservoir.level());
-    mqttDevice.write("r_wgt", reservoir.weight());
-    mqttDevice.write("w_cur", brewProcess.weight());
-    mqttDevice.write("w_end", brewProcess.end_weight());
-    mqttDevice.write("shots", (long)settings.shotCounter());
-
-    mqttDevice.write("boil", (char *)boilerController.get_state_name());
-    if (boilerController.is_error())
-      mqttDevice.write("boil_err", (char *)boilerController.get_error_text());
-
-    mqttDevice.write("brew", (char *)brewProcess.get_state_name());
-    if (brewProcess.is_error())
-      mqttDevice.write("brew_err", (char *)brewProcess.get_error_text());
-
-    if (reservoir.is_error())
-      mqttDevice.write("res_err", (char *)reservoir.get_error_text());
-
-    mqttDevice.write("msec", (long)millis());
-    mqttDevice.send();
-
-    prev_time = millis();
-  }
+  telemetry.update();
 }
 
 typedef enum
@@ -196,13 +165,14 @@ typedef enum
   SAVED,
   ERROR,
   INFO,
+  GRAPH,
   WARNING_ALMOST_EMPTY
 } menus_t;
 
 
 
 // #define LOOP_COUNT_TEST
-// #define LOOP_TIMERS // To monitor the performance of the main loop
+// #define LOOP_TIMERS // To monitor the performance of the main loop [usec], t2: menu_main() with Display::show()
 
 /**
  * @brief main process loop
@@ -224,7 +194,7 @@ void loop()
   #endif
   
   #ifdef LOOP_TIMERS
-    unsigned long tstart = millis();
+    unsigned long tstart = micros();
 
     unsigned long t1, t2, t3, t4;
   #endif
@@ -232,7 +202,9 @@ void loop()
   static Timer menu_saved_timer = Timer(MILLIS);
   static menus_t menu = COMMISSIONING;
 
-  bool button_pressed = display.button_pressed();
+  display.input(); // the input events since the last loop: every reader below sees them, the next loop does not
+  brewSwitch.update(display.input_events());
+  bool button_pressed = display.button_pressed() && !startupProcess.is_splash(); // presses during the logo are for the factory reset
 
 
 
@@ -260,10 +232,18 @@ void loop()
   dpSerial.receive(); // check for incoming serial commands
 
   send_state();
+  wifiManager.run();
   mqttDevice.run();
+  statusLed.update(); // a color set while the Wifi module was busy
+  powerBudget.run();
+  telemetry.run();
+  menu_graph_sample();
+  warmRestart.update();
+  brownOut.run();
+  startupProcess.run();
 
   #ifdef LOOP_TIMERS
-    t1 = millis();
+    t1 = micros();
   #endif
   
 
@@ -274,7 +254,9 @@ void loop()
   if (brewProcess.is_error())
     menu = ERROR; // error menu
 
-  switch (menu)
+  if (startupProcess.is_splash() && menu != ERROR)
+    ; // the logo is shown, do not draw the menus
+  else switch (menu)
   {
   case COMMISSIONING:
     if (settings.commissioningDone())
@@ -291,11 +273,11 @@ void loop()
     }
 
 #ifdef LOOP_TIMERS
-    t2 = millis();
+    t2 = micros();
 #endif
     menu_main();
 #ifdef LOOP_TIMERS
-    t3 = millis();
+    t3 = micros();
 #endif
 
     if (button_pressed) {
@@ -317,14 +299,11 @@ void loop()
       boilerController.clear_error();
       reservoir.clear_error();
       settings.apply();
-      display.button_pressed(); // prevent entering settings again
       menu = SAVED;
     }
     else if (menuSettings == 2)
     {
       dpSerial.send("Cancel!");
-      display.button_pressed();
-      display.encoder_changed();
       menu = MAIN;
     }
     break;
@@ -333,14 +312,10 @@ void loop()
     if (!brewProcess.is_awake())
     {
       menu = MAIN;
-      display.button_pressed(); // consume button pressed event, prevent jump to settings menu
-      display.encoder_changed();
     }
     break;
   case SAVED: // saved menu
     menu_saved();
-    display.button_pressed();
-    display.encoder_changed();
 
     if (menu_saved_timer.state() != status_t::RUNNING) {
       menu_saved_timer.start(); // start timer if not running
@@ -363,6 +338,13 @@ void loop()
     break;
   case INFO: // state info menu
     menu_state();
+    if (button_pressed)
+      menu = SETTINGS;
+    if (display.encoder_changed())
+      menu = GRAPH;
+    break;
+  case GRAPH: // temperature or shot graph
+    menu_graph();
     if (button_pressed)
       menu = SETTINGS;
     if (display.encoder_changed())
@@ -380,12 +362,12 @@ void loop()
   }
 
 #ifdef LOOP_TIMERS
-  t4 = millis();
+  t4 = micros();
 #endif
 
 
   // sleep (de)activation and menu selection (note: sleep can be activated automatically)
-  if (display.button_long_pressed())
+  if (!startupProcess.is_splash() && display.button_long_pressed())
   {
     if (brewProcess.is_awake())
       brewProcess.sleep();
@@ -396,9 +378,9 @@ void loop()
     menu = SLEEP;
 
   #ifdef LOOP_TIMERS
-    unsigned long tend = millis();
+    unsigned long tend = micros();
 
-    dpSerial.send("loop: " + String(tend - tstart) + "ms, t0: " + String(t1 - tstart) + "ms, t1: " + String(t2 - t1) + "ms, t2: " + String(t3 - t2) + "ms, t3: " + String(t4 - t3) + "ms, t4: " + String(tend - t4) + "ms");
+    dpSerial.send("loop: " + String(tend - tstart) + "us, t0: " + String(t1 - tstart) + "us, t1: " + String(t2 - t1) + "us, t2: " + String(t3 - t2) + "us, t3: " + String(t4 - t3) + "us, t4: " + String(tend - t4) + "us");
   #endif
 }
 
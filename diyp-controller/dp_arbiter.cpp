@@ -0,0 +1,42 @@
+/*
+  Mains current arbiter between the heater and the pump
+  (c) 2025 diyPresso - CC-BY-NC
+*/
+#include "dp_arbiter.h"
+
+PowerArbiter powerArbiter = PowerArbiter();
+
+double PowerArbiter::pump(bool pump, unsigned long pump_msec)
+{
+  if (!pump)
+    return 0.0;
+  return pump_msec < ARBITER_INRUSH_MSEC ? ARBITER_PUMP_INRUSH * PUMP_RATED_POWER : PUMP_RATED_POWER;
+}
+
+// Returns the state of the heater SSR for a requested power (want [%]) and the state of its PWM (on), called at every
+// PWM update. delta_usec is the time since the previous call, during which its decision was in effect.
+bool PowerArbiter::heater(double want, bool on, bool pump, unsigned long pump_msec, unsigned long delta_usec)
+{
+  double energy = HEATER_RATED_POWER * delta_usec / 1E6; // [J] of the heater during the previous decision
+  if (_cut)
+  {
+    _debt += energy;
+    _withheld += energy;
+    if (_debt > ARBITER_DEBT_MAX_J)
+      _debt = ARBITER_DEBT_MAX_J;
+  }
+  else if (_repay)
+    _debt = _debt > energy ? _debt - energy : 0.0;
+
+  bool inrush = pump && pump_msec < ARBITER_INRUSH_MSEC;
+  bool fits = HEATER_RATED_POWER + this->pump(pump, pump_msec) <= _limit;
+  if (inrush && !_inrush && want > 0 && !fits)
+    _deferred++;
+  _inrush = inrush;
+
+  if (want <= 0) // nothing requested (e.g. on temperature or off): the debt is forgiven
+    _debt = 0;
+  _cut = on && !fits;
+  _repay = !on && fits && _debt > 0;
+  return fits && (on || _repay);
+}
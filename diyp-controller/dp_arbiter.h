@@ -0,0 +1,54 @@
+/*
+  Mains current arbiter between the heater and the pump
+  (c) 2025 diyPresso - CC-BY-NC
+
+  The heater and the pump switch independently, so at the start of a shot the inrush of the pump can coincide with
+  full heater power. The arbiter gates the heater SSR so that the combined power never exceeds the mains limit (the
+  mainsLimit setting, ARBITER_LIMIT_W by default):
+  - the pump draws ARBITER_PUMP_INRUSH times its rated power during ARBITER_INRUSH_MSEC after it switched on, and its
+    rated power after that. The heater may only conduct when its rated power fits in the room that leaves under the
+    limit. The pump switches the heater off before its own SSR is switched on;
+  - this is checked at every control() of the heater, so within each PWM window the on-phase of the heater is cut
+    where it does not fit;
+  - the heater energy that is cut is a debt, it is repaid by keeping the heater on after its on-phase, as soon as it
+    fits again. The debt is accounted in the energy actually withheld and delivered, so the heater energy equals the
+    requested energy and the boiler control is not disturbed.
+
+  With the default limit the heater and the pump fit together, only the inrush is staggered. A limit below their sum
+  keeps the heater off while the pump runs, the debt is then repaid after the shot (up to ARBITER_DEBT_MAX_J).
+
+  Portable C++, no Arduino dependencies: power in [W] and [%] of the rated power, time in [usec] and [msec].
+*/
+#ifndef ARBITER_H
+#define ARBITER_H
+
+#include "dp_hardware.h"
+
+#define ARBITER_LIMIT_W 1100.0    // default max combined power of the heater and the pump [W]
+#define ARBITER_INRUSH_MSEC 100   // the pump draws its inrush current after it switched on [msec]
+#define ARBITER_PUMP_INRUSH 4.0   // inrush power of the pump, times its rated power
+#define ARBITER_DEBT_MAX_J 5000.0 // max withheld heater energy that is repaid [J]
+
+class PowerArbiter
+{
+private:
+  double _limit = ARBITER_LIMIT_W; // [W]
+  double _debt = 0.0;              // [J] withheld heater energy
+  double _withheld = 0.0;          // [J] total withheld energy, for statistics
+  unsigned long _deferred = 0;     // pump starts during which the heater was kept off
+  bool _cut = false, _repay = false; // decision of the previous call: on-phase cut, repaying after the on-phase
+  bool _inrush = false;
+
+public:
+  bool heater(double want, bool on, bool pump, unsigned long pump_msec, unsigned long delta_usec);
+  double pump(bool pump, unsigned long pump_msec); // [W] power drawn by the pump
+  void limit(double watt) { _limit = watt; }       // [W]
+  double limit() { return _limit; }
+  double debt() { return _debt; }                  // [J]
+  double withheld() { return _withheld / 3600.0; } // [Wh]
+  unsigned long deferred() { return _deferred; }
+};
+
+extern PowerArbiter powerArbiter;
+
+#endif // ARBITER_H
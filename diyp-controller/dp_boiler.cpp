@@ -8,6 +8,7 @@
 #include "dp_boiler.h"
 #include "dp_heater.h"
 #include "dp_settings.h"
+#include "dp_time.h"
 
 //#include <Adafruit_MAX31865.h>
 
@@ -103,8 +104,9 @@ void BoilerStateMachine::init()
   _pid.setWindUpLimits(WINDUP_LIMIT_MIN, WINDUP_LIMIT_MAX); // set bounds for the integral term to prevent integral wind-up
   _pid.start();
 
-  begin();  // start the thermistor.
-  delay(500); // wait for the thermistor to start up. TODO: wait in loop?
+  begin();  // start the thermistor, control() waits for the first conversion
+  _init_time = millis();
+  _rtd_valid = false;
   _error = BOILER_ERROR_NONE;
   _rtd_error = 0;
   _on = true;
@@ -124,6 +126,23 @@ void BoilerStateMachine::begin()
 void BoilerStateMachine::control(void)
 {
 
+  if (!_rtd_valid) // wait for the first RTD conversion, keep the heater off until then
+  {
+    double t = thermistor.getTemperature(RNOMINAL, RREF);
+    bool plausible = !thermistor.getFault() && t > TEMP_LIMIT_LOW && t < TEMP_LIMIT_HIGH;
+    unsigned long elapsed = time_since(_init_time);
+    if (!(plausible && elapsed >= RTD_MIN_STARTUP_MSEC) && elapsed < RTD_STARTUP_MSEC)
+    {
+      _last_control_time = millis();
+      heaterDevice.power(0);
+#ifdef WATCHDOG_ENABLED
+      wdt_reset();
+#endif
+      return;
+    }
+    _rtd_valid = true;
+  }
+
   //unsigned long start_time = millis();
   //_act_temp = thermistor.temperature(RNOMINAL, RREF);
   _act_temp = thermistor.getTemperature(RNOMINAL, RREF);
@@ -193,7 +212,12 @@ void BoilerStateMachine::control(void)
 
 const char *BoilerStateMachine::get_error_text()
 {
-  switch (_error)
+  return get_error_text(_error);
+}
+
+const char *BoilerStateMachine::get_error_text(boiler_error_t error)
+{
+  switch (error)
   {
   case BOILER_ERROR_NONE:
     return "OK";
@@ -227,4 +251,20 @@ const char *BoilerStateMachine::get_state_name()
   RETURN_STATE_NAME(error);
   RETURN_NONE_STATE_NAME()
   RETURN_UNKNOWN_STATE_NAME();
-}
\ No newline at end of file
+}
+
+// Name of a stored state, e.g. a buffered telemetry sample
+const char *BoilerStateMachine::get_state_name(boiler_state_t state)
+{
+  static const char *names[] = {"off", "heating", "ready", "brew", "error"};
+  return state < sizeof(names) / sizeof(names[0]) ? names[state] : "<unknown>";
+}
+
+boiler_state_t BoilerStateMachine::get_state()
+{
+  RETURN_STATE_ID(heating, BOILER_STATE_HEATING);
+  RETURN_STATE_ID(ready, BOILER_STATE_READY);
+  RETURN_STATE_ID(brew, BOILER_STATE_BREW);
+  RETURN_STATE_ID(error, BOILER_STATE_ERROR);
+  return BOILER_STATE_OFF;
+}
@@ -5,6 +5,7 @@
 #ifndef BOILER_H
 #define BOILER_H
 
+#undef _DP_FSM_TYPE // the headers of the other state machines define it too
 #define _DP_FSM_TYPE BoilerStateMachine // used for the state machine macro NEXT()
 #include "dp_hardware.h"
 #include "dp_fsm.h"
@@ -32,6 +33,20 @@
 #define TIMEOUT_CONTROL_MSEC (1000 * 10)    // Max time between control updates [milliseconds]
 #define TIMEOUT_HEATER_SSR_MSEC (1000 * 60) // maximum time the SSR is allowed to be ON [milliseconds]
 
+// Time to wait for the first RTD conversion after init() [milliseconds]
+#define RTD_MIN_STARTUP_MSEC 70 // first conversion in continuous mode with 50Hz filter takes ~66 msec
+#define RTD_STARTUP_MSEC 500    // maximum wait for a plausible reading, errors are checked after this time
+
+// Boiler states, in the same order as get_state_name()
+typedef enum
+{
+  BOILER_STATE_OFF,
+  BOILER_STATE_HEATING,
+  BOILER_STATE_READY,
+  BOILER_STATE_BREW,
+  BOILER_STATE_ERROR,
+} boiler_state_t;
+
 // Various boiler errors
 typedef enum
 {
@@ -64,7 +79,14 @@ public:
   double set_ff_brew(double ff) { return _ff_brew = min(100.0, max(ff, 0.0)); }
   double get_ff_brew(void) { return _ff_brew; }
   void set_pid(double p, double i, double d) { _pid.setCoefficients(p, i, d); }
-  void on() { _on = true; }
+  double integral() { return _pid.I(); }
+  void integral(double i) { _pid.setIntegral(i); }
+  void on()
+  {
+    if (!_on)
+      _last_control_time = millis(); // control may have been paused while off
+    _on = true;
+  }
   void off()
   {
     _on = false;
@@ -77,9 +99,12 @@ public:
   bool is_error() { return _cur_state == &BoilerStateMachine::state_error; }
   const char *get_error_text();
   const char *get_state_name();
+  boiler_state_t get_state();
+  static const char *get_error_text(boiler_error_t error);
+  static const char *get_state_name(boiler_state_t state);
   void control();
   void begin();
-  void init(); 
+  void init();
 
 
 private:
@@ -87,6 +112,8 @@ private:
   double _act_temp = 0, _set_temp = 0, _ff_heat = 0, _ff_ready = 0, _ff_brew = 0, _power = 0;
   bool _on = false, _brew = false;
   unsigned long _last_control_time = 0;
+  unsigned long _init_time = 0; // start of the RTD conversion grace period
+  bool _rtd_valid = false;      // true after the first plausible RTD reading
   boiler_error_t _error = BOILER_ERROR_NONE;
   int _rtd_error = 0;   // current RTD errors
   void state_off();     // SSR is forced OFF
@@ -192,6 +192,7 @@ void BrewProcess::state_pre_infuse()
   {
     _start_weight = reservoir.weight();
     _brewTimer.start();
+    _brew_lag = is_prev_state(STATE(state_idle)) ? brewSwitch.since(micros()) / 1000 : 0; // the shot started with the switch
     statusLed.color(ColorLed::BLUE);
     pumpDevice.on();
     boilerController.start_brew();
@@ -246,6 +247,7 @@ void BrewProcess::state_finished()
   ON_MESSAGE(MSG_BUTTON)
   {
     _brewTimer.start();
+    _brew_lag = 0;
     NEXT(state_extract);
   }
   ON_TIMEOUT_SEC(finishedTime)
@@ -294,9 +296,40 @@ const char *BrewProcess::get_state_name()
   RETURN_UNKNOWN_STATE_NAME();
 }
 
+// Name of a stored state, e.g. a buffered telemetry sample
+const char *BrewProcess::get_state_name(brew_state_t state)
+{
+  static const char *names[] = {"init", "fill", "purge", "sleep", "empty", "idle", "check", "done",
+                                "warning_pre_brew", "pre_infuse", "infuse", "extract", "finished", "error"};
+  return state < sizeof(names) / sizeof(names[0]) ? names[state] : "<unknown>";
+}
+
+brew_state_t BrewProcess::get_state()
+{
+  RETURN_STATE_ID(fill, BREW_STATE_FILL);
+  RETURN_STATE_ID(purge, BREW_STATE_PURGE);
+  RETURN_STATE_ID(sleep, BREW_STATE_SLEEP);
+  RETURN_STATE_ID(empty, BREW_STATE_EMPTY);
+  RETURN_STATE_ID(idle, BREW_STATE_IDLE);
+  RETURN_STATE_ID(check, BREW_STATE_CHECK);
+  RETURN_STATE_ID(done, BREW_STATE_DONE);
+  RETURN_STATE_ID(warning_pre_brew, BREW_STATE_WARNING_PRE_BREW);
+  RETURN_STATE_ID(pre_infuse, BREW_STATE_PRE_INFUSE);
+  RETURN_STATE_ID(infuse, BREW_STATE_INFUSE);
+  RETURN_STATE_ID(extract, BREW_STATE_EXTRACT);
+  RETURN_STATE_ID(finished, BREW_STATE_FINISHED);
+  RETURN_STATE_ID(error, BREW_STATE_ERROR);
+  return BREW_STATE_INIT;
+}
+
 const char *BrewProcess::get_error_text()
 {
-  switch (_error)
+  return get_error_text(_error);
+}
+
+const char *BrewProcess::get_error_text(brew_error_t error)
+{
+  switch (error)
   {
   case BREW_ERROR_NONE:
     return "OK";
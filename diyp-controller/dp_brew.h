@@ -7,6 +7,7 @@
 #include "dp_time.h"
 #include "dp_reservoir.h"
 
+#undef _DP_FSM_TYPE
 #define _DP_FSM_TYPE BrewProcess // used for the state machine macro NEXT()
 #include "dp_fsm.h"
 
@@ -20,10 +21,29 @@ typedef enum
   BREW_ERROR_NO_WATER,
 } brew_error_t;
 
+// Brew process states, in the same order as get_state_name()
+typedef enum
+{
+  BREW_STATE_INIT,
+  BREW_STATE_FILL,
+  BREW_STATE_PURGE,
+  BREW_STATE_SLEEP,
+  BREW_STATE_EMPTY,
+  BREW_STATE_IDLE,
+  BREW_STATE_CHECK,
+  BREW_STATE_DONE,
+  BREW_STATE_WARNING_PRE_BREW,
+  BREW_STATE_PRE_INFUSE,
+  BREW_STATE_INFUSE,
+  BREW_STATE_EXTRACT,
+  BREW_STATE_FINISHED,
+  BREW_STATE_ERROR,
+} brew_state_t;
+
 class BrewProcess : public StateMachine<BrewProcess>
 {
 private:
-  typedef enum BrewProcessMessages
+  enum BrewProcessMessages
   {
     START = 1,
     STOP = 2,
@@ -38,8 +58,8 @@ public:
   BrewProcess() : StateMachine(STATE(state_init)) {};
   void start() { run(START); }
   void stop() { run(STOP); }
-  void sleep() { run(SLEEP); }
-  void wakeup() { run(WAKEUP); }
+  bool sleep() { return !run(SLEEP); }   // returns false if not possible in the current state
+  bool wakeup() { return !run(WAKEUP); } // returns false if not sleeping
   void clear_error() { run(RESET); };
   bool is_awake() { return !IN_STATE(sleep); }
   bool is_error() { return IN_STATE(error); }
@@ -51,11 +71,15 @@ public:
   bool is_purge() { return IN_STATE(purge); }
   bool is_busy() { return IN_STATE(pre_infuse) || IN_STATE(infuse) || IN_STATE(extract); }
   bool is_warning_almost_empty() { return IN_STATE(warning_pre_brew); }
-  double brew_time() { return _brewTimer.read() / 1000.0; }
+  double brew_time() { return (_brewTimer.read() + _brew_lag) / 1000.0; }
   double weight() { return _start_weight - reservoir.weight(); }
   double end_weight() { return _end_weight; }
   virtual const char *get_state_name();
+  brew_state_t get_state();
   const char *get_error_text();
+  static const char *get_error_text(brew_error_t error);
+  static const char *get_state_name(brew_state_t state);
+  brew_error_t error() { return _error; }
   typedef enum
   {
     MSG_NONE = 0,
@@ -65,6 +89,7 @@ public:
 protected:
   double _start_weight = 0.0, _end_weight = 0.0;
   Timer _brewTimer = Timer();
+  unsigned long _brew_lag = 0; // [msec] from the edge of the brew switch to the start of the timer
   void state_sleep();
   void state_init();
   void state_fill();
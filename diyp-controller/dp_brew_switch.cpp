@@ -2,5 +2,30 @@
  diyEspresso Pump Process control
  */
 #include "dp_brew_switch.h"
+#include "dp_encoder.h"
 
 BrewSwitch brewSwitch;
+
+void BrewSwitch::begin(uint32_t now)
+{
+    _up = BrewSwitchPin::read();
+    _since = now;
+    _pushed = _up;
+    _switch.begin(_up, now);
+}
+
+void BrewSwitch::sample(uint32_t now)
+{
+    _switch.update(BrewSwitchPin::read(), now);
+    if (_switch.state() != _pushed) // again at the next sample if the queue is full: the loop ends up in the same state
+        if (inputEvents.push(_switch.state() ? EVENT_BREW_UP : EVENT_BREW_DOWN, _switch.since()))
+            _pushed = _switch.state();
+}
+
+void BrewSwitch::update(const InputFrame &input)
+{
+    if (!input.brew_changes)
+        return;
+    _up = input.brew_up;
+    _since = input.brew_time;
+}
@@ -2,13 +2,30 @@
 #define BREW_HANDLE_H
 #include <Arduino.h>
 #include "dp_hardware.h"
+#include "dp_events.h"
+#include "dp_fastpin.h"
 
+#define BREW_DEBOUNCE_US 20000 // the lever is stable for this long [microseconds]
+
+typedef FastPin<PIN_BREW_SWITCH> BrewSwitchPin;
+
+// The brew switch is sampled by the timer interrupt of the encoder, its debounced changes are input events with the
+// time of their edge; up() and down() give the state of the events of this loop, the same for all readers.
 class BrewSwitch
 {
+private:
+    Debouncer _switch = Debouncer(BREW_DEBOUNCE_US); // true: up, of the interrupt
+    bool _pushed = true;                             // the state of the last event
+    bool _up = true;
+    uint32_t _since = 0; // [usec] the edge of the last change
 public:
-    BrewSwitch() { pinMode(PIN_BREW_SWITCH, INPUT_PULLUP); }
-    bool up(void) { return digitalRead(PIN_BREW_SWITCH); }
+    BrewSwitch() { BrewSwitchPin::input_pullup(); }
+    void begin(uint32_t now);             // before the interrupt samples it
+    void sample(uint32_t now);            // interrupt: pushes the changes
+    void update(const InputFrame &input); // loop: the changes drained
+    bool up(void) { return _up; }
     bool down() { return !up(); }
+    uint32_t since(uint32_t now) { return now - _since; } // [usec] in this position
 };
 
 extern BrewSwitch brewSwitch;
@@ -0,0 +1,156 @@
+/*
+  Brown-out triggered emergency persistence.
+  Timing from the SAMD21 datasheet (NVM characteristics, max at 48MHz), not measured on the controller: row erase
+  6 msec at startup, record (page) write 2.5 msec in the interrupt handler. The hold-up time of the 3.3V rail after
+  the mains is switched off is not measured either; it is expected to be several tens of msec. The firmware measures
+  the erase and the save of the running controller and reports them with `GET info`.
+  (c) 2025 diyPresso - CC-BY-NC
+*/
+#include "dp.h"
+#include "dp_hardware.h"
+#include "dp_brownout.h"
+#include "dp_time.h"
+#include "dp_settings.h"
+#include "dp_boiler.h"
+#include "dp_brew.h"
+#include "dp_reservoir.h"
+#include "dp_heater.h"
+#include "dp_pump.h"
+#include "dp_serial.h"
+#include <FlashStorage.h>
+
+// One flash row, reserved for the brown-out records
+__attribute__((__aligned__(BROWNOUT_ROW_SIZE))) static const uint8_t brownout_flash[BROWNOUT_ROW_SIZE] = { };
+static FlashClass brownout_storage(brownout_flash, sizeof(brownout_flash));
+
+BrownOut brownOut;
+
+static const volatile void *slot_address(int slot)
+{
+    return (const volatile void *)(brownout_flash + slot * BROWNOUT_PAGE_SIZE);
+}
+
+/// @brief restore the newest record, prepare the flash row and arm the brown-out detector
+/// Call after the settings are loaded: a restored shot counter overrides a lower value from the settings
+void BrownOut::init()
+{
+    brownout_record_t slots[BROWNOUT_SLOTS];
+
+    brownout_storage.read(slot_address(0), slots, sizeof(slots));
+    int newest = brownout_newest(slots, BROWNOUT_SLOTS);
+    if (newest >= 0)
+    {
+        _last = slots[newest];
+        _restored = true;
+        _sequence = _last.sequence;
+        _runtime = _last.runtime;
+        if ((int)_last.shotCounter > settings.shotCounter())
+            settings.shotCounter(_last.shotCounter);
+        heaterDevice.energy(_last.heaterEnergy);
+        pumpDevice.energy(_last.pumpEnergy);
+    }
+
+    prepare(BROWNOUT_CAUSE_BOOT); // also measures the save path
+
+    configure(SYSCTRL_BOD33_ACTION_INT);
+    SYSCTRL->INTFLAG.reg = SYSCTRL_INTFLAG_BOD33DET;
+    SYSCTRL->INTENSET.reg = SYSCTRL_INTENSET_BOD33DET;
+    NVIC_SetPriority(SYSCTRL_IRQn, 0); // highest priority: preempt everything else
+    NVIC_EnableIRQ(SYSCTRL_IRQn);
+}
+
+/// @brief erase the row and write the current state to the first slot
+/// Erase now, so the emergency save only needs a page write. An emergency during the erase and the write is skipped,
+/// like one during a settings commit: the interrupt does not touch the row while it is prepared.
+void BrownOut::prepare(brownout_cause_t cause)
+{
+    nvm_lock();
+    unsigned long start = micros();
+    brownout_storage.erase();
+    _erase_time = usec_since(start);
+    _slot = 0;
+    write(cause);
+    nvm_unlock();
+}
+
+/// @brief the last slot was used by a dip the controller survived: prepare the row for the next one
+void BrownOut::run()
+{
+    if (_slot < BROWNOUT_SLOTS)
+        return;
+    dpSerial.send("Brown-out record row full after " + String(_saves) + " saves, erasing it");
+    prepare(BROWNOUT_CAUSE_RECYCLE);
+}
+
+/// @brief (re)configure the BOD33 detector with a new action (interrupt or reset)
+void BrownOut::configure(unsigned long action)
+{
+    SYSCTRL->BOD33.reg &= ~SYSCTRL_BOD33_ENABLE;
+    while (!SYSCTRL->PCLKSR.bit.B33SRDY) { }
+    SYSCTRL->BOD33.reg = SYSCTRL_BOD33_LEVEL(BOD33_LEVEL) | action | SYSCTRL_BOD33_HYST;
+    while (!SYSCTRL->PCLKSR.bit.B33SRDY) { }
+    SYSCTRL->BOD33.reg |= SYSCTRL_BOD33_ENABLE;
+    while (!SYSCTRL->PCLKSR.bit.BOD33RDY) { }
+}
+
+/// @brief write the current critical state to the next free slot
+/// @return true if written, false if no slot is free (counted in full()) or a flash write is in progress
+bool BrownOut::save(brownout_cause_t cause)
+{
+    if (_slot >= BROWNOUT_SLOTS) // until run() prepared the row again
+    {
+        _full += 1;
+        return false;
+    }
+    if (_nvm_locked) // the settings commit will persist the shot counter anyway
+    {
+        _skipped += 1;
+        return false;
+    }
+    write(cause);
+    return true;
+}
+
+/// @brief write the record to the next slot, which is free
+void BrownOut::write(brownout_cause_t cause)
+{
+    brownout_record_t rec;
+
+    memset(&rec, 0, sizeof(rec));
+    rec.sequence = ++_sequence;
+    rec.shotCounter = settings.shotCounter();
+    rec.runtime = runtime();
+    rec.heaterEnergy = heaterDevice.energy();
+    rec.pumpEnergy = pumpDevice.energy();
+    rec.saveTime = _save_time;
+    rec.boilerError = boilerController.error();
+    rec.brewError = brewProcess.error();
+    rec.reservoirError = reservoir.error();
+    rec.cause = cause;
+    brownout_seal(&rec);
+
+    unsigned long start = micros();
+    brownout_storage.write(slot_address(_slot), &rec, sizeof(rec));
+    _save_time = usec_since(start);
+    _slot += 1;
+    _saves += 1;
+}
+
+/// @brief Called from the BOD33 interrupt: the supply is failing
+void BrownOut::emergency()
+{
+    HeaterSsr::low(); // shed the loads, we are going down anyway
+    PumpSsr::low();
+    save(BROWNOUT_CAUSE_POWER);
+    configure(SYSCTRL_BOD33_ACTION_RESET); // hold the CPU in reset until the supply is back
+    configure(SYSCTRL_BOD33_ACTION_INT);   // still running: it was a dip, re-arm for the next one
+}
+
+extern "C" void SYSCTRL_Handler(void)
+{
+    if (SYSCTRL->INTFLAG.bit.BOD33DET)
+    {
+        SYSCTRL->INTFLAG.reg = SYSCTRL_INTFLAG_BOD33DET;
+        brownOut.emergency();
+    }
+}
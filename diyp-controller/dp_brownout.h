@@ -0,0 +1,59 @@
+/*
+  dp_brownout class
+  Emergency persistence of counters and runtime state on power loss.
+
+  The SAMD21 BOD33 brown-out detector is configured to raise an interrupt when the 3.3V supply drops below
+  BOD33_LEVEL. The interrupt handler writes a small critical-state record (shot counter, energy counters, last errors)
+  to a pre-erased flash row in the time that is left, so no flash writes are needed during normal operation.
+  After the save the detector is switched to reset mode, to keep the CPU in reset while the supply collapses.
+
+  The flash row holds BROWNOUT_SLOTS records of one flash page each (dp_brownout_record.h). At startup the newest
+  valid record is restored, the row is erased and the restored state is written to the first slot again. A dip that
+  the controller survives uses a slot too: when the row is full, run() prepares it again from the loop, like init().
+  (c) 2025 diyPresso - CC-BY-NC
+*/
+#ifndef BROWNOUT_H
+#define BROWNOUT_H
+
+#include <Arduino.h>
+#include "dp_brownout_record.h"
+
+#define BOD33_LEVEL 48          // BOD33 threshold level (48 = ~3.07V)
+
+class BrownOut
+{
+    public:
+        typedef ::brownout_record_t brownout_record_t; // see dp_brownout_record.h
+
+    private:
+        brownout_record_t _last;            // last record restored at startup
+        bool _restored = false;
+        unsigned long _sequence = 0, _runtime = 0;
+        unsigned long _save_time = 0, _erase_time = 0; // [usec] measured flash timing
+        int _slot = 0;                      // next free slot in flash row
+        int _saves = 0, _skipped = 0, _full = 0; // _full: saves refused, no free slot
+        volatile bool _nvm_locked = false;
+        void configure(unsigned long action);
+        void prepare(brownout_cause_t cause);
+        void write(brownout_cause_t cause);
+    public:
+        BrownOut() {};
+        void init();
+        void run();                         // loop: prepares the row again when a dip used the last slot
+        bool save(brownout_cause_t cause);
+        void emergency();
+        void nvm_lock() { _nvm_locked = true; }
+        void nvm_unlock() { _nvm_locked = false; }
+        bool restored() { return _restored; }
+        brownout_record_t *last() { return &_last; }
+        unsigned long runtime() { return _runtime + millis() / 1000; } // [sec] total operating time
+        unsigned long save_time() { return _save_time; }   // [usec] last record write
+        unsigned long erase_time() { return _erase_time; } // [usec] last row erase
+        int saves() { return _saves; }
+        int skipped() { return _skipped; }
+        int full() { return _full; }
+};
+
+extern BrownOut brownOut;
+
+#endif // BROWNOUT_H
@@ -0,0 +1,32 @@
+/*
+  Brown-out record: the critical state saved by the interrupt of the brown-out detector (see dp_brownout.h)
+  (c) 2025 diyPresso - CC-BY-NC
+*/
+#include "dp_brownout_record.h"
+#include "dp_crc.h"
+
+static uint32_t record_crc(const brownout_record_t *r)
+{
+    return dp_crc32((const uint8_t *)r + sizeof(r->crc), sizeof(brownout_record_t) - sizeof(r->crc));
+}
+
+void brownout_seal(brownout_record_t *r)
+{
+    r->magic = BROWNOUT_MAGIC;
+    r->version = BROWNOUT_VERSION;
+    r->crc = record_crc(r);
+}
+
+bool brownout_valid(const brownout_record_t *r)
+{
+    return r->magic == BROWNOUT_MAGIC && r->version == BROWNOUT_VERSION && record_crc(r) == r->crc;
+}
+
+int brownout_newest(const brownout_record_t *slots, int n)
+{
+    int newest = -1;
+    for (int i = 0; i < n; i++)
+        if (brownout_valid(&slots[i]) && (newest < 0 || slots[i].sequence > slots[newest].sequence))
+            newest = i;
+    return newest;
+}
@@ -0,0 +1,49 @@
+/*
+  Brown-out record: the critical state saved by the interrupt of the brown-out detector (see dp_brownout.h)
+  (c) 2025 diyPresso - CC-BY-NC
+
+  A record fills one flash page, BROWNOUT_SLOTS records fill the flash row that is erased at startup. The fields have
+  a fixed size, so the layout on the host is the one in flash; the static_assert checks it. The crc covers all fields
+  after it, with the CRC-32 of the settings (dp_crc.h). A slot is valid with the magic, the version and its crc: an erased
+  slot (all 0xFF) is not. At startup the valid slot with the highest sequence number is restored.
+
+  Portable C++, no Arduino dependencies: the host round-trip test of the record and the flash row is
+  server/brownout_sim.
+*/
+#ifndef BROWNOUT_RECORD_H
+#define BROWNOUT_RECORD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define BROWNOUT_MAGIC 0x64506F77 // "dPow"
+#define BROWNOUT_VERSION 1        // Update this if the record structure changes
+#define BROWNOUT_PAGE_SIZE 64     // SAMD21 flash page size [bytes]
+#define BROWNOUT_ROW_SIZE 256     // SAMD21 flash row (erase unit) size [bytes]
+#define BROWNOUT_SLOTS (BROWNOUT_ROW_SIZE / BROWNOUT_PAGE_SIZE)
+
+typedef enum { BROWNOUT_CAUSE_BOOT, BROWNOUT_CAUSE_POWER, BROWNOUT_CAUSE_RECYCLE } brownout_cause_t;
+
+typedef struct __attribute__((packed)) // exactly one flash page
+{
+    uint32_t crc;      // crc of all the fields after the crc
+    uint32_t magic;
+    uint32_t version;
+    uint32_t sequence; // incremented for every record written
+    uint32_t shotCounter;
+    uint32_t runtime;     // [sec] total operating time
+    double heaterEnergy;  // [Wh]
+    double pumpEnergy;    // [Wh]
+    uint32_t saveTime;    // [usec] duration of the previous flash write
+    uint8_t boilerError, brewError, reservoirError, cause;
+    uint8_t reserved[16];
+} brownout_record_t;
+
+static_assert(sizeof(brownout_record_t) == BROWNOUT_PAGE_SIZE, "brown-out record must fill exactly one flash page");
+static_assert(sizeof(double) == 8, "brown-out record: the energies are 64 bit doubles");
+
+void brownout_seal(brownout_record_t *r);                         // sets the magic, the version and the crc
+bool brownout_valid(const brownout_record_t *r);
+int brownout_newest(const brownout_record_t *slots, int n);       // the slot to restore, -1: none is valid
+
+#endif // BROWNOUT_RECORD_H
@@ -0,0 +1,68 @@
+/*
+ diyPresso minimal CBOR encoder
+ (c) 2025 diyPresso
+ */
+#include <string.h>
+#include "dp_cbor.h"
+
+void CborWriter::put(const uint8_t *data, size_t n)
+{
+  if (!_ok || n > _size - _len)
+  {
+    _ok = false;
+    return;
+  }
+  memcpy(_buf + _len, data, n);
+  _len += n;
+}
+
+// Initial byte with the major type, followed by the value in the shortest form
+void CborWriter::head(uint8_t major, uint64_t value)
+{
+  uint8_t b[9];
+  size_t n;
+  major <<= 5;
+  if (value < 24)
+  {
+    b[0] = major | value;
+    n = 1;
+  }
+  else if (value <= 0xFF)
+  {
+    b[0] = major | 24;
+    n = 2;
+  }
+  else if (value <= 0xFFFF)
+  {
+    b[0] = major | 25;
+    n = 3;
+  }
+  else if (value <= 0xFFFFFFFFUL)
+  {
+    b[0] = major | 26;
+    n = 5;
+  }
+  else
+  {
+    b[0] = major | 27;
+    n = 9;
+  }
+  for (size_t i = n - 1; i > 0; i--, value >>= 8) // big endian
+    b[i] = value & 0xFF;
+  put(b, n);
+}
+
+void CborWriter::integer(int64_t value)
+{
+  if (value >= 0)
+    head(0, value);
+  else
+    head(1, -1 - value);
+}
+
+void CborWriter::text(const char *s)
+{
+  size_t n = strlen(s);
+  head(3, n);
+  put((const uint8_t *)s, n);
+}
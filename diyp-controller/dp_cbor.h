@@ -0,0 +1,39 @@
+/*
+  Minimal CBOR (RFC 8949) encoder into a fixed buffer
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Only the types we need for telemetry: (negative) integers, text, arrays and maps (also of indefinite length).
+  Portable C++, no Arduino dependencies. When the buffer is full further items are ignored and ok() returns false.
+*/
+#ifndef CBOR_H
+#define CBOR_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+class CborWriter
+{
+private:
+  uint8_t *_buf;
+  size_t _size, _len = 0;
+  bool _ok = true;
+  void head(uint8_t major, uint64_t value);
+  void put(const uint8_t *data, size_t n);
+
+public:
+  CborWriter(uint8_t *buf, size_t size) : _buf(buf), _size(size) {};
+  void reset() { _len = 0; _ok = true; }
+  void uinteger(uint64_t value) { head(0, value); }
+  void integer(int64_t value);
+  void text(const char *s);
+  void array(size_t n) { head(4, n); }
+  void map(size_t n) { head(5, n); }
+  void array_begin() { uint8_t b = 0x9F; put(&b, 1); } // indefinite length array, end with end()
+  void end() { uint8_t b = 0xFF; put(&b, 1); }
+  const uint8_t *data() { return _buf; }
+  size_t size() { return _len; }
+  size_t available() { return _size - _len; }
+  bool ok() { return _ok; }
+};
+
+#endif // CBOR_H
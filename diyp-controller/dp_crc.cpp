@@ -0,0 +1,18 @@
+/*
+  CRC-32 (see dp_crc.h)
+  (c) 2025 diyPresso - CC-BY-NC
+*/
+#include "dp_crc.h"
+
+uint32_t dp_crc32(const void *data, size_t n)
+{
+  const uint8_t *s = (const uint8_t *)data;
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < n; i++)
+  {
+    uint8_t ch = s[i];
+    for (int j = 0; j < 8; j++, ch >>= 1)
+      crc = (crc >> 1) ^ ((ch ^ crc) & 1 ? 0xEDB88320 : 0);
+  }
+  return ~crc;
+}
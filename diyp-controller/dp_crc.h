@@ -0,0 +1,16 @@
+/*
+  CRC-32 (IEEE 802.3, the one of zlib) of the settings, the brown-out record and the warm restart state
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Bitwise, without a table: the blocks are small and flash is scarcer than time. Portable C++, no Arduino
+  dependencies: the check value is tested by server/brownout_sim.
+*/
+#ifndef CRC_H
+#define CRC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+uint32_t dp_crc32(const void *data, size_t n);
+
+#endif // CRC_H
@@ -6,8 +6,7 @@
 #include "dp_hardware.h"
 #include "dp_chars.h"
 #include "dp_encoder.h"
-
-#include <math.h>
+#include "dp_lcd_bus.h"
 
 hd44780_I2Cexp lcd(DISPLAY_I2C_ADDRESS,20,4); // address 0x27, 4 lines, 20 chars:
 Display display;
@@ -18,94 +17,64 @@ Display::Display(void)
 }
 
 
-/*
- * show display content, expect 4x20 chars + zero terminator
- * Replace placeholders ('#' chars) with supplied string arguments
- * And display to lcd screen
- * Example screen:
- *
- * char *screen = 
- * "01234567890123456789"
- * "arg0:####  arg1:####"
- * "arg3: ##############"
- * "arg4: ## arg 5: ####"
- *
- */
-void Display::show(const char *screen, char *args[])
+// The display can take a frame: the last one is DISPLAY_FRAME_MSEC ago and off the bus (see dp_lcd_bus.h)
+bool Display::ready()
 {
-  const char *s = screen;
-  char buf[4*21], *d, *a, l[32];
-  bool in_arg = false;
-  int idx=0;
-  d = buf;
-  a = args[idx];
-
-  while( *s )
+  if (millis() - _frame_time < DISPLAY_FRAME_MSEC || lcdBus.busy())
+    return false;
+  if (lcdBus.failed()) // not all of the last frame arrived: rewrite the glass
   {
-    if ( *s != '#' ) // copy source to dest
-    {
-      if ( in_arg )
-      {
-         in_arg = false;
-         idx += 1;
-         a = args[idx];
-      }
-      *d = *s;
-    }
-    else // args
-    {
-      in_arg = true;
-      *d = *a ? *a : ' '; // on end of argument string: pad with spaces
-      if ( *a ) a += 1; // If not end of string, advance one char
-    }
-    s += 1;
-    d += 1;
-  }
-  *d = 0;
-
-  for(int i=0; i<4; i++)
-  {
-    memcpy((void*)l, &buf[20*i], 20);
-    l[20] = 0;
-    lcd.setCursor(0,i);
-    lcd.print(l); // [Done] used to be: slowwwww 27ms for 20 chars > switched to https://github.com/duinoWitchery/hd44780/tree/master
+    _fb.invalidate();
+    _overwritten = true;
   }
+  return true;
 }
 
-void format_float(char *dest, double f, int digits, int len)
+/*
+ * show a rendered screen (see dp_view.h): FB_ROWS x FB_COLS chars, row by row
+ * Only the characters that differ from the glass are sent (see dp_framebuffer.h), in the background (see
+ * dp_lcd_bus.h), after the rows of the custom characters that changed. Call when ready(): the screen is not shown
+ * otherwise, the next one supersedes it.
+ */
+void Display::show(const char *text)
 {
-  bool neg = f < 0;
-  if ( neg ) f *= -1.0;
-  char sign[2] = {'-', 0};
-  if ( !neg )
-    sign[0] = 0;
-  switch( digits )
+  if (!ready())
+    return;
+  _frame_time = millis();
+  _overwritten = false;
+
+  fb_run_t runs[CG_MAX_RUNS + FB_MAX_RUNS];
+  int m = 0;
+  if (_chars_changed)
   {
-    case 1: sprintf(dest, "%s%d.%d", sign, (int)f, (int)fmod(10.0*f,10)); break;
-    case 2: sprintf(dest, "%s%d.%d%d", sign, (int)f, (int)fmod(10.0*f,10),(int)fmod(100.0*f,10)); break;
-    case 3: sprintf(dest, "%s%d.%d%d%d", sign, (int)f, (int)fmod(10.0*f,10),(int)fmod(100.0*f,10),(int)fmod(1000.0*f,10)); break;
-    default: sprintf(dest, "%s%d", sign, (int)f); break;
+    m = _cg.update(_chars, runs);
+    _fb.lost_cursor(); // the address counter is in the CGRAM
+    _chars_changed = false;
   }
-  if ( len ) // right align result to length
+  int n = _fb.update(text, runs + m);
+  if ( !m && !n )
+    return;
+  LcdFrame &frame = lcdBus.frame();
+  frame.clear();
+  for(int i=0; i<m; i++)
   {
-    int org = strlen(dest)-1;
-    dest[len] = 0;
-    for(int i=len-1; i>=0; i--)
-    {
-      if (org >= 0)
-        dest[i] = dest[org--];
-      else
-        dest[i] = ' ';
-    }
-
+    frame.cgram(runs[i].pos);
+    frame.write((const char *)_cg.rows() + runs[i].pos, runs[i].len);
   }
+  for(int i=m; i<m+n; i++)
+  {
+    if ( runs[i].move )
+      frame.cursor(runs[i].col, runs[i].row);
+    frame.write(_fb.glass() + runs[i].pos, runs[i].len);
+  }
+  lcdBus.send(); // [Done] used to be: slowwwww 27ms for 20 chars with lcd.print(), now DMA in the background
 }
 
-// Load custom characters
+// Load custom characters: only the rows that changed go out, with the next frame of show()
 void Display::custom_chars(const unsigned char *chars)
 {
-  for(int i=0; i<8; i++)
-    lcd.createChar(i, (unsigned char*)chars+8*i);
+  memcpy(_chars, chars, CG_SIZE);
+  _chars_changed = memcmp(_chars, _cg.rows(), CG_SIZE) != 0;
 }
 
 
@@ -121,32 +90,30 @@ void Display::init()
   lcd.createChar(5, (unsigned char*)cC5);
   lcd.createChar(6, (unsigned char*)cC6);
   lcd.createChar(7, (unsigned char*)cC7);
+  _fb.invalidate();
+  _cg.invalidate();
   
 #ifdef WIRECLOCK
     Wire.setClock(WIRECLOCK);
 #endif
+  lcdBus.begin();
 
 }
 
 
+void Display::input()
+{
+  _input.drain(inputEvents);
+}
+
 bool Display::button_pressed()
 {
-  static unsigned long prev_count=0;
-  bool pressed = prev_count != encoder.button_count();
-  prev_count = encoder.button_count();
-  return pressed;
+  return _input.presses > 0;
 }
 
 bool Display::button_long_pressed()
 {
-  static unsigned long prev_count=0;
-  bool pressed = prev_count != encoder.button_count();
-  if ( pressed && (encoder.button_time() > 1000) )
-  {
-    prev_count = encoder.button_count();
-    return true;
-  }
-  return false;
+  return _input.long_presses > 0;
 }
 
 int Display::button_pressed_time()
@@ -156,10 +123,7 @@ int Display::button_pressed_time()
 
 bool Display::encoder_changed()
 {
-  static long prev_value=0;
-  bool changed = prev_value != encoder.position();
-  prev_value = encoder.position();
-  return changed;
+  return _input.steps != 0;
 }
 
 long Display::encoder_value()
@@ -168,74 +132,55 @@ long Display::encoder_value()
 }
 
 
-void Display::logo(const char *date, const char*time)
+// Draw the diyPresso logo (uses custom characters 1..7 loaded by init())
+void Display::logo()
 {
-  int textDelay = 1;
+  lcdBus.wait();
+  _fb.invalidate();
+  _overwritten = true;
   lcd.setCursor(8,0);
   lcd.write (1);
-  delay(textDelay);
   lcd.print (" ");
-  delay(textDelay);
   lcd.write (1);
-  delay(textDelay);
   lcd.write (2);
-  delay(textDelay);
   lcd.write (2);
-  delay(textDelay);
   lcd.write (2);
-  delay(textDelay);
   lcd.write (1);
-  delay(textDelay);
 
   lcd.setCursor(8,1);
   lcd.write (1);
-  delay(textDelay);
   lcd.print (" ");
-  delay(textDelay);
   lcd.write (1);
-  delay(textDelay);
   lcd.write (3);
-  delay(textDelay);
   lcd.write (3);
-  delay(textDelay);
   lcd.write (6);
-  delay(textDelay);
   lcd.write (7);
 
   lcd.setCursor(4,2);
-  delay(textDelay);
   lcd.write (4);
-  delay(textDelay);
   lcd.write (5);
-  delay(textDelay);
   lcd.write (2);
-  delay(textDelay);
   lcd.write (2);
-  delay(textDelay);
   lcd.write (1);
-  delay(textDelay);
   lcd.print (" ");
-  delay(textDelay);
   lcd.write (1);
-  delay(textDelay);
 
   lcd.setCursor(4,3);
   lcd.write (1);
-  delay(textDelay);
   lcd.write (3);
-  delay(textDelay);
   lcd.write (3);
-  delay(textDelay);
   lcd.write (3);
-  delay(textDelay);
   lcd.write (1);
-  delay(textDelay);
   lcd.print (" ");
-  delay(textDelay);
   lcd.write (1);
-  delay(textDelay);
+}
 
-  delay(1000);
+// Add the hardware revision, software version and build date to the logo
+void Display::logo_text(const char *date, const char*time)
+{
+  lcdBus.wait();
+  _fb.invalidate();
+  _overwritten = true;
   lcd.setCursor(0,3);
   lcd.print("r" HARDWARE_REVISION);
   lcd.setCursor(20-strlen("v" SOFTWARE_VERSION), 3);
@@ -250,7 +195,4 @@ void Display::logo(const char *date, const char*time)
   lcd.setCursor(2,0);
   lcd.print("!!! TESTING !!!");
 #endif
-
-
-  delay(3000);
 }
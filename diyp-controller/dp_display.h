@@ -9,30 +9,46 @@
 #include <Wire.h>
 #include <hd44780.h>                       // main hd44780 header
 #include <hd44780ioClass/hd44780_I2Cexp.h> // i2c expander i/o class header
+#include "dp_framebuffer.h"
+#include "dp_format.h"
+#include "dp_events.h"
 
 #ifndef WIRECLOCK
 #define WIRECLOCK 400000L
 #endif
 
+#define DISPLAY_FRAME_MSEC 50 // frame rate cap: max one update of the glass per this period [msec]
+
 extern const unsigned char custom_chars_spinner[];
-extern void format_float(char *dest, double f, int digits=0, int len=0);
 
 extern hd44780_I2Cexp lcd; // switched to hd44780 library as it is way faster, espcially with 400kHz I2C clock
 
 class Display
 {
     private:
+        FrameBuffer _fb;               // what is on the glass
+        CharRam _cg;                   // what is in the custom characters
+        uint8_t _chars[CG_SIZE];       // the custom characters for the next frame
+        bool _chars_changed = false;   // _chars differ from the CGRAM
+        unsigned long _frame_time = 0; // [msec] of the last update of the glass
+        bool _overwritten = false;     // the glass is not what show() left: the logo, a failed frame
+        InputFrame _input;             // the input events of this loop
     public:
         Display(void);
         void init();
-        void logo(const char *date, const char *time);
-        void show(const char *screen, char *args[]);
+        void logo();
+        void logo_text(const char *date, const char *time);
+        bool ready();
+        bool overwritten() { return _overwritten || _chars_changed; } // show() the screen again, even when it did not change
+        void show(const char *text);
+        void input();                  // once per loop, at the start: the events for the readers of this loop
+        const InputFrame &input_events() { return _input; }
         bool button_pressed();
         bool button_long_pressed();
         int button_pressed_time();
         bool encoder_changed();
         long encoder_value();
-        void custom_chars(const unsigned char *chars);
+        void custom_chars(const unsigned char *chars); // 8 x 8 rows, sent with the next frame of show()
 };
 
 extern Display display;
@@ -1,68 +1,75 @@
 /*
   Rotary Encoder driver
   (c) 2024 diyEspresso -- CC-BY-NC 
-  Hacky implementation of debounced rotary encoder, working with a periodic timer.
-  This should work on all GPIO pins (no interrupt capability required)
+  Interrupt driven: the EIC calls on every edge of A and B, the decoder (dp_quadrature.h) counts the detents; nothing
+  runs while nobody touches the knob. The switch shares its EXTINT line with A (PA22 and PB22 are both EXTINT[6]), a
+  slow timer samples it and the decoder debounces it and times the press from its edges.
+  The timer interrupt is the producer of the input events (dp_events.h): the detents turned since its last run, the
+  presses, releases and long presses, and the changes of the brew switch that it samples too. It is the only one, the
+  edges of A and B push nothing: the queue needs no lock, whatever the priorities of the EIC and the timer.
+  Both read the pins with FastPin (dp_fastpin.h), the PORT bits of the pins of dp_hardware.h.
   Only one instance supported at the moment (due to one set of global variables and one interrupt handler)
  */
 #include "dp_encoder.h"
 #include "dp_hardware.h"
+#include "dp_quadrature.h"
+#include "dp_brew_switch.h"
+#include "dp_fastpin.h"
 #include "uTimerLib.h"
 
 Encoder encoder(PIN_ENC_A,  PIN_ENC_B, PIN_ENC_S);
 
-volatile static int enc_value=0, enc_button=0, enc_button_count=0, enc_button_time=0;
+typedef FastPin<PIN_ENC_A> EncoderA; // read in the interrupts: the PORT bits, not digitalRead()
+typedef FastPin<PIN_ENC_B> EncoderB;
+typedef FastPin<PIN_ENC_S> EncoderS;
+static_assert(EncoderA::bit == BIT_ENC_A && EncoderB::bit == BIT_ENC_B, "dp_hardware.h: the bits of the encoder");
+
+static QuadratureDecoder decoder;
+EventQueue inputEvents;
+static long pushed_position = 0; // of the events, behind the decoder while the queue is full
+static bool long_pushed = false; // the long press of this press
 volatile static int timer_count = 0;
 static int _pin_a, _pin_b, _pin_s;
 
 
-#define TIMER_PERIOD_US 400 // Timer period [microseconds] (400usec timer = 2.5kHz)
-#define DEGLITCH 2 // Deglitch count value. The degitch time is: 2 * TIMER_PERIOD_US * DEGLITCH
-#define BUTTON_DEGLITCH_BITS 0xFFFFFFF // Set bits that need to be high before we switch back. Deglitch period is: TIMER_PERIOD_US * HIGH_BITS
+#define BUTTON_PERIOD_US 2000 // Switch sample period [microseconds] (500 Hz; all pins were polled at 2.5 kHz)
+#define LONG_PRESS_US 1000000 // [microseconds]
+
+static uint8_t encoder_levels()
+{
+    return (EncoderA::read() ? 1 : 0) | (EncoderB::read() ? 2 : 0);
+}
+
+void encoder_edge_function()
+{
+    decoder.rotate(encoder_levels());
+}
 
 void encoder_timer_function()
 {
-    volatile static unsigned int val=0, cur=0, prev=0, enc_switch=0, enc_prev_button=0;
-    volatile static int afilt=0, bfilt=0;
+    uint32_t now = micros();
     timer_count = (timer_count+1) & 0xFFFF;
 
+    long steps = constrain(decoder.position() - pushed_position, -127, 127);
+    if (steps && inputEvents.push(EVENT_ROTATE, now, steps))
+        pushed_position += steps;
 
-    // button de-glitching and handling
-    enc_switch = (enc_switch<<1) | (digitalRead(_pin_s) ? 0 : 1);
-    enc_button = (enc_switch & BUTTON_DEGLITCH_BITS) == BUTTON_DEGLITCH_BITS ? 1 : 0;
-
-    if ( (enc_button) && (!enc_prev_button) ) // falling edge
-      enc_button_count += 1;
-    enc_prev_button = enc_button;
-    if ( enc_button )
-      enc_button_time += 1;
-    else
-      enc_button_time = 0;
-
-    // encoder de-glitching and handling
-    val = 0;
-    val |=  digitalRead(_pin_a) ? 1 : 0;
-    val |=  digitalRead(_pin_b) ? 2 : 0;
-
-    if (val & 1)
-      afilt += 1;
-    else
-      afilt -= 1;
-    if (afilt > DEGLITCH) { afilt = DEGLITCH; cur |= 1; }
-    if (afilt < -DEGLITCH) { afilt = -DEGLITCH; cur &= 2; }
-
-    if (val & 2)
-      bfilt += 1;
-    else
-      bfilt -= 1;
-    if (bfilt > DEGLITCH) { bfilt = DEGLITCH; cur |= 2; }
-    if (bfilt < -DEGLITCH) { bfilt = -DEGLITCH; cur &= 1; }
-
-    if ( ((prev & 1) == 1) && ((cur & 1) == 0)  )
+    if (decoder.button(!EncoderS::read(), now))
     {
-      enc_value += ( cur & 2 ? -1 : 1 );
+        inputEvents.push(decoder.pressed() ? EVENT_PRESS : EVENT_RELEASE, decoder.edge());
+        long_pushed = false;
     }
-    prev = cur;
+    if (!long_pushed && decoder.press_time(now) >= LONG_PRESS_US)
+        long_pushed = inputEvents.push(EVENT_LONG_PRESS, decoder.edge() + LONG_PRESS_US);
+
+    brewSwitch.sample(now);
+}
+
+// Majority filter of the EIC on the line of a pin: a glitch shorter than 3 samples of the EIC clock is no edge
+static void encoder_filter(int pin)
+{
+    int line = g_APinDescription[pin].ulExtInt;
+    EIC->CONFIG[line / 8].reg |= EIC_CONFIG_FILTEN0 << (4 * (line % 8));
 }
 
 Encoder::Encoder(int pin_a, int pin_b, int pin_s)
@@ -73,12 +80,19 @@ Encoder::Encoder(int pin_a, int pin_b, int pin_s)
 
 void Encoder::start(void)
 {
-    TimerLib.setInterval_us(encoder_timer_function,  TIMER_PERIOD_US );
+    decoder.begin(encoder_levels(), !EncoderS::read(), micros());
+    pushed_position = decoder.position();
+    brewSwitch.begin(micros());
+    attachInterrupt(digitalPinToInterrupt(_pin_a), encoder_edge_function, CHANGE);
+    attachInterrupt(digitalPinToInterrupt(_pin_b), encoder_edge_function, CHANGE);
+    encoder_filter(_pin_a);
+    encoder_filter(_pin_b);
+    TimerLib.setInterval_us(encoder_timer_function,  BUTTON_PERIOD_US );
 }
 
 volatile int Encoder::position()
 {
-    return enc_value;
+    return decoder.position();
 }
 
 volatile int Encoder::loop_count()
@@ -88,19 +102,22 @@ volatile int Encoder::loop_count()
 
 volatile int Encoder::button_count()
 {
-    return enc_button_count;
+    return decoder.presses();
 }
 
 volatile bool Encoder::button_state()
 {
-    return enc_button;
+    return decoder.pressed();
 }
 
 /// @brief Return time the button is pressed
 /// @return  time in msec, zero if raised, counting up while pressed
 volatile int Encoder::button_time()
 {
-    return (enc_button_time*TIMER_PERIOD_US) / 1000;
+    noInterrupts(); // the state and the start of the press
+    uint32_t t = decoder.press_time(micros());
+    interrupts();
+    return t / 1000;
 }
 
 volatile void Encoder::reset()
@@ -112,6 +129,9 @@ volatile void Encoder::reset()
 
 volatile void Encoder::set(int value)
 {
-  enc_value = value;
+  noInterrupts(); // no steps of the events
+  decoder.set(value);
+  pushed_position = value;
+  interrupts();
 }
 
@@ -3,6 +3,7 @@
 #define ENCODER_H
 
 #include <Arduino.h>
+#include "dp_events.h"
 
 class Encoder
 {
@@ -22,5 +23,6 @@ class Encoder
 };
 
 extern Encoder encoder;
+extern EventQueue inputEvents; // the timer interrupt of the encoder pushes, the loop drains (Display::input())
 
 #endif // ENCODER_H
\ No newline at end of file
@@ -0,0 +1,90 @@
+/*
+  Input events: a lock-free queue from the timer interrupt of the encoder to the main loop
+  (c) 2025 diyPresso - CC-BY-NC
+*/
+#include "dp_events.h"
+
+#define EVENT_MASK (EVENT_QUEUE_SIZE - 1)
+
+bool EventQueue::push(uint8_t type, uint32_t time, int8_t steps)
+{
+  uint8_t head = _head.load(std::memory_order_relaxed);
+  if ((uint8_t)(head - _tail.load(std::memory_order_acquire)) == EVENT_QUEUE_SIZE) // the slot is not read yet
+  {
+    _dropped.store(_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return false;
+  }
+  input_event_t &event = _events[head & EVENT_MASK];
+  event.time = time;
+  event.type = type;
+  event.steps = steps;
+  _head.store(head + 1, std::memory_order_release); // publishes the event
+  return true;
+}
+
+bool EventQueue::pop(input_event_t *event)
+{
+  uint8_t tail = _tail.load(std::memory_order_relaxed);
+  if (tail == _head.load(std::memory_order_acquire))
+    return false;
+  *event = _events[tail & EVENT_MASK];
+  _tail.store(tail + 1, std::memory_order_release); // frees the slot
+  return true;
+}
+
+int EventQueue::count() const
+{
+  return (uint8_t)(_head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire));
+}
+
+int InputFrame::drain(EventQueue &queue)
+{
+  input_event_t event;
+  int n = 0;
+  steps = 0;
+  presses = releases = long_presses = brew_changes = 0;
+  while (queue.pop(&event))
+  {
+    n++;
+    switch (event.type)
+    {
+    case EVENT_ROTATE:
+      steps += event.steps;
+      break;
+    case EVENT_PRESS:
+      presses++;
+      press_time = event.time;
+      break;
+    case EVENT_RELEASE:
+      releases++;
+      break;
+    case EVENT_LONG_PRESS:
+      long_presses++;
+      break;
+    case EVENT_BREW_UP:
+    case EVENT_BREW_DOWN:
+      brew_changes++;
+      brew_up = event.type == EVENT_BREW_UP;
+      brew_time = event.time;
+      break;
+    }
+  }
+  return n;
+}
+
+bool Debouncer::update(bool level, uint32_t now)
+{
+  bool changed = false;
+  if (_level != _state && now - _edge >= _usec) // the level settled since it changed
+  {
+    _state = _level;
+    _since = _edge;
+    changed = true;
+  }
+  if (level != _level)
+  {
+    _level = level;
+    _edge = now;
+  }
+  return changed;
+}
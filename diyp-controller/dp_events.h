@@ -0,0 +1,91 @@
+/*
+  Input events: a lock-free queue from the timer interrupt of the encoder to the main loop
+  (c) 2025 diyPresso - CC-BY-NC
+
+  The interrupt is the only producer: it turns the detents of the encoder, the presses of its switch and the changes
+  of the brew switch into events, stamped with micros() of the edge they began with (not of the loop that reads them).
+  The loop is the only consumer: it drains the queue once, at its start, into an InputFrame that the menus and the
+  brew process read. An event is seen by every reader of that loop and by none of the next: nothing needs to be
+  "consumed" by hand, a press is never handled twice nor lost between two readers.
+
+  EventQueue is a ring of EVENT_QUEUE_SIZE events with one index per side: the producer only stores the head, the
+  consumer only stores the tail. The event is written before the head is released, read before the tail is: no
+  interrupt is disabled and neither side waits. A full queue drops the new event and counts it.
+
+  Debouncer takes the level of a contact with a timestamp, at its changes and when sampled: a level counts once it
+  was stable for the debounce time, and starts at the edge it began with.
+
+  Portable C++, no Arduino dependencies: the host test of the queue under interleavings is server/event_sim.
+*/
+#ifndef EVENTS_H
+#define EVENTS_H
+
+#include <stdint.h>
+#include <atomic>
+
+#define EVENT_QUEUE_SIZE 32 // a power of 2, at most 128: the indexes are free running bytes
+
+typedef enum
+{
+  EVENT_NONE = 0,
+  EVENT_ROTATE,     // steps: detents, + is up
+  EVENT_PRESS,      // the switch of the encoder, debounced
+  EVENT_RELEASE,
+  EVENT_LONG_PRESS, // held for the long press time, once per press
+  EVENT_BREW_UP,    // the brew switch, debounced: open (brewing)
+  EVENT_BREW_DOWN   // closed
+} event_type_t;
+
+typedef struct
+{
+  uint32_t time; // [usec] micros() of the edge
+  uint8_t type;  // event_type_t
+  int8_t steps;  // EVENT_ROTATE
+} input_event_t;
+
+class EventQueue
+{
+private:
+  input_event_t _events[EVENT_QUEUE_SIZE];
+  std::atomic<uint8_t> _head{0}; // the next to write: stored by the producer only
+  std::atomic<uint8_t> _tail{0}; // the next to read: stored by the consumer only
+  std::atomic<uint32_t> _dropped{0};
+
+public:
+  bool push(uint8_t type, uint32_t time, int8_t steps = 0); // producer, false: full, dropped
+  bool pop(input_event_t *event);                            // consumer, false: empty
+  int count() const;
+  uint32_t dropped() const { return _dropped.load(std::memory_order_relaxed); }
+};
+
+// The events of one loop: the counters start at zero with every drain(), the brew switch keeps its last change
+class InputFrame
+{
+public:
+  int steps = 0; // detents turned
+  uint8_t presses = 0, releases = 0, long_presses = 0;
+  uint8_t brew_changes = 0;
+  bool brew_up = true;     // the last change of the brew switch
+  uint32_t brew_time = 0;  // [usec] of it
+  uint32_t press_time = 0; // [usec] of the last press
+  int drain(EventQueue &queue); // the number of events
+};
+
+class Debouncer
+{
+private:
+  uint32_t _usec;               // the level is stable for this long
+  bool _level = false;          // the last sample
+  volatile bool _state = false; // debounced
+  uint32_t _edge = 0;           // [usec] the last change of the level
+  volatile uint32_t _since = 0; // [usec] start of the state: the edge it began with
+
+public:
+  Debouncer(uint32_t usec) : _usec(usec) {}
+  void begin(bool level, uint32_t now) { _level = _state = level, _edge = _since = now; }
+  bool update(bool level, uint32_t now); // true: the state changed
+  bool state() const { return _state; }
+  uint32_t since() const { return _since; }
+};
+
+#endif // EVENTS_H
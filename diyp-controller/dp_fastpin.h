@@ -0,0 +1,69 @@
+/*
+  Compile-time GPIO: the PORT group and bit of a pin resolved by the compiler
+  (c) 2025 diyPresso - CC-BY-NC
+
+  digitalWrite() and digitalRead() of the SAMD core look the pin up in g_APinDescription (in flash) at every call,
+  check its type and, for a write, whether it is an output (else the write sets the pull-up). FastPin<pin> takes the
+  group and the mask from a constexpr copy of the pin table of the MKR boards: a write inlines to one store in OUTSET
+  or OUTCLR through the IOBUS (single cycle), a read to one load of IN (through the APB: the IOBUS reads IN only with
+  continuous sampling on). pinMode() still configures the pin, once, through the core.
+
+  Without ARDUINO_ARCH_SAMD (the host) a pin is an entry of FastPinHost: the writes set the level and are counted,
+  the test sets the level of the inputs. The host test and benchmark is server/gpio_bench.
+*/
+#ifndef FASTPIN_H
+#define FASTPIN_H
+
+#include <stdint.h>
+#ifdef ARDUINO_ARCH_SAMD
+#include <Arduino.h>
+#endif
+
+#define FASTPIN_PINS 15 // D0..D14
+#define FASTPIN_PB 0x20 // group B
+
+// Group and bit of D0..D14 of the MKR boards (variants/mkrwifi1010/variant.cpp of the SAMD core)
+static constexpr uint8_t fastpin_map[FASTPIN_PINS] = {
+    22, 23, 10, 11, FASTPIN_PB | 10, FASTPIN_PB | 11, 20, 21, 16, 17, 19, 8, 9, FASTPIN_PB | 23, FASTPIN_PB | 22};
+
+#ifndef ARDUINO_ARCH_SAMD
+struct FastPinHost
+{
+  bool output[FASTPIN_PINS]; // pinMode(OUTPUT)
+  bool level[FASTPIN_PINS];  // of the last write, or set by the test
+  unsigned long writes[FASTPIN_PINS];
+};
+
+inline FastPinHost &fastpin_host()
+{
+  static FastPinHost host = FastPinHost();
+  return host;
+}
+#endif
+
+template <uint8_t PIN> class FastPin
+{
+  static_assert(PIN < FASTPIN_PINS, "FastPin: the pin is not in fastpin_map");
+
+public:
+  static constexpr uint8_t group = fastpin_map[PIN] >> 5;
+  static constexpr uint8_t bit = fastpin_map[PIN] & 31;
+  static constexpr uint32_t mask = 1UL << bit;
+
+#ifdef ARDUINO_ARCH_SAMD
+  static void output() { pinMode(PIN, OUTPUT); }
+  static void input_pullup() { pinMode(PIN, INPUT_PULLUP); }
+  static void high() { PORT_IOBUS->Group[group].OUTSET.reg = mask; }
+  static void low() { PORT_IOBUS->Group[group].OUTCLR.reg = mask; }
+  static bool read() { return PORT->Group[group].IN.reg & mask; }
+#else
+  static void output() { fastpin_host().output[PIN] = true; }
+  static void input_pullup() { fastpin_host().level[PIN] = true; }
+  static void high() { fastpin_host().level[PIN] = true, fastpin_host().writes[PIN]++; }
+  static void low() { fastpin_host().level[PIN] = false, fastpin_host().writes[PIN]++; }
+  static bool read() { return fastpin_host().level[PIN]; }
+#endif
+  static void write(bool level) { level ? high() : low(); }
+};
+
+#endif // FASTPIN_H
@@ -0,0 +1,130 @@
+/*
+  Numbers to text for the menus, the serial interface and MQTT
+  (c) 2025 diyPresso - CC-BY-NC
+*/
+#include <math.h>
+#include "dp_format.h"
+
+static const unsigned long scale[FORMAT_MAX_DECIMALS + 1] = {1, 10, 100, 1000};
+
+// Right aligned in len: spaces, sign, the digits of value with the point before the last decimals
+static int emit(char *dest, unsigned long value, bool neg, int decimals, int len)
+{
+  char digits[3 * sizeof(value) + 1]; // reversed
+  int n = 0;
+  do
+  {
+    digits[n++] = '0' + value % 10;
+    value /= 10;
+  } while (value || n <= decimals);
+  int size = n + (decimals > 0) + neg, i = 0;
+  while (i < len - size)
+    dest[i++] = ' ';
+  if (neg)
+    dest[i++] = '-';
+  while (n)
+  {
+    if (n-- == decimals)
+      dest[i++] = '.';
+    dest[i++] = digits[n];
+  }
+  dest[i] = 0;
+  return i;
+}
+
+int format_fixed(char *dest, long value, int decimals, int len)
+{
+  if (decimals < 0)
+    decimals = 0;
+  if (decimals > 9) // the digits of a 32 bit long
+    decimals = 9;
+  unsigned long v = value < 0 ? 0UL - (unsigned long)value : (unsigned long)value;
+  return emit(dest, v, value < 0, decimals, len);
+}
+
+// f >= 0 in 10^-decimals units, rounded to nearest, ties to even; false: out of range, inf or nan
+static bool round_units(double f, int decimals, unsigned long *units)
+{
+  double s = scale[decimals];
+  if (!(f * s < 4294967295.0))
+    return false;
+  // f * s rounds, which moves values next to a tie across it: split f in halves of 26 bits (Veltkamp), the
+  // products with s (max 10 bits) are exact and the fraction h + l - v is compared with 0 and 1/2 without rounding
+  double c = 134217729.0 * f, hi = c - (c - f), lo = f - hi;
+  double h = hi * s, l = lo * s;
+  unsigned long v = (unsigned long)(h + l);
+  double r = h - v; // exact
+  if (r < -l)       // h + l rounded up to the next integer
+    v--, r += 1;
+  r -= 0.5;
+  if (r > -l || (r == -l && (v & 1)))
+    v++;
+  *units = v;
+  return true;
+}
+
+static int clamp_decimals(int decimals)
+{
+  return decimals < 0 ? 0 : decimals > FORMAT_MAX_DECIMALS ? FORMAT_MAX_DECIMALS : decimals;
+}
+
+int format_float(char *dest, double f, int decimals, int len)
+{
+  decimals = clamp_decimals(decimals);
+  bool neg = f < 0;
+  unsigned long v;
+  if (!round_units(neg ? -f : f, decimals, &v))
+  {
+    int i = 0;
+    do
+      dest[i++] = '*';
+    while (i < len);
+    dest[i] = 0;
+    return i;
+  }
+  return emit(dest, v, neg && v, decimals, len);
+}
+
+double round_float(double f, int decimals)
+{
+  decimals = clamp_decimals(decimals);
+  unsigned long v;
+  if (!round_units(f < 0 ? -f : f, decimals, &v))
+    return NAN;
+  return f < 0 ? -(double)v : (double)v;
+}
+
+int parse_float(const char *s, double *f)
+{
+  static const double exact = 1e15; // mantissa without rounding, powers of ten are exact up to 10^22
+  const char *p = s;
+  bool neg = *p == '-';
+  if (*p == '-' || *p == '+')
+    p++;
+  double m = 0;
+  int exp = 0, digits = 0;
+  bool point = false;
+  for (;; p++)
+  {
+    if (*p == '.' && !point)
+      point = true;
+    else if (*p >= '0' && *p <= '9')
+    {
+      digits++;
+      if (m < exact)
+        m = m * 10 + (*p - '0'), exp -= point;
+      else
+        exp += !point;
+    }
+    else
+      break;
+  }
+  if (!digits)
+    return 0;
+  double scale = 1;
+  for (int e = exp < 0 ? -exp : exp; e > 0; e--)
+    scale *= 10;
+  m = exp < 0 ? m / scale : m * scale;
+  *f = neg ? -m : m;
+  return p - s;
+}
@@ -0,0 +1,27 @@
+/*
+  Numbers to text for the menus, the serial interface and MQTT
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Fixed point: format_float() scales the value to an integer of 10^-decimals units and rounds it exactly like
+  printf("%.*f") (to nearest, ties to even), format_fixed() takes such an integer directly (e.g. the telemetry
+  fields). The digits come from integer division, no sprintf(), no fmod(), no heap. Differences with printf("%*.*f"):
+  a value that rounds to zero has no sign ("0.0", not "-0.0"), and a value out of range (beyond 2^32 units, inf,
+  nan) is a field of '*'. A result longer than len is not cut. round_float() gives the integer format_float() shows,
+  to see whether a value changed at the shown precision without formatting it.
+  parse_float() is the way back for the serial interface: a decimal number without exponent, no strtod() (which
+  allocates on newlib). Up to 15 significant digits the result is the nearest double, like the compiler's.
+
+  Portable C++, no Arduino dependencies: the host test and benchmark is server/format_bench.
+*/
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#define FORMAT_MAX_DECIMALS 3
+#define FORMAT_CHARS 13 // size of dest without alignment (32 bit long): sign, 10 digits, point and terminator
+
+extern int format_fixed(char *dest, long value, int decimals = 0, int len = 0); // value [10^-decimals], returns strlen
+extern int format_float(char *dest, double f, int decimals = 0, int len = 0);   // decimals 0..3, returns strlen
+extern double round_float(double f, int decimals);                              // format_float() in units, NAN: out of range
+extern int parse_float(const char *s, double *f); // returns the characters used, 0: no number
+
+#endif // FORMAT_H
@@ -0,0 +1,88 @@
+/*
+  Shadow framebuffer of the 4x20 character LCD
+  (c) 2025 diyPresso - CC-BY-NC
+*/
+#include <string.h>
+#include "dp_framebuffer.h"
+
+static const uint8_t ddram_rows[FB_ROWS] = {0, 2, 1, 3}; // rows in the order of the display memory
+
+void FrameBuffer::invalidate()
+{
+  memset(_glass, 0, sizeof(_glass));
+  _cursor = -1;
+}
+
+// Collect the changed characters of a screen in runs and take the screen as what is on the glass
+int FrameBuffer::update(const char *screen, fb_run_t *runs)
+{
+  int n = 0, start = -1, end = -1; // the open run [start, end)
+  for (int pos = 0; pos <= FB_SIZE; pos++)
+  {
+    if (pos < FB_SIZE)
+    {
+      int row = ddram_rows[pos / FB_COLS], col = pos % FB_COLS;
+      char c = screen[row * FB_COLS + col];
+      if (c == _glass[pos])
+        continue;
+      _glass[pos] = c;
+      if (start >= 0 && pos - end <= FB_MERGE_GAP) // cheaper to rewrite the gap than to move the cursor
+      {
+        end = pos + 1;
+        continue;
+      }
+    }
+    if (start >= 0)
+    {
+      fb_run_t &run = runs[n++];
+      run.pos = start;
+      run.len = end - start;
+      run.move = start != _cursor;
+      run.row = ddram_rows[start / FB_COLS];
+      run.col = start % FB_COLS;
+      _cursor = end % FB_SIZE; // the address wraps from the end of row 3 to the start of row 0
+    }
+    start = pos;
+    end = pos + 1;
+  }
+  return n;
+}
+
+void CharRam::invalidate()
+{
+  memset(_rows, 0xFF, sizeof(_rows));
+}
+
+// Collect the changed rows of the custom characters in runs and take them as what is in the CGRAM. The address
+// counter is shared with the DDRAM: every run sets it, the screen after it moves the cursor (lost_cursor()).
+int CharRam::update(const uint8_t *chars, fb_run_t *runs)
+{
+  int n = 0, start = -1, end = -1; // the open run [start, end)
+  for (int pos = 0; pos <= CG_SIZE; pos++)
+  {
+    if (pos < CG_SIZE)
+    {
+      uint8_t row = chars[pos] & 0x1F;
+      if (row == _rows[pos])
+        continue;
+      _rows[pos] = row;
+      if (start >= 0 && pos - end <= FB_MERGE_GAP)
+      {
+        end = pos + 1;
+        continue;
+      }
+    }
+    if (start >= 0)
+    {
+      fb_run_t &run = runs[n++];
+      run.pos = start;
+      run.len = end - start;
+      run.move = true;
+      run.row = start / 8; // the character
+      run.col = start % 8; // its row
+    }
+    start = pos;
+    end = pos + 1;
+  }
+  return n;
+}
@@ -0,0 +1,64 @@
+/*
+  Shadow framebuffer of the 4x20 character LCD
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Holds what is on the glass, so a new screen only sends the characters that changed. The changes are collected in
+  runs in the order of the display memory (DDRAM): rows 0, 2, 1, 3, which are consecutive addresses; the HD44780
+  increments the address after every character, also from the end of a row to the start of the next one in that
+  order. A run only needs a cursor move when it does not start where the previous write left the cursor, and an
+  unchanged character between two changes is rewritten: that costs the same as the cursor command it saves.
+
+  CharRam does the same for the 8 custom characters (CGRAM, 8 rows of 5 pixels each, consecutive addresses): a
+  graph that changes a few columns only sends the rows that changed.
+
+  Portable C++, no Arduino dependencies: the caller writes the runs to the LCD.
+*/
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <stdint.h>
+
+#define FB_ROWS 4
+#define FB_COLS 20
+#define FB_SIZE (FB_ROWS * FB_COLS)
+#define FB_MERGE_GAP 1 // max unchanged characters rewritten between two changes
+#define FB_MAX_RUNS (FB_SIZE / (FB_MERGE_GAP + 2) + 1)
+#define CG_CHARS 8
+#define CG_SIZE (CG_CHARS * 8) // rows of the custom characters
+#define CG_MAX_RUNS (CG_SIZE / (FB_MERGE_GAP + 2) + 1)
+
+typedef struct
+{
+  uint8_t pos;      // start in DDRAM order, see glass(); CharRam: the CGRAM address
+  uint8_t len;      // characters
+  bool move;        // set the cursor first
+  uint8_t row, col; // of the start
+} fb_run_t;
+
+class FrameBuffer
+{
+private:
+  char _glass[FB_SIZE]; // in DDRAM order, 0: unknown (never part of a screen, it ends a string)
+  int _cursor = -1;     // position of the cursor in DDRAM order, -1: unknown
+
+public:
+  FrameBuffer() { invalidate(); }
+  void invalidate();                   // the glass was written directly (e.g. the logo) or cleared
+  void lost_cursor() { _cursor = -1; } // the cursor was moved, e.g. by loading custom characters
+  int update(const char *screen, fb_run_t *runs); // screen: FB_ROWS * FB_COLS chars, row by row; returns the runs
+  const char *glass() { return _glass; }
+};
+
+class CharRam
+{
+private:
+  uint8_t _rows[CG_SIZE]; // what is in the CGRAM, 0xFF: unknown
+
+public:
+  CharRam() { invalidate(); }
+  void invalidate();                                // the CGRAM was written directly (createChar)
+  int update(const uint8_t *chars, fb_run_t *runs); // chars: CG_CHARS x 8 rows; returns the runs, each sets the address
+  const uint8_t *rows() { return _rows; }
+};
+
+#endif // FRAMEBUFFER_H
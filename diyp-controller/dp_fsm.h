@@ -68,7 +68,7 @@ class StateMachine
             _prev_state = &StateMachine::state_none;
         }
         bool in_state(state_function_ptr state) { return _cur_state == state; }
-        bool run() { run(0); }
+        bool run() { return run(0); }
         bool run(int msg)
         {
             _message = msg;
@@ -90,6 +90,7 @@ class StateMachine
 #endif // _DP_FSM_H
 
 // Some convenient macros (note: set _DP_FSM_TYPE to the Class name of your state machine before including <dp_fsm.h> header to use them)
+// Every state machine header sets it: #undef it first, and include the header of the class last in its .cpp
 #define STATE(state) (&_DP_FSM_TYPE::state)
 #define IN_STATE(state) (in_state(STATE(state_ ##state)))
 
@@ -103,4 +104,7 @@ class StateMachine
 // Handy macro to be used in get_state_name() implementation
 #define RETURN_STATE_NAME(state) if (IN_STATE(state)) return #state;
 #define RETURN_NONE_STATE_NAME() if (IN_STATE(none)) return "<none>";
-#define RETURN_UNKNOWN_STATE_NAME() return  "<unknown>";
\ No newline at end of file
+#define RETURN_UNKNOWN_STATE_NAME() return  "<unknown>";
+
+// Handy macro to map states on an enumeration, e.g. to store a state as a number
+#define RETURN_STATE_ID(state, id) if (IN_STATE(state)) return id;
\ No newline at end of file
@@ -11,6 +11,10 @@
 #define PIN_SSR_PUMP 2
 #define PIN_SSR_HEATER 3
 
+// Rated power of the mains loads, used for energy accounting
+#define HEATER_RATED_POWER 1000.0 // [W] nominal power of the boiler heater element
+#define PUMP_RATED_POWER 48.0     // [W] nominal power of the vibration pump
+
 // HX711
 #define PIN_HX711_CLK 4
 #define PIN_HX711_DAT 5
@@ -28,6 +32,12 @@
 #define PIN_SDA 11
 #define PIN_SCL 12
 #define DISPLAY_I2C_ADDRESS 0x27
+#define DISPLAY_SERCOM SERCOM0 // the SERCOM of Wire on pins 11/12 (PERIPH_WIRE)
+#define DISPLAY_SERCOM_DMAC_ID_TX SERCOM0_DMAC_ID_TX
+#define DISPLAY_DMA_CHANNEL 0
+#define DISPLAY_PCF_RS 0x01 // PCF8574 bits of the LCD backpack, D4..D7 on P4..P7
+#define DISPLAY_PCF_EN 0x04
+#define DISPLAY_PCF_BL 0x08
 
 // ENCODER
 #define PIN_ENC_A 14  // pin nr
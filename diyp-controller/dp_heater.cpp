@@ -3,6 +3,8 @@
 */
 #include "dp_heater.h"
 #include "dp_time.h"
+#include "dp_pump.h"
+#include "dp_arbiter.h"
 
 #define LPF_FACTOR 0.01   // Low pass filter coefficient. Smaller is lower bandwidth
 
@@ -15,23 +17,32 @@ TODO: Remove float calculations from loop
 
 void HeaterDevice::control(void)
 {
-  unsigned long on_period = (_power/100.0) * _pwm_period;
   unsigned long delta = usec_since(_time);
+  double want = min(_power, _limit);
+  unsigned long on_period = (want/100.0) * _pwm_period;
+
+  if ( _on ) // the SSR state of the previous call was active during delta
+    _energy += HEATER_RATED_POWER * delta / 1E6;
 
   _period += delta;  
   if ( _period >= _pwm_period )
     _period -= _pwm_period;
-  if ( _period < on_period )
+  bool pwm = _period < on_period;
+  bool on = powerArbiter.heater(want, pwm, pumpDevice.is_on(), pumpDevice.on_time(), delta);
+  _output = on == pwm ? want : on ? 100.0 : 0.0; // cut or repaid by the arbiter
+  if ( on )
   {
-    digitalWrite(PIN_SSR_HEATER, HIGH); 
+    HeaterSsr::high();
+    if ( !_first_on )
+      _first_on = max(millis(), 1UL);
     _on=true;
   }
   else
   {
-    digitalWrite(PIN_SSR_HEATER, LOW); 
+    HeaterSsr::low();
     _on=false;
   }
-  _average = LPF_FACTOR * _power + (1.0-LPF_FACTOR) * _average; //TODO: need delta in here
+  _average = LPF_FACTOR * _output + (1.0-LPF_FACTOR) * _average; //TODO: need delta in here
   if ( delta ) // update time if not zero
     _time = micros();
 }
@@ -6,24 +6,36 @@
 #define HEATER_H
 #include <Arduino.h>
 #include "dp_hardware.h"
-#include "dp_led.h"
+#include "dp_fastpin.h"
+
+typedef FastPin<PIN_SSR_HEATER> HeaterSsr;
 
 class HeaterDevice
 {
     private:
         double _power=0.0, _average=0.0; // [0..100%]
+        double _limit=100.0; // [0..100%] max power, set by the power budget (see dp_power.h)
+        double _output=0.0; // [0..100%] delivered power, after the arbitration with the pump (see dp_arbiter.h)
+        double _energy=0.0; // [J] energy delivered by the heater element
+        unsigned long _first_on=0; // [msec] time the SSR was switched on for the first time, 0=not yet
         unsigned long _pwm_period = 1000000, _time=0, _period=0; // microsec, default PWM = 1 sec]
         bool _on = false;
     public:
-        HeaterDevice() { pinMode(PIN_SSR_HEATER, OUTPUT); off();  }
+        HeaterDevice() { HeaterSsr::output(); off();  }
         void control(void); // control PWM output
         void pwm_period(double t) { _pwm_period =  min(1E7, max(1E5, t*1E6)); control(); } // set pwm period in [sec] between 0.1 and 10.0 sec
         void on(void) { _power = 100.0; control();  } // sets power to 100%, not really an on switch
         void off(void) { _power = 0.0; control();  } // sets power to 0%, not really an off switch
         void power(double p) { _power = min(100, max(p, 0)); control(); }
-        double power() { return _power; }
+        double power() { return _power; } // requested power [%]
+        void limit(double p) { _limit = min(100, max(p, 0)); }
+        double limit() { return _limit; }
+        double output() { return _output; } // delivered power [%]
         double average() { return _average; }
+        double energy() { return _energy / 3600.0; } // consumed energy in [Wh]
+        void energy(double wh) { _energy = wh * 3600.0; } // restore energy counter [Wh]
         bool is_on(void) { return _on; }
+        unsigned long first_on() { return _first_on; } // time to first heater on since power-on [msec]
         double pwm_period() { return _pwm_period / 1E6; } // actual PWM period in [sec]
 };
 
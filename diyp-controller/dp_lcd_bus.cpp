@@ -0,0 +1,161 @@
+/*
+  Asynchronous I2C transport of the LCD: DMA to the SERCOM of Wire
+  (c) 2025 diyPresso - CC-BY-NC
+*/
+#include "dp.h"
+#include <Wire.h>
+#include "dp_lcd_bus.h"
+
+LcdBus lcdBus = LcdBus();
+
+// The descriptor of the channel and its write back, the DMAC finds them by channel number
+static DmacDescriptor dma_descriptors[DISPLAY_DMA_CHANNEL + 1] __attribute__((aligned(16)));
+static DmacDescriptor dma_writeback[DISPLAY_DMA_CHANNEL + 1] __attribute__((aligned(16)));
+static DmacDescriptor *descriptors = NULL; // the table of the DMAC (BASEADDR): ours, or of the driver that enabled it
+
+// BASEADDR and WRBADDR can only be written while the DMAC is disabled. When another driver enabled it, its table is
+// used, if the channel is free in it. Otherwise the frames go out through Wire.
+void LcdBus::begin()
+{
+  PM->AHBMASK.reg |= PM_AHBMASK_DMAC;
+  PM->APBBMASK.reg |= PM_APBBMASK_DMAC;
+  _status = LCD_BUS_IDLE;
+  if (!DMAC->CTRL.bit.DMAENABLE)
+  {
+    DMAC->BASEADDR.reg = (uint32_t)dma_descriptors;
+    DMAC->WRBADDR.reg = (uint32_t)dma_writeback;
+    DMAC->CTRL.reg = DMAC_CTRL_DMAENABLE | DMAC_CTRL_LVLEN(0xF);
+  }
+  descriptors = (DmacDescriptor *)DMAC->BASEADDR.reg;
+  DMAC->CHID.reg = DMAC_CHID_ID(DISPLAY_DMA_CHANNEL);
+  _dma = descriptors == dma_descriptors ||
+         (descriptors && !DMAC->CHCTRLA.bit.ENABLE && !descriptors[DISPLAY_DMA_CHANNEL].BTCTRL.bit.VALID);
+  if (!_dma)
+  {
+    Serial.print("* Display: DMA channel "); Serial.print(DISPLAY_DMA_CHANNEL);
+    Serial.println(" is in use, the LCD is written through Wire (blocking)");
+    return;
+  }
+  DMAC->CHCTRLA.reg &= ~DMAC_CHCTRLA_ENABLE;
+  DMAC->CHCTRLA.reg = DMAC_CHCTRLA_SWRST;
+  while (DMAC->CHCTRLA.reg & DMAC_CHCTRLA_SWRST)
+    ;
+  // a beat (byte) every time the master is ready for the next byte on the bus
+  DMAC->CHCTRLB.reg = DMAC_CHCTRLB_LVL(0) | DMAC_CHCTRLB_TRIGSRC(DISPLAY_SERCOM_DMAC_ID_TX) | DMAC_CHCTRLB_TRIGACT_BEAT;
+}
+
+// Next transaction of the frame: the address, then the DMA feeds DATA
+void LcdBus::start()
+{
+  Sercom *sercom = DISPLAY_SERCOM;
+  _chunk = _frame.length() - _sent;
+  if (_chunk > LCD_BUS_CHUNK)
+    _chunk = LCD_BUS_CHUNK;
+  DmacDescriptor &d = descriptors[DISPLAY_DMA_CHANNEL];
+  d.BTCTRL.reg = DMAC_BTCTRL_VALID | DMAC_BTCTRL_BEATSIZE_BYTE | DMAC_BTCTRL_SRCINC | DMAC_BTCTRL_BLOCKACT_NOACT;
+  d.BTCNT.reg = _chunk;
+  d.SRCADDR.reg = (uint32_t)(_frame.bytes() + _sent + _chunk); // the end, when the source increments
+  d.DSTADDR.reg = (uint32_t)&sercom->I2CM.DATA.reg;
+  d.DESCADDR.reg = 0;
+  DMAC->CHID.reg = DMAC_CHID_ID(DISPLAY_DMA_CHANNEL);
+  DMAC->CHCTRLA.reg |= DMAC_CHCTRLA_ENABLE;
+  sercom->I2CM.ADDR.reg = SERCOM_I2CM_ADDR_ADDR(DISPLAY_I2C_ADDRESS << 1) | SERCOM_I2CM_ADDR_LENEN |
+                          SERCOM_I2CM_ADDR_LEN(_chunk);
+  while (sercom->I2CM.SYNCBUSY.bit.SYSOP)
+    ;
+}
+
+// Stop the DMA and release the bus
+void LcdBus::abort()
+{
+  Sercom *sercom = DISPLAY_SERCOM;
+  DMAC->CHID.reg = DMAC_CHID_ID(DISPLAY_DMA_CHANNEL);
+  DMAC->CHCTRLA.reg &= ~DMAC_CHCTRLA_ENABLE;
+  sercom->I2CM.CTRLB.bit.CMD = 3; // STOP
+  while (sercom->I2CM.SYNCBUSY.bit.SYSOP)
+    ;
+  sercom->I2CM.INTFLAG.reg = SERCOM_I2CM_INTFLAG_ERROR;
+  sercom->I2CM.STATUS.reg = SERCOM_I2CM_STATUS_BUSERR | SERCOM_I2CM_STATUS_ARBLOST;
+  _status = LCD_BUS_ERROR;
+}
+
+// Without the DMA the frame is written by Wire, send() returns when it is out (max 20 msec)
+void LcdBus::write()
+{
+  for (; _sent < _frame.length(); _sent += _chunk)
+  {
+    _chunk = _frame.length() - _sent;
+    if (_chunk > LCD_BUS_CHUNK)
+      _chunk = LCD_BUS_CHUNK;
+    Wire.beginTransmission(DISPLAY_I2C_ADDRESS);
+    Wire.write(_frame.bytes() + _sent, _chunk);
+    if (Wire.endTransmission() != 0)
+    {
+      _status = LCD_BUS_ERROR;
+      return;
+    }
+  }
+}
+
+void LcdBus::send()
+{
+  _sent = 0;
+  _start = millis();
+  if (!_frame.length())
+    return;
+  if (!_dma)
+  {
+    write();
+    return;
+  }
+  _status = LCD_BUS_BUSY;
+  start();
+}
+
+bool LcdBus::busy()
+{
+  if (_status != LCD_BUS_BUSY)
+    return false;
+  Sercom *sercom = DISPLAY_SERCOM;
+  if (sercom->I2CM.INTFLAG.bit.ERROR || sercom->I2CM.STATUS.bit.RXNACK)
+  {
+    abort(); // display gone or disturbed: Display::show() rewrites the glass
+    return false;
+  }
+  DMAC->CHID.reg = DMAC_CHID_ID(DISPLAY_DMA_CHANNEL);
+  if (DMAC->CHCTRLA.bit.ENABLE || !sercom->I2CM.INTFLAG.bit.MB) // bytes left, or the last one is on the bus
+  {
+    if (millis() - _start > LCD_BUS_TIMEOUT_MSEC)
+      abort();
+    return _status == LCD_BUS_BUSY;
+  }
+  if (sercom->I2CM.STATUS.bit.BUSSTATE == 2) // owner: not stopped by the length counter
+  {
+    sercom->I2CM.CTRLB.bit.CMD = 3;
+    while (sercom->I2CM.SYNCBUSY.bit.SYSOP)
+      ;
+  }
+  _sent += _chunk;
+  if (_sent < _frame.length())
+  {
+    start();
+    return true;
+  }
+  _status = LCD_BUS_IDLE;
+  return false;
+}
+
+bool LcdBus::failed()
+{
+  busy();
+  if (_status != LCD_BUS_ERROR)
+    return false;
+  _status = LCD_BUS_IDLE;
+  return true;
+}
+
+void LcdBus::wait()
+{
+  while (busy())
+    ;
+}
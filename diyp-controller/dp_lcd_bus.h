@@ -0,0 +1,102 @@
+/*
+  Asynchronous I2C transport of the LCD: the frames of Display::show() go out by DMA in the background
+  (c) 2025 diyPresso - CC-BY-NC
+
+  The hd44780 library clocks every character out through Wire and waits for it: an I2C transaction of 5 bytes per
+  character. LcdFrame encodes the cursor moves and characters of a frame for the PCF8574 expander of the backpack
+  (4 bit mode: per nibble the data with E high and with E low), LcdBus hands the buffer to the DMA controller, which
+  writes it to the SERCOM of Wire in transactions of up to 255 bytes (ADDR.LEN). The main loop only polls: busy()
+  starts the next transaction and ends one with a STOP, no interrupt (the SERCOM interrupt belongs to Wire).
+
+  Timing: the HD44780 needs 37 usec per command or character, the 4 expander bytes of one take 90 usec at 400 kHz.
+  The slow commands (clear, home: 1.5 msec) are not sent through the bus. The hd44780 library (init, createChar,
+  the logo) only uses Wire after wait().
+
+  The DMAC has one descriptor table for all channels. When another driver enabled the DMAC first, begin() uses its
+  table if DISPLAY_DMA_CHANNEL is free in it; otherwise it says so on Serial and send() writes the frame through Wire
+  and blocks.
+
+  LcdFrame is portable C++ without Arduino dependencies, the host benchmark (server/lcd_bench) decodes it. On the
+  machine, LOOP_TIMERS of diyp-controller.ino shows the time of a display update in t2 (menu_main()).
+*/
+#ifndef LCD_BUS_H
+#define LCD_BUS_H
+
+#include <stdint.h>
+#include "dp_hardware.h"
+#include "dp_framebuffer.h"
+
+#define LCD_BUS_BYTES ((FB_SIZE + FB_MAX_RUNS + CG_SIZE + CG_MAX_RUNS) * 4) // all characters and custom characters
+#define LCD_BUS_CHUNK 255                                                  // max bytes per I2C transaction (ADDR.LEN)
+#define LCD_BUS_TIMEOUT_MSEC 50                                            // wait() gives up, a frame takes max 20 msec
+
+class LcdFrame
+{
+private:
+  uint8_t _bytes[LCD_BUS_BYTES];
+  uint16_t _length = 0;
+
+  void nibble(uint8_t value, uint8_t rs)
+  {
+    uint8_t b = (value << 4) | rs | DISPLAY_PCF_BL;
+    _bytes[_length++] = b | DISPLAY_PCF_EN; // the HD44780 takes the nibble on the falling edge of E
+    _bytes[_length++] = b;
+  }
+  void send(uint8_t value, uint8_t rs)
+  {
+    if (_length + 4 > LCD_BUS_BYTES)
+      return;
+    nibble(value >> 4, rs);
+    nibble(value & 0x0F, rs);
+  }
+
+public:
+  void clear() { _length = 0; }
+  void cursor(uint8_t col, uint8_t row)
+  {
+    static const uint8_t offsets[] = {0x00, 0x40, 0x14, 0x54}; // DDRAM address of the rows
+    send(0x80 | (offsets[row & 3] + col), 0);                  // set DDRAM address
+  }
+  void cgram(uint8_t address) { send(0x40 | (address & 0x3F), 0); } // set CGRAM address: char * 8 + row
+  void write(const char *s, uint8_t n)
+  {
+    while (n--)
+      send(*s++, DISPLAY_PCF_RS);
+  }
+  const uint8_t *bytes() const { return _bytes; }
+  uint16_t length() const { return _length; }
+};
+
+typedef enum
+{
+  LCD_BUS_IDLE,
+  LCD_BUS_BUSY,
+  LCD_BUS_ERROR // the last frame was not (completely) acknowledged
+} lcd_bus_status_t;
+
+class LcdBus
+{
+private:
+  LcdFrame _frame;
+  uint16_t _sent = 0, _chunk = 0; // bytes of the frame done, in the current transaction
+  lcd_bus_status_t _status = LCD_BUS_IDLE;
+  unsigned long _start = 0; // [msec] of the frame
+  bool _dma = false;        // the DMA channel is ours, otherwise the frames are written by Wire
+
+  void start();
+  void abort();
+  void write();
+
+public:
+  void begin();                        // after Wire.begin() (lcd.init())
+  bool dma() { return _dma; }          // frames go out in the background
+  LcdFrame &frame() { return _frame; } // fill it when not busy
+  void send();                         // start sending the frame, returns immediately with dma()
+  bool busy();                         // polls the transfer
+  bool failed();                       // the last frame failed, clears the error
+  void wait();                         // until the frame is out, before the hd44780 library uses Wire
+};
+
+extern LcdBus lcdBus;
+
+#endif // LCD_BUS_H
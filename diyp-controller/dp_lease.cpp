@@ -0,0 +1,103 @@
+/*
+  Distributed power leases
+  (c) 2025 diyPresso - CC-BY-NC
+*/
+#include "dp_lease.h"
+
+// Store the announcement of another node (our own is ignored)
+void PowerLeases::receive(uint32_t id, uint8_t priority, uint16_t demand, uint16_t claim, unsigned long now)
+{
+  if (id == _id)
+    return;
+  int i = 0;
+  while (i < _count && _nodes[i].id != id)
+    i++;
+  if (i == _count)
+  {
+    if (_count == POWER_MAX_NODES)
+    {
+      _overflows++;
+      return;
+    }
+    _count++;
+  }
+  _nodes[i].id = id;
+  _nodes[i].priority = priority < POWER_PRIORITIES ? priority : POWER_PRIORITY_HEATING;
+  _nodes[i].demand = demand;
+  _nodes[i].claim = claim;
+  _nodes[i].time = now;
+
+  unsigned int used = others(now); // the other node may use its claim from its next tick on
+  if (_grant + used > _budget)
+    _grant = used < _budget ? _budget - used : 0;
+}
+
+// Power reserved by the other nodes, forget nodes that are gone
+unsigned int PowerLeases::others(unsigned long now)
+{
+  unsigned int sum = 0;
+  for (int i = 0; i < _count;)
+  {
+    if (now - _nodes[i].time >= POWER_FORGET_MSEC)
+    {
+      _nodes[i] = _nodes[--_count];
+      continue;
+    }
+    if (fresh(_nodes[i], now))
+      sum += _nodes[i].claim;
+    else
+      sum += _nodes[i].claim < _failsafe ? _nodes[i].claim : _failsafe; // it falls back to its failsafe power
+    i++;
+  }
+  return sum;
+}
+
+// Our share of the budget: by priority, and max-min fair between the demands of the same priority.
+// All nodes compute the same allocation from the same announcements.
+unsigned int PowerLeases::allocate(uint8_t priority, uint16_t demand, unsigned long now)
+{
+  unsigned int left = _budget;
+  for (int p = POWER_PRIORITIES - 1; p >= 0; p--)
+  {
+    uint16_t demands[POWER_MAX_NODES + 1];
+    int n = 0;
+    if (priority == p && demand)
+      demands[n++] = demand;
+    for (int i = 0; i < _count; i++)
+      if (fresh(_nodes[i], now) && _nodes[i].priority == p && _nodes[i].demand)
+        demands[n++] = _nodes[i].demand;
+    for (int i = 1; i < n; i++) // insertion sort, ascending
+      for (int j = i; j > 0 && demands[j] < demands[j - 1]; j--)
+      {
+        uint16_t d = demands[j];
+        demands[j] = demands[j - 1];
+        demands[j - 1] = d;
+      }
+
+    // water filling: the smallest demands are served first, the others share what is left equally
+    unsigned int mine = 0;
+    for (int i = 0; i < n; i++)
+    {
+      unsigned int share = left / (n - i);
+      unsigned int take = demands[i] < share ? demands[i] : share;
+      if (priority == p && demands[i] == demand && !mine)
+        mine = take;
+      left -= take;
+    }
+    if (priority == p)
+      return mine;
+  }
+  return 0;
+}
+
+// Compute and return our claim for the next period, a higher claim is only granted after it has been announced
+uint16_t PowerLeases::tick(uint8_t priority, uint16_t demand, unsigned long now)
+{
+  unsigned int used = others(now);
+  unsigned int claim = allocate(priority, demand, now);
+  if (claim + used > _budget)
+    claim = used < _budget ? _budget - used : 0;
+  _grant = claim < _claim ? claim : _claim;
+  _claim = claim;
+  return _claim;
+}
@@ -0,0 +1,74 @@
+/*
+  Distributed power leases: share a mains power budget between machines on one circuit
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Every node periodically announces its priority, its heater demand and its claim [W] to all nodes. A claim is a
+  lease: it is valid until it is renewed or expires (POWER_LEASE_MSEC without an announcement).
+
+  On every tick a node computes the same allocation as all other nodes (the budget is divided by priority, and
+  within a priority max-min fair between the demands) and announces as claim its allocation, limited to the budget
+  minus the claims of the others. A lower claim is used immediately, a higher claim only from the next tick, after
+  it has been announced. When an announcement of another node is received the grant is reduced to what is left of the
+  budget. So two nodes that raise their claim at the same time see each others claim before they use it, and the
+  total power of all nodes stays below the budget as long as announcements arrive within one tick.
+
+  A node that is not heard anymore keeps (at most) its failsafe power reserved until it is forgotten, because it
+  falls back to that power itself (see dp_power.h).
+
+  Portable C++, no Arduino dependencies: time is passed in [msec], power in [W].
+*/
+#ifndef LEASE_H
+#define LEASE_H
+
+#include <stdint.h>
+
+#define POWER_TICK_MSEC 1000              // interval between two announcements of a node [msec]
+#define POWER_LEASE_MSEC 3500             // a claim expires when it is not renewed within this time [msec]
+#define POWER_FORGET_MSEC (600 * 1000UL)  // a node that is not heard is forgotten after this time [msec]
+#define POWER_MAX_NODES 8                 // max number of other nodes
+
+// Priorities, a higher priority gets its power first
+typedef enum
+{
+  POWER_PRIORITY_HEATING, // warming up, can wait
+  POWER_PRIORITY_READY,   // keeping the boiler on temperature
+  POWER_PRIORITY_BREWING, // a shot is being made
+  POWER_PRIORITIES,
+} power_priority_t;
+
+typedef struct
+{
+  uint32_t id;
+  uint8_t priority;
+  uint16_t demand, claim; // [W]
+  unsigned long time;     // time of the last announcement [msec]
+} power_node_t;
+
+class PowerLeases
+{
+private:
+  uint32_t _id;
+  unsigned int _budget = 0, _failsafe = 0;
+  power_node_t _nodes[POWER_MAX_NODES];
+  int _count = 0;
+  uint16_t _claim = 0, _grant = 0;
+  unsigned long _overflows = 0;
+  bool fresh(const power_node_t &node, unsigned long now) { return now - node.time < POWER_LEASE_MSEC; }
+  unsigned int others(unsigned long now);
+  unsigned int allocate(uint8_t priority, uint16_t demand, unsigned long now);
+
+public:
+  PowerLeases(uint32_t id = 0) : _id(id) {};
+  void id(uint32_t id) { _id = id; }
+  uint32_t id() { return _id; }
+  void budget(unsigned int budget, unsigned int failsafe) { _budget = budget; _failsafe = failsafe; }
+  unsigned int budget() { return _budget; }
+  void receive(uint32_t id, uint8_t priority, uint16_t demand, uint16_t claim, unsigned long now);
+  uint16_t tick(uint8_t priority, uint16_t demand, unsigned long now); // returns the claim to announce
+  uint16_t claim() { return _claim; }
+  uint16_t grant() { return _grant; } // power that may be used now [W]
+  int nodes() { return _count; }
+  unsigned long overflows() { return _overflows; } // announcements ignored because the node table was full
+};
+
+#endif // LEASE_H
@@ -7,6 +7,7 @@
 #include "dp_led.h"
 #include <WiFiNINA.h>
 #include <utility/wifi_drv.h>
+#include "dp_wifi.h"
 
 ColorLed statusLed = ColorLed();
 
@@ -19,10 +20,22 @@ ColorLed::ColorLed(void)
 
 void ColorLed::color(const bool c[])
 {
+  memcpy(_color, c, sizeof(_color));
+  update();
+}
+
+// The led is on the Wifi module: write only a new color, and not while a DNS lookup has the module
+void ColorLed::update()
+{
+  if ((_written && memcmp(_color, _shown, sizeof(_shown)) == 0) || wifiManager.busy())
+    return;
+  const bool *c = _color;
   WiFiDrv::pinMode(25, OUTPUT); // R
   WiFiDrv::pinMode(26, OUTPUT); // G
   WiFiDrv::pinMode(27, OUTPUT); // B
   WiFiDrv::digitalWrite(25, (c[0] ? HIGH : LOW) );
   WiFiDrv::digitalWrite(26, (c[1] ? HIGH : LOW) );
   WiFiDrv::digitalWrite(27, (c[2] ? HIGH : LOW) );
+  memcpy(_shown, _color, sizeof(_shown));
+  _written = true;
 }
@@ -7,9 +7,12 @@
 class ColorLed
 {
     private:
+        bool _color[3] = {false, false, false}, _shown[3] = {false, false, false};
+        bool _written = false;
     public:
         ColorLed(void);
         void color(const bool c[]);
+        void update(); // loop: writes a color that was deferred while the Wifi module was busy
         inline constexpr static const bool BLACK[3] = {false,false,false}; // RGB
         inline constexpr static const bool RED[3] =   {true,false,false}; 
         inline constexpr static const bool GREEN[3] = {false,true,false};
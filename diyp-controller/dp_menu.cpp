@@ -1,6 +1,9 @@
 /*
   menu functions
   We are non-blocking and we assume to be called ~ 2x to 4x per second
+
+  The screens are declared: a layout and the functions that give the value of each placeholder (dp_view.h). A menu
+  function handles its input and draws its screen; the display only gets a frame when a shown value changed.
  */
 #include "dp.h"
 #include "dp_menu.h"
@@ -12,13 +15,8 @@
 #include "dp_heater.h"
 #include "dp_pump.h"
 #include "dp_settings.h"
-
-double settings_vals[32];
-
-// the increment setting has some special values:
-#define READ_ONLY 0         // only display value, cannot modify
-#define EXECUTE_FUNCTION -1 // Execute a function, the 'decimals' field contains a function ID
-#define SELECT_ITEM -2      // Select item from a list, 'unit' has an `ASCII-ZERO` separated list
+#include "dp_view.h"
+#include "dp_sparkline.h"
 
 // List of function IDs
 #define FUNCTION_SAVE 1
@@ -27,29 +25,31 @@ double settings_vals[32];
 #define FUNCTION_DEFAULTS 4
 #define FUNCTION_EXIT 5
 
-// "text", "unit", pointer, increment, decimals
+// a setting (name, unit, step and decimals from dp_settings_table.cpp), or: -1, "text", "unit", function ID
 const setting_t settings_list[] =
     {
-        {"Temperature", "\337C", &settings_vals[0], 0.5, 2},
-        {"Pre-infusion time", "sec", &settings_vals[1], 0.1, 2},
-        {"Infusion time", "sec", &settings_vals[2], 0.1, 2},
-        {"Extraction time", "sec", &settings_vals[3], 0.5, 2},
-        {"Extraction weight", "gram", &settings_vals[4], 0.5, 2},
-        {"P-Gain", "%/\337C", &settings_vals[5], 0.2, 1},
-        {"I-Gain", "%/\337C/s", &settings_vals[6], 0.01, 2},
-        {"D-Gain", "%s", &settings_vals[7], 0.2, 1},
-        {"FF-heat Value", "%", &settings_vals[8], 0.2, 1},
-        {"FF-ready Value", "%", &settings_vals[9], 0.2, 1},
-        {"FF-brew Value", "%", &settings_vals[10], 0.2, 1},
-        {"Shot counter", "shots", &settings_vals[11], READ_ONLY, 0},
-        {"WIFI Mode", "OFF\0ON\0CONFIG-AP\0", &settings_vals[12], SELECT_ITEM, 1},
-        {"Weight trim", "%", &settings_vals[13], 0.05, 2},
-        {"Commissioning done", "NO\0YES\0", &settings_vals[14], SELECT_ITEM, 1},
-        {"   <Tare Weight>", "FULL", &settings_vals[31], EXECUTE_FUNCTION, FUNCTION_TARE},
-        {"   <Zero Counter>", "", &settings_vals[31], EXECUTE_FUNCTION, FUNCTION_ZERO},
-        {"<Reset to defaults>", "", &settings_vals[31], EXECUTE_FUNCTION, FUNCTION_DEFAULTS},
-        {"       <EXIT>", "", &settings_vals[31], EXECUTE_FUNCTION, FUNCTION_EXIT},
-        {"       <SAVE>", "", &settings_vals[31], EXECUTE_FUNCTION, FUNCTION_SAVE}};
+        {SET_TEMPERATURE},
+        {SET_PRE_INFUSION_TIME},
+        {SET_INFUSION_TIME},
+        {SET_EXTRACTION_TIME},
+        {SET_EXTRACTION_WEIGHT},
+        {SET_P},
+        {SET_I},
+        {SET_D},
+        {SET_FF_HEAT},
+        {SET_FF_READY},
+        {SET_FF_BREW},
+        {SET_SHOT_COUNTER},
+        {SET_WIFI_MODE},
+        {SET_MAINS_LIMIT},
+        {SET_TELEMETRY_FORMAT},
+        {SET_TRIM_WEIGHT},
+        {SET_COMMISSIONING_DONE},
+        {-1, "   <Tare Weight>", "FULL", FUNCTION_TARE},
+        {-1, "   <Zero Counter>", "", FUNCTION_ZERO},
+        {-1, "<Reset to defaults>", "", FUNCTION_DEFAULTS},
+        {-1, "       <EXIT>", "", FUNCTION_EXIT},
+        {-1, "       <SAVE>", "", FUNCTION_SAVE}};
 
 const int num_settings = sizeof(settings_list) / sizeof(setting_t);
 
@@ -69,202 +69,356 @@ const int num_errors = sizeof(errors_list) / sizeof(char *);
 // const char spinner_chars[] = "/-\|";
 const char spinner_chars[] = "\0\1\2\3\4\5\6\7";
 
-const char *menus[] = {
-    // MAIN=0
-    // 01234567890123456789
-    "Boiler #####/#####\337C" // [0:actual] / [1:set_temp]
-    "Power    ### % ## # "    // [2:percentage] [3:ON_OFF] [4:PUMP]
-    "############# #####s"    // [5:state] [6:time]
-    "Weight ##### gram # ",   // [7:Weight] [8:level]
+const char *get_string_item(const char *items, int index);
+int get_item_count(const char *items);
+
+static View view;
+static ViewList settings_nav(num_settings);
+static const char *wifi_msg = "";
+
+typedef struct
+{
+  Sparkline *line;
+  const char *title, *unit;
+  unsigned long interval; // [msec] per sample
+} graph_t;
+
+static Sparkline temperature_line(1.0), shot_line(5.0); // scale: at least 1 degree, 5 gram
+static const graph_t graphs[] = {{&temperature_line, "Temperature", "\337C", GRAPH_TEMPERATURE_SAMPLE_MS},
+                                 {&shot_line, "Shot weight", "g", GRAPH_SHOT_SAMPLE_MS}};
+static bool graph_chars = false; // the custom characters hold the graph, not the spinner
+
+// The frame of the animations
+static unsigned long animation(unsigned long period = ANIMATION_REFRESH_RATE_MS) { return millis() / period; }
+
+// The values of the placeholders
+
+static double act_temp() { return boilerController.act_temp(); }
+static double set_temp() { return boilerController.set_temp(); }
+static double heater_power() { return heaterDevice.power(); }
+static const char *heater_on() { return heaterDevice.is_on() ? "ON" : ""; }
+
+static const char *pump_spinner()
+{
+  static char s[2];
+  s[0] = pumpDevice.is_on() ? spinner_chars[animation() % 8] : 0;
+  return s;
+}
 
-    // SETTING=1
+static const char *brew_state() { return brewProcess.get_state_name(); }
+static double brew_time() { return brewProcess.brew_time(); }
+static double state_time() { return brewProcess.state_time(); }
+
+static double main_weight()
+{
+  if (brewProcess.is_busy())
+    return brewProcess.weight();
+  if (brewProcess.is_finished())
+    return brewProcess.end_weight();
+  return reservoir.weight();
+}
+
+static double reservoir_weight() { return reservoir.weight(); }
+static double brew_weight() { return brewProcess.weight(); }
+
+static const char *level()
+{
+  static char s[2];
+  if (reservoir.is_empty() or reservoir.is_almost_empty())
+    s[0] = spinner_chars[((animation() % 8) > 4) ? 7 : 0]; // flash empty with a period of 8
+  else
+    s[0] = reservoir_level_indicator();
+  return s;
+}
+
+static const char *level_indicator()
+{
+  static char s[2];
+  s[0] = reservoir_level_indicator();
+  return s;
+}
+
+static const setting_t &setting() { return settings_list[settings_nav.index()]; }
+static double setting_number() { return settings_nav.index() + 1; }
+static double setting_count() { return num_settings; }
+
+static const char *setting_label()
+{
+  const setting_desc_t *desc = settings_desc(setting().id);
+  return desc ? desc->label : setting().name;
+}
+
+static const char *setting_value()
+{
+  static char buf[FORMAT_CHARS + 10];
+  static int shown_id = -1;
+  static double shown_value;
+  const setting_desc_t *desc = settings_desc(setting().id);
+  if (!desc)
+    return ""; // A function to execute: no value to display
+  double value = settings.get(setting().id);
+  if (desc->type == SETTING_SELECT)
+    return get_string_item(desc->unit, value);
+  if (setting().id != shown_id || value != shown_value) // format when the value changed
+  {
+    format_float(buf, value, desc->decimals, 10);
+    shown_id = setting().id;
+    shown_value = value;
+  }
+  return buf;
+}
+
+static const char *setting_unit()
+{
+  const setting_desc_t *desc = settings_desc(setting().id);
+  if (!desc)
+    return setting().unit;
+  return desc->type == SETTING_SELECT ? "" : desc->unit;
+}
+
+static const char *sleep_spinner()
+{
+  static const char *spinner[] =
+      {
+          "          ",
+          "Z         ",
+          "Zz        ",
+          "Zzz       ",
+          "Zzzz      ",
+          "Zzzzz     ",
+          "Zzzzzz    ",
+          " Zzzzzzz  ",
+          "  Zzzzzzz ",
+          "   Zzzzzzz",
+          "    Zzzzzz",
+          "     Zzzzz",
+          "      Zzzz",
+          "       Zzz",
+          "        Zz",
+          "         Z",
+          "          ",
+      };
+  return spinner[animation(SLEEP_SPINNER_REFRESH_RATE_MS) % (sizeof(spinner) / sizeof(const char *))];
+}
+
+static const char *wifi_spinner()
+{
+  static const char *spinner[] =
+      {
+          ".     ",
+          " .    ",
+          "  .   ",
+          "   .  ",
+          "    . ",
+          "     .",
+      };
+  return spinner[animation() % (sizeof(spinner) / sizeof(const char *))];
+}
+
+static const char *wifi_message() { return wifi_msg; }
+
+// The shot while brewing and after it, else the temperature
+static const graph_t &graph() { return graphs[brewProcess.is_busy() || brewProcess.is_finished()]; }
+static const char *graph_title() { return graph().title; }
+static double graph_value() { return graph().line->last(); }
+static const char *graph_unit() { return graph().unit; }
+static const char *graph_line() { return SPARK_TEXT; }
+static double graph_window() { return graph().interval * SPARK_WIDTH / 1000.0; }
+
+static double graph_high()
+{
+  double low, high;
+  graph().line->scale(&low, &high);
+  return high;
+}
+
+static double graph_low()
+{
+  double low, high;
+  graph().line->scale(&low, &high);
+  return low;
+}
+
+static const char *brew_error() { return brewProcess.get_error_text(); }
+static const char *boiler_state() { return boilerController.get_state_name(); }
+static const char *boiler_error() { return boilerController.get_error_text(); }
+static const char *reservoir_error() { return reservoir.get_error_text(); }
+
+static int commissioning_substate()
+{
+  int substate = 4;
+  if (brewProcess.is_init())
+    substate = 0;
+  if (brewProcess.is_fill())
+    substate = 1;
+  if (brewProcess.is_purge())
+    substate = 2;
+  if (brewProcess.is_check())
+    substate = 3;
+  if (brewProcess.is_done())
+    substate = 4;
+  return substate;
+}
+
+static const char *commissioning_name()
+{ //                                  sub-state:   0                    1                 2                    3                     4
+  static const char *substate_names[] = {"Fill reservoir", "Filling boiler", "Purge", "Press button when", "Done!", "?"};
+  return substate_names[commissioning_substate()];
+}
+
+static const char *commissioning_info()
+{
+  static const char *substate_info[] = {"And press button", "Wait...", "Put brew lever UP", "Water pours out", "Put lever DOWN", "?"};
+  static char buf[32];
+  int substate = commissioning_substate();
+  if (substate != 1)
+    return substate_info[substate];
+  strcpy(buf, "Wait ");
+  strcpy(buf + 5 + format_fixed(buf + 5, (int)INITIAL_PUMP_TIME - (int)brewProcess.state_time()), "...");
+  return buf;
+}
+
+// The screens: layout, the values of the placeholders in order (number, text, decimals, length)
+
+static const view_field_t main_fields[] = {
+    {act_temp, NULL, 1, 5}, {set_temp, NULL, 1, 0}, {heater_power, NULL, 0, 3}, {NULL, heater_on}, {NULL, pump_spinner},
+    {NULL, brew_state}, {brew_time, NULL, 1, 5}, {main_weight, NULL, 0, 5}, {NULL, level}};
+static const view_screen_t screen_main = {
+    // 01234567890123456789
+    "Boiler #####/#####\337C"
+    "Power    ### % ## # "
+    "############# #####s"
+    "Weight ##### gram # ",
+    main_fields, sizeof(main_fields) / sizeof(view_field_t)};
+
+static const view_field_t setting_fields[] = {
+    {setting_number, NULL, 0, 2}, {setting_count, NULL, 0, 0}, {NULL, setting_label}, {NULL, setting_value},
+    {NULL, setting_unit}};
+static const view_screen_t screen_setting = {
     // 01234567890123456789
     "SETTINGS     [##/##]"
     "################### "
     "  ########## #######"
     "             [PRESS]",
-
-    // MODIFY=2
+    setting_fields, sizeof(setting_fields) / sizeof(view_field_t)};
+static const view_screen_t screen_modify = {
     // 01234567890123456789
     "MODIFY       [##/##]"
     "################### "
     "  ########## #######"
     "              [TURN]",
+    setting_fields, sizeof(setting_fields) / sizeof(view_field_t)};
 
-    // ERROR=3
-    // 01234567890123456789
-    "****** ERROR *******"
-    "*##################*"
-    "* TURN MACHINE OFF *"
-    "********************",
-
-    // BREW=4
+static const view_field_t brew_fields[] = {{NULL, brew_state}, {state_time, NULL, 1, 0}, {brew_time, NULL, 1, 0}};
+static const view_screen_t screen_brew = {
     // 01234567890123456789
     "STATE ############  "
     "STEP-T ######## sec "
     "BREW-T ######## sec "
     "                    ",
-    // SLEEP=5
+    brew_fields, sizeof(brew_fields) / sizeof(view_field_t)};
+
+static const view_field_t sleep_fields[] = {{NULL, sleep_spinner}};
+static const view_screen_t screen_sleep = {
     // 01234567890123456789
     "     ##########     "
     "   I AM SLEEPING!   "
     " LONG PRESS BUTTON  "
     "   TO WAKE ME...    ",
+    sleep_fields, sizeof(sleep_fields) / sizeof(view_field_t)};
 
-    // CONFIRM=6
-    // 01234567890123456789
-    "####################"
-    "    ARE YOU SURE?   "
-    "                    "
-    "       ###    [TURN]",
-
-    // WIFI=7
+static const view_field_t wifi_fields[] = {{NULL, wifi_spinner}, {NULL, wifi_message}};
+static const view_screen_t screen_wifi = {
     // 01234567890123456789
     " WIFI CONNECTING... "
     " ################## "
     " ################## "
     "                    ",
-    // SAVED=8
+    wifi_fields, sizeof(wifi_fields) / sizeof(view_field_t)};
+
+static const view_screen_t screen_saved = {
     // 01234567890123456789
     "                    "
     "   SETTINGS SAVED   "
     "                    "
     "                    ",
-    // STATE=9
+    NULL, 0};
+
+static const view_field_t state_fields[] = {
+    {NULL, brew_state}, {NULL, brew_error}, {NULL, boiler_state}, {NULL, boiler_error}, {NULL, reservoir_error}};
+static const view_screen_t screen_state = {
     // 01234567890123456789
     "####### ############"
     "B: ################ "
     "E: ################ "
     "R: ################ ",
+    state_fields, sizeof(state_fields) / sizeof(view_field_t)};
 
-    // COMMISSIONING=10
+static const view_field_t commissioning_fields[] = {
+    {NULL, commissioning_name}, {NULL, commissioning_info}, {brew_weight, NULL, 0, 5}};
+static const view_screen_t screen_commissioning = {
     // 01234567890123456789
     "___COMMISSIONING___ "
     " ################## "
     " ################## "
     " Weight ##### gram  ",
+    commissioning_fields, sizeof(commissioning_fields) / sizeof(view_field_t)};
 
-    // WARNING_ALMOST_EMPTY=11
-  // 01234567890123456789
+static const view_field_t graph_fields[] = {
+    {NULL, graph_title}, {graph_value, NULL, 1, 5}, {NULL, graph_unit}, {graph_high, NULL, 1, 0}, {NULL, graph_line},
+    {graph_window, NULL, 0, 4}, {graph_low, NULL, 1, 0}};
+static const view_screen_t screen_graph = {
+    // 01234567890123456789
+    "########### ##### ##"
+    "max ######          "
+    "    ########  ####s "
+    "min ######          ",
+    graph_fields, sizeof(graph_fields) / sizeof(view_field_t)};
+
+static const view_field_t warning_fields[] = {{reservoir_weight, NULL, 0, 5}, {NULL, level_indicator}};
+static const view_screen_t screen_warning_almost_empty = {
+    // 01234567890123456789
     "       Warning!     "
     "     Almost empty   "
     " Push to start brew "
-    "Weight ##### gram # " // [0:Weight] [1:level]
-
-};
-const int num_menus = sizeof(menus) / sizeof(char *);
+    "Weight ##### gram # ",
+    warning_fields, sizeof(warning_fields) / sizeof(view_field_t)};
 
-const char *get_string_item(const char *items, int index);
-int get_item_count(const char *items);
-double add_value(int n, double delta);
+// Render a screen and draw it when something changed and the display can take it
+static void draw(const view_screen_t *screen)
+{
+  if (graph_chars && screen != &screen_graph)
+  {
+    display.custom_chars(custom_chars_spinner);
+    graph_chars = false;
+  }
+  view.show(screen);
+  if (!display.ready())
+    return;
+  if (view.update() || display.overwritten())
+  {
+    display.show(view.text());
+    view.drawn();
+  }
+}
 
 bool menu_brew() // not used?
 {
-  char bufs[10][32];
-  char *arg[10];
-
-  arg[0] = bufs[0];
-  arg[1] = bufs[1];
-  arg[2] = bufs[2];
-
-  arg[0] = (char *)brewProcess.get_state_name();
-  format_float(arg[1], brewProcess.state_time(), 1);
-  format_float(arg[2], brewProcess.brew_time(), 1);
-
-  display.show(menus[MENU_BREW], arg);
+  draw(&screen_brew);
   return false;
 }
 
 // Main menu
 bool menu_main()
 {
-  static unsigned int animation_counter = 0;
-  char bufs[10][32];
-  char *arg[10];
-  char pump_spinner[2], heater_spinner[2], level_spinner[2];
-
-  static unsigned long last_count_increment_t = 0;
-  unsigned long delta_t = millis() - last_count_increment_t;
-
-  if (delta_t > ANIMATION_REFRESH_RATE_MS) //increment animation_counter for animations every X msec
-  {
-    last_count_increment_t = millis();
-    animation_counter++;
-  }
-
-  // Animations
-  if (pumpDevice.is_on())
-  {
-    pump_spinner[0] = spinner_chars[animation_counter % 8];
-    pump_spinner[1] = 0;
-  }
-  else
-    pump_spinner[0] = 0;
-
-  if (heaterDevice.is_on())
-  {
-    heater_spinner[0] = spinner_chars[7];
-    heater_spinner[1] = 0;
-  }
-  else
-    heater_spinner[0] = 0;
-
-  if (reservoir.is_empty() or reservoir.is_almost_empty()) 
-  {
-    level_spinner[0] = spinner_chars[((animation_counter % 8) > 4) ? 7 : 0]; // flash empty with a period of 8
-  }
-  else
-  {
-    level_spinner[0] = reservoir_level_indicator();
-    level_spinner[1] = 0;
-  }
-
-  for (int i = 0; i < 10; i++)
-    arg[i] = bufs[i];
-
-  // [0:actual] / [1:set_temp]
-  format_float(arg[0], boilerController.act_temp(), 1, 5);
-  format_float(arg[1], boilerController.set_temp(), 1);
-
-  // [2:percentage] [3:ON_OFF] [4:PUMP]
-  format_float(arg[2], heaterDevice.power(), 0, 3);
-  strcpy(arg[3], heaterDevice.is_on() ? "ON" : "");
-  arg[4] = pump_spinner;
-
-  // [5:state] [6:time]
-  arg[5] = (char *)brewProcess.get_state_name();
-  format_float(arg[6], brewProcess.brew_time(), 1, 5);
-
-  // [7:Weight] [8:level]
-  if (brewProcess.is_busy())
-    format_float(arg[7], brewProcess.weight(), 0, 5);
-  else if (brewProcess.is_finished())
-    format_float(arg[7], brewProcess.end_weight(), 0, 5);
-  else
-    format_float(arg[7], reservoir.weight(), 0, 5);
-
-  arg[8] = level_spinner;
-
-  display.show(menus[MENU_MAIN], arg);
+  draw(&screen_main);
   return false;
 }
 
 // Reservoir almost empty warning menu
 bool menu_warning_almost_empty()
 {
-  char bufs[10][32];
-  char *arg[10];
-
-  for (int i = 0; i < 10; i++)
-    arg[i] = bufs[i];
-
-  // [0:Weight]
-  format_float(bufs[0], reservoir.weight(), 0, 5);
-
-  // [1:level]
-  bufs[1][0] = reservoir_level_indicator();
- 
-  display.show(menus[MENU_WARNING_ALMOST_EMPTY], arg);
+  draw(&screen_warning_almost_empty);
   return false;
 }
 
@@ -274,37 +428,17 @@ bool menu_warning_almost_empty()
  */
 int menu_settings(bool button_pressed)
 {
-  static char buf[32], bufs[10][32];
-  static char *arg[10];
-  static bool modify = false;
-  static int idx = 0;
-  static long pos = 0, prev_pos = 0, loop = 0;
-  static double set_val = 0;
-
-  for (int i = 0; i < 10; i++)
-    arg[i] = bufs[i];
-  format_float(arg[1], num_settings, 0);
-
-  setting_t set = settings_list[idx];
-  pos = display.encoder_value();
-  if (modify)
-  {
-    set_val = add_value(idx, set.delta * (pos - prev_pos));
-  }
-  else
-  {
-    idx += pos - prev_pos;
-    idx %= num_settings;
-    if (idx < 0)
-      idx += num_settings;
-    set_val = add_value(idx, 0.0);
-  }
+  int steps = settings_nav.turn(display.encoder_value()); // selects an item, or the steps to modify it
+  const setting_t &set = setting();
+  const setting_desc_t *desc = settings_desc(set.id);
+  if (steps && desc)
+    settings.set(set.id, settings.get(set.id) + desc->step * steps); // clamped by the settings
 
   if (button_pressed)
   {
-    if (set.delta == EXECUTE_FUNCTION)
+    if (!desc)
     {
-      switch (set.decimals)
+      switch (set.function)
       {
       case FUNCTION_EXIT:
         return 2;
@@ -329,115 +463,18 @@ int menu_settings(bool button_pressed)
     }
     else
     {
-      if (set.delta != READ_ONLY)
-        modify = !modify;
+      if (desc->step != 0) // not read only
+        settings_nav.press();
     }
   }
 
-  if (modify && set.delta == EXECUTE_FUNCTION && set.decimals == FUNCTION_SAVE)
-    return 1;
-
-  arg[2] = set.name;
-  arg[4] = set.unit;
-
-  switch ((int)set.delta)
-  {
-  case EXECUTE_FUNCTION:
-    *arg[3] = 0;
-    break; // A function to execute: no value to display
-  case SELECT_ITEM:
-    strcpy(arg[3], get_string_item(set.unit, set_val));
-    arg[4] = "";
-    break;
-  default:
-    format_float(arg[3], set_val, set.decimals, 10);
-    break; // Show the value
-  }
-
-  format_float(arg[0], idx + 1, 0, 2); // the item number
-  display.show(menus[modify ? MENU_MODIFY : MENU_SETTING], arg);
-  prev_pos = pos;
-
+  draw(settings_nav.modify() ? &screen_modify : &screen_setting);
   return 0;
 }
 
-// add a value to a setting
-double add_value(int n, double delta)
-{
-  double result;
-  if (delta != 0)
-    Serial.print("delta:");
-  Serial.print(delta);
-
-  switch (n)
-  {
-  case 0:
-    return settings.temperature(settings.temperature() + delta);
-  case 1:
-    return settings.preInfusionTime(settings.preInfusionTime() + delta);
-  case 2:
-    return settings.infusionTime(settings.infusionTime() + delta);
-  case 3:
-    return settings.extractionTime(settings.extractionTime() + delta);
-  case 4:
-    return settings.extractionWeight(settings.extractionWeight() + delta);
-  case 5:
-    return settings.P(settings.P() + delta);
-  case 6:
-    return settings.I(settings.I() + delta);
-  case 7:
-    return settings.D(settings.D() + delta);
-  case 8:
-    return settings.ff_heat(settings.ff_heat() + delta);
-  case 9:
-    return settings.ff_ready(settings.ff_ready() + delta);
-  case 10:
-    return settings.ff_brew(settings.ff_brew() + delta);
-  case 11:
-    return settings.shotCounter();
-  case 12:
-    return settings.wifiMode(settings.wifiMode() - (delta / 2.0));
-  case 13:
-    return settings.trimWeight(settings.trimWeight() + delta);
-  case 14:
-    return settings.commissioningDone(settings.commissioningDone() + (delta / 2.0));
-
-  default:
-    return 0;
-  }
-}
-
 bool menu_commissioning()
-{ //                   sub-state:   0                    1                 2                    3                     4
-  static char *substate_names[] = {"Fill reservoir", "Filling boiler", "Purge", "Press button when", "Done!", "?"};
-  static char *substate_info[] = {"And press button", "Wait...", "Put brew lever UP", "Water pours out", "Put lever DOWN", "?"};
-  char buf[32];
-  char *args[3];
-  char weight[10];
-  int substate = 4;
-
-  format_float(weight, brewProcess.weight(), 0, 5);
-  args[2] = weight;
-
-  if (brewProcess.is_init())
-    substate = 0;
-  if (brewProcess.is_fill())
-    substate = 1;
-  if (brewProcess.is_purge())
-    substate = 2;
-  if (brewProcess.is_check())
-    substate = 3;
-  if (brewProcess.is_done())
-    substate = 4;
-
-  args[0] = (char *)substate_names[substate];
-  args[1] = (char *)substate_info[substate];
-  if (substate == 1)
-  {
-    sprintf(buf, "Wait %d...", (int)INITIAL_PUMP_TIME - (int)brewProcess.state_time());
-    args[1] = buf;
-  }
-  display.show(menus[MENU_COMMISSIONING], args);
+{
+  draw(&screen_commissioning);
   // if (display.button_pressed())
   //   return true;
   return false;
@@ -445,103 +482,81 @@ bool menu_commissioning()
 
 bool menu_sleep()
 {
-  char *sleep_spinner[] = 
-      {
-          "          ",
-          "Z         ",
-          "Zz        ",
-          "Zzz       ",
-          "Zzzz      ",
-          "Zzzzz     ",
-          "Zzzzzz    ",
-          " Zzzzzzz  ",
-          "  Zzzzzzz ",
-          "   Zzzzzzz",
-          "    Zzzzzz",
-          "     Zzzzz",
-          "      Zzzz",
-          "       Zzz",
-          "        Zz",
-          "         Z",
-          "          ",
-      };
-  static unsigned int animation_counter = 0;
-  static unsigned long last_count_increment_t = 0;
-
-  unsigned long delta_t = millis() - last_count_increment_t;
-  if (delta_t > SLEEP_SPINNER_REFRESH_RATE_MS) //increment animation_counter for animations every X msec
-  {
-    last_count_increment_t = millis();
-    animation_counter += 1;
-  }
-  if (animation_counter >= sizeof(sleep_spinner) / sizeof(const char *))
-    animation_counter = 0;
-  display.show(menus[MENU_SLEEP], &sleep_spinner[animation_counter]);
+  draw(&screen_sleep);
   return false;
 }
 
 bool menu_error(const char *msg)
 {
-
-  static char *args[10];
-  args[0] = (char *)brewProcess.get_state_name();
-  args[1] = (char *)brewProcess.get_error_text();
-  args[2] = (char *)boilerController.get_state_name();
-  args[3] = (char *)boilerController.get_error_text();
-  args[4] = (char *)reservoir.get_error_text();
-
-  display.show(menus[MENU_STATE], args);
+  draw(&screen_state);
   return false;
-
-  /*static unsigned int animation_counter=0;
-  static char *arg[10];
-  arg[0] = (char*)msg;
-  display.show(menus[MENU_ERROR], arg);
-  return false; */
 }
 
 bool menu_wifi(char *msg = "")
 {
-  const char *wifi_spinner[] =
-      {
-          ".     ",
-          " .    ",
-          "  .   ",
-          "   .  ",
-          "    . ",
-          "     .",
-      };
-  static unsigned int spinner = 0;
-  static char *args[10];
-  spinner += 1;
-  if (spinner >= sizeof(wifi_spinner) / sizeof(const char *))
-    spinner = 0;
-  args[0] = (char *)wifi_spinner[spinner];
-  args[1] = msg;
-  display.show(menus[MENU_WIFI], args);
+  wifi_msg = msg;
+  draw(&screen_wifi);
   return false;
 }
 
 bool menu_saved()
 {
-  static char *args[10];
-  display.show(menus[MENU_SAVED], args);
+  draw(&screen_saved);
   return false;
 }
 
 bool menu_state()
 {
-  static char *args[10];
-  args[0] = (char *)brewProcess.get_state_name();
-  args[1] = (char *)brewProcess.get_error_text();
-  args[2] = (char *)boilerController.get_state_name();
-  args[3] = (char *)boilerController.get_error_text();
-  args[4] = (char *)reservoir.get_error_text();
-
-  display.show(menus[MENU_STATE], args);
+  draw(&screen_state);
+  return false;
+}
+
+// Graph of the temperature or the shot in the custom characters
+bool menu_graph()
+{
+  static const Sparkline *rendered = NULL;
+  static unsigned long added = 0;
+  const Sparkline *line = graph().line;
+  if (!graph_chars || line != rendered || line->added() != added)
+  {
+    uint8_t chars[SPARK_CHARS * 8];
+    line->render(chars);
+    display.custom_chars(chars);
+    graph_chars = true;
+    rendered = line;
+    added = line->added();
+  }
+  draw(&screen_graph);
   return false;
 }
 
+// Record the samples of the graphs, every loop
+void menu_graph_sample()
+{
+  static unsigned long temperature_time = 0, shot_time = 0;
+  static bool brewing = false;
+  unsigned long now = millis();
+  if (now - temperature_time >= GRAPH_TEMPERATURE_SAMPLE_MS)
+  {
+    temperature_time = now;
+    temperature_line.add(boilerController.act_temp());
+  }
+  if (brewProcess.is_busy())
+  {
+    if (!brewing) // a new shot
+    {
+      shot_line.clear();
+      shot_time = now - GRAPH_SHOT_SAMPLE_MS;
+    }
+    if (now - shot_time >= GRAPH_SHOT_SAMPLE_MS)
+    {
+      shot_time = now;
+      shot_line.add(brewProcess.weight());
+    }
+  }
+  brewing = brewProcess.is_busy();
+}
+
 char reservoir_level_indicator()
 {
   int level_index =  (sizeof(spinner_chars) * reservoir.level()) / 100.0;
@@ -8,6 +8,8 @@
 
 #define ANIMATION_REFRESH_RATE_MS 100 // in msec, the base rate for animation updates
 #define SLEEP_SPINNER_REFRESH_RATE_MS 500 // in msec, the base rate for sleep spinner updates
+#define GRAPH_TEMPERATURE_SAMPLE_MS 10000 // in msec, per sample of the temperature graph (the warm-up)
+#define GRAPH_SHOT_SAMPLE_MS 1000 // in msec, per sample of the weight graph of a shot
 
 extern int menu_settings(bool button_pressed);
 extern bool menu_brew(); // not used?
@@ -19,33 +21,17 @@ extern bool menu_saved();
 extern bool menu_error(const char *msg);
 extern bool menu_commissioning();
 extern bool menu_state();
-
-typedef enum
-{
-  MENU_MAIN = 0,
-  MENU_SETTING = 1,
-  MENU_MODIFY = 2,
-  MENU_ERROR = 3,
-  MENU_BREW = 4,
-  MENU_SLEEP = 5,
-  MENU_CONFIRM = 6,
-  MENU_WIFI = 7,
-  MENU_SAVED = 8,
-  MENU_STATE = 9,
-  MENU_COMMISSIONING = 10,
-  MENU_WARNING_ALMOST_EMPTY = 11
-} menu_list_t;
+extern bool menu_graph();
+extern void menu_graph_sample();
 
 typedef struct setting
 {
-  char *name;
-  char *unit;
-  double *val;
-  double delta;
-  int decimals;
+  int id;           // setting_id_t (dp_settings_table.h), -1: a function
+  const char *name; // function
+  const char *unit;
+  int function;
 } setting_t;
 
-extern const char *menus[];
 extern const setting_t settings_list[];
 extern const int num_settings;
 
@@ -1,21 +1,18 @@
+#include <utility/server_drv.h>
+#include <utility/WiFiSocketBuffer.h>
+#include "dp_time.h"
+#include "dp_serial.h"
+#include "dp_wifi.h"
 #include "dp_mqtt.h"
-#include <WiFiNINA.h>
+#include "dp_format.h"
 
 
-MqttDevice mqttDevice;
+MqttDevice mqttDevice = MqttDevice();
 
 
-WiFiClient wifiClient;
-MqttClient mqttClient(wifiClient);
-
-
-const char broker[] = "test.mosquitto.org";
-int port = 1883;
-char topic[64]  = "";
-
-const long interval = 4000;
-unsigned long previousMillis = 0;
-int count = 0;
+MqttSocket mqttSocket;
+static const uint8_t connack_accepted[4] = {0x20, 0x02, 0x00, 0x00}; // connection accepted, served to the library
+MqttClient mqttClient(mqttSocket);
 
 
 void mac_to_hex(char *hex, byte *mac)
@@ -24,67 +21,524 @@ void mac_to_hex(char *hex, byte *mac)
     for(int i=0; i<6; i++)
     {
         hex[2*i+0] = hexchar[ (mac[i] >> 4) ];
-        hex[2*i+1] = hexchar[ (mac[1] & 15) ];
+        hex[2*i+1] = hexchar[ (mac[i] & 15) ];
     }
-    hex[13] = 0;
+    hex[12] = 0;
+}
+
+void MqttSocket::adopt(uint8_t sock)
+{
+    _client = WiFiClient(sock);
+    _sock = sock;
+    _adopt = true;
+    _rx = RX_HEADER;
+    _hdr_size = _fake = 0;
+    _connack = -1;
+    _acked = _refused = 0;
 }
 
-void MqttDevice::init()
+// Close the socket without waiting for the connection to be closed (WiFiClient::stop() waits up to 5 seconds)
+void MqttSocket::stop()
 {
-  byte mac[6]; // Wifi MAC address
+    if (_adopt || _sock == 255)
+        return;
+    ServerDrv::stopClient(_sock);
+    WiFiSocketBuffer.close(_sock);
+    _client = WiFiClient(255);
+    _sock = 255;
+}
+
+// The CONNECT of the library is answered by the socket, the real CONNACK is polled by the device
+size_t MqttSocket::write(const uint8_t *buf, size_t size)
+{
+    if (size && buf[0] == 0x10 && _connack < 0)
+        _fake = 4;
+    return _client.write(buf, size);
+}
 
-  Serial.print("Attempting to connect to the MQTT broker: ");
-  Serial.println(broker);
-  WiFi.macAddress(mac);
-  char topic_buf[64];
-  strcpy(topic, "diyPressoOne/");
-  mac_to_hex(topic+strlen(topic), mac);
+// Read the received stream up to the next packet for the library, taking the CONNACK and SUBACKs out of it
+void MqttSocket::receive()
+{
+    while (_rx != RX_PASS && _client.available())
+    {
+        uint8_t b = _client.read();
+        if (_rx == RX_ACK)
+        {
+            _ack[_out++] = b;
+            if (_out < _len)
+                continue;
+            int i = (_ack[0] << 8 | _ack[1]) - MQTT_SUBSCRIBE_ID; // SUBACK: index of the subscription
+            if (_hdr[0] == 0x20)
+                _connack = _ack[1];
+            else if (i >= 0 && i < 8)
+            {
+                _acked |= 1 << i;
+                if (_ack[2] & 0x80)
+                    _refused |= 1 << i;
+            }
+            _rx = RX_HEADER;
+            _hdr_size = 0;
+            continue;
+        }
+        _hdr[_hdr_size++] = b;
+        if (_hdr_size == 1 || (b & 0x80 && _hdr_size < 5)) // the remaining length continues
+            continue;
+        _len = 0;
+        for (int i = _hdr_size - 1; i >= 1; i--)
+            _len = _len << 7 | (_hdr[i] & 0x7F);
+        _out = 0;
+        _left = _len;
+        _rx = (_hdr[0] == 0x20 && _len == 2) || (_hdr[0] == 0x90 && _len == 3) ? RX_ACK : RX_PASS;
+    }
+}
+
+int MqttSocket::available()
+{
+    if (_fake)
+        return _fake;
+    receive();
+    if (_rx != RX_PASS)
+        return 0;
+    return _hdr_size - _out + min(_left, (size_t)_client.available());
+}
+
+int MqttSocket::read()
+{
+    if (_fake)
+        return connack_accepted[4 - _fake--];
+    if (!available())
+        return -1;
+    int b = _out < _hdr_size ? _hdr[_out++] : (_left--, _client.read());
+    if (_out == _hdr_size && !_left)
+    {
+        _rx = RX_HEADER;
+        _hdr_size = 0;
+    }
+    return b;
+}
 
-  if (!mqttClient.connect(broker, port)) {
-    Serial.print("MQTT connection failed! Error code = ");
-    Serial.println(mqttClient.connectError());
-  }
-  on();
-  
-  Serial.println("You're connected to the MQTT broker! Subscribe using mosquitto with this command:");
-  
-  Serial.print("mosquitto_sub -h ");
-  Serial.print(broker);
-  Serial.print(" -t ");
-  Serial.println(topic);
+int MqttSocket::read(uint8_t *buf, size_t size)
+{
+    size_t n = 0;
+    while (n < size && available())
+    {
+        if (_out == _hdr_size && _left > 1) // the body: in one read of the socket buffer
+        {
+            int got = _client.read(buf + n, min(size - n, _left - 1));
+            if (got > 0)
+                n += got, _left -= got;
+            continue;
+        }
+        buf[n++] = read();
+    }
+    return n ? n : -1;
+}
+
+int MqttSocket::peek()
+{
+    if (_fake)
+        return connack_accepted[4 - _fake];
+    if (!available())
+        return -1;
+    return _out < _hdr_size ? _hdr[_out] : _client.peek();
+}
+
+int MqttSocket::suback(int i)
+{
+    receive();
+    if (!(_acked & 1 << i))
+        return -1;
+    return !(_refused & 1 << i);
+}
+
+bool MqttSocket::subscribe(int i, const char *topic)
+{
+    uint8_t packet[128];
+    size_t len = strlen(topic), size = 2 + 2 + len + 1;
+    if (!connected() || 2 + size > sizeof(packet))
+        return false;
+    packet[0] = 0x82;
+    packet[1] = size;
+    packet[2] = (MQTT_SUBSCRIBE_ID + i) >> 8;
+    packet[3] = (MQTT_SUBSCRIBE_ID + i) & 0xFF;
+    packet[4] = len >> 8;
+    packet[5] = len & 0xFF;
+    memcpy(packet + 6, topic, len);
+    packet[6 + len] = 0; // QoS 0
+    return _client.write(packet, 2 + size) == 2 + size;
+}
+
+// Close the session and the socket
+void MqttDevice::close()
+{
+    if (mqttClient.connected())
+        mqttClient.stop(); // sends DISCONNECT
+    mqttSocket.release();
+    _sock = 255;
+    _state = MSG_START;
+}
+
+// A connect failed or the session was lost: retry later
+void MqttDevice::fail()
+{
+    close();
+    _failures++;
+    if (_failures >= MQTT_RESOLVE_FAILURES)
+        _resolved = false;
+    NEXT(state_backoff);
+}
+
+void MqttDevice::state_off()
+{
+    ON_MESSAGE(START)
+    {
+        byte mac[6]; // Wifi MAC address
+        WiFi.macAddress(mac);
+        strcpy(_topic, MQTT_TOPIC);
+        mac_to_hex(_topic + strlen(_topic), mac);
+        strcpy(_status_topic, _topic);
+        strcat(_status_topic, MQTT_STATUS_TOPIC);
+        strcpy(_cmd_topic, _topic);
+        strcat(_cmd_topic, MQTT_CMD_TOPIC);
+        strcpy(_reply_topic, _topic);
+        strcat(_reply_topic, MQTT_REPLY_TOPIC);
+        strcpy(_client_id, "diyPresso-");
+        mac_to_hex(_client_id + strlen(_client_id), mac);
+        mqttClient.setTxPayloadSize(MQTT_TX_PAYLOAD_SIZE);
+        NEXT(state_wait_wifi);
+    }
 }
 
+void MqttDevice::state_wait_wifi()
+{
+    ON_MESSAGE(STOP)
+    {
+        NEXT(state_off);
+        return;
+    }
+    if (wifiManager.is_connected())
+        NEXT(state_resolve);
+}
 
-void MqttDevice::run() 
+// Resolve the broker address, once (and after failures). The Wifi module is busy during the lookup: wifiManager
+// reads its reply in a later pass
+void MqttDevice::state_resolve()
 {
-    static int count = 0;
-    unsigned long currentMillis = millis();
-    if ( !is_on() )
+    ON_ENTRY()
+    {
+        _resolving = false;
+    }
+    ON_MESSAGE(STOP)
+    {
+        NEXT(state_off);
         return;
+    }
+    if (_resolved)
+    {
+        NEXT(state_connect);
+        return;
+    }
+    ON_TIMEOUT(MQTT_RESOLVE_TIMEOUT_MSEC)
+    {
+        Serial.println("MQTT: resolve timeout");
+        _connect_errors++;
+        fail();
+        return;
+    }
+    if (!wifiManager.is_connected())
+    {
+        fail();
+        return;
+    }
+    if (!_resolving) // until the module takes the request
+    {
+        _resolving = wifiManager.resolve(MQTT_BROKER);
+        return;
+    }
+    int result = wifiManager.resolved(_broker_ip);
+    if (result < 0)
+        return;
+    if (result == 0)
+    {
+        Serial.println("MQTT: could not resolve broker " MQTT_BROKER);
+        _connect_errors++;
+        fail();
+        return;
+    }
+    _resolved = true;
+    NEXT(state_connect);
+}
 
-    // call poll() regularly to allow the library to send MQTT keep alive which avoids being disconnected by the broker
-    mqttClient.poll();
+// Open the TCP connection, poll until it is established, then send the CONNECT
+void MqttDevice::state_connect()
+{
+    ON_ENTRY()
+    {
+        _poll_time = _connect_time = millis();
+        _sock = ServerDrv::getSocket();
+        if (_sock == NO_SOCKET_AVAIL)
+        {
+            _sock = 255;
+            _connect_errors++;
+            fail();
+            return;
+        }
+        mqttSocket.adopt(_sock); // the socket is closed by mqttSocket, also if the connect fails
+        ServerDrv::startClient(uint32_t(_broker_ip), MQTT_PORT, _sock);
+    }
+    ON_MESSAGE(STOP)
+    {
+        close();
+        NEXT(state_off);
+        return;
+    }
+    ON_TIMEOUT(MQTT_CONNECT_TIMEOUT_MSEC)
+    {
+        Serial.println("MQTT: connect timeout");
+        _connect_errors++;
+        fail();
+        return;
+    }
+    if (!wifiManager.is_connected())
+    {
+        fail();
+        return;
+    }
+    if (time_since(_poll_time) < MQTT_POLL_MSEC)
+        return;
+    _poll_time = millis();
+    if (ServerDrv::getClientState(_sock) != ESTABLISHED)
+        return;
 
-    /* if (currentMillis - previousMillis >= interval) 
+    mqttClient.setId(_client_id);
+    mqttClient.setKeepAliveInterval(MQTT_KEEPALIVE_MSEC);
+    mqttClient.setConnectionTimeout(MQTT_POLL_MSEC); // the CONNACK is served by mqttSocket
+    mqttClient.beginWill(_status_topic, true, 1);
+    mqttClient.print("offline");
+    mqttClient.endWill();
+    if (!mqttClient.connect(_broker_ip, MQTT_PORT))
     {
-        previousMillis = currentMillis;
-        Serial.print("Sending message to topic: ");
-        Serial.println(topic);
-        Serial.println(count++);
-        mqttClient.beginMessage(topic);
-        mqttClient.print("counter count=");
-        mqttClient.print(count);
+        Serial.println("MQTT: could not send the CONNECT");
+        _connect_errors++;
+        fail();
+        return;
+    }
+    NEXT(state_connack);
+}
+
+// Wait for the CONNACK of the broker
+void MqttDevice::state_connack()
+{
+    ON_MESSAGE(STOP)
+    {
+        close();
+        NEXT(state_off);
+        return;
+    }
+    int code = mqttSocket.connack();
+    if (code > 0)
+    {
+        Serial.print("MQTT connection failed! Error code = ");
+        Serial.println(code);
+        _connect_errors++;
+        fail();
+        return;
+    }
+    if (code == 0)
+    {
+        _connect_duration = time_since(_connect_time);
+        NEXT(state_connected);
+        return;
+    }
+    ON_TIMEOUT(MQTT_CONNACK_TIMEOUT_MSEC)
+    {
+        Serial.println("MQTT: CONNACK timeout");
+        _connect_errors++;
+        fail();
+        return;
+    }
+    if (!mqttSocket.connected() || !wifiManager.is_connected())
+    {
+        Serial.println("MQTT: connection closed before the CONNACK");
+        _connect_errors++;
+        fail();
+    }
+}
+
+void MqttDevice::state_connected()
+{
+    ON_ENTRY()
+    {
+        _connects++;
+        _failures = 0;
+        _publish_failures = 0;
+        _backoff = MQTT_BACKOFF_MIN_MSEC;
+        _connected_time = millis();
+        mqttClient.beginMessage(_status_topic, true, 1);
+        mqttClient.print("online");
+        mqttClient.endMessage();
+        _subscribing = 0;
+        for (int i = 0; i <= _handlers; i++) // the SUBACKs are checked in the next passes
+            subscribe(i);
+        Serial.println("You're connected to the MQTT broker! Subscribe using mosquitto with this command:");
+        Serial.print("mosquitto_sub -h " MQTT_BROKER " -t ");
+        Serial.println(_topic);
+    }
+    ON_MESSAGE(STOP)
+    {
+        mqttClient.beginMessage(_status_topic, true, 1); // a clean disconnect does not trigger the last will
+        mqttClient.print("offline");
         mqttClient.endMessage();
-    } */
+        close();
+        NEXT(state_off);
+        return;
+    }
+
+    // call parseMessage() (which calls poll()) regularly to allow the library to send MQTT keep alive which avoids
+    // being disconnected by the broker
+    int size = mqttClient.parseMessage();
+    if (size > 0)
+        receive(size);
+    if (_subscribing)
+        check_subscriptions();
+
+    if (!mqttClient.connected() || !wifiManager.is_connected() || _publish_failures >= MQTT_PUBLISH_FAILURES)
+    {
+        Serial.println("MQTT: session lost");
+        _drops++;
+        fail();
+    }
+}
+
+// Wait before the next attempt, the delay doubles after every consecutive failure
+void MqttDevice::state_backoff()
+{
+    ON_MESSAGE(STOP)
+    {
+        NEXT(state_off);
+        return;
+    }
+    ON_TIMEOUT(_backoff)
+    {
+        _backoff = min(2 * _backoff, (unsigned long)MQTT_BACKOFF_MAX_MSEC);
+        NEXT(state_wait_wifi);
+    }
+}
+
+// Read a received message and pass it to the command interpreter or the handler of the topic
+void MqttDevice::receive(int size)
+{
+    char buf[MQTT_CMD_SIZE + 1];
+
+    // the payload follows the header in the same packet; an incomplete or too large message is discarded by the
+    // next parseMessage()
+    if (size > MQTT_CMD_SIZE || mqttClient.read((uint8_t *)buf, size) != size)
+    {
+        _command_errors++;
+        return;
+    }
+    buf[size] = 0;
+    String topic = mqttClient.messageTopic();
+    if (topic == _cmd_topic)
+    {
+        command(buf);
+        return;
+    }
+    for (int i = 0; i < _handlers; i++)
+        if (topic == _handler_topic[i])
+            _handler[i](_handler_topic[i], buf, size);
+}
+
+// Execute a command "<id> <command>" and publish the response
+void MqttDevice::command(char *request)
+{
+    unsigned long start = micros();
+    char *cmd = strchr(request, ' ');
+    if (cmd)
+        *cmd++ = 0;
+
+    mqttClient.beginMessage(_reply_topic);
+    mqttClient.print("id=");
+    mqttClient.println(request);
+    if (!cmd || !dpSerial.execute(String(cmd), mqttClient))
+    {
+        mqttClient.println("unknown command");
+        _command_errors++;
+    }
+    else
+        _commands++;
+    sent(mqttClient.endMessage());
+    _command_usec = micros() - start;
+}
+
+// Subscribe to a topic, the handler is called from run() for every received message. The topic string must remain
+// valid, the subscriptions are renewed on every connect.
+bool MqttDevice::subscribe(const char *topic, mqtt_handler_t handler)
+{
+    if (_handlers == MQTT_MAX_HANDLERS)
+        return false;
+    _handler_topic[_handlers] = topic;
+    _handler[_handlers++] = handler;
+    if (is_connected())
+        subscribe(_handlers);
+    return true;
+}
+
+// Send the SUBSCRIBE of the command topic (0) or of handler i - 1, without waiting for the SUBACK
+void MqttDevice::subscribe(int i)
+{
+    const char *topic = i ? _handler_topic[i - 1] : _cmd_topic;
+    _subscribe_time = millis();
+    if (mqttSocket.subscribe(i, topic))
+        _subscribing |= 1 << i;
+    else
+    {
+        Serial.println("MQTT: could not subscribe to " + String(topic));
+        _subscribe_errors++;
+    }
+}
+
+// Check the SUBACKs of the subscriptions sent
+void MqttDevice::check_subscriptions()
+{
+    bool timeout = time_since(_subscribe_time) > MQTT_SUBACK_TIMEOUT_MSEC;
+    for (int i = 0; i <= _handlers; i++)
+    {
+        if (!(_subscribing & 1 << i))
+            continue;
+        int acked = mqttSocket.suback(i);
+        if (acked < 0 && !timeout)
+            continue;
+        _subscribing &= ~(1 << i);
+        if (acked <= 0)
+        {
+            Serial.println("MQTT: could not subscribe to " + String(i ? _handler_topic[i - 1] : _cmd_topic));
+            _subscribe_errors++;
+        }
+    }
+}
+
+const char *MqttDevice::get_state_name()
+{
+    RETURN_STATE_NAME(off);
+    RETURN_STATE_NAME(wait_wifi);
+    RETURN_STATE_NAME(resolve);
+    RETURN_STATE_NAME(connect);
+    RETURN_STATE_NAME(connack);
+    RETURN_STATE_NAME(connected);
+    RETURN_STATE_NAME(backoff);
+    RETURN_UNKNOWN_STATE_NAME();
 }
 
 void MqttDevice::prepare(char *measurement)
 {
     if (_state == MSG_START)
     {
-        mqttClient.beginMessage(topic);
+        mqttClient.beginMessage(_topic);
         mqttClient.print("measurement ");
     }
+    if (_state == MSG_LINE)
+        mqttClient.print("\nmeasurement ");
     if (_state == MSG_NEXT)
         mqttClient.print(",");
     mqttClient.print(measurement);
@@ -94,14 +548,16 @@ void MqttDevice::prepare(char *measurement)
 
 void MqttDevice::write(char *measurement, double value)
 {
-    if ( !is_on() )  return;
+    if ( !is_connected() )  return;
     prepare(measurement);
-    mqttClient.print(value);
+    char buf[FORMAT_CHARS];
+    format_float(buf, value, 2); // like print(double), without its float arithmetic per digit
+    mqttClient.print(buf);
 }
 
 void MqttDevice::write(char *measurement, char *value)
 {
-    if ( !is_on() ) return;
+    if ( !is_connected() ) return;
     prepare(measurement);
     mqttClient.print("\"");
     mqttClient.print(value);
@@ -110,13 +566,65 @@ void MqttDevice::write(char *measurement, char *value)
 
 void MqttDevice::write(char *measurement, long value)
 {
-    if ( !is_on() ) return;
+    if ( !is_connected() ) return;
     prepare(measurement);
     mqttClient.print(value);
 }
 
-void MqttDevice::send()
+// End a line with an (influxDB) timestamp [sec, msec], the next write() starts a new line in the same message
+void MqttDevice::end_line(uint32_t seconds, uint16_t msec)
 {
-    mqttClient.endMessage();
+    if (_state != MSG_NEXT)
+        return;
+    if (seconds) // no timestamp: the time of arrival is used
+    {
+        char buf[24];
+        sprintf(buf, " %lu%03u000000", (unsigned long)seconds, msec); // [nsec]
+        mqttClient.print(buf);
+    }
+    _state = MSG_LINE;
+}
+
+bool MqttDevice::send()
+{
+    if (_state == MSG_START)
+        return false;
     _state = MSG_START;
-}
\ No newline at end of file
+    return sent(mqttClient.endMessage());
+}
+
+// Publish a (binary) message on a sub topic of the device topic in one write
+bool MqttDevice::publish(const char *subtopic, const uint8_t *data, size_t size)
+{
+    char topic[sizeof(_topic) + 16];
+    if (!is_connected() || strlen(_topic) + strlen(subtopic) >= sizeof(topic))
+        return false;
+    strcpy(topic, _topic);
+    strcat(topic, subtopic);
+    mqttClient.beginMessage(topic, (unsigned long)size); // with a known size the payload is not buffered
+    return sent(mqttClient.write(data, size) == size && mqttClient.endMessage());
+}
+
+// Publish a text message on an (absolute) topic
+bool MqttDevice::publish_to(const char *topic, const char *text, bool retain)
+{
+    if (!is_connected())
+        return false;
+    mqttClient.beginMessage(topic, (unsigned long)strlen(text), retain);
+    mqttClient.print(text);
+    return sent(mqttClient.endMessage());
+}
+
+// Count a published message
+bool MqttDevice::sent(bool ok)
+{
+    if (ok)
+    {
+        _published++;
+        _publish_failures = 0;
+        return true;
+    }
+    _publish_errors++;
+    _publish_failures++;
+    return false;
+}
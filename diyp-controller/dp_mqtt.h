@@ -1,32 +1,167 @@
 /*
  * MQTT client (using ArduinoMqttClient) with message formatting in influxDB line format
  * This allows easy forwarding of measurements to influxDB, using telegraf or another client.
+ *
+ * The session is a state machine advanced from run(), no step waits for the network: the broker address is resolved
+ * once (the lookup is polled through wifiManager), the TCP connection is opened on a socket of the Wifi module and
+ * polled until it is established, then the CONNECT is sent and the CONNACK polled, and the SUBSCRIBEs are sent and
+ * their SUBACKs checked in later passes. Lost sessions are reconnected with an exponential backoff. The broker
+ * publishes "offline" on the retained status topic (last will) when the session is lost.
+ *
+ * Commands: the device subscribes to <topic>/cmd and accepts the serial commands (see dp_serial.cpp), preceded by a
+ * request id: "<id> <command>", e.g. "17 PUT settings temperature=96.00". One command is executed per run(), the
+ * response is published on <topic>/reply as "id=<id>" followed by the response lines, or "unknown command".
+ * Note: anyone with access to the broker can send commands, use a private broker for remote control.
+ *
+ * Other modules can subscribe to (absolute) topics with a handler that is called from run() with the payload.
  */
 #ifndef DP_MQTT_H
 #define DP_MQTT_H
 
 #include "dp.h"
 #include <ArduinoMqttClient.h>
+#include <WiFiNINA.h>
 
-class MqttDevice
+#undef _DP_FSM_TYPE
+#define _DP_FSM_TYPE MqttDevice // used for the state machine macro NEXT()
+#include "dp_fsm.h"
+
+#define MQTT_BROKER "test.mosquitto.org"
+#define MQTT_PORT 1883
+#define MQTT_TOPIC "diyPressoOne/"        // topic prefix, followed by the Wifi MAC address in hex
+#define MQTT_STATUS_TOPIC "/status"       // retained "online", or "offline" as last will
+#define MQTT_CMD_TOPIC "/cmd"             // commands to the device
+#define MQTT_REPLY_TOPIC "/reply"         // responses to the commands
+#define MQTT_CMD_SIZE 400                 // max length of a received message (command), larger ones are ignored [bytes]
+#define MQTT_MAX_HANDLERS 4               // max number of subscriptions of other modules
+#define MQTT_KEEPALIVE_MSEC 30000         // MQTT keep alive interval, the library sends the PINGREQ [msec]
+#define MQTT_CONNECT_TIMEOUT_MSEC 10000   // max time to establish the TCP connection [msec]
+#define MQTT_RESOLVE_TIMEOUT_MSEC 15000   // max time to resolve the broker address [msec]
+#define MQTT_CONNACK_TIMEOUT_MSEC 5000    // max time to wait for the CONNACK of the broker (polled) [msec]
+#define MQTT_SUBACK_TIMEOUT_MSEC 5000     // max time to wait for the SUBACK of a subscription (polled) [msec]
+#define MQTT_SUBSCRIBE_ID 0xF000          // packet id of the first subscription, away from the ids of the library
+#define MQTT_POLL_MSEC 50                 // interval to poll the TCP connection state while connecting [msec]
+#define MQTT_BACKOFF_MIN_MSEC 1000        // retry delay after the first failure [msec]
+#define MQTT_BACKOFF_MAX_MSEC 64000       // the retry delay doubles after every failure, up to this maximum [msec]
+#define MQTT_RESOLVE_FAILURES 4           // resolve the broker address again after this many failed connects
+#define MQTT_PUBLISH_FAILURES 3           // consider the session lost after this many consecutive failed publishes
+#define MQTT_TX_PAYLOAD_SIZE 2816         // message buffer, holds a batch of telemetry lines (the library default is 256) [bytes]
+
+// Client for ArduinoMqttClient that adopts a TCP connection we established ourselves without blocking.
+// The library waits for the CONNACK in connect() and for the SUBACK in subscribe(): the socket answers the CONNECT
+// with a CONNACK of its own, so connect() returns at once, and takes the CONNACK and the SUBACKs of the broker out of
+// the received stream; the device polls them with connack() and suback() (-1: not received yet).
+class MqttSocket : public Client
+{
+private:
+  typedef enum { RX_HEADER, RX_PASS, RX_ACK } rx_state_t;
+  WiFiClient _client;
+  uint8_t _sock = 255;
+  bool _adopt = false;
+  rx_state_t _rx = RX_HEADER;
+  uint8_t _hdr[5], _ack[3];      // fixed header of the received packet, body of a CONNACK or SUBACK
+  uint8_t _hdr_size = 0, _out = 0, _fake = 0; // _out: header bytes passed to the library, _fake: CONNACK bytes to serve
+  size_t _len = 0, _left = 0;    // remaining length of the packet, bytes of it not passed yet
+  int _connack = -1;             // return code of the CONNACK of the broker
+  uint8_t _acked = 0, _refused = 0; // SUBACKs received and refused, bit i: packet id MQTT_SUBSCRIBE_ID + i
+  void receive();
+
+public:
+  void adopt(uint8_t sock);
+  int connect(IPAddress ip, uint16_t port) { return adopted(); }
+  int connect(const char *host, uint16_t port) { return adopted(); }
+  size_t write(uint8_t b) { return write(&b, 1); }
+  size_t write(const uint8_t *buf, size_t size);
+  int available();
+  int read();
+  int read(uint8_t *buf, size_t size);
+  int peek();
+  void flush() { _client.flush(); }
+  void stop();
+  void release() { _adopt = false; stop(); }
+  uint8_t connected() { return _sock != 255 && _client.connected(); }
+  operator bool() { return connected(); }
+  int connack() { receive(); return _connack; }
+  int suback(int i);                            // 1: granted, 0: refused, -1: not received yet
+  bool subscribe(int i, const char *topic);     // send a SUBSCRIBE (QoS 0) with packet id MQTT_SUBSCRIBE_ID + i
+
+private:
+  int adopted() { bool ok = _adopt && connected(); _adopt = false; return ok; }
+};
+
+typedef void (*mqtt_handler_t)(const char *topic, char *payload, int size); // payload is 0 terminated
+
+class MqttDevice : public StateMachine<MqttDevice>
 {
     private:
-      bool _on=false;
-      typedef enum  mqtt_state_t { MSG_START, MSG_NEXT };
+      enum MqttDeviceMessages
+      {
+        START = 1,
+        STOP = 2,
+      };
+      enum mqtt_state_t { MSG_START, MSG_NEXT, MSG_LINE };
       mqtt_state_t _state = MSG_START;
+      char _topic[32] = "";
+      char _status_topic[40] = "";
+      char _cmd_topic[40] = "";
+      char _reply_topic[40] = "";
+      char _client_id[32] = "";
+      IPAddress _broker_ip;
+      bool _resolved = false, _resolving = false;
+      uint8_t _sock = 255;
+      uint8_t _subscribing = 0;          // SUBACKs not received yet, bit 0: the command topic, bit i: handler i - 1
+      unsigned long _subscribe_time = 0;
+      unsigned long _poll_time = 0, _backoff = MQTT_BACKOFF_MIN_MSEC, _connected_time = 0, _connect_time = 0;
+      unsigned long _connect_duration = 0;
+      unsigned int _failures = 0, _publish_failures = 0;
+      unsigned long _connects = 0, _connect_errors = 0, _drops = 0, _published = 0, _publish_errors = 0;
+      unsigned long _commands = 0, _command_errors = 0, _command_usec = 0, _subscribe_errors = 0;
+      const char *_handler_topic[MQTT_MAX_HANDLERS];
+      mqtt_handler_t _handler[MQTT_MAX_HANDLERS];
+      int _handlers = 0;
       void prepare(char *measurement);
+      void receive(int size);
+      void command(char *request);
+      bool sent(bool ok);
+      void fail();
+      void close();
+      void subscribe(int i);
+      void check_subscriptions();
     public:
-      MqttDevice() { off(); }
-      void on(void) { _on=true;  }
-      void off() { _on = false; }
-      bool is_on(void) { return _on; }
-      void init();
-      void run();
+      MqttDevice() : StateMachine(STATE(state_off)) {};
+      void begin() { run(START); }
+      void end() { run(STOP); }
+      bool is_connected(void) { return IN_STATE(connected); }
       void write(char *measurement, long value);
       void write(char *measurement, double value);
       void write(char *measurement, char *value);
-      void send();
+      void end_line(uint32_t seconds, uint16_t msec);
+      bool send();
+      bool publish(const char *subtopic, const uint8_t *data, size_t size);
+      bool publish_to(const char *topic, const char *text, bool retain = false);
+      bool subscribe(const char *topic, mqtt_handler_t handler);
+      const char *topic() { return _topic; }
+      unsigned long connects() { return _connects; }
+      unsigned long connect_errors() { return _connect_errors; }
+      unsigned long drops() { return _drops; }
+      unsigned long published() { return _published; }
+      unsigned long publish_errors() { return _publish_errors; }
+      unsigned long connect_duration() { return _connect_duration; }      // duration of the last successful connect [msec]
+      unsigned long session_time() { return is_connected() ? millis() - _connected_time : 0; } // [msec]
+      unsigned long commands() { return _commands; }
+      unsigned long command_errors() { return _command_errors; }
+      unsigned long command_usec() { return _command_usec; }              // execution time of the last command [usec]
+      unsigned long subscribe_errors() { return _subscribe_errors; }      // refused, not acknowledged or not sent
+      virtual const char *get_state_name();
 
+    protected:
+      void state_off();
+      void state_wait_wifi();
+      void state_resolve();
+      void state_connect();
+      void state_connack();
+      void state_connected();
+      void state_backoff();
 };
 
 extern MqttDevice mqttDevice;
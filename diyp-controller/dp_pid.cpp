@@ -103,6 +103,13 @@ void DpPID::setWindUpLimits(const double &min, const double &max)
     }
 }
 
+/// @brief Preset the integral term, constrained to the wind-up limits
+/// @param i the new value of the integral term
+void DpPID::setIntegral(const double &i)
+{
+    termI = constrain(i, windUpMin, windUpMax);
+}
+
 void DpPID::setCoefficients(const double &p, const double &i, const double &d)
 {
     Kp = p;
@@ -31,6 +31,7 @@ public:
 
     double P() {return termP;}
     double I() {return termI;}
+    void setIntegral(const double& i); // preset the integral term (e.g. after a warm restart)
     double D() {return termD;}
 
     void printToSerial();
@@ -0,0 +1,405 @@
+/*
+ diyPresso Wifi configuration portal
+ Implemented as a Finite State Machine, run from the main loop (by the wifiManager)
+ (c) 2025 diyPresso
+ */
+#include "dp.h"
+#include <utility/wifi_drv.h>
+#include "dp_portal.h"
+
+ConfigPortal configPortal = ConfigPortal();
+
+#define HTTP_HEADER_HTML \
+  "HTTP/1.1 200 OK\r\n" \
+  "Content-Type: text/html\r\n" \
+  "Cache-Control: no-store\r\n" \
+  "Connection: close\r\n" \
+  "\r\n" \
+  "<!DOCTYPE html><html><head><meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">" \
+  "<title>diyPresso-One</title></head>" \
+  "<body style=\"font-family:verdana;background-color:SteelBlue;color:GhostWhite\"><h2>diyPresso-One</h2>"
+
+static const char HTTP_FORM_HEAD[] =
+  HTTP_HEADER_HTML
+  "<p>Select your Wifi network and enter the password:</p>"
+  "<form method=\"POST\" action=\"/\">"
+  "<input name=\"XXID\" list=\"ssids\" placeholder=\"network\" autocomplete=\"off\"><datalist id=\"ssids\">";
+
+static const char HTTP_FORM_TAIL[] =
+  "</datalist><br><input type=\"password\" name=\"XXPS\" placeholder=\"password\"><br>"
+  "<input type=\"submit\" name=\"action\" value=\"Submit\"></form></body></html>";
+
+static const char HTTP_THANKS[] =
+  HTTP_HEADER_HTML
+  "<p style=\"color:DarkOrange\">Thank you, the machine is connecting to your network.</p></body></html>";
+
+// Captive portal detection (e.g. /generate_204, /hotspot-detect.html) and other pages are redirected to the form
+static const char HTTP_REDIRECT[] =
+  "HTTP/1.1 302 Found\r\n"
+  "Location: " PORTAL_URL "\r\n"
+  "Content-Length: 0\r\n"
+  "Connection: close\r\n"
+  "\r\n";
+
+static const portal_segment_t RESPONSE_THANKS[] = { { HTTP_THANKS, sizeof(HTTP_THANKS) - 1 }, { NULL, 0 } };
+static const portal_segment_t RESPONSE_REDIRECT[] = { { HTTP_REDIRECT, sizeof(HTTP_REDIRECT) - 1 }, { NULL, 0 } };
+
+// Append text to a fixed buffer, escaped for use in a HTML attribute. Returns false if it does not fit
+static bool append_html(char *buf, size_t size, size_t &len, const char *text)
+{
+  for (; *text; text++)
+  {
+    const char *s;
+    char c[2] = { *text, 0 };
+    switch (*text)
+    {
+    case '"': s = "&quot;"; break;
+    case '&': s = "&amp;"; break;
+    case '<': s = "&lt;"; break;
+    case '>': s = "&gt;"; break;
+    default: s = c;
+    }
+    size_t n = strlen(s);
+    if (len + n >= size)
+      return false;
+    memcpy(buf + len, s, n);
+    len += n;
+  }
+  buf[len] = 0;
+  return true;
+}
+
+static int hex_value(char c)
+{
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// Decode an url encoded form value (src, len) into dst (size includes the terminating 0)
+static void url_decode(const char *src, size_t len, char *dst, size_t size)
+{
+  size_t n = 0;
+  for (size_t i = 0; i < len && n < size - 1; i++)
+  {
+    if (src[i] == '+')
+      dst[n++] = ' ';
+    else if (src[i] == '%' && i + 2 < len && hex_value(src[i + 1]) >= 0 && hex_value(src[i + 2]) >= 0)
+    {
+      dst[n++] = (char)(hex_value(src[i + 1]) * 16 + hex_value(src[i + 2]));
+      i += 2;
+    }
+    else
+      dst[n++] = src[i];
+  }
+  dst[n] = 0;
+}
+
+// Render the network list of the scan once, the form is then streamed from constant segments
+void ConfigPortal::render_list(int count)
+{
+  size_t len = 0;
+  _list[0] = 0;
+  for (int i = 0; i < count && i < PORTAL_MAX_SSID; i++)
+  {
+    static const char head[] = "<option value=\"", tail[] = "\"></option>";
+    size_t start = len;
+    const char *ssid = WiFi.SSID(i);
+    if (ssid == NULL || *ssid == 0)
+      continue;
+    if (len + sizeof(head) - 1 < sizeof(_list))
+    {
+      strcpy(_list + len, head); // markup: not escaped, only the name is
+      len += sizeof(head) - 1;
+    }
+    if (len == start || !append_html(_list, sizeof(_list), len, ssid) || len + sizeof(tail) - 1 >= sizeof(_list))
+    {
+      _list[len = start] = 0; // does not fit: drop this (and further) entries
+      break;
+    }
+    strcpy(_list + len, tail);
+    len += sizeof(tail) - 1;
+  }
+  _form[0] = { HTTP_FORM_HEAD, sizeof(HTTP_FORM_HEAD) - 1 };
+  _form[1] = { _list, len };
+  _form[2] = { HTTP_FORM_TAIL, sizeof(HTTP_FORM_TAIL) - 1 };
+  _form[3] = { NULL, 0 };
+  Serial.print("* Portal: found networks: "); Serial.println(count);
+}
+
+// Answer (at most) one DNS query: every A record resolves to the portal
+void ConfigPortal::dns()
+{
+  if (_udp.parsePacket() == 0)
+    return;
+  IPAddress remote = _udp.remoteIP();
+  uint16_t port = _udp.remotePort();
+  int size = _udp.read(_packet, sizeof(_packet));
+  if (size < 12 || (_packet[2] & 0x80) || remote == IPAddress(PORTAL_IP)) // too short, a response, or our own query
+    return;
+  if (((_packet[4] << 8) | _packet[5]) == 0) // no question
+    return;
+
+  // skip the name labels of the first question
+  int p = 12;
+  while (p < size && _packet[p] != 0)
+  {
+    if (_packet[p] & 0xC0) // compression is not expected in a question
+      return;
+    p += _packet[p] + 1;
+  }
+  if (p + 5 > size || p + 5 + 16 > (int)sizeof(_packet))
+    return;
+  bool type_a = _packet[p + 1] == 0 && _packet[p + 2] == 1 && _packet[p + 3] == 0 && _packet[p + 4] == 1;
+  p += 5;
+
+  // turn the query into the response: header, the first question and one answer
+  _packet[2] = 0x81; // response, recursion desired
+  _packet[3] = 0x80; // recursion available, no error
+  _packet[4] = 0; _packet[5] = 1; // QDCOUNT
+  _packet[6] = 0; _packet[7] = type_a ? 1 : 0; // ANCOUNT
+  memset(&_packet[8], 0, 4); // NSCOUNT, ARCOUNT
+  if (type_a)
+  {
+    const uint8_t answer[] = {
+        0xC0, 0x0C,                      // name: pointer to the question
+        0x00, 0x01, 0x00, 0x01,          // type A, class IN
+        0x00, 0x00, 0x00, PORTAL_DNS_TTL, // TTL
+        0x00, 0x04, PORTAL_IP};          // address
+    memcpy(&_packet[p], answer, sizeof(answer));
+    p += sizeof(answer);
+  }
+  _udp.beginPacket(remote, port);
+  _udp.write(_packet, p);
+  _udp.endPacket();
+  _dns_count++;
+}
+
+// Handle a complete line of the request (line ending removed)
+void ConfigPortal::http_line()
+{
+  if (_request_line)
+  {
+    _request_line = false;
+    _post = strncmp(_line, "POST ", 5) == 0;
+    const char *path = strchr(_line, ' ');
+    _root = path && path[1] == '/' && (path[2] == ' ' || path[2] == '?' || path[2] == 0);
+  }
+  else if (_line_len == 0) // end of the headers
+  {
+    if (_post && _content_length > 0)
+      _http = HTTP_BODY;
+    else
+      http_respond();
+  }
+  else if (strncasecmp(_line, "Content-Length:", 15) == 0)
+    _content_length = min((size_t)atoi(_line + 15), sizeof(_body) - 1);
+}
+
+// Select the response for the request
+void ConfigPortal::http_respond()
+{
+  _response = RESPONSE_REDIRECT;
+  if (_post)
+  {
+    parse_form();
+    _response = _accepted ? RESPONSE_THANKS : _form;
+  }
+  else if (_root)
+    _response = _form;
+  _segment = 0;
+  _offset = 0;
+  _http = HTTP_RESPOND;
+}
+
+void ConfigPortal::http_close()
+{
+  if (_http != HTTP_IDLE)
+    _client.stop();
+  _http = HTTP_IDLE;
+  if (_accepted) // the confirmation is sent, we can close the portal
+    _received = true;
+}
+
+// Extract the credentials from the posted form: XXID=<ssid>&XXPS=<password>&action=Submit
+void ConfigPortal::parse_form()
+{
+  char ssid[PORTAL_SSID_SIZE] = "", pass[PORTAL_PASS_SIZE] = "";
+  _body[_body_len] = 0;
+  for (char *field = _body; field && *field;)
+  {
+    char *end = strchr(field, '&');
+    size_t len = end ? (size_t)(end - field) : strlen(field);
+    if (strncmp(field, "XXID=", 5) == 0)
+      url_decode(field + 5, len - 5, ssid, sizeof(ssid));
+    else if (strncmp(field, "XXPS=", 5) == 0)
+      url_decode(field + 5, len - 5, pass, sizeof(pass));
+    field = end ? end + 1 : NULL;
+  }
+  if (ssid[0] == 0)
+  {
+    Serial.println("* Portal: invalid input, no network name");
+    return;
+  }
+  strcpy(_ssid, ssid);
+  strcpy(_pass, pass);
+  _accepted = true;
+  Serial.print("* Portal: received credentials for network: "); Serial.println(_ssid);
+}
+
+// Service the HTTP client: one bounded read or write per call
+void ConfigPortal::http()
+{
+  if (_http == HTTP_IDLE)
+  {
+    _client = _server.available();
+    if (!_client)
+      return;
+    _http = HTTP_REQUEST;
+    _client_time = millis();
+    _request_line = true;
+    _line_len = 0;
+    _body_len = 0;
+    _content_length = 0;
+    _post = false;
+    _root = false;
+    _http_count++;
+  }
+
+  if ((millis() - _client_time) > PORTAL_CLIENT_TIMEOUT_MSEC || !_client.connected())
+  {
+    http_close();
+    return;
+  }
+
+  if (_http == HTTP_RESPOND)
+  {
+    const portal_segment_t &segment = _response[_segment];
+    if (segment.data == NULL)
+    {
+      http_close();
+      return;
+    }
+    size_t n = min(segment.size - _offset, (size_t)PORTAL_WRITE_CHUNK);
+    _offset += _client.write((const uint8_t *)segment.data + _offset, n); // a busy socket writes 0 bytes, retry next time
+    if (_offset >= segment.size)
+    {
+      _segment++;
+      _offset = 0;
+    }
+    return;
+  }
+
+  uint8_t buf[PORTAL_READ_CHUNK];
+  int n = min(_client.available(), (int)sizeof(buf));
+  if (n <= 0)
+    return;
+  n = _client.read(buf, n);
+  for (int i = 0; i < n && _http != HTTP_RESPOND; i++)
+  {
+    char c = buf[i];
+    if (_http == HTTP_BODY)
+    {
+      _body[_body_len++] = c;
+      if (_body_len >= _content_length)
+        http_respond();
+    }
+    else if (c == '\n')
+    {
+      _line[_line_len] = 0;
+      http_line();
+      _line_len = 0;
+    }
+    else if (c != '\r' && _line_len < sizeof(_line) - 1)
+      _line[_line_len++] = c;
+  }
+}
+
+void ConfigPortal::state_idle()
+{
+  ON_MESSAGE(START)
+  {
+    NEXT(state_scan);
+  }
+}
+
+// Scan the networks (for the form) while we are still a client
+void ConfigPortal::state_scan()
+{
+  ON_ENTRY()
+  {
+    Serial.println("* Portal: scanning networks");
+    _accepted = false;
+    _received = false;
+    WiFi.disconnect();
+    WiFiDrv::startScanNetworks();
+  }
+  ON_MESSAGE(STOP)
+  {
+    NEXT(state_idle);
+    return;
+  }
+  ON_TIMEOUT(PORTAL_SCAN_MSEC)
+  {
+    render_list(WiFiDrv::getScanNetworks());
+    NEXT(state_ap);
+  }
+}
+
+// Start the access point and wait until it is listening
+void ConfigPortal::state_ap()
+{
+  ON_ENTRY()
+  {
+    Serial.print("* Portal: creating access point named: "); Serial.println(_name);
+    WiFi.end();
+    WiFi.config(IPAddress(PORTAL_IP), IPAddress(PORTAL_IP), IPAddress(PORTAL_IP), IPAddress(255, 255, 255, 0));
+    WiFiDrv::wifiSetApNetwork(_name, strlen(_name), PORTAL_CHANNEL);
+    _poll_time = millis();
+  }
+  ON_MESSAGE(STOP)
+  {
+    WiFi.end();
+    NEXT(state_idle);
+    return;
+  }
+  ON_TIMEOUT(PORTAL_AP_TIMEOUT_MSEC)
+  {
+    Serial.println("* Portal: creating access point failed, retry");
+    NEXT(state_scan);
+    return;
+  }
+  if ((millis() - _poll_time) < PORTAL_POLL_MSEC)
+    return;
+  _poll_time = millis();
+  if (WiFi.status() == WL_AP_LISTENING)
+  {
+    _udp.begin(PORTAL_DNS_PORT);
+    _server.begin();
+    NEXT(state_listen);
+  }
+}
+
+void ConfigPortal::state_listen()
+{
+  ON_MESSAGE(STOP)
+  {
+    http_close();
+    _udp.stop();
+    WiFi.end();
+    NEXT(state_idle);
+    return;
+  }
+  dns();
+  http();
+}
+
+const char *ConfigPortal::get_state_name()
+{
+  RETURN_STATE_NAME(idle);
+  RETURN_STATE_NAME(scan);
+  RETURN_STATE_NAME(ap);
+  RETURN_STATE_NAME(listen);
+  RETURN_UNKNOWN_STATE_NAME();
+}
@@ -0,0 +1,111 @@
+/*
+  Wifi configuration portal (captive portal)
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Opens an access point with a DNS responder that resolves every name to the portal and a small web server with a form
+  to enter the network credentials. Everything is serviced from the main loop with fixed buffers: every call of run()
+  handles at most one DNS packet and one bounded read or write of the HTTP client, so the machine keeps heating and
+  brewing while the portal is open. Responses are streamed from constant templates in large writes.
+*/
+#ifndef PORTAL_H
+#define PORTAL_H
+
+#include <Arduino.h>
+#include <WiFiNINA.h>
+#include <WiFiUdp.h>
+
+#undef _DP_FSM_TYPE
+#define _DP_FSM_TYPE ConfigPortal // used for the state machine macro NEXT()
+#include "dp_fsm.h"
+
+#define PORTAL_IP 192, 168, 11, 1
+#define PORTAL_URL "http://192.168.11.1/"
+#define PORTAL_CHANNEL 5              // AP wifi channel
+#define PORTAL_DNS_PORT 53
+#define PORTAL_HTTP_PORT 80
+#define PORTAL_SCAN_MSEC 3000         // time for the network scan before the AP is opened [msec]
+#define PORTAL_AP_TIMEOUT_MSEC 10000  // max time to wait for the AP to start listening [msec]
+#define PORTAL_CLIENT_TIMEOUT_MSEC 3000 // close a HTTP connection that does not complete in time [msec]
+#define PORTAL_MAX_SSID 10            // max number of networks shown in the form
+#define PORTAL_SSID_SIZE 32           // SSID buffer, the size of the stored credentials
+#define PORTAL_PASS_SIZE 32           // password buffer, the size of the stored credentials
+#define PORTAL_LINE_SIZE 96           // HTTP request and header line buffer, longer lines are truncated
+#define PORTAL_BODY_SIZE 256          // POST body buffer (url encoded form)
+#define PORTAL_DNS_SIZE 512           // max DNS packet size (RFC 1035 UDP limit)
+#define PORTAL_READ_CHUNK 64          // max bytes read from the HTTP client per run() [bytes]
+#define PORTAL_WRITE_CHUNK 512        // max bytes written to the HTTP client per run() [bytes]
+#define PORTAL_POLL_MSEC 100          // interval to poll the Wifi module while the AP starts [msec]
+#define PORTAL_DNS_TTL 60             // TTL of the DNS answers, short so clients forget the portal quickly [sec]
+
+// A part of a HTTP response, a response is a list of segments terminated by a NULL segment
+typedef struct
+{
+  const char *data;
+  size_t size;
+} portal_segment_t;
+
+class ConfigPortal : public StateMachine<ConfigPortal>
+{
+private:
+  enum ConfigPortalMessages
+  {
+    START = 1,
+    STOP = 2,
+  };
+  typedef enum
+  {
+    HTTP_IDLE,    // waiting for a client
+    HTTP_REQUEST, // reading the request line and headers
+    HTTP_BODY,    // reading the POST body
+    HTTP_RESPOND, // streaming the response
+  } http_state_t;
+  const char *_name;
+  WiFiServer _server = WiFiServer(PORTAL_HTTP_PORT);
+  WiFiUDP _udp;
+  WiFiClient _client;
+  http_state_t _http = HTTP_IDLE;
+  unsigned long _client_time = 0, _poll_time = 0;
+  char _line[PORTAL_LINE_SIZE];
+  size_t _line_len = 0;
+  char _body[PORTAL_BODY_SIZE];
+  size_t _body_len = 0, _content_length = 0;
+  bool _request_line = true, _post = false, _root = false;
+  const portal_segment_t *_response = NULL;
+  size_t _segment = 0, _offset = 0;
+  uint8_t _packet[PORTAL_DNS_SIZE];
+  char _list[PORTAL_MAX_SSID * (PORTAL_SSID_SIZE + 20)]; // pre-rendered <option> list of the scanned networks
+  portal_segment_t _form[4];
+  char _ssid[PORTAL_SSID_SIZE], _pass[PORTAL_PASS_SIZE];
+  bool _accepted = false, _received = false;
+  unsigned int _dns_count = 0, _http_count = 0;
+
+  void render_list(int count);
+  void dns();
+  void http();
+  void http_line();
+  void http_respond();
+  void http_close();
+  void parse_form();
+
+public:
+  ConfigPortal() : StateMachine(STATE(state_idle)) {};
+  void begin(const char *name) { _name = name; run(START); }
+  void end() { run(STOP); }
+  bool is_open() { return !IN_STATE(idle); }
+  bool received() { return _received; } // credentials were received, and the confirmation page was sent
+  const char *ssid() { return _ssid; }
+  const char *pass() { return _pass; }
+  unsigned int dns_count() { return _dns_count; }
+  unsigned int http_count() { return _http_count; }
+  virtual const char *get_state_name();
+
+protected:
+  void state_idle();
+  void state_scan();
+  void state_ap();
+  void state_listen();
+};
+
+extern ConfigPortal configPortal;
+
+#endif // PORTAL_H
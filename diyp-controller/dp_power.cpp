@@ -0,0 +1,172 @@
+/*
+ diyPresso mains power budget, shared with the other machines on the circuit
+ Implemented as a Finite State Machine, run from the main loop
+ (c) 2025 diyPresso
+ */
+#include "dp.h"
+#include <WiFiNINA.h>
+#include "dp_hardware.h"
+#include "dp_heater.h"
+#include "dp_boiler.h"
+#include "dp_brew.h"
+#include "dp_settings.h"
+#include "dp_crc.h"
+#include "dp_mqtt.h"
+#include "dp_wifi.h"
+#include "dp_power.h"
+
+PowerBudget powerBudget = PowerBudget();
+
+static void power_handler(const char *topic, char *payload, int size)
+{
+  if (strcmp(topic, POWER_BUDGET_TOPIC) == 0)
+    powerBudget.configure(payload);
+  else
+    powerBudget.announcement(payload);
+}
+
+// Read the stored budget from the Wifi module, returns false if there is none
+bool PowerBudget::load()
+{
+  WiFiStorageFile file = WiFiStorage.open(POWER_FILE);
+  if (!file)
+    return false;
+  file.seek(0);
+  bool ok = file.read(&_config, sizeof(_config)) == sizeof(_config);
+  file.close();
+  if (!ok)
+    _config.budget = 0;
+  return ok;
+}
+
+bool PowerBudget::store()
+{
+  WiFiStorageFile file = WiFiStorage.open(POWER_FILE);
+  if (!_config.budget)
+  {
+    file.erase();
+    file.close();
+    return true;
+  }
+  bool ok = file.write(&_config, sizeof(_config)) == sizeof(_config);
+  file.close();
+  return ok;
+}
+
+// Budget message: "budget=<W>,failsafe=<W>"
+void PowerBudget::configure(char *payload)
+{
+  power_config_t config = {0, 0};
+  for (char *item = strtok(payload, ","); item; item = strtok(NULL, ","))
+  {
+    char *value = strchr(item, '=');
+    if (!value)
+      continue;
+    *value++ = 0;
+    if (strcmp(item, "budget") == 0)
+      config.budget = atoi(value);
+    else if (strcmp(item, "failsafe") == 0)
+      config.failsafe = atoi(value);
+  }
+  config.failsafe = min(config.failsafe, config.budget);
+  if (config.budget == _config.budget && config.failsafe == _config.failsafe)
+    return; // the retained message is received again on every connect
+  _config = config;
+  _leases.budget(_config.budget, _config.failsafe);
+  store();
+}
+
+// Announcement: "<id> <priority> <demand> <claim>", our own confirms that the broker relays our claims
+void PowerBudget::announcement(char *payload)
+{
+  unsigned long id;
+  unsigned int priority, demand, claim;
+  if (sscanf(payload, "%lx %u %u %u", &id, &priority, &demand, &claim) != 4)
+    return;
+  if (id == _leases.id())
+    _echo_time = max(millis(), 1UL);
+  else
+    _leases.receive(id, priority, demand, claim, millis());
+}
+
+// Announce our demand and claim once per tick
+void PowerBudget::tick(uint16_t failsafe)
+{
+  _demand = max(_demand, heaterDevice.power());
+  if (millis() - _tick_time < POWER_TICK_MSEC)
+    return;
+  _tick_time = millis();
+
+  uint8_t priority = brewProcess.is_busy() ? POWER_PRIORITY_BREWING
+                     : boilerController.is_ready() ? POWER_PRIORITY_READY : POWER_PRIORITY_HEATING;
+  uint16_t demand = _demand * HEATER_RATED_POWER / 100.0;
+  uint16_t claim = max(_leases.tick(priority, demand, millis()), failsafe); // we may use the failsafe power
+  char buf[40];
+  sprintf(buf, "%08lX %u %u %u", (unsigned long)_leases.id(), priority, demand, claim);
+  mqttDevice.publish_to(POWER_NODES_TOPIC, buf);
+  _demand = heaterDevice.power();
+}
+
+// Identify the machine and load the stored budget, false if the Wifi module does not answer
+bool PowerBudget::start()
+{
+  byte mac[6];
+  if (WiFi.status() == WL_NO_SHIELD) // also initializes the Wifi module driver, needed for WiFiStorage
+    return false;
+  WiFi.macAddress(mac);
+  _leases.id(dp_crc32(mac, sizeof(mac)));
+  mqttDevice.subscribe(POWER_BUDGET_TOPIC, power_handler);
+  mqttDevice.subscribe(POWER_NODES_TOPIC, power_handler);
+  if (load())
+    _leases.budget(_config.budget, _config.failsafe);
+  return true;
+}
+
+void PowerBudget::state_off()
+{
+  ON_MESSAGE(START)
+    _starting = true;
+  if (_starting && !wifiManager.busy() && millis() - _tick_time >= POWER_TICK_MSEC) // retried until the module answers
+  {
+    _tick_time = millis();
+    _starting = !start();
+  }
+  heaterDevice.limit(100.0);
+  if (_config.budget)
+    NEXT(state_failsafe);
+}
+
+// Local cap: the broker is not reachable (or our announcements are not relayed)
+void PowerBudget::state_failsafe()
+{
+  ON_ENTRY()
+  {
+    if (is_prev_state(STATE(state_shared)))
+      _failsafes++;
+  }
+  tick(_config.failsafe);
+  heaterDevice.limit(100.0 * _config.failsafe / HEATER_RATED_POWER);
+  if (!_config.budget)
+    NEXT(state_off);
+  else if (heard() && mqttDevice.is_connected())
+    NEXT(state_shared);
+}
+
+// Use the power granted by the leases
+void PowerBudget::state_shared()
+{
+  tick(0);
+  heaterDevice.limit(100.0 * _leases.grant() / HEATER_RATED_POWER);
+  if (!_config.budget)
+    NEXT(state_off);
+  else if (!heard() || !mqttDevice.is_connected())
+    NEXT(state_failsafe);
+}
+
+const char *PowerBudget::get_state_name()
+{
+  RETURN_STATE_NAME(off);
+  RETURN_STATE_NAME(failsafe);
+  RETURN_STATE_NAME(shared);
+  RETURN_UNKNOWN_STATE_NAME();
+}
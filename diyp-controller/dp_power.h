@@ -0,0 +1,77 @@
+/*
+  Mains power budget shared by the machines on one circuit
+  (c) 2025 diyPresso - CC-BY-NC
+
+  The budget is configured for all machines at once with a retained message on POWER_BUDGET_TOPIC:
+    "budget=3000,failsafe=600" [W]   (budget=0 switches the coordination off)
+  It is stored on the Wifi module, so it is known at power-on, before the network is up. The module is only used when
+  Wifi is on: the startup process starts the budget then.
+
+  Every POWER_TICK_MSEC each machine announces its priority (brewing, ready, heating), heater demand and claim on
+  POWER_NODES_TOPIC: "<id> <priority> <demand> <claim>". The claims are leases, see dp_lease.h. The heater power is
+  limited to the granted power.
+
+  Fail safe: until our own announcement is received back from the broker (and when it is not received anymore for
+  POWER_LEASE_MSEC), the heater is limited to the failsafe power. Others keep that power reserved for a machine they
+  do not hear anymore. Choose the budget with some margin below the rating of the circuit, as the power of a machine
+  that joins is only accounted after its first announcement.
+*/
+#ifndef POWER_H
+#define POWER_H
+
+#include <Arduino.h>
+#include "dp_lease.h"
+
+#undef _DP_FSM_TYPE
+#define _DP_FSM_TYPE PowerBudget // used for the state machine macro NEXT()
+#include "dp_fsm.h"
+
+#define POWER_BUDGET_TOPIC "diyPressoOne/power/budget"  // retained configuration of the budget
+#define POWER_NODES_TOPIC "diyPressoOne/power/nodes"    // announcements of all machines
+#define POWER_FILE "/fs/power"                          // stored budget on the Wifi module
+
+class PowerBudget : public StateMachine<PowerBudget>
+{
+private:
+  enum PowerBudgetMessages
+  {
+    START = 1,
+  };
+  typedef struct
+  {
+    uint16_t budget, failsafe; // [W]
+  } power_config_t;
+  power_config_t _config = {0, 0};
+  PowerLeases _leases;
+  unsigned long _tick_time = 0, _echo_time = 0, _failsafes = 0;
+  double _demand = 0; // max requested heater power since the last tick [%]
+  bool _starting = false;
+  bool start();
+  bool load();
+  bool store();
+  void tick(uint16_t limit);
+  bool heard() { return _echo_time && millis() - _echo_time < POWER_LEASE_MSEC; }
+
+public:
+  PowerBudget() : StateMachine(STATE(state_off)) {};
+  void begin() { run(START); } // from the loop, when the Wifi module is used
+  void configure(char *payload);
+  void announcement(char *payload);
+  bool is_active() { return !IN_STATE(off); }
+  bool is_failsafe() { return IN_STATE(failsafe); }
+  unsigned int budget() { return _config.budget; }
+  unsigned int grant() { return _leases.grant(); }
+  unsigned int claim() { return _leases.claim(); }
+  int nodes() { return _leases.nodes(); }
+  unsigned long failsafes() { return _failsafes; } // times the shared budget was left for the local cap
+  virtual const char *get_state_name();
+
+protected:
+  void state_off();
+  void state_failsafe();
+  void state_shared();
+};
+
+extern PowerBudget powerBudget;
+
+#endif // POWER_H
@@ -3,16 +3,35 @@
 
 #include <Arduino.h>
 #include "dp_hardware.h"
+#include "dp_heater.h"
+#include "dp_fastpin.h"
+
+typedef FastPin<PIN_SSR_PUMP> PumpSsr;
 
 class PumpDevice
 {
     private:       
       bool _on=false;
+      unsigned long _on_time=0; // [msec] timestamp of last switch-on
+      double _energy=0.0;       // [J] energy of completed pump runs
+      double running() { return _on ? PUMP_RATED_POWER * (millis() - _on_time) / 1000.0 : 0.0; } // [J] energy of current run
     public:
-      PumpDevice() { pinMode(PIN_SSR_PUMP, OUTPUT); off(); }
-      void on(void) { _on=true; digitalWrite(PIN_SSR_PUMP, HIGH); } 
-      void off() { _on = false; digitalWrite(PIN_SSR_PUMP, LOW); }
+      PumpDevice() { PumpSsr::output(); off(); }
+      void on(void)
+      {
+        if ( !_on )
+        {
+          _on_time = millis();
+          _on = true;
+          heaterDevice.control(); // the heater is switched off during the inrush of the pump (see dp_arbiter.h)
+        }
+        PumpSsr::high();
+      }
+      void off() { _energy += running(); _on = false; PumpSsr::low(); }
       bool is_on(void) { return _on; } 
+      unsigned long on_time() { return _on ? millis() - _on_time : 0; } // time since switch-on [msec]
+      double energy() { return (_energy + running()) / 3600.0; } // consumed energy in [Wh]
+      void energy(double wh) { _energy = wh * 3600.0 - running(); } // restore energy counter [Wh]
 };
 
 extern PumpDevice pumpDevice;
@@ -0,0 +1,35 @@
+/*
+  Quadrature and push button decoder of the rotary encoder, driven by edges
+  (c) 2025 diyPresso - CC-BY-NC
+*/
+#include "dp_quadrature.h"
+
+// Quarter steps of a transition [previous << 2 | current]: 3 -> 1 -> 0 -> 2 -> 3 is up (A falls with B low)
+static const int8_t quarters[16] = {0, -1, 1, 0, 1, 0, 0, -1, -1, 0, 0, 1, 0, 1, -1, 0};
+
+void QuadratureDecoder::begin(uint8_t ab, bool pressed, uint32_t now)
+{
+  _ab = ab & 3;
+  _quarters = 0;
+  _switch.begin(pressed, now);
+}
+
+void QuadratureDecoder::rotate(uint8_t ab)
+{
+  ab &= 3;
+  _quarters += quarters[_ab << 2 | ab];
+  _ab = ab;
+  if (ab != QUAD_DETENT)
+    return;
+  _position += (_quarters + (_quarters > 0 ? 2 : -2)) / 4; // the detents, rounded: a missed edge is half of one
+  _quarters = 0;
+}
+
+bool QuadratureDecoder::button(bool pressed, uint32_t now)
+{
+  if (!_switch.update(pressed, now))
+    return false;
+  if (_switch.state())
+    _presses++;
+  return true;
+}
@@ -0,0 +1,48 @@
+/*
+  Quadrature and push button decoder of the rotary encoder, driven by edges
+  (c) 2025 diyPresso - CC-BY-NC
+
+  rotate() takes the levels of A and B at every edge of either (the EIC interrupt). The transitions of the Gray code
+  add quarter steps, an invalid transition (both changed, an edge was missed) adds nothing; back in the detent (both
+  high, the pull-ups) the quarters count as steps of four, rounded: a missed edge loses no step, half a turn back
+  none either. A bouncing contact goes back and forth between two states and adds up to nothing, no deglitch timing
+  is needed.
+
+  button() takes the level of the switch with a timestamp, at its changes and when polled, through a Debouncer
+  (dp_events.h): a level counts once it was stable for QUAD_DEBOUNCE_USEC, a press is counted at the next call after
+  that and starts at the edge it began with, so the press time does not depend on how often it is polled. A tap
+  shorter than the polling interval is still counted, at the release.
+
+  Portable C++, no Arduino dependencies: the host test with synthetic edge sequences is server/encoder_sim.
+*/
+#ifndef QUADRATURE_H
+#define QUADRATURE_H
+
+#include <stdint.h>
+#include "dp_events.h"
+
+#define QUAD_DEBOUNCE_USEC 10000 // the switch is stable for this long [usec]
+#define QUAD_DETENT 3            // A and B high: the rest position
+
+class QuadratureDecoder
+{
+private:
+  volatile long _position = 0;
+  uint8_t _ab = QUAD_DETENT;      // the levels of A (bit 0) and B (bit 1)
+  int8_t _quarters = 0;           // since the detent
+  Debouncer _switch = Debouncer(QUAD_DEBOUNCE_USEC); // true: pressed
+  volatile unsigned long _presses = 0;
+
+public:
+  void begin(uint8_t ab, bool pressed, uint32_t now); // the levels at the start
+  void rotate(uint8_t ab);                           // A: bit 0, B: bit 1
+  bool button(bool pressed, uint32_t now);           // [usec], true: pressed or released
+  long position() { return _position; }
+  void set(long position) { _position = position; }
+  unsigned long presses() { return _presses; }
+  bool pressed() { return _switch.state(); }
+  uint32_t edge() { return _switch.since(); } // [usec] start of the press, or of the release
+  uint32_t press_time(uint32_t now) { return pressed() ? now - edge() : 0; } // [usec], 0: released
+};
+
+#endif // QUADRATURE_H
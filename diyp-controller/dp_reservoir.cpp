@@ -37,9 +37,9 @@ void Reservoir::read()
   }
 }
 
-const char *Reservoir::get_error_text()
+const char *Reservoir::get_error_text(reservoir_error_t error)
 {
-    switch( _error )
+    switch( error )
     {
       case RESERVOIR_ERROR_NONE: return "OK"; break;
       case RESERVOIR_ERROR_OUT_OF_RANGE: return "OUT_OF_RANGE"; break;
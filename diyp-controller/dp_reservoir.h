@@ -38,7 +38,8 @@ class Reservoir
       bool is_almost_empty() { return level() < RESERVOIR_ALMOST_EMPTY_WARNING_LEVEL; } // return true if under warning limit
       bool is_error() { return _error != RESERVOIR_ERROR_NONE; }
       reservoir_error_t error() { return _error; }
-      const char *get_error_text();
+      const char *get_error_text() { return get_error_text(_error); }
+      static const char *get_error_text(reservoir_error_t error);
       void clear_error() { _error = RESERVOIR_ERROR_NONE; }
 };
 
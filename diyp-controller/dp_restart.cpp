@@ -0,0 +1,95 @@
+/*
+  Warm restart after watchdog or software reset, using no-init RAM
+  (c) 2025 diyPresso - CC-BY-NC
+ */
+#include "dp.h"
+#include "dp_restart.h"
+#include "dp_settings.h"
+#include "dp_crc.h"
+#include "dp_boiler.h"
+#include "dp_brew.h"
+#include "dp_time.h"
+
+WarmRestart warmRestart;
+
+// Not cleared or initialized by the startup code: survives a reset as long as the supply is stable
+__attribute__((section(".noinit"))) static WarmRestart::warm_state_t warm_state;
+extern char __noinit_start__ __attribute__((weak)); // defined by dp_flash_with_bootloader.ld
+
+static_assert(sizeof(WarmRestart::warm_state_t) <= WARM_NOINIT_SIZE, "the state block fits in the NOINIT region");
+static_assert(WARM_NOINIT_ADDR + WARM_NOINIT_SIZE == HMCRAMC0_ADDR + HMCRAMC0_SIZE - 4,
+              "the NOINIT region ends at the double tap magic of the bootloader, the last word of RAM");
+
+unsigned long WarmRestart::crc(warm_state_t *s)
+{
+    return dp_crc32(((unsigned char *)s) + 4, sizeof(warm_state_t) - 4);
+}
+
+/// @brief Determine the reset cause and check the state block. Call first thing in setup()
+void WarmRestart::init()
+{
+    _cause = PM->RCAUSE.reg;
+    _placed = &__noinit_start__ == (char *)&warm_state && (uintptr_t)&warm_state == WARM_NOINIT_ADDR;
+    _valid = _placed && warm_state.magic == WARM_MAGIC && crc(&warm_state) == warm_state.crc;
+    _warm = _valid && (_cause & (PM_RCAUSE_WDT | PM_RCAUSE_SYST));
+    if (!_valid)
+    {
+        memset(&warm_state, 0, sizeof(warm_state));
+        warm_state.magic = WARM_MAGIC;
+    }
+    if (_warm)
+        warm_state.restarts += 1;
+    warm_state.resetCause = _cause;
+    warm_state.crc = crc(&warm_state);
+}
+
+/// @brief Resume the saved boiler and brew state. Call after the boiler is initialized and the settings are applied
+void WarmRestart::restore()
+{
+    if (!_warm)
+        return;
+    boilerController.set_temp(warm_state.setTemp);
+    boilerController.integral(warm_state.integral);
+    if (warm_state.boilerState == BOILER_STATE_HEATING || warm_state.boilerState == BOILER_STATE_READY ||
+        warm_state.boilerState == BOILER_STATE_BREW)
+        boilerController.on();
+    // The brew process always restarts in init (commissioned: idle). A shot in progress is not resumed.
+    if (warm_state.brewState == BREW_STATE_SLEEP)
+    {
+        brewProcess.run();
+        brewProcess.sleep();
+    }
+}
+
+/// @brief Refresh the state block, called from the main loop
+void WarmRestart::update()
+{
+    if (time_since(_last_update) < WARM_UPDATE_PERIOD_MSEC)
+        return;
+    _last_update = millis();
+    warm_state.boilerState = boilerController.get_state();
+    warm_state.brewState = brewProcess.get_state();
+    warm_state.setTemp = boilerController.set_temp();
+    warm_state.integral = boilerController.integral();
+    warm_state.crc = crc(&warm_state);
+}
+
+unsigned long WarmRestart::restarts()
+{
+    return warm_state.restarts;
+}
+
+const char *WarmRestart::get_reset_cause_text()
+{
+    if (_cause & PM_RCAUSE_WDT)
+        return "WATCHDOG";
+    if (_cause & PM_RCAUSE_SYST)
+        return "SOFTWARE";
+    if (_cause & PM_RCAUSE_EXT)
+        return "EXTERNAL";
+    if (_cause & (PM_RCAUSE_BOD33 | PM_RCAUSE_BOD12))
+        return "BROWN_OUT";
+    if (_cause & PM_RCAUSE_POR)
+        return "POWER_ON";
+    return "UNKNOWN";
+}
@@ -0,0 +1,57 @@
+/*
+  dp_restart class
+  Warm restart after a watchdog or software reset.
+
+  A small state block lives in a `.noinit` RAM section, that is not cleared by the startup code. The linker script
+  dp_flash_with_bootloader.ld (board_build.ldscript of platformio.ini) places it at WARM_NOINIT_ADDR: the top of RAM,
+  below the double tap magic of the bootloader (the last word), with the stack below it. init() checks the address of
+  the block: a build without the script (the Arduino IDE) leaves the section to the linker, and always starts cold.
+  It is refreshed from the main loop and protected with a magic number and CRC. After a watchdog or software reset
+  a valid block lets the controller skip the splash screen and resume heating with the last setpoint, FSM state and
+  PID integrator. The reset cause and restart counter are reported with `GET info`.
+  (c) 2025 diyPresso - CC-BY-NC
+*/
+#ifndef RESTART_H
+#define RESTART_H
+
+#include <Arduino.h>
+
+#define WARM_MAGIC 0x77524D53        // "wRMS"
+#define WARM_UPDATE_PERIOD_MSEC 100  // refresh period of the state block [msec]
+#define WARM_NOINIT_ADDR 0x20007FC0  // the NOINIT region of dp_flash_with_bootloader.ld
+#define WARM_NOINIT_SIZE 60          // up to the double tap magic of the bootloader [bytes]
+
+class WarmRestart
+{
+    public:
+        typedef struct __attribute__ ((packed)) warm_state_struct {
+            unsigned long int crc;          // crc of all the fields after the crc
+            unsigned long int magic;
+            unsigned long int restarts;     // number of warm restarts since the last power-on
+            unsigned char boilerState;      // boiler_state_t
+            unsigned char brewState;        // brew_state_t
+            unsigned char resetCause;       // PM->RCAUSE of the last reset
+            unsigned char reserved;
+            double setTemp;                 // [degC] boiler setpoint
+            double integral;                // PID integral term
+        } warm_state_t;
+    private:
+        bool _warm = false, _valid = false, _placed = false;
+        unsigned char _cause = 0;
+        unsigned long _last_update = 0;
+        unsigned long crc(warm_state_t *s);
+    public:
+        WarmRestart() {};
+        void init();
+        void restore();
+        void update();
+        bool is_warm() { return _warm; } // true if we resume after a watchdog or software reset
+        bool is_placed() { return _placed; } // the state block is in the NOINIT region of the linker script
+        unsigned long restarts();
+        unsigned char reset_cause() { return _cause; }
+        const char *get_reset_cause_text();
+};
+
+extern WarmRestart warmRestart;
+
+#endif // RESTART_H
@@ -14,6 +14,10 @@
     - GET settings
     - PUT settings temperature=98.50,P=7.00,I=0.30,D=80.00,ff_heat=3.00,ff_ready=10.00,ff_brew=80.00,tareWeight=0.00,trimWeight=0.00,preInfusionTime=3.00,infuseTime=1.00,extractTime=25.00,extractionWeight=0.00,commissioningDone=1,shotCounter=5,wifiMode=0
     or e.g. PUT settings temperature=98.00,commissioningDone=1
+    - POST sleep
+    - POST wakeup (start warming up)
+
+    The same commands are accepted on the MQTT command topic, see dp_mqtt.h
 
 */
 
@@ -23,6 +27,17 @@
 #include "dp_brew.h"
 #include "dp_boiler.h"
 #include "dp_reservoir.h"
+#include "dp_heater.h"
+#include "dp_pump.h"
+#include "dp_brownout.h"
+#include "dp_restart.h"
+#include "dp_startup.h"
+#include "dp_wifi.h"
+#include "dp_portal.h"
+#include "dp_mqtt.h"
+#include "dp_telemetry.h"
+#include "dp_power.h"
+#include "dp_arbiter.h"
 
 //initialize the class
 DpSerial dpSerial(115200);
@@ -42,30 +57,30 @@ void DpSerial::send(const String &data) {
     int start = 0;
     int end = data.indexOf('\n');
     while (end != -1) {
-        Serial.println(data.substring(start, end));
+        _out->println(data.substring(start, end));
         start = end + 1;
         end = data.indexOf('\n', start);
     }
     // Send the last part if there is no newline at the end
     if (start < data.length()) {
-        Serial.println(data.substring(start));
+        _out->println(data.substring(start));
     }
 }
 
 void DpSerial::send(double data) {
-    Serial.println(data);
+    _out->println(data);
 }
 
 void DpSerial::send(int data) {
-    Serial.println(data);
+    _out->println(data);
 }
 
 void DpSerial::send(char data) {
-    Serial.println(data);
+    _out->println(data);
 }
 
 void DpSerial::send(const char* data) {
-    Serial.println(data);
+    _out->println(data);
 }
 
 /* receives commands from serial bus and prasses them
@@ -79,18 +94,41 @@ void DpSerial::receive() {
 
     receivedData = Serial.readStringUntil('\n');
 
+    execute(receivedData, Serial);
+
+    send("echo: " + receivedData);
+}
+
+/* executes a command, the response is written to out
+   returns false if the command is unknown
+*/
+bool DpSerial::execute(const String &command, Print &out) {
+    bool known = true;
+    _out = &out;
+
     //GET info
-    if (receivedData.startsWith("GET info")) {
+    if (command.startsWith("GET info")) {
         send_info();
-    } else if (receivedData.startsWith("GET settings")) {
+    } else if (command.startsWith("GET settings")) {
         send_settings();
-    } else if (receivedData.startsWith("PUT settings "))
-    {
-        put_settings(receivedData.substring(String("SET settings ").length()));
+    } else if (command.startsWith("PUT settings ")) {
+        put_settings(command.substring(String("PUT settings ").length()));
+    } else if (command.startsWith("POST sleep")) {
+        if (brewProcess.sleep())
+            send("POST sleep OK");
+        else
+            send("POST sleep NOK, not possible in state " + String(brewProcess.get_state_name()));
+    } else if (command.startsWith("POST wakeup")) {
+        if (brewProcess.wakeup())
+            send("POST wakeup OK, warming up.");
+        else
+            send("POST wakeup NOK, not sleeping.");
+    } else {
+        known = false;
     }
-    
 
-    send("echo: " + receivedData);
+    _out = &Serial;
+    return known;
 }
 
 void DpSerial::send_info() {
@@ -103,6 +141,64 @@ void DpSerial::send_info() {
     send("boilerControllerState=" + String(boilerController.get_state_name()));
     send("boilerControllerError=" + String(boilerController.get_error_text()));
     send("reservoirError=" + String(reservoir.get_error_text()));
+    send("startupState=" + String(startupProcess.get_state_name()));
+    send("wifiState=" + String(wifiManager.get_state_name()));
+    send("wifiAttempts=" + String(wifiManager.attempts()));
+    send("wifiDrops=" + String(wifiManager.drops()));
+    send("mqttState=" + String(mqttDevice.get_state_name()));
+    send("mqttConnects=" + String(mqttDevice.connects()));
+    send("mqttConnectErrors=" + String(mqttDevice.connect_errors()));
+    send("mqttDrops=" + String(mqttDevice.drops()));
+    send("mqttPublished=" + String(mqttDevice.published()));
+    send("mqttPublishErrors=" + String(mqttDevice.publish_errors()));
+    send("mqttConnectTime=" + String(mqttDevice.connect_duration()));
+    send("mqttSessionTime=" + String(mqttDevice.session_time()));
+    send("mqttCommands=" + String(mqttDevice.commands()));
+    send("mqttCommandErrors=" + String(mqttDevice.command_errors()));
+    send("mqttCommandUsec=" + String(mqttDevice.command_usec()));
+    send("mqttSubscribeErrors=" + String(mqttDevice.subscribe_errors()));
+    send("telemetryPending=" + String(telemetry.pending()));
+    send("telemetryPublished=" + String(telemetry.published()));
+    send("telemetryDropped=" + String(telemetry.dropped()));
+    send("telemetryBytes=" + String(telemetry.used()));
+    send("telemetryFormats=" + String(telemetry.formats()));
+    send("telemetryPushUsec=" + String(telemetry.push_usec()));
+    send("telemetryDrainUsec=" + String(telemetry.drain_usec()));
+    if (powerBudget.is_active()) {
+        send("powerState=" + String(powerBudget.get_state_name()));
+        send("powerBudget=" + String(powerBudget.budget()));
+        send("powerClaim=" + String(powerBudget.claim()));
+        send("powerGrant=" + String(powerBudget.grant()));
+        send("powerNodes=" + String(powerBudget.nodes()));
+        send("powerFailsafes=" + String(powerBudget.failsafes()));
+        send("heaterLimit=" + String(heaterDevice.limit()));
+    }
+    if (configPortal.is_open()) {
+        send("portalState=" + String(configPortal.get_state_name()));
+        send("portalDnsQueries=" + String(configPortal.dns_count()));
+        send("portalHttpRequests=" + String(configPortal.http_count()));
+    }
+    send("heaterFirstOn=" + String(heaterDevice.first_on()));
+    send("resetCause=" + String(warmRestart.get_reset_cause_text()));
+    send("warmRestart=" + String(warmRestart.is_warm() ? 1 : 0));
+    send("warmRestartPlaced=" + String(warmRestart.is_placed() ? 1 : 0));
+    send("restartCount=" + String(warmRestart.restarts()));
+    send("shotCounter=" + String(settings.shotCounter()));
+    send("heaterEnergy=" + String(heaterDevice.energy()));
+    send("pumpEnergy=" + String(pumpDevice.energy()));
+    send("arbiterDebt=" + String(powerArbiter.debt()));
+    send("arbiterWithheld=" + String(powerArbiter.withheld()));
+    send("arbiterDeferred=" + String(powerArbiter.deferred()));
+    send("runtime=" + String(brownOut.runtime()));
+    send("powerLossSaveTime=" + String(brownOut.save_time()));
+    send("powerLossEraseTime=" + String(brownOut.erase_time()));
+    send("powerLossSkipped=" + String(brownOut.skipped()));
+    send("powerLossFull=" + String(brownOut.full()));
+    if (brownOut.restored()) {
+        send("powerLossSequence=" + String(brownOut.last()->sequence));
+        send("powerLossBoilerError=" + String(brownOut.last()->boilerError));
+        send("powerLossBrewError=" + String(brownOut.last()->brewError));
+    }
     send("GET info OK");
 }
 
@@ -111,19 +207,19 @@ void DpSerial::send_settings() {
     send("GET settings OK");
 }
 
-void DpSerial::put_settings(String value) {
+void DpSerial::put_settings(const String &value) {
 
-    int res_deserialize = settings.deserialize(value);
+    int res_deserialize = settings.deserialize(value.c_str());
 
     if (res_deserialize == 0) {
 
         send(settings.temperature());
         int res_save = settings.save(); // all good, save the settings
 
-        if (res_save = 1) {
+        if (res_save == 1) {
             send("PUT settings OK, settings saved.");
             settings.apply();
-        } else if (res_save = 0) {
+        } else if (res_save == 0) {
             send("PUT settings OK, no changes.");
         } else {
             send("PUT settings NOK, unknown return code when saving settings: " + String(res_save));
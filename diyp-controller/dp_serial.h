@@ -15,12 +15,14 @@ class DpSerial {
         void send(char data);
         void send(const char *data);
         void receive();
+        bool execute(const String &command, Print &out);
         void send_info();
         void send_settings();
 
     private:
         unsigned long _baudRate;
-        void put_settings(String value);
+        Print *_out = &Serial; // output of the command being executed
+        void put_settings(const String &value);
 };
 
 extern DpSerial dpSerial;
@@ -3,7 +3,7 @@
   Loads and Saves the persistent settings.
   if no changes are made to the settings, nothing is saved
   If no valid data is present, default values are saved
-  the setters check the range of the values to save, to prevent incorrect data
+  the setters check the range of the values to save, to prevent incorrect data (see dp_settings_table.h)
 */
 
 #ifndef DpSettings_h
@@ -11,32 +11,17 @@
 
 #include "Arduino.h"
 #include "dp_serial.h"
+#include "dp_settings_table.h"
 
-typedef enum wifi_modes { WIFI_MODE_OFF, WIFI_MODE_ON, WIFI_MODE_AP };
+enum wifi_modes { WIFI_MODE_OFF, WIFI_MODE_ON, WIFI_MODE_AP };
 
 class DpSettings
 {
     private:
-        typedef struct __attribute__ ((packed)) settings_struct { // a packed struct has no alignment of fields
-            unsigned long int crc; // crc of all the the fields after the crc
-            unsigned long int version; // settings struct version
-            double temperature;
-            double preInfusionTime;
-            double infusionTime;
-            double extractionTime;
-            double extractionWeight;
-            double p, i, d, ff_heat, ff_ready, ff_brew;
-            double tareWeight;
-            double trimWeight;
-            int commissioningDone;
-            int shotCounter;
-            int wifiMode;
-        } settings_t;
-        settings_t settings;
+        settings_t settings; // the fields are described by dp_settings_table.h
         void read(settings_t *s);
         void update_crc(void);
         bool crc_is_valid(settings_t *s);
-        unsigned long crc32(const unsigned char *s, size_t n);
     public:
         DpSettings();
         void defaults();
@@ -44,39 +29,45 @@ class DpSettings
         int save();
         void apply();
         String serialize();
-        int deserialize(String input);
+        int deserialize(const char *input);
+        double get(int id) { return settings_get(&settings, id); }
+        double set(int id, double value) { return settings_set(&settings, id, value); } // clamped to the range
         double temperature() { return settings.temperature; }
-        double temperature(double t) { return settings.temperature = min(104.0, max(t, 0.0)); }
+        double temperature(double t) { return set(SET_TEMPERATURE, t); }
         double preInfusionTime() { return settings.preInfusionTime; }
-        double preInfusionTime(double t) { return settings.preInfusionTime = min(60.0, max(t, 0.0)); }
+        double preInfusionTime(double t) { return set(SET_PRE_INFUSION_TIME, t); }
         double infusionTime() { return settings.infusionTime; }
-        double infusionTime(double t) { return settings.infusionTime = min(60.0, max(t, 0.0)); }
+        double infusionTime(double t) { return set(SET_INFUSION_TIME, t); }
         double extractionTime() { return settings.extractionTime; }
-        double extractionTime(double t) { return settings.extractionTime = min(60.0, max(t, 0.0)); }
+        double extractionTime(double t) { return set(SET_EXTRACTION_TIME, t); }
         double extractionWeight() { return settings.extractionWeight; }
-        double extractionWeight(double w) { return settings.extractionWeight = min(500.0, max(w, 1.0)); }
+        double extractionWeight(double w) { return set(SET_EXTRACTION_WEIGHT, w); }
         double P() { return settings.p; }
-        double P(double p) { return settings.p = min(10.0, max(p, 0.0)); }
+        double P(double p) { return set(SET_P, p); }
         double I() { return settings.i; }
-        double I(double i) { return settings.i = min(20.0, max(i, 0.00)); }
+        double I(double i) { return set(SET_I, i); }
         double D() { return settings.d; }
-        double D(double d) { return settings.d = min(100.0, max(d, 0.0)); }
+        double D(double d) { return set(SET_D, d); }
         double ff_heat() { return settings.ff_heat; }
-        double ff_heat(double ff) { return settings.ff_heat = min(100.0, max(ff, 0.0)); }
+        double ff_heat(double ff) { return set(SET_FF_HEAT, ff); }
         double ff_ready() { return settings.ff_ready; }
-        double ff_ready(double ff) { return settings.ff_ready = min(100.0, max(ff, 0.0)); }
+        double ff_ready(double ff) { return set(SET_FF_READY, ff); }
         double ff_brew() { return settings.ff_brew; }
-        double ff_brew(double ff) { return settings.ff_brew = min(100.0, max(ff, 0.0)); }
+        double ff_brew(double ff) { return set(SET_FF_BREW, ff); }
         double tareWeight() { return settings.tareWeight; }
-        double tareWeight(double t) { return settings.tareWeight = min(2000.0, max(t, -2000.0)); }
+        double tareWeight(double t) { return set(SET_TARE_WEIGHT, t); }
         double trimWeight() { return settings.trimWeight; }
-        double trimWeight(double t) { return settings.trimWeight = min(10.0, max(t, -10.0)); }
+        double trimWeight(double t) { return set(SET_TRIM_WEIGHT, t); }
         int wifiMode() { return settings.wifiMode; }
-        int wifiMode(int state) { return settings.wifiMode = min(2, max(state, 0)); }
+        int wifiMode(int state) { return set(SET_WIFI_MODE, state); }
+        int mainsLimit() { return settings.mainsLimit; }
+        int mainsLimit(int watt) { return set(SET_MAINS_LIMIT, watt); }
+        int telemetryFormat() { return settings.telemetryFormat; }
+        int telemetryFormat(int format) { return set(SET_TELEMETRY_FORMAT, format); }
         int shotCounter() { return settings.shotCounter; }
-        int shotCounter(int count) { return settings.shotCounter = min(INT32_MAX, max(count, 0)); }
+        int shotCounter(int count) { return set(SET_SHOT_COUNTER, count); }
         int commissioningDone() { return settings.commissioningDone; }
-        int commissioningDone(int state) { return settings.commissioningDone = min(1, max(state, 0)); }
+        int commissioningDone(int state) { return set(SET_COMMISSIONING_DONE, state); }
         int incShotCounter() { return settings.shotCounter += 1; }
         void zeroShotCounter() { settings.shotCounter = 0; }
 };
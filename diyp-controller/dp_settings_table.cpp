@@ -0,0 +1,163 @@
+/*
+  Descriptor table of the persistent settings
+  (c) 2025 diyPresso - CC-BY-NC
+*/
+#include <stddef.h>
+#include <string.h>
+#include "dp_settings_table.h"
+#include "dp_format.h"
+#include "dp_arbiter.h"
+
+#define FIELD(f) offsetof(settings_t, f)
+
+// key, type, offset, min, max, default, menu: step, decimals, label, unit
+static constexpr setting_desc_t table[] = {
+    {"temperature", SETTING_DOUBLE, FIELD(temperature), 0, 104, 98, 0.5, 2, "Temperature", "\337C"},
+    {"preInfusionTime", SETTING_DOUBLE, FIELD(preInfusionTime), 0, 60, 3, 0.1, 2, "Pre-infusion time", "sec"},
+    {"infusionTime", SETTING_DOUBLE, FIELD(infusionTime), 0, 60, 1, 0.1, 2, "Infusion time", "sec"},
+    {"extractionTime", SETTING_DOUBLE, FIELD(extractionTime), 0, 60, 25, 0.5, 2, "Extraction time", "sec"},
+    {"extractionWeight", SETTING_DOUBLE, FIELD(extractionWeight), 0, 500, 0, 0.5, 2, "Extraction weight", "gram"},
+    {"p", SETTING_DOUBLE, FIELD(p), 0, 10, 6.2, 0.2, 1, "P-Gain", "%/\337C"},
+    {"i", SETTING_DOUBLE, FIELD(i), 0, 20, 0.08, 0.01, 2, "I-Gain", "%/\337C/s"},
+    {"d", SETTING_DOUBLE, FIELD(d), 0, 100, 70, 0.2, 1, "D-Gain", "%s"},
+    {"ff_heat", SETTING_DOUBLE, FIELD(ff_heat), 0, 100, 6, 0.2, 1, "FF-heat Value", "%"},
+    {"ff_ready", SETTING_DOUBLE, FIELD(ff_ready), 0, 100, 6, 0.2, 1, "FF-ready Value", "%"},
+    {"ff_brew", SETTING_DOUBLE, FIELD(ff_brew), 0, 100, 35, 0.2, 1, "FF-brew Value", "%"},
+    {"tareWeight", SETTING_DOUBLE, FIELD(tareWeight), -2000, 2000, 0, 0, 1, "Tare weight", "gram"},
+    {"trimWeight", SETTING_DOUBLE, FIELD(trimWeight), -10, 10, 0, 0.05, 2, "Weight trim", "%"},
+    {"commissioningDone", SETTING_SELECT, FIELD(commissioningDone), 0, 1, 0, 1, 0, "Commissioning done", "NO\0YES\0"},
+    {"shotCounter", SETTING_INT, FIELD(shotCounter), 0, INT32_MAX, 0, 0, 0, "Shot counter", "shots"},
+    {"wifiMode", SETTING_SELECT, FIELD(wifiMode), 0, 2, 0, 1, 0, "WIFI Mode", "OFF\0ON\0CONFIG-AP\0"},
+    {"mainsLimit", SETTING_INT, FIELD(mainsLimit), HEATER_RATED_POWER, 3680, ARBITER_LIMIT_W, 10, 0, "Mains limit", "W"},
+    {"telemetryFormat", SETTING_SELECT, FIELD(telemetryFormat), 0, 2, 0, 1, 0, "Telemetry", "LINE\0CBOR\0LINE+CBOR\0"}};
+
+// Other keys of the serial interface
+static constexpr struct
+{
+  const char *key;
+  int id;
+} aliases[] = {{"P", SET_P}, {"I", SET_I}, {"D", SET_D},
+               {"infuseTime", SET_INFUSION_TIME},      // deprecated alias for infusionTime
+               {"extractTime", SET_EXTRACTION_TIME}}; // deprecated alias for extractionTime
+
+#define TABLE_SIZE (int)(sizeof(table) / sizeof(table[0]))
+#define KEYS (TABLE_SIZE + (int)(sizeof(aliases) / sizeof(aliases[0])))
+#define SLOTS (1 << SETTINGS_HASH_BITS)
+
+static constexpr const char *key(int k) { return k < TABLE_SIZE ? table[k].key : aliases[k - TABLE_SIZE].key; }
+static constexpr int id(int k) { return k < TABLE_SIZE ? k : aliases[k - TABLE_SIZE].id; }
+static constexpr int length(const char *s) { return *s ? 1 + length(s + 1) : 0; }
+static constexpr uint32_t hash(int k) { return settings_hash(key(k), length(key(k))); }
+
+// The key in a slot, -1: none
+static constexpr int slot(uint32_t h, int k = 0) { return k == KEYS ? -1 : hash(k) == h ? k : slot(h, k + 1); }
+
+static constexpr bool unique(int k = 0, int j = 1)
+{
+  return k >= KEYS - 1 ? true : j == KEYS ? unique(k + 1, k + 2) : hash(k) != hash(j) && unique(k, j + 1);
+}
+static constexpr bool ordered(int k = 1) // the table in the order of settings_t, with the defaults in range
+{
+  return k == TABLE_SIZE ? table[0].min <= table[0].def && table[0].def <= table[0].max
+                         : table[k - 1].offset < table[k].offset && table[k].min <= table[k].def &&
+                               table[k].def <= table[k].max && ordered(k + 1);
+}
+static_assert(TABLE_SIZE == SETTINGS_COUNT, "an entry per setting_id_t");
+static_assert(ordered(), "the table in the order of settings_t, defaults in range");
+static_assert(unique(), "hash collision of the settings keys: choose another SETTINGS_HASH_SEED");
+static_assert(KEYS <= SLOTS, "more keys than slots: increase SETTINGS_HASH_BITS");
+
+#define SLOT1(h) slot(h)
+#define SLOT4(h) SLOT1(h), SLOT1(h + 1), SLOT1(h + 2), SLOT1(h + 3)
+#define SLOT16(h) SLOT4(h), SLOT4(h + 4), SLOT4(h + 8), SLOT4(h + 12)
+static const int8_t slots[SLOTS] = {SLOT16(0), SLOT16(16)};
+static_assert(SLOTS == 32, "the initializer of slots");
+
+const setting_desc_t *settings_desc(int id) { return id >= 0 && id < SETTINGS_COUNT ? &table[id] : NULL; }
+
+int settings_find(const char *s, int len)
+{
+  int k = slots[settings_hash(s, len)];
+  return k >= 0 && strncmp(key(k), s, len) == 0 && key(k)[len] == 0 ? id(k) : -1;
+}
+
+double settings_get(const settings_t *s, int id)
+{
+  const char *field = (const char *)s + table[id].offset;
+  if (table[id].type == SETTING_DOUBLE)
+  {
+    double value;
+    memcpy(&value, field, sizeof(value)); // packed: not aligned
+    return value;
+  }
+  int32_t value;
+  memcpy(&value, field, sizeof(value));
+  return value;
+}
+
+double settings_set(settings_t *s, int id, double value)
+{
+  const setting_desc_t &d = table[id];
+  value = value < d.min ? d.min : value > d.max ? d.max : value;
+  char *field = (char *)s + d.offset;
+  if (d.type == SETTING_DOUBLE)
+  {
+    memcpy(field, &value, sizeof(value));
+    return value;
+  }
+  int32_t i = (int32_t)value;
+  memcpy(field, &i, sizeof(i));
+  return i;
+}
+
+void settings_defaults(settings_t *s)
+{
+  s->version = SETTINGS_VERSION;
+  for (int id = 0; id < SETTINGS_COUNT; id++)
+    settings_set(s, id, table[id].def);
+}
+
+int settings_serialize(const settings_t *s, char *dest)
+{
+  char *d = dest;
+  for (int id = 0; id < SETTINGS_COUNT; id++)
+  {
+    strcpy(d, table[id].key);
+    d += strlen(d);
+    *d++ = '=';
+    double value = settings_get(s, id);
+    if (table[id].type == SETTING_DOUBLE)
+      d += format_float(d, value, FORMAT_MAX_DECIMALS);
+    else
+      d += format_fixed(d, (long)value);
+    *d++ = '\n';
+  }
+  *d = 0;
+  return d - dest;
+}
+
+int settings_deserialize(settings_t *s, const char *input)
+{
+  const char *p = input;
+  while (*p)
+  {
+    if (*p == ',' || *p == '\n' || *p == '\r')
+    {
+      p++;
+      continue;
+    }
+    const char *equal = strchr(p, '=');
+    if (!equal)
+      return -1;
+    int id = settings_find(p, equal - p);
+    if (id < 0)
+      return -2;
+    double value;
+    int n = parse_float(equal + 1, &value);
+    p = equal + 1 + n;
+    if (!n || (*p && *p != ',' && *p != '\n' && *p != '\r'))
+      return -1;
+    settings_set(s, id, value);
+  }
+  return 0;
+}
@@ -0,0 +1,98 @@
+/*
+  Descriptor table of the persistent settings
+  (c) 2025 diyPresso - CC-BY-NC
+
+  One constant entry per field of settings_t: the key of the serial interface, type, offset, range, default and the
+  menu step, decimals, label and unit. The storage (defaults, clamping), the serialization, the key lookup of the
+  serial PUT and the settings menu all work from it; a new setting is a field, an id and an entry.
+
+  Key lookup is a perfect hash, checked at compile time: FNV-1a with SETTINGS_HASH_SEED, the top SETTINGS_HASH_BITS
+  bits index a slot table built by the compiler. When a new key collides the build fails, choose another seed (the
+  first that fits is fine).
+
+  Portable C++, no Arduino dependencies: the host round trip check and benchmark is server/settings_bench.
+*/
+#ifndef SETTINGS_TABLE_H
+#define SETTINGS_TABLE_H
+
+#include <stdint.h>
+
+#define SETTINGS_VERSION 3 // Update this if new fields are added to settings_t to prevent incorrect reads
+#define SETTINGS_HASH_SEED 27131
+#define SETTINGS_HASH_BITS 5
+#define SETTINGS_TEXT_SIZE 384 // settings_serialize(): all keys and values, with room for the version and crc
+
+typedef struct __attribute__((packed)) // a packed struct has no alignment of fields, the layout in the EEPROM
+{
+  uint32_t crc;     // crc of all the the fields after the crc
+  uint32_t version; // settings struct version
+  double temperature;
+  double preInfusionTime;
+  double infusionTime;
+  double extractionTime;
+  double extractionWeight;
+  double p, i, d, ff_heat, ff_ready, ff_brew;
+  double tareWeight;
+  double trimWeight;
+  int32_t commissioningDone;
+  int32_t shotCounter;
+  int32_t wifiMode;
+  int32_t mainsLimit; // [W] max combined power of the heater and the pump (see dp_arbiter.h)
+  int32_t telemetryFormat; // the telemetry formats (see dp_telemetry.h) - 1
+} settings_t;
+
+typedef enum // the order of the table and settings_t
+{
+  SET_TEMPERATURE,
+  SET_PRE_INFUSION_TIME,
+  SET_INFUSION_TIME,
+  SET_EXTRACTION_TIME,
+  SET_EXTRACTION_WEIGHT,
+  SET_P,
+  SET_I,
+  SET_D,
+  SET_FF_HEAT,
+  SET_FF_READY,
+  SET_FF_BREW,
+  SET_TARE_WEIGHT,
+  SET_TRIM_WEIGHT,
+  SET_COMMISSIONING_DONE,
+  SET_SHOT_COUNTER,
+  SET_WIFI_MODE,
+  SET_MAINS_LIMIT,
+  SET_TELEMETRY_FORMAT,
+  SETTINGS_COUNT
+} setting_id_t;
+
+typedef enum
+{
+  SETTING_DOUBLE,
+  SETTING_INT,
+  SETTING_SELECT // int, the index in the list of names in unit
+} setting_type_t;
+
+typedef struct
+{
+  const char *key; // serial interface
+  setting_type_t type;
+  uint16_t offset; // in settings_t
+  double min, max, def;
+  double step;      // menu increment per encoder step, 0: read only
+  uint8_t decimals; // menu
+  const char *label, *unit; // menu; SETTING_SELECT: an `ASCII-ZERO` separated list of the names
+} setting_desc_t;
+
+constexpr uint32_t settings_hash(const char *s, int n, uint32_t h = SETTINGS_HASH_SEED)
+{
+  return n ? settings_hash(s + 1, n - 1, (h ^ (uint8_t)*s) * 16777619u) : h >> (32 - SETTINGS_HASH_BITS);
+}
+
+extern const setting_desc_t *settings_desc(int id);
+extern int settings_find(const char *key, int len);                // setting_id_t, -1: unknown key
+extern double settings_get(const settings_t *s, int id);
+extern double settings_set(settings_t *s, int id, double value);   // clamped to the range, returns the value set
+extern void settings_defaults(settings_t *s);                      // not the crc
+extern int settings_serialize(const settings_t *s, char *dest);    // "key=value\n" lines, returns strlen
+extern int settings_deserialize(settings_t *s, const char *input); // "key=value,...", 0: OK, -1: format, -2: key
+
+#endif // SETTINGS_TABLE_H
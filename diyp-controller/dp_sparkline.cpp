@@ -0,0 +1,65 @@
+/*
+  Scrolling sparkline graph in the custom characters of the LCD
+  (c) 2025 diyPresso - CC-BY-NC
+*/
+#include <math.h>
+#include <string.h>
+#include "dp_sparkline.h"
+
+void Sparkline::add(double value)
+{
+  _samples[_next] = value;
+  _next = (_next + 1) % SPARK_WIDTH;
+  if (_count < SPARK_WIDTH)
+    _count++;
+  _added++;
+}
+
+double Sparkline::last() const
+{
+  return _count ? _samples[(_next + SPARK_WIDTH - 1) % SPARK_WIDTH] : NAN;
+}
+
+void Sparkline::scale(double *low, double *high) const
+{
+  double lo = INFINITY, hi = -INFINITY;
+  for (int i = 0; i < _count; i++)
+  {
+    lo = _samples[i] < lo ? _samples[i] : lo;
+    hi = _samples[i] > hi ? _samples[i] : hi;
+  }
+  if (!_count)
+    lo = hi = 0;
+  if (hi - lo < _span) // a flat line in the middle, not noise over the full height
+  {
+    double mid = (lo + hi) / 2;
+    lo = mid - _span / 2;
+    hi = mid + _span / 2;
+  }
+  *low = lo;
+  *high = hi;
+}
+
+void Sparkline::render(uint8_t *chars) const
+{
+  memset(chars, 0, SPARK_CHARS * 8);
+  double lo, hi;
+  scale(&lo, &hi);
+  int prev = -1;
+  for (int i = 0; i < _count; i++)
+  {
+    int x = SPARK_WIDTH - _count + i; // right aligned
+    double v = _samples[(_next + SPARK_WIDTH - _count + i) % SPARK_WIDTH];
+    if (isnan(v)) // a sensor error: a gap
+    {
+      prev = -1;
+      continue;
+    }
+    int y = (int)floor((v - lo) / (hi - lo) * (SPARK_HEIGHT - 1) + 0.5); // 0: bottom
+    y = y < 0 ? 0 : y > SPARK_HEIGHT - 1 ? SPARK_HEIGHT - 1 : y;
+    int from = prev < 0 ? y : prev < y ? prev + 1 : prev > y ? prev - 1 : y; // connect to the previous sample
+    for (int p = from < y ? from : y; p <= (from > y ? from : y); p++)
+      chars[x / 5 * 8 + SPARK_HEIGHT - 1 - p] |= 0x10 >> (x % 5);
+    prev = y;
+  }
+}
@@ -0,0 +1,41 @@
+/*
+  Scrolling sparkline graph in the custom characters of the LCD
+  (c) 2025 diyPresso - CC-BY-NC
+
+  The last SPARK_WIDTH samples of a value (temperature during the warm-up, weight during a shot) drawn in SPARK_CHARS
+  custom characters next to each other: a column of 8 pixels per sample, the newest on the right, consecutive samples
+  connected. The scale follows the samples, at least span wide. The screen shows the characters, render() gives their
+  rows for Display::custom_chars(), which only sends the rows that changed (see CharRam in dp_framebuffer.h).
+
+  Portable C++, no Arduino dependencies: the host renderer is server/spark_render.
+*/
+#ifndef SPARKLINE_H
+#define SPARKLINE_H
+
+#include <stdint.h>
+
+#define SPARK_CHARS 8                         // all custom characters
+#define SPARK_WIDTH (SPARK_CHARS * 5)         // samples
+#define SPARK_HEIGHT 8                        // pixels
+#define SPARK_TEXT "\10\11\12\13\14\15\16\17" // the characters on the screen: 8..15 are 0..7, 0 ends a string
+
+class Sparkline
+{
+private:
+  float _samples[SPARK_WIDTH]; // ring buffer
+  uint8_t _count = 0, _next = 0;
+  float _span;                 // minimum of the scale
+  unsigned long _added = 0;
+
+public:
+  Sparkline(float span) : _span(span) {}
+  void clear() { _count = _next = 0, _added++; }
+  void add(double value);
+  int count() const { return _count; }
+  unsigned long added() const { return _added; } // changes with every sample: render() again
+  double last() const;                           // NAN: no samples
+  void scale(double *low, double *high) const;   // the values of the bottom and top row
+  void render(uint8_t *chars) const;             // SPARK_CHARS x 8 rows of 5 pixels
+};
+
+#endif // SPARKLINE_H
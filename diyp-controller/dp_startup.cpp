@@ -0,0 +1,122 @@
+/*
+ diyPresso startup sequencer
+ Implemented as a Finite State Machine, run from the main loop
+ (c) 2025 diyPresso
+ */
+#include "dp.h"
+#include "dp_boiler.h"
+#include "dp_display.h"
+#include "dp_encoder.h"
+#include "dp_menu.h"
+#include "dp_settings.h"
+#include "dp_serial.h"
+#include "dp_restart.h"
+#include "dp_wifi.h"
+#include "dp_mqtt.h"
+#include "dp_power.h"
+#include "dp_startup.h"
+
+StartupProcess startupProcess = StartupProcess();
+
+// Show the logo on a cold start, skip it after a warm restart
+void StartupProcess::state_init()
+{
+  if (warmRestart.is_warm())
+  {
+    display.custom_chars(custom_chars_spinner);
+    NEXT(state_network);
+  }
+  else
+    NEXT(state_logo);
+}
+
+void StartupProcess::state_logo()
+{
+  ON_ENTRY()
+  {
+    display.logo();
+  }
+  ON_TIMEOUT(STARTUP_LOGO_MSEC)
+  NEXT(state_logo_text);
+}
+
+// Show version info. Pressing the button 4x during the logo performs a factory reset of the settings
+void StartupProcess::state_logo_text()
+{
+  ON_ENTRY()
+  {
+    display.logo_text(__DATE__, __TIME__);
+  }
+  ON_TIMEOUT(STARTUP_LOGO_TEXT_MSEC)
+  {
+    dpSerial.send(encoder.button_count());
+    if (encoder.button_count() > 3)
+    {
+      dpSerial.send("button pressed 4x at startup: perform factory reset of settings");
+      settings.defaults();
+      dpSerial.send(settings.save());
+      settings.apply();
+    }
+    display.custom_chars(custom_chars_spinner);
+    NEXT(state_network);
+  }
+}
+
+// Start the network. After a warm restart we wait until the boiler is back on temperature
+void StartupProcess::state_network()
+{
+  ON_ENTRY()
+  {
+    if (settings.wifiMode() != WIFI_MODE_OFF)
+      powerBudget.begin(); // the stored budget limits the heater, also while the network is deferred
+  }
+  if (warmRestart.is_warm() && boilerController.is_on() && !boilerController.is_ready())
+  {
+    ON_TIMEOUT(STARTUP_NETWORK_DEFER_MSEC)
+    NEXT(state_wifi);
+    return;
+  }
+  if (settings.wifiMode() == WIFI_MODE_OFF)
+    NEXT(state_done);
+  else
+    NEXT(state_wifi);
+}
+
+void StartupProcess::state_wifi()
+{
+  if (settings.wifiMode() == WIFI_MODE_AP)
+  {
+    wifiManager.erase();
+    settings.wifiMode(WIFI_MODE_ON);
+    settings.save();
+  }
+  wifiManager.begin(); // connects in the background, see wifiManager.run()
+  NEXT(state_mqtt);
+}
+
+// The MQTT session waits for the Wifi connection and reconnects by itself, see mqttDevice.run()
+void StartupProcess::state_mqtt()
+{
+  mqttDevice.begin();
+  NEXT(state_done);
+}
+
+void StartupProcess::state_done()
+{
+  ON_ENTRY()
+  {
+    dpSerial.send("STARTUP DONE");
+  }
+}
+
+const char *StartupProcess::get_state_name()
+{
+  RETURN_STATE_NAME(init);
+  RETURN_STATE_NAME(logo);
+  RETURN_STATE_NAME(logo_text);
+  RETURN_STATE_NAME(network);
+  RETURN_STATE_NAME(wifi);
+  RETURN_STATE_NAME(mqtt);
+  RETURN_STATE_NAME(done);
+  RETURN_UNKNOWN_STATE_NAME();
+}
@@ -0,0 +1,43 @@
+/*
+  Startup sequencer
+  (c) 2025 diyPresso - CC-BY-NC
+
+  setup() only performs the safety critical initialization (settings, RTD, SSRs, watchdog), so the boiler
+  is controlled from the first loop pass. The rest of the startup runs from the main loop as a state machine:
+  the logo is shown, a factory reset is checked and the network (Wifi, MQTT) is started in the background.
+  The Wifi connection and the MQTT session are made by the wifiManager and mqttDevice state machines.
+*/
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include <Arduino.h>
+
+#undef _DP_FSM_TYPE
+#define _DP_FSM_TYPE StartupProcess // used for the state machine macro NEXT()
+#include "dp_fsm.h"
+
+#define STARTUP_LOGO_MSEC 1000      // time to show the logo graphic [msec]
+#define STARTUP_LOGO_TEXT_MSEC 3000 // time to show the logo with version and build date [msec]
+#define STARTUP_NETWORK_DEFER_MSEC (60 * 1000UL) // max time to defer the network start after a warm restart [msec]
+
+class StartupProcess : public StateMachine<StartupProcess>
+{
+public:
+  StartupProcess() : StateMachine(STATE(state_init)) {};
+  bool is_splash() { return IN_STATE(init) || IN_STATE(logo) || IN_STATE(logo_text); } // the logo owns the display
+  bool is_done() { return IN_STATE(done); }
+  virtual const char *get_state_name();
+
+protected:
+  void state_init();
+  void state_logo();
+  void state_logo_text();
+  void state_network();
+  void state_wifi();
+  void state_mqtt();
+  void state_done();
+};
+
+extern StartupProcess startupProcess;
+
+#endif // STARTUP_H
@@ -0,0 +1,149 @@
+/*
+ diyPresso telemetry store-and-forward buffer
+ (c) 2025 diyPresso
+ */
+#include "dp.h"
+#include <WiFiNINA.h>
+#include "dp_boiler.h"
+#include "dp_brew.h"
+#include "dp_heater.h"
+#include "dp_reservoir.h"
+#include "dp_settings.h"
+#include "dp_mqtt.h"
+#include "dp_time.h"
+#include "dp_telemetry.h"
+
+Telemetry telemetry = Telemetry();
+
+static int32_t scaled(double value, telemetry_field_t field)
+{
+  return (int32_t)round(value * telemetry_fields[field].scale);
+}
+
+// Take a sample of the current machine state
+void Telemetry::sample(telemetry_sample_t &sample)
+{
+  sample.time = millis();
+  sample.value[TM_T_SET] = scaled(boilerController.set_temp(), TM_T_SET);
+  sample.value[TM_T_ACT] = scaled(boilerController.act_temp(), TM_T_ACT);
+  sample.value[TM_H_PWR] = scaled(heaterDevice.power(), TM_H_PWR);
+  sample.value[TM_H_AVG] = scaled(heaterDevice.average(), TM_H_AVG);
+  sample.value[TM_R_LVL] = scaled(reservoir.level(), TM_R_LVL);
+  sample.value[TM_R_WGT] = scaled(reservoir.weight(), TM_R_WGT);
+  sample.value[TM_W_CUR] = scaled(brewProcess.weight(), TM_W_CUR);
+  sample.value[TM_W_END] = scaled(brewProcess.end_weight(), TM_W_END);
+  sample.value[TM_SHOTS] = settings.shotCounter();
+  sample.value[TM_BOIL] = boilerController.get_state();
+  sample.value[TM_BREW] = brewProcess.get_state();
+  sample.value[TM_BOIL_ERR] = boilerController.error();
+  sample.value[TM_BREW_ERR] = brewProcess.error();
+  sample.value[TM_RES_ERR] = reservoir.error();
+}
+
+// Sample interval of the rate policy in the state of the sample [msec], 0: change driven (see TelemetryRing::due())
+uint32_t Telemetry::interval(const telemetry_sample_t &sample)
+{
+  switch (sample.value[TM_BREW])
+  {
+  case BREW_STATE_PRE_INFUSE:
+  case BREW_STATE_INFUSE:
+  case BREW_STATE_EXTRACT:
+    return TELEMETRY_BUSY_MSEC;
+  case BREW_STATE_FILL:
+  case BREW_STATE_PURGE:
+  case BREW_STATE_FINISHED:
+    return TELEMETRY_ACTIVE_MSEC;
+  }
+  if (sample.value[TM_BOIL] == BOILER_STATE_HEATING)
+    return TELEMETRY_ACTIVE_MSEC;
+  return 0;
+}
+
+// Take a sample and store it if the rate policy wants it, call from the main loop
+void Telemetry::update()
+{
+  telemetry_sample_t s;
+  sample(s);
+  if (!due(s, interval(s)))
+    return;
+  unsigned long start = micros();
+  push(s);
+  _push_usec = micros() - start;
+}
+
+// Add a sample as a line to the MQTT message, with the time of the sample if the time of day is known
+void Telemetry::publish(const telemetry_sample_t &sample)
+{
+  for (int i = 0; i < TELEMETRY_FIELDS; i++)
+  {
+    int32_t v = sample.value[i];
+    int32_t scale = telemetry_fields[i].scale;
+    if (scale == 1)
+      mqttDevice.write((char *)telemetry_fields[i].name, (long)v);
+    else if (scale > 1)
+      mqttDevice.write((char *)telemetry_fields[i].name, (double)v / scale);
+  }
+  mqttDevice.write("boil", (char *)BoilerStateMachine::get_state_name((boiler_state_t)sample.value[TM_BOIL]));
+  if (sample.value[TM_BOIL] == BOILER_STATE_ERROR)
+    mqttDevice.write("boil_err", (char *)BoilerStateMachine::get_error_text((boiler_error_t)sample.value[TM_BOIL_ERR]));
+  mqttDevice.write("brew", (char *)BrewProcess::get_state_name((brew_state_t)sample.value[TM_BREW]));
+  if (sample.value[TM_BREW] == BREW_STATE_ERROR)
+    mqttDevice.write("brew_err", (char *)BrewProcess::get_error_text((brew_error_t)sample.value[TM_BREW_ERR]));
+  if (sample.value[TM_RES_ERR] != RESERVOIR_ERROR_NONE)
+    mqttDevice.write("res_err", (char *)Reservoir::get_error_text((reservoir_error_t)sample.value[TM_RES_ERR]));
+  mqttDevice.write("msec", (long)sample.time);
+
+  if (_epoch)
+  {
+    int64_t msec = (int64_t)_epoch * 1000 + (int32_t)(sample.time - _epoch_millis);
+    mqttDevice.end_line(msec / 1000, msec % 1000);
+  }
+  else
+    mqttDevice.end_line(0, 0);
+}
+
+// Publish the buffered samples while the MQTT session is up, one batch per call
+void Telemetry::run()
+{
+  if (!mqttDevice.is_connected())
+    return;
+  if (!_epoch && time_since(_epoch_time) > TELEMETRY_EPOCH_MSEC)
+  {
+    _epoch_time = millis();
+    _epoch = WiFi.getTime(); // 0 until the Wifi module has the time (NTP)
+    _epoch_millis = millis();
+  }
+  if (!pending() || time_since(_drain_time) < drain_interval())
+    return;
+
+  unsigned long start = micros();
+  telemetry_sample_t sample, prev;
+  CborWriter cbor(_cbor, sizeof(_cbor));
+  uint8_t formats = _formats & ~batch_sent(); // a kept batch is only sent in the formats that do not have it yet
+  int batch = batch_records() ? batch_records() : TELEMETRY_DRAIN_BATCH, n = 0;
+  _drain_time = millis();
+  if (!batch_records())
+    _cbor_epoch = _epoch ? (uint64_t)_epoch * 1000 - _epoch_millis : 0;
+  if (formats & TELEMETRY_FORMAT_CBOR)
+    cbor_begin(cbor, _cbor_epoch);
+  while (n < batch && cbor.available() > TELEMETRY_CBOR_SAMPLE_MAX && next(sample))
+  {
+    if (formats & TELEMETRY_FORMAT_LINE)
+      publish(sample);
+    if (formats & TELEMETRY_FORMAT_CBOR)
+      cbor_sample(cbor, sample, n ? &prev : NULL);
+    prev = sample;
+    n++;
+  }
+  uint8_t sent = 0;
+  if ((formats & TELEMETRY_FORMAT_LINE) && mqttDevice.send())
+    sent |= TELEMETRY_FORMAT_LINE;
+  if (formats & TELEMETRY_FORMAT_CBOR)
+  {
+    cbor.end();
+    if (n && cbor.ok() && mqttDevice.publish(TELEMETRY_CBOR_TOPIC, cbor.data(), cbor.size()))
+      sent |= TELEMETRY_FORMAT_CBOR;
+  }
+  drained(sent, _formats);
+  _drain_usec = micros() - start;
+}
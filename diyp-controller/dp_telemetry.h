@@ -0,0 +1,50 @@
+/*
+  Telemetry store-and-forward buffer
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Rate policy: a sample is taken at 10 Hz while brewing, at 1 Hz while heating (and around a shot) and otherwise only
+  when a field changes more than its deadband, with a heartbeat. State and error changes are stored immediately.
+
+  Samples of the machine state are stored in a fixed RAM ring buffer and published to MQTT, oldest first, in batches
+  (one MQTT message with multiple influxDB lines). While Wifi or the broker is down the samples are kept, when the
+  buffer is full the oldest block is dropped.
+
+  Formats: influxDB line protocol on the device topic and/or CBOR on <topic>/cbor, chosen with the telemetryFormat
+  setting (settings.apply() sets formats()). A switch takes effect at the next batch. The ring, its encoding, the
+  CBOR message and the rate policy are in dp_telemetry_ring.h; this module takes the samples of the machine, picks
+  the sample interval of its state and publishes the batches.
+*/
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Arduino.h>
+#include "dp_telemetry_ring.h"
+
+#define TELEMETRY_EPOCH_MSEC 10000  // interval to ask the Wifi module for the time, until it is known [msec]
+#define TELEMETRY_CBOR_TOPIC "/cbor"
+
+class Telemetry : public TelemetryRing
+{
+private:
+  unsigned long _push_usec = 0, _drain_usec = 0, _drain_time = 0, _epoch_time = 0;
+  uint32_t _epoch = 0, _epoch_millis = 0;
+  uint64_t _cbor_epoch = 0; // epoch of the CBOR message of the kept batch, a retry sends the same message
+  uint8_t _formats = TELEMETRY_FORMAT_LINE;
+  uint8_t _cbor[TELEMETRY_CBOR_SIZE];
+
+  static uint32_t interval(const telemetry_sample_t &sample);
+  void publish(const telemetry_sample_t &sample);
+
+public:
+  void sample(telemetry_sample_t &sample);
+  void update();
+  void run();
+  uint8_t formats() { return _formats; }
+  void formats(uint8_t formats) { _formats = formats; } // TELEMETRY_FORMAT_LINE and/or TELEMETRY_FORMAT_CBOR
+  unsigned long push_usec() { return _push_usec; }    // duration of the last push (encode) [usec]
+  unsigned long drain_usec() { return _drain_usec; }  // duration of the last drain (decode and publish a batch) [usec]
+};
+
+extern Telemetry telemetry;
+
+#endif // TELEMETRY_H
@@ -0,0 +1,267 @@
+/*
+  Telemetry ring: the store-and-forward buffer of the telemetry samples (see dp_telemetry_ring.h)
+  (c) 2025 diyPresso - CC-BY-NC
+*/
+#include <stdlib.h>
+#include <string.h>
+#include "dp_telemetry_ring.h"
+
+const telemetry_field_info_t telemetry_fields[TELEMETRY_FIELDS] = {
+    {"t_set", 100, 0},    // any change
+    {"t_act", 100, 20},   // 0.2 C
+    {"h_pwr", 10, 1000},  // never: the PID output jitters at idle, h_avg follows the trend
+    {"h_avg", 10, 50},    // 5 %
+    {"r_lvl", 10, 10},    // 1 %
+    {"r_wgt", 10, 50},    // 5 g, the load cell drifts a few grams
+    {"w_cur", 10, 10},    // 1 g
+    {"w_end", 10, 0},     // any change
+    {"shots", 1, 0},      // any change
+    {"boil", 0, 0},
+    {"brew", 0, 0},
+    {"boil_err", 0, 0},
+    {"brew_err", 0, 0},
+    {"res_err", 0, 0},
+};
+
+static const telemetry_sample_t zero_sample = {};
+
+static size_t put_varint(uint8_t *buf, uint32_t value)
+{
+  size_t n = 0;
+  while (value >= 0x80)
+  {
+    buf[n++] = (value & 0x7F) | 0x80;
+    value >>= 7;
+  }
+  buf[n++] = value;
+  return n;
+}
+
+static bool get_varint(const uint8_t *buf, size_t size, size_t &pos, uint32_t &value)
+{
+  value = 0;
+  for (int shift = 0; pos < size && shift < 35; shift += 7)
+  {
+    uint8_t b = buf[pos++];
+    value |= (uint32_t)(b & 0x7F) << shift;
+    if (!(b & 0x80))
+      return true;
+  }
+  return false;
+}
+
+static uint32_t zigzag(int32_t value) { return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31); }
+static int32_t unzigzag(uint32_t value) { return (int32_t)(value >> 1) ^ -(int32_t)(value & 1); }
+
+// Encode a sample relative to the reference sample, returns the record size
+size_t TelemetryRing::encode(uint8_t *buf, const telemetry_sample_t &sample, const telemetry_sample_t &ref)
+{
+  uint32_t mask = 0;
+  for (int i = 0; i < TELEMETRY_FIELDS; i++)
+    if (sample.value[i] != ref.value[i])
+      mask |= 1UL << i;
+  size_t n = put_varint(buf, sample.time - ref.time);
+  n += put_varint(buf + n, mask);
+  for (int i = 0; i < TELEMETRY_FIELDS; i++)
+    if (mask & (1UL << i))
+      n += put_varint(buf + n, zigzag(sample.value[i] - ref.value[i]));
+  return n;
+}
+
+// Decode a record, sample is the reference on entry. Returns the record size, 0 if the record is invalid
+size_t TelemetryRing::decode(const uint8_t *buf, size_t size, telemetry_sample_t &sample)
+{
+  size_t pos = 0;
+  uint32_t delta, mask;
+  if (!get_varint(buf, size, pos, delta) || !get_varint(buf, size, pos, mask))
+    return 0;
+  sample.time += delta;
+  for (int i = 0; i < TELEMETRY_FIELDS; i++)
+    if (mask & (1UL << i))
+    {
+      if (!get_varint(buf, size, pos, delta))
+        return 0;
+      sample.value[i] += unzigzag(delta);
+    }
+  return pos;
+}
+
+void TelemetryRing::clear()
+{
+  memset(_used, 0, sizeof(_used));
+  memset(_count, 0, sizeof(_count));
+  _head = _tail = 0;
+  _read_offset = _read_index = 0;
+  _read_ref = zero_sample;
+  _write_ref = zero_sample;
+  _last = zero_sample;
+  _pending = 0;
+  _batch_sent = _batch_records = 0;
+  rollback();
+}
+
+// Rate policy: should this sample be stored after the last one? interval: the sample interval of the state [msec],
+// 0: change driven
+bool TelemetryRing::due(const telemetry_sample_t &sample, const telemetry_sample_t &last, uint32_t interval)
+{
+  uint32_t elapsed = sample.time - last.time;
+  for (int i = 0; i < TELEMETRY_FIELDS; i++)
+    if (telemetry_fields[i].scale == 0 && sample.value[i] != last.value[i])
+      return true; // state or error change
+  if (interval)
+    return elapsed >= interval;
+
+  if (elapsed >= TELEMETRY_HEARTBEAT_MSEC)
+    return true;
+  if (elapsed < TELEMETRY_IDLE_MSEC)
+    return false;
+  for (int i = 0; i < TELEMETRY_FIELDS; i++)
+    if (abs(sample.value[i] - last.value[i]) > telemetry_fields[i].deadband)
+      return true;
+  return false;
+}
+
+// Store a sample. The first record of a block is a keyframe, if the ring is full the oldest block is dropped
+void TelemetryRing::push(const telemetry_sample_t &sample)
+{
+  uint8_t record[TELEMETRY_RECORD_MAX];
+  size_t n = encode(record, sample, _used[_head] ? _write_ref : zero_sample);
+  if (_used[_head] + n > TELEMETRY_BLOCK_SIZE)
+  {
+    uint8_t next = (_head + 1) % TELEMETRY_BLOCKS;
+    if (next == _tail)
+      drop_tail();
+    _head = next;
+    _used[_head] = 0;
+    _count[_head] = 0;
+    n = encode(record, sample, zero_sample);
+  }
+  memcpy(&_ring[_head][_used[_head]], record, n);
+  _used[_head] += n;
+  _count[_head]++;
+  _write_ref = sample;
+  _last = sample;
+  _pushed++;
+  _pending++;
+}
+
+// Drop the unread records of the oldest block, the rest of a kept batch stays at the read position
+void TelemetryRing::drop_tail()
+{
+  unsigned long n = _count[_tail] - _read_index;
+  _dropped += n;
+  _pending -= n;
+  _tail = (_tail + 1) % TELEMETRY_BLOCKS;
+  _read_offset = 0;
+  _read_index = 0;
+  _read_ref = zero_sample;
+  if (_batch_records > n)
+    _batch_records -= n;
+  else
+    _batch_sent = _batch_records = 0;
+  rollback();
+}
+
+// Read the next (oldest) sample, it is removed from the buffer by commit()
+bool TelemetryRing::next(telemetry_sample_t &sample)
+{
+  for (;;)
+  {
+    if (_peek_index < _count[_peek_block])
+    {
+      size_t n = decode(&_ring[_peek_block][_peek_offset], _used[_peek_block] - _peek_offset, _peek_ref);
+      if (n == 0)
+        return false;
+      _peek_offset += n;
+      _peek_index++;
+      _peek_records++;
+      sample = _peek_ref;
+      return true;
+    }
+    if (_peek_block == _head)
+      return false;
+    _peek_block = (_peek_block + 1) % TELEMETRY_BLOCKS;
+    _peek_offset = 0;
+    _peek_index = 0;
+    _peek_ref = zero_sample;
+  }
+}
+
+// Remove the samples returned by next()
+void TelemetryRing::commit()
+{
+  _pending -= _peek_records;
+  _published += _peek_records;
+  _peek_records = 0;
+  _tail = _peek_block;
+  _read_offset = _peek_offset;
+  _read_index = _peek_index;
+  _read_ref = _peek_ref;
+}
+
+// Keep the samples returned by next(), they are returned again
+void TelemetryRing::rollback()
+{
+  _peek_block = _tail;
+  _peek_offset = _read_offset;
+  _peek_index = _read_index;
+  _peek_ref = _read_ref;
+  _peek_records = 0;
+}
+
+// End a drain: the samples returned by next() are published in the formats sent. They are removed once every format
+// of formats has them, otherwise they are kept as the batch of the next drain, which skips the formats that have it
+void TelemetryRing::drained(uint8_t sent, uint8_t formats)
+{
+  sent |= _batch_sent;
+  if (_peek_records && (sent & formats) == formats)
+  {
+    commit();
+    sent = 0;
+  }
+  _batch_sent = sent;
+  _batch_records = sent ? _peek_records : 0;
+  rollback();
+}
+
+// Bytes in use, including the records that are already published in the oldest block
+size_t TelemetryRing::used()
+{
+  size_t n = 0;
+  for (uint8_t b = _tail;; b = (b + 1) % TELEMETRY_BLOCKS)
+  {
+    n += _used[b];
+    if (b == _head)
+      return n;
+  }
+}
+
+// Start a CBOR message, the samples follow, end it with cbor.end()
+void TelemetryRing::cbor_begin(CborWriter &cbor, uint64_t epoch_msec)
+{
+  cbor.map(3);
+  cbor.uinteger(0);
+  cbor.uinteger(TELEMETRY_CBOR_VERSION);
+  cbor.uinteger(1);
+  cbor.uinteger(epoch_msec);
+  cbor.uinteger(2);
+  cbor.array_begin();
+}
+
+// Add a sample to the CBOR message, with only the fields that changed since the previous sample in the message
+void TelemetryRing::cbor_sample(CborWriter &cbor, const telemetry_sample_t &sample, const telemetry_sample_t *prev)
+{
+  int n = 1;
+  for (int i = 0; i < TELEMETRY_FIELDS; i++)
+    if (!prev || sample.value[i] != prev->value[i])
+      n++;
+  cbor.map(n);
+  cbor.uinteger(0);
+  cbor.uinteger(sample.time);
+  for (int i = 0; i < TELEMETRY_FIELDS; i++)
+    if (!prev || sample.value[i] != prev->value[i])
+    {
+      cbor.uinteger(i + 1);
+      cbor.integer(sample.value[i]);
+    }
+}
@@ -0,0 +1,125 @@
+/*
+  Telemetry ring: the store-and-forward buffer of the telemetry samples (see dp_telemetry.h)
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Encoding: the ring is divided in blocks, every block starts with a keyframe. A record holds the time difference
+  and a bitmask of the changed fields, followed by the changes. All numbers are (zigzag) varints, a keyframe is a
+  record relative to an all-zero sample. An idle record (only the temperature changed) takes about 5 bytes.
+
+  Publishing: next() reads the oldest samples, commit() removes them once they are published, rollback() keeps them.
+  A batch is published in every format (a bitmask); drained() ends a drain with the formats that succeeded. When a
+  format fails the batch is kept, with the formats that already have it: the next drain reads the same samples and
+  publishes them only in the formats that failed, so no sample is published twice in a format.
+
+  Rate policy (due()): a sample is stored at a fixed interval, or when the interval is 0 only when a field changes
+  more than its deadband, with a heartbeat. State and error changes are always stored.
+
+  CBOR message: {0: version, 1: epoch [msec] at millis() == 0 or 0 if unknown, 2: [samples]}, a sample is a map
+  {0: millis(), field + 1: scaled value, ...} with only the fields that changed since the previous sample in the same
+  message (all fields in the first sample). See dp_cbor.h and server/cbor_decoder.h.
+
+  Portable C++, no Arduino dependencies: the host test and benchmark is server/telemetry_sim. The server tools use the
+  fields, the sample and the rate policy of this header (server/cbor_decoder.h, server/fleet_load).
+*/
+#ifndef TELEMETRY_RING_H
+#define TELEMETRY_RING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "dp_cbor.h"
+
+#define TELEMETRY_BLOCK_SIZE 256    // bytes per block [bytes]
+#define TELEMETRY_BLOCKS 16         // blocks in the ring, the oldest block is dropped on overflow
+#define TELEMETRY_DRAIN_BATCH 10    // max samples per MQTT message, must fit in MQTT_TX_PAYLOAD_SIZE
+#define TELEMETRY_DRAIN_MSEC 5000   // min time between two MQTT messages with live samples [msec]
+#define TELEMETRY_BACKLOG_MSEC 100  // min time between two MQTT messages while a backlog (a full batch) is drained [msec]
+#define TELEMETRY_BUSY_MSEC 100     // sample interval while brewing (10 Hz) [msec]
+#define TELEMETRY_ACTIVE_MSEC 1000  // sample interval while heating, filling, purging or after a shot (1 Hz) [msec]
+#define TELEMETRY_IDLE_MSEC 1000    // min interval between change driven samples when idle [msec]
+#define TELEMETRY_HEARTBEAT_MSEC (60 * 1000UL) // max interval between samples when idle [msec]
+#define TELEMETRY_FORMAT_LINE 1     // influxDB line protocol on the device topic
+#define TELEMETRY_FORMAT_CBOR 2     // CBOR on <device topic>/cbor
+#define TELEMETRY_CBOR_VERSION 1
+#define TELEMETRY_CBOR_SIZE 1024    // CBOR message buffer [bytes]
+#define TELEMETRY_CBOR_SAMPLE_MAX (1 + 6 + 6 * TELEMETRY_FIELDS) // max size of a CBOR sample [bytes]
+#define TELEMETRY_RECORD_MAX (5 + 3 + 5 * TELEMETRY_FIELDS) // max size of an encoded record [bytes]
+
+// Fields of a sample, values are scaled to integers (see telemetry_fields[])
+typedef enum
+{
+  TM_T_SET,     // set temperature [0.01 C]
+  TM_T_ACT,     // actual temperature [0.01 C]
+  TM_H_PWR,     // heater power [0.1 %]
+  TM_H_AVG,     // average heater power [0.1 %]
+  TM_R_LVL,     // reservoir level [0.1 %]
+  TM_R_WGT,     // reservoir weight [0.1 g]
+  TM_W_CUR,     // brew weight [0.1 g]
+  TM_W_END,     // end weight of the last shot [0.1 g]
+  TM_SHOTS,     // shot counter
+  TM_BOIL,      // boiler state (boiler_state_t)
+  TM_BREW,      // brew state (brew_state_t)
+  TM_BOIL_ERR,  // boiler error (boiler_error_t)
+  TM_BREW_ERR,  // brew error (brew_error_t)
+  TM_RES_ERR,   // reservoir error (reservoir_error_t)
+  TELEMETRY_FIELDS
+} telemetry_field_t;
+
+typedef struct
+{
+  uint32_t time; // [msec] since boot
+  int32_t value[TELEMETRY_FIELDS];
+} telemetry_sample_t;
+
+typedef struct
+{
+  const char *name;  // field name in the MQTT message
+  int32_t scale;     // value = round(measurement * scale), 0 for an enumeration
+  int32_t deadband;  // a change larger than this is stored when idle [scaled units], enumerations are always stored
+} telemetry_field_info_t;
+
+extern const telemetry_field_info_t telemetry_fields[TELEMETRY_FIELDS];
+
+class TelemetryRing
+{
+private:
+  uint8_t _ring[TELEMETRY_BLOCKS][TELEMETRY_BLOCK_SIZE];
+  uint16_t _used[TELEMETRY_BLOCKS];   // bytes used per block
+  uint16_t _count[TELEMETRY_BLOCKS];  // records per block
+  uint8_t _head = 0, _tail = 0;       // block that is written, oldest block with unread records
+  telemetry_sample_t _write_ref;      // last written sample, the reference of the next record
+  telemetry_sample_t _last;           // last stored sample, for the rate policy
+  // read position (committed) and peek position (records read, but not yet published)
+  uint16_t _read_offset = 0, _read_index = 0, _peek_offset = 0, _peek_index = 0, _peek_records = 0;
+  uint8_t _peek_block = 0;
+  telemetry_sample_t _read_ref, _peek_ref;
+  uint8_t _batch_sent = 0, _batch_records = 0; // the batch at the read position, published in these formats only
+  unsigned long _pushed = 0, _published = 0, _dropped = 0, _pending = 0;
+
+  static size_t encode(uint8_t *buf, const telemetry_sample_t &sample, const telemetry_sample_t &ref);
+  static size_t decode(const uint8_t *buf, size_t size, telemetry_sample_t &sample);
+  void drop_tail();
+
+public:
+  TelemetryRing() { clear(); }
+  void clear();
+  void push(const telemetry_sample_t &sample);
+  bool due(const telemetry_sample_t &sample, uint32_t interval) { return _pushed == 0 || due(sample, _last, interval); }
+  uint32_t drain_interval() { return _pending >= TELEMETRY_DRAIN_BATCH ? TELEMETRY_BACKLOG_MSEC : TELEMETRY_DRAIN_MSEC; }
+  bool next(telemetry_sample_t &sample);
+  void commit();
+  void rollback();
+  void drained(uint8_t sent, uint8_t formats);
+  uint8_t batch_sent() { return _batch_sent; }       // formats that have the batch at the read position
+  uint8_t batch_records() { return _batch_records; } // samples in that batch, 0: no batch is kept
+  unsigned long pending() { return _pending; }
+  unsigned long pushed() { return _pushed; }
+  unsigned long published() { return _published; }
+  unsigned long dropped() { return _dropped; }
+  size_t used();
+
+  static bool due(const telemetry_sample_t &sample, const telemetry_sample_t &last, uint32_t interval); // [msec]
+  static void cbor_begin(CborWriter &cbor, uint64_t epoch_msec);
+  static void cbor_sample(CborWriter &cbor, const telemetry_sample_t &sample, const telemetry_sample_t *prev);
+};
+
+#endif // TELEMETRY_RING_H
@@ -0,0 +1,93 @@
+/*
+  Declarative screens of the 4x20 character LCD, rendered lazily
+  (c) 2025 diyPresso - CC-BY-NC
+*/
+#include <string.h>
+#include "dp_view.h"
+#include "dp_format.h"
+
+void View::show(const view_screen_t *screen)
+{
+  if (screen == _screen)
+    return;
+  _screen = screen;
+  const char *s = screen->layout;
+  char prev = 0;
+  bool field = false; // in the placeholder of a field
+  int n = 0;
+  for (int i = 0; i < FB_SIZE; i++)
+  {
+    char c = *s ? *s++ : ' '; // short layout: blank the rest
+    _text[i] = c;
+    if (c == '#' && prev != '#')
+    {
+      field = n < screen->count && n < VIEW_MAX_FIELDS; // else the placeholder shows '#'
+      if (field)
+        _pos[n] = i, _width[n] = 0, n++;
+    }
+    if (c == '#' && field)
+      _width[n - 1]++;
+    prev = c;
+  }
+  for (int i = 0; i < n; i++)
+    memset(_text + _pos[i], ' ', _width[i]);
+  _text[FB_SIZE] = 0;
+  for (; n < VIEW_MAX_FIELDS; n++)
+    _width[n] = 0;
+  _valid = 0;
+  _dirty = true;
+}
+
+// Write a value in the placeholder of a field, returns true when it changed
+bool View::put(int field, const char *s)
+{
+  bool changed = false;
+  char *d = _text + _pos[field];
+  for (int i = 0; i < _width[field]; i++)
+  {
+    char c = s && *s ? *s++ : ' '; // on end of the value: pad with spaces
+    if (d[i] != c)
+      d[i] = c, changed = true;
+  }
+  return changed;
+}
+
+bool View::update()
+{
+  if (!_screen)
+    return false;
+  for (int i = 0; i < _screen->count && i < VIEW_MAX_FIELDS; i++)
+  {
+    const view_field_t &f = _screen->fields[i];
+    bool changed;
+    if (f.number)
+    {
+      double value = f.number();
+      double shown = round_float(value, f.decimals); // NAN: out of range, not equal to anything
+      if ((_valid & (1 << i)) && shown == _shown[i])
+        continue;
+      char buf[FORMAT_CHARS + FB_COLS];
+      format_float(buf, value, f.decimals, f.len);
+      changed = put(i, buf);
+      _shown[i] = shown;
+      _renders++;
+    }
+    else
+      changed = put(i, f.text ? f.text() : 0);
+    _valid |= 1 << i;
+    _dirty = _dirty || changed;
+  }
+  return _dirty;
+}
+
+int ViewList::turn(long position)
+{
+  int steps = position - _position;
+  _position = position;
+  if (_modify || !_count)
+    return steps;
+  _index = (_index + steps) % _count;
+  if (_index < 0)
+    _index += _count;
+  return 0;
+}
@@ -0,0 +1,77 @@
+/*
+  Declarative screens of the 4x20 character LCD, rendered lazily
+  (c) 2025 diyPresso - CC-BY-NC
+
+  A screen is a constant layout with '#' placeholders and a field per placeholder, bound to a function that returns
+  its value: a number (decimals, right aligned in len, see format_float()) or a text. View polls the bindings and only
+  formats a number when it changed at the shown precision; a text is compared with what is in its placeholder. The
+  rendered screen goes to the display only when a character changed, so a screen with nothing new costs the calls of
+  its bindings. Poll when the display can take a frame (Display::ready()), not every loop.
+
+  ViewList is the navigation of a list with the encoder: turn to select an item, press to modify it, turn to change it.
+
+  Portable C++, no Arduino dependencies: the host test with a fake encoder is server/menu_sim.
+*/
+#ifndef VIEW_H
+#define VIEW_H
+
+#include <stdint.h>
+#include "dp_framebuffer.h"
+
+#define VIEW_MAX_FIELDS 10
+
+typedef struct
+{
+  double (*number)();    // the value of a number, or:
+  const char *(*text)(); // the value of a text, left aligned (NULL: empty)
+  int8_t decimals;       // number: 0..3
+  int8_t len;            // number: right aligned in len characters, 0: left aligned
+} view_field_t;
+
+typedef struct
+{
+  const char *layout;         // FB_ROWS x FB_COLS characters, '#' runs: the placeholders of the fields in order
+  const view_field_t *fields; // NULL: no fields
+  uint8_t count;
+} view_screen_t;
+
+class View
+{
+private:
+  const view_screen_t *_screen = 0;
+  char _text[FB_SIZE + 1];
+  uint8_t _pos[VIEW_MAX_FIELDS], _width[VIEW_MAX_FIELDS]; // of the placeholders
+  double _shown[VIEW_MAX_FIELDS];                         // numbers: the value on the text, see round_float()
+  uint16_t _valid = 0;                                    // fields with a value on the text
+  bool _dirty = false;                                    // the text changed since drawn()
+  unsigned long _renders = 0;                             // fields formatted
+
+  bool put(int field, const char *s);
+
+public:
+  void show(const view_screen_t *screen); // the screen to render, starts over when it is another one
+  void invalidate() { _valid = 0; }       // format all fields again
+  bool update();                          // polls the fields, returns true when the text has to be drawn
+  void drawn() { _dirty = false; }        // the text is on the display
+  const char *text() { return _text; }    // FB_SIZE characters and a terminator
+  unsigned long renders() { return _renders; }
+};
+
+class ViewList
+{
+private:
+  int _count, _index = 0;
+  bool _modify = false;
+  long _position = 0; // of the encoder at the last turn()
+
+public:
+  ViewList(int count) : _count(count) {}
+  int turn(long position); // the steps of the encoder since the last call, returns them when modifying, else selects
+  void press() { _modify = !_modify; } // start or stop modifying the item
+  void stop() { _modify = false; }
+  int index() { return _index; }
+  int count() { return _count; }
+  bool modify() { return _modify; }
+};
+
+#endif // VIEW_H
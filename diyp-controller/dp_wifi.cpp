@@ -1,49 +1,261 @@
 /*
  diyEspresso Wifi interface
+ Implemented as a Finite State Machine, run from the main loop
  */
 #include "dp.h"
 #include <Arduino.h>
 #include <WiFiNINA.h>
-#include <WiFiUdp.h>
+#include <utility/wifi_drv.h>
+#include <utility/spi_drv.h>
+#include <utility/wifi_spi.h>
 #include "EasyWiFi.h"
+#include "dp_portal.h"
+#include "dp_wifi.h"
 
 /*********** Global Settings  **********/
 EasyWiFi MyEasyWiFi;
 char MyAPName[]= {"diyPresso-One"};
 
-void wifi_setup()
+WifiManager wifiManager = WifiManager();
+
+// Rate limit the polls of the Wifi module, returns true when a poll is due
+bool WifiManager::poll(unsigned long interval)
 {
-  if (WiFi.status() == WL_NO_SHIELD) {
-    Serial.println("WiFi shield not present");
-  }
-  WiFi.setHostname("diyPresso-One");
-  MyEasyWiFi.apname(MyAPName);
-  MyEasyWiFi.seed(5);
+  if ((millis() - _poll_time) < interval)
+    return false;
+  _poll_time = millis();
+  return true;
 }
 
-void printWiFiStatus()
+// A connection attempt failed: retry later, or open the configuration AP if we never got a connection
+void WifiManager::fail()
+{
+  _failures++;
+  WiFi.disconnect();
+  if (!_ever_connected && _failures >= WIFI_PORTAL_FAILURES)
+    NEXT(state_portal);
+  else
+    NEXT(state_backoff);
+}
+
+void WifiManager::print_status()
 {
     Serial.print("\nStatus: SSID: "); Serial.print(WiFi.SSID());
     IPAddress ip = WiFi.localIP(); Serial.print(" - IPAddress: "); Serial.print(ip);
     long rssi = WiFi.RSSI(); Serial.print("- Rssi: "); Serial.print(rssi); Serial.println("dBm");
 }
 
-void wifi_loop()
+void WifiManager::erase()
 {
-  if (WiFi.status()==WL_CONNECTED)
+   MyEasyWiFi.erase();
+}
+
+// The module pulls its ready line low when it can take a command, or has the reply of the last one
+static bool module_ready()
+{
+  return digitalRead(NINA_ACK) == LOW;
+}
+
+// Send the request of WiFi.hostByName() to the module, without waiting for its reply
+bool WifiManager::resolve(const char *host)
+{
+  if (busy() || !IN_STATE(connected) || !module_ready())
+    return false;
+  SpiDrv::spiSlaveSelect();
+  SpiDrv::sendCmd(REQ_HOST_BY_NAME_CMD, PARAM_NUMS_1);
+  SpiDrv::sendParam((uint8_t *)host, strlen(host), LAST_PARAM);
+  for (int size = 5 + strlen(host); size % 4; size++) // pad the command to a multiple of 4 bytes
+    SpiDrv::readChar();
+  SpiDrv::spiSlaveDeselect();
+  _lookup = -1;
+  _lookup_time = millis();
+  return true;
+}
+
+// Read the reply of a running lookup once the module is ready, then the address (the module answers that at once)
+void WifiManager::lookup()
+{
+  if (_lookup >= 0)
+    return;
+  if (!module_ready())
   {
-    printWiFiStatus();
+    if (millis() - _lookup_time >= WIFI_RESOLVE_TIMEOUT_MSEC)
+      _lookup = 0; // the next command waits for the module, like before
+    return;
   }
-  else
+  uint8_t result = 0, len = 0, addr[4];
+  SpiDrv::spiSlaveSelect();
+  bool ok = SpiDrv::waitResponseCmd(REQ_HOST_BY_NAME_CMD, PARAM_NUMS_1, &result, &len) && result;
+  SpiDrv::spiSlaveDeselect();
+  if (ok)
   {
-    Serial.println("* Not Connected, starting EasyWiFi");
-    MyEasyWiFi.start();
+    WAIT_FOR_SLAVE_SELECT();
+    SpiDrv::sendCmd(GET_HOST_BY_NAME_CMD, PARAM_NUMS_0);
+    SpiDrv::spiSlaveDeselect();
+    SpiDrv::waitForSlaveReady();
+    SpiDrv::spiSlaveSelect();
+    ok = SpiDrv::waitResponseCmd(GET_HOST_BY_NAME_CMD, PARAM_NUMS_1, addr, &len) && len == 4;
+    SpiDrv::spiSlaveDeselect();
+    _lookup_ip = IPAddress(addr);
   }
-} // end Main loop
+  _lookup = ok && _lookup_ip != IPAddress(255, 255, 255, 255);
+}
 
-void wifi_erase()
+void WifiManager::state_idle()
 {
-   MyEasyWiFi.erase();
+  ON_MESSAGE(START)
+  {
+    if (WiFi.status() == WL_NO_SHIELD) {
+      Serial.println("WiFi shield not present");
+      return;
+    }
+    WiFi.setHostname(WIFI_HOSTNAME);
+    MyEasyWiFi.seed(5);
+    MyEasyWiFi.led(false); // the RGB led is owned by the status led
+    if (MyEasyWiFi.credentials(_ssid, _pass))
+      NEXT(state_connecting);
+    else
+      NEXT(state_portal);
+  }
 }
 
+// Start the association, then poll the module until it reports a result
+void WifiManager::state_connecting()
+{
+  ON_ENTRY()
+  {
+    Serial.print("* Connecting to network: "); Serial.println(_ssid);
+    _attempts++;
+    _poll_time = millis();
+    if (strlen(_pass) > 0)
+      WiFiDrv::wifiSetPassphrase(_ssid, strlen(_ssid), _pass, strlen(_pass));
+    else
+      WiFiDrv::wifiSetNetwork(_ssid, strlen(_ssid));
+  }
+  ON_MESSAGE(STOP)
+  {
+    WiFi.disconnect();
+    NEXT(state_idle);
+    return;
+  }
+  ON_TIMEOUT(WIFI_CONNECT_TIMEOUT_MSEC)
+  {
+    fail();
+    return;
+  }
+  if (!poll(WIFI_POLL_MSEC))
+    return;
+  switch (WiFi.status())
+  {
+  case WL_CONNECTED:
+    NEXT(state_connected);
+    break;
+  case WL_CONNECT_FAILED:
+    fail();
+    break;
+  }
+}
 
+void WifiManager::state_connected()
+{
+  ON_ENTRY()
+  {
+    _ever_connected = true;
+    _failures = 0;
+    _backoff = WIFI_BACKOFF_MIN_MSEC;
+    print_status();
+  }
+  lookup();
+  ON_MESSAGE(STOP)
+  {
+    if (busy() || !module_ready()) // the module takes no other command: the lookup is finished first
+    {
+      NEXT(state_stopping);
+      return;
+    }
+    WiFi.disconnect();
+    NEXT(state_idle);
+    return;
+  }
+  if (!busy() && poll(WIFI_CHECK_MSEC) && WiFi.status() != WL_CONNECTED)
+  {
+    Serial.println("* Wifi connection lost");
+    _drops++;
+    NEXT(state_backoff);
+  }
+}
+
+// Disconnect once the module is ready, a running lookup is finished or abandoned in the passes of the loop
+void WifiManager::state_stopping()
+{
+  lookup();
+  if (_lookup >= 0 && module_ready())
+  {
+    WiFi.disconnect();
+    NEXT(state_idle);
+    return;
+  }
+  ON_TIMEOUT(WIFI_RESOLVE_TIMEOUT_MSEC) // the module does not answer: leave it, the next command waits for it
+  {
+    _lookup = 0;
+    NEXT(state_idle);
+  }
+}
+
+// Wait before the next attempt, the delay doubles after every consecutive failure
+void WifiManager::state_backoff()
+{
+  ON_MESSAGE(STOP)
+  {
+    NEXT(state_idle);
+    return;
+  }
+  ON_MESSAGE(PORTAL)
+  {
+    NEXT(state_portal);
+    return;
+  }
+  ON_TIMEOUT(_backoff)
+  {
+    if (_failures > 0)
+      _backoff = min(2 * _backoff, (unsigned long)WIFI_BACKOFF_MAX_MSEC);
+    NEXT(state_connecting);
+  }
+}
+
+// The configuration portal runs while the machine keeps working, until new credentials are received
+void WifiManager::state_portal()
+{
+  ON_ENTRY()
+  {
+    configPortal.begin(MyAPName);
+  }
+  ON_MESSAGE(STOP)
+  {
+    configPortal.end();
+    NEXT(state_idle);
+    return;
+  }
+  configPortal.run();
+  if (configPortal.received())
+  {
+    strncpy(_ssid, configPortal.ssid(), sizeof(_ssid));
+    strncpy(_pass, configPortal.pass(), sizeof(_pass));
+    MyEasyWiFi.store(_ssid, _pass);
+    configPortal.end();
+    _failures = 0;
+    _backoff = WIFI_BACKOFF_MIN_MSEC;
+    NEXT(state_connecting);
+  }
+}
+
+const char *WifiManager::get_state_name()
+{
+  RETURN_STATE_NAME(idle);
+  RETURN_STATE_NAME(connecting);
+  RETURN_STATE_NAME(connected);
+  RETURN_STATE_NAME(stopping);
+  RETURN_STATE_NAME(backoff);
+  RETURN_STATE_NAME(portal);
+  RETURN_UNKNOWN_STATE_NAME();
+}
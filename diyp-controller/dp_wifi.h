@@ -1,9 +1,80 @@
+/*
+  Wifi connection manager
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Connects to the stored network without blocking the main loop: every call of run() performs at most one
+  (rate limited) status poll of the Wifi module. Failed attempts and dropped links are retried with an exponential
+  backoff. When there are no credentials, or the first connection attempts fail, the configuration AP is opened.
+
+  A DNS lookup keeps the module busy until the DNS server answers (seconds when it does not): resolve() sends the
+  request, run() reads the reply in a later pass, once the module signals it is ready, and resolved() returns it.
+  Until then the module must not get other commands: the status polls are skipped, and the other modules check
+  busy(). A STOP during a lookup goes through the stopping state, which waits in later passes until the module is
+  ready for the disconnect, up to WIFI_RESOLVE_TIMEOUT_MSEC.
+*/
 #ifndef WIFI_H
 #define WIFI_H
 #include "dp.h"
+#include <Arduino.h>
+
+#undef _DP_FSM_TYPE
+#define _DP_FSM_TYPE WifiManager // used for the state machine macro NEXT()
+#include "dp_fsm.h"
+
+#define WIFI_HOSTNAME "diyPresso-One"
+#define WIFI_POLL_MSEC 250                 // interval to poll the Wifi module while connecting [msec]
+#define WIFI_CHECK_MSEC 1000               // interval to check the link while connected [msec]
+#define WIFI_CONNECT_TIMEOUT_MSEC 15000    // max duration of one connection attempt [msec]
+#define WIFI_BACKOFF_MIN_MSEC 1000         // retry delay after the first failure [msec]
+#define WIFI_BACKOFF_MAX_MSEC 64000        // the retry delay doubles after every failure, up to this maximum [msec]
+#define WIFI_PORTAL_FAILURES 4             // open the configuration AP after this many failed attempts (only if never connected)
+#define WIFI_RESOLVE_TIMEOUT_MSEC 10000    // give up a DNS lookup that the module does not finish [msec]
+
+class WifiManager : public StateMachine<WifiManager>
+{
+private:
+  enum WifiManagerMessages
+  {
+    START = 1,
+    STOP = 2,
+    PORTAL = 3,
+  };
+  char _ssid[32], _pass[32];
+  bool _ever_connected = false;
+  int _lookup = 0;                   // -1: running, 0: failed (or none), 1: done, the address is _lookup_ip
+  IPAddress _lookup_ip;
+  unsigned long _poll_time = 0, _backoff = WIFI_BACKOFF_MIN_MSEC, _lookup_time = 0;
+  unsigned int _failures = 0, _attempts = 0, _drops = 0;
+  bool poll(unsigned long interval);
+  void fail();
+  void print_status();
+  void lookup();
+
+public:
+  WifiManager() : StateMachine(STATE(state_idle)) {};
+  void begin() { run(START); }
+  void end() { run(STOP); }
+  void portal() { run(PORTAL); }
+  void erase();
+  bool resolve(const char *host);    // start a DNS lookup, false if the module is not connected or busy
+  int resolved(IPAddress &ip) { ip = _lookup_ip; return _lookup; } // -1: running, 0: failed, 1: the address is in ip
+  bool busy() { return _lookup < 0 || IN_STATE(stopping); } // a DNS lookup has the module: send no other commands
+  bool is_connected() { return IN_STATE(connected); }
+  bool is_portal() { return IN_STATE(portal); }
+  unsigned int attempts() { return _attempts; }
+  unsigned int drops() { return _drops; }
+  unsigned long backoff() { return _backoff; }
+  virtual const char *get_state_name();
+
+protected:
+  void state_idle();
+  void state_connecting();
+  void state_connected();
+  void state_stopping();
+  void state_backoff();
+  void state_portal();
+};
 
-void wifi_setup();
-void wifi_loop();
-void wifi_erase();
+extern WifiManager wifiManager;
 
 #endif // WIFI_H
@@ -0,0 +1,121 @@
+/*
+  Simulation of the mains current arbiter between the heater and the pump (diyp-controller/dp_arbiter.h)
+  (c) 2025 diyPresso - CC-BY-NC
+
+  A boiler on temperature with a PI controller and feed forward (like the boiler controller), the heater with the
+  software PWM of HeaterDevice, and a shot every 2 minutes. The pump draws PUMP_INRUSH times its rated power during
+  its inrush. The run is done without the arbiter, with the arbiter at the default limit and at a limit below the
+  heater and the pump together, for several PWM phases of the shot. Check:
+  - the peak combined power never exceeds the limit;
+  - at the default limit: the shot temperature deviation (max and rms) does not rise above the run without arbiter,
+    and the heater energy is the same.
+
+  usage: arbiter_sim [shots] [pwm phase of the first shot msec]
+*/
+#include <cstdio>
+#include <cmath>
+#include <cstdlib>
+#include "../diyp-controller/dp_arbiter.h"
+
+#define CAPACITY 4200.0   // heat capacity of the boiler [J/K]
+#define LOSS 0.7          // heat loss [W/K]
+#define AMBIENT 20.0
+#define SETPOINT 98.0
+#define SHOT_LOAD 700.0   // cooling by the fresh water during a shot [W]
+#define SHOT_MSEC 30000
+#define SHOT_INTERVAL_MSEC 120000
+#define PUMP_INRUSH 4.0   // inrush current of the pump, times the rated current
+#define PUMP_INRUSH_MSEC 50
+#define PWM_USEC 1000000UL
+#define STEP_USEC 1000    // control loop interval
+#define LOW_LIMIT_W HEATER_RATED_POWER // below the heater and the pump together
+
+static int errors = 0;
+
+static void check(bool ok, const char *what, double got = 0, double expect = 0)
+{
+  if (!ok && errors++ < 20)
+    printf("FAIL %s: %.3f, expected %.3f\n", what, got, expect);
+}
+
+typedef struct
+{
+  double peak, dev, rms, energy, withheld; // [W], [C], [C], [Wh], [Wh]
+} result_t;
+
+// limit 0: without the arbiter
+static result_t run(int shots, unsigned long phase, double limit)
+{
+  PowerArbiter arbiter;
+  arbiter.limit(limit);
+  result_t r = {0, 0, 0, 0, 0};
+  double temp = SETPOINT, integral = 0;
+  unsigned long period = 0, samples = 0;
+  unsigned long end = (unsigned long)shots * SHOT_INTERVAL_MSEC * 1000;
+  for (unsigned long t = 0; t < end; t += STEP_USEC)
+  {
+    unsigned long msec = (t / 1000 + SHOT_INTERVAL_MSEC - 10000 - phase) % SHOT_INTERVAL_MSEC;
+    bool pump = msec < SHOT_MSEC;
+
+    // boiler controller: PI with feed forward (ff_ready, ff_brew)
+    double error = SETPOINT - temp;
+    integral += error * STEP_USEC / 1E6 * 0.08;
+    integral = integral < -7 ? -7 : integral > 7 ? 7 : integral;
+    double want = 6.2 * error + integral + (pump ? 35.0 : 6.0);
+    want = want < 0 ? 0 : want > 100 ? 100 : want;
+
+    // HeaterDevice PWM
+    period = (period + STEP_USEC) % PWM_USEC;
+    bool heater = period < want / 100.0 * PWM_USEC;
+    if (limit > 0)
+      heater = arbiter.heater(want, heater, pump, pump ? msec : 0, STEP_USEC);
+    double power = (heater ? HEATER_RATED_POWER : 0) + (pump ? PUMP_RATED_POWER * (msec < PUMP_INRUSH_MSEC ? PUMP_INRUSH : 1) : 0);
+    r.peak = power > r.peak ? power : r.peak;
+    r.energy += heater ? HEATER_RATED_POWER * STEP_USEC / 1E6 / 3600 : 0;
+
+    temp += ((heater ? HEATER_RATED_POWER : 0) - LOSS * (temp - AMBIENT) - (pump ? SHOT_LOAD : 0)) * STEP_USEC / 1E6 / CAPACITY;
+    if (pump)
+    {
+      double d = temp - SETPOINT;
+      r.dev = fabs(d) > r.dev ? fabs(d) : r.dev;
+      r.rms += d * d;
+      samples++;
+    }
+  }
+  r.rms = sqrt(r.rms / samples);
+  r.withheld = arbiter.withheld();
+  return r;
+}
+
+static void print(const char *what, double limit, const result_t &r)
+{
+  printf("  %-10s limit %4.0f W: peak %4.0f W (%.2f A at 230 V), shot deviation max %.3f C, rms %.3f C, "
+         "heater energy %.1f Wh, withheld %.2f Wh\n",
+         what, limit, r.peak, r.peak / 230.0, r.dev, r.rms, r.energy, r.withheld);
+}
+
+int main(int argc, char **argv)
+{
+  int shots = argc > 1 ? atoi(argv[1]) : 20;
+  unsigned long phases[] = {0, 250, 500, 750};
+  int n = argc > 2 ? 1 : 4;
+  if (argc > 2)
+    phases[0] = atoi(argv[2]);
+
+  for (int k = 0; k < n; k++)
+  {
+    result_t none = run(shots, phases[k], 0), fit = run(shots, phases[k], ARBITER_LIMIT_W),
+             low = run(shots, phases[k], LOW_LIMIT_W);
+    printf("pwm phase %lu msec\n", phases[k]);
+    print("no arbiter", 0, none);
+    print("arbiter", ARBITER_LIMIT_W, fit);
+    print("arbiter", LOW_LIMIT_W, low);
+    check(fit.peak <= ARBITER_LIMIT_W, "peak [W]", fit.peak, ARBITER_LIMIT_W);
+    check(low.peak <= LOW_LIMIT_W, "peak at the low limit [W]", low.peak, LOW_LIMIT_W);
+    check(fit.dev <= none.dev, "shot deviation max [C]", fit.dev, none.dev);
+    check(fit.rms <= none.rms, "shot deviation rms [C]", fit.rms, none.rms);
+    check(fabs(fit.energy - none.energy) < 0.1, "heater energy [Wh]", fit.energy, none.energy);
+  }
+  printf("%d errors\n", errors);
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,192 @@
+/*
+  Host stand-in for the Arduino core, to link portable firmware modules (e.g. dp_pid.cpp) in the server tools
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Only what those modules use. millis() is a simulated clock per thread: a tool sets it with host_clock() before it
+  calls the firmware code, so every worker thread can run its own machines; with host_realtime() set it follows the
+  monotonic clock instead (for a test against real sockets). Serial prints to stderr. Print, String, Client and
+  IPAddress behave like the ones of the core (println() ends the line with CR LF). digitalRead() is defined by the
+  stand-in of the module it reads (WiFiNINA.cpp: the ready line of the Wifi module).
+*/
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <time.h>
+#include <string>
+
+typedef uint8_t byte;
+typedef unsigned long ulong;
+typedef bool boolean;
+
+inline unsigned long &host_clock() // [msec]
+{
+  static thread_local unsigned long msec = 0;
+  return msec;
+}
+inline bool &host_realtime() // millis() and micros() follow the monotonic clock
+{
+  static bool on = false;
+  return on;
+}
+inline unsigned long long host_usec()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+inline unsigned long millis() { return host_realtime() ? host_usec() / 1000 : host_clock(); }
+inline unsigned long micros() { return host_realtime() ? host_usec() : host_clock() * 1000; }
+
+#define LOW 0
+#define HIGH 1
+int digitalRead(uint8_t pin);
+
+// compared in the common type, like the macros of the Arduino core do
+template <class A, class B> inline auto min(A a, B b) -> decltype(a + b)
+{
+  return (decltype(a + b))a < (decltype(a + b))b ? a : b;
+}
+template <class A, class B> inline auto max(A a, B b) -> decltype(a + b)
+{
+  return (decltype(a + b))a > (decltype(a + b))b ? a : b;
+}
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+class Print;
+
+class String
+{
+  std::string _s;
+
+public:
+  String(const char *s = "") : _s(s) {}
+  String(const std::string &s) : _s(s) {}
+  explicit String(int v) : _s(std::to_string(v)) {}
+  explicit String(long v) : _s(std::to_string(v)) {}
+  explicit String(unsigned long v) : _s(std::to_string(v)) {}
+  const char *c_str() const { return _s.c_str(); }
+  unsigned int length() const { return _s.size(); }
+  char operator[](unsigned int i) const { return i < _s.size() ? _s[i] : 0; }
+  bool operator==(const char *s) const { return _s == s; }
+  bool operator==(const String &s) const { return _s == s._s; }
+  bool operator!=(const char *s) const { return _s != s; }
+  String &operator+=(const String &s)
+  {
+    _s += s._s;
+    return *this;
+  }
+  friend String operator+(const String &a, const String &b) { return String(a._s + b._s); }
+};
+
+class Printable
+{
+public:
+  virtual size_t printTo(Print &p) const = 0;
+};
+
+class Print
+{
+public:
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *buf, size_t size)
+  {
+    size_t n = 0;
+    while (size--)
+      n += write(*buf++);
+    return n;
+  }
+  size_t write(const char *s) { return write((const uint8_t *)s, strlen(s)); }
+  size_t print(const char *s) { return write(s); }
+  size_t print(const String &s) { return write(s.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int v) { return print((long)v); }
+  size_t print(unsigned int v) { return print((unsigned long)v); }
+  size_t print(long v) { return format("%ld", v); }
+  size_t print(unsigned long v) { return format("%lu", v); }
+  size_t print(double v, int digits = 2) { return format("%.*f", digits, v); }
+  size_t print(const Printable &p) { return p.printTo(*this); }
+  size_t println() { return write("\r\n"); }
+  template <class T> size_t println(T v)
+  {
+    size_t n = print(v);
+    return n + println();
+  }
+
+private:
+  template <class... A> size_t format(const char *f, A... a)
+  {
+    char buf[64];
+    snprintf(buf, sizeof(buf), f, a...);
+    return write(buf);
+  }
+};
+
+class HostSerial : public Print
+{
+public:
+  using Print::write;
+  size_t write(uint8_t c) { return fputc(c, stderr) != EOF; }
+  size_t write(const uint8_t *buf, size_t size) { return fwrite(buf, 1, size, stderr); }
+};
+
+static HostSerial Serial __attribute__((unused));
+
+class IPAddress : public Printable
+{
+  uint8_t _a[4];
+
+public:
+  IPAddress() : IPAddress(0, 0, 0, 0) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _a{a, b, c, d} {}
+  IPAddress(uint32_t ip) { memcpy(_a, &ip, 4); } // in network order, like the core
+  IPAddress(const uint8_t *ip) { memcpy(_a, ip, 4); }
+  operator uint32_t() const
+  {
+    uint32_t ip;
+    memcpy(&ip, _a, 4);
+    return ip;
+  }
+  bool operator==(const IPAddress &o) const { return memcmp(_a, o._a, 4) == 0; }
+  bool operator!=(const IPAddress &o) const { return !(*this == o); }
+  uint8_t operator[](int i) const { return _a[i]; }
+  uint8_t &operator[](int i) { return _a[i]; }
+  size_t printTo(Print &p) const
+  {
+    char buf[16];
+    snprintf(buf, sizeof(buf), "%u.%u.%u.%u", _a[0], _a[1], _a[2], _a[3]);
+    return p.print(buf);
+  }
+};
+
+class Stream : public Print
+{
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+};
+
+class Client : public Stream
+{
+public:
+  virtual int connect(IPAddress ip, uint16_t port) = 0;
+  virtual int connect(const char *host, uint16_t port) = 0;
+  virtual size_t write(uint8_t b) = 0;
+  virtual size_t write(const uint8_t *buf, size_t size) = 0;
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int read(uint8_t *buf, size_t size) = 0;
+  virtual int peek() = 0;
+  virtual void flush() = 0;
+  virtual void stop() = 0;
+  virtual uint8_t connected() = 0;
+  virtual operator bool() = 0;
+};
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,165 @@
+/*
+  Host stand-in for the ArduinoMqttClient library (see ArduinoMqttClient.h)
+  (c) 2025 diyPresso - CC-BY-NC
+*/
+#include <ArduinoMqttClient.h>
+#include "../mqtt.h"
+
+bool MqttClient::send(const std::string &packet)
+{
+  _last_tx = millis();
+  return _client->write((const uint8_t *)packet.data(), packet.size()) == packet.size();
+}
+
+int MqttClient::beginWill(const char *topic, bool retain, uint8_t qos)
+{
+  _will_topic = topic;
+  _will.clear();
+  _will_retain = retain;
+  _will_qos = qos;
+  _in_will = true;
+  return 1;
+}
+
+int MqttClient::connect(IPAddress ip, uint16_t port)
+{
+  _connected = false;
+  _connect_error = -2; // MQTT_CONNECTION_REFUSED
+  _rx.clear();
+  _packet_id = 0;
+  if (!_client->connect(ip, port))
+    return 0;
+  std::string body, packet;
+  mqtt_string(body, "MQTT");
+  body += char(4); // 3.1.1
+  body += char(0x02 | (_will_topic.empty() ? 0 : 0x04 | _will_qos << 3 | (_will_retain ? 0x20 : 0)));
+  body += char(_keepalive / 1000 >> 8);
+  body += char(_keepalive / 1000 & 0xFF);
+  mqtt_string(body, _id);
+  if (!_will_topic.empty())
+  {
+    mqtt_string(body, _will_topic);
+    mqtt_string(body, _will);
+  }
+  mqtt_header(packet, MQTT_CONNECT, 0, body.size());
+  if (!send(packet + body))
+  {
+    _client->stop();
+    return 0;
+  }
+  _connect_error = -4; // MQTT_CONNECTION_TIMEOUT
+  unsigned long start = millis();
+  while (_client->connected() && millis() - start < _timeout) // like the library: blocks until the CONNACK
+  {
+    receive();
+    if (_connected || _connect_error >= 0)
+      break;
+  }
+  if (!_connected)
+    _client->stop();
+  return _connected;
+}
+
+void MqttClient::stop()
+{
+  if (connected())
+    send(std::string("\xE0\x00", 2));
+  _connected = false;
+  _client->stop();
+}
+
+// Read what the client received, handle complete packets; a PUBLISH stays in _payload until it is read
+void MqttClient::receive()
+{
+  while (_client->available() > 0)
+  {
+    int b = _client->read();
+    if (b < 0)
+      break;
+    _rx += char(b);
+    mqtt_packet_t packet;
+    long n = mqtt_parse((const uint8_t *)_rx.data(), _rx.size(), packet);
+    if (n == 0)
+      continue;
+    if (n < 0)
+    {
+      stop();
+      return;
+    }
+    if (packet.type == MQTT_CONNACK && packet.size == 2)
+    {
+      _connect_error = packet.body[1];
+      _connected = _connect_error == 0;
+    }
+    if (packet.type == MQTT_PUBLISH)
+    {
+      size_t pos = 0;
+      mqtt_read_string(packet, pos, _message_topic);
+      if (packet.flags & 0x06)
+        pos += 2;
+      _payload.assign((const char *)packet.body + pos, packet.size - pos);
+      _read = 0;
+    }
+    _rx.clear();
+    if (packet.type == MQTT_PUBLISH)
+      break;
+  }
+}
+
+void MqttClient::poll()
+{
+  if (!connected())
+    return;
+  if (millis() - _last_tx >= _keepalive)
+    send(std::string("\xC0\x00", 2));
+  receive();
+}
+
+int MqttClient::parseMessage()
+{
+  _payload.clear();
+  _read = 0;
+  poll();
+  return _payload.size();
+}
+
+int MqttClient::read(uint8_t *buf, size_t size)
+{
+  size = min(size, _payload.size() - _read);
+  memcpy(buf, _payload.data() + _read, size);
+  _read += size;
+  return size;
+}
+
+int MqttClient::beginMessage(const char *topic, bool retain, uint8_t qos, bool dup)
+{
+  _topic = topic;
+  _tx.clear();
+  _retain = retain;
+  _qos = qos;
+  return 1;
+}
+
+size_t MqttClient::write(const uint8_t *buf, size_t size)
+{
+  std::string &out = _in_will ? _will : _tx;
+  if (!_in_will && out.size() + size > _tx_size)
+    return 0;
+  out.append((const char *)buf, size);
+  return size;
+}
+
+int MqttClient::endMessage()
+{
+  std::string body, packet;
+  mqtt_string(body, _topic);
+  if (_qos)
+  {
+    _packet_id++;
+    body += char(_packet_id >> 8);
+    body += char(_packet_id & 0xFF);
+  }
+  body += _tx;
+  mqtt_header(packet, MQTT_PUBLISH, (_qos << 1) | (_retain ? 1 : 0), body.size());
+  return connected() && send(packet + body);
+}
@@ -0,0 +1,57 @@
+/*
+  Host stand-in for the ArduinoMqttClient library, to run dp_mqtt of the firmware in the server tools
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Only what dp_mqtt uses, with the behaviour of the library that matters to it: connect() writes the CONNECT and then
+  waits (blocking) for the CONNACK up to the connection timeout, poll() sends the PINGREQ of the keep alive, a
+  received PUBLISH is returned by parseMessage() once it is complete. Messages are written by endMessage() in one
+  write of the client. The packets are made with the codec of server/mqtt.h.
+*/
+#ifndef HOST_ARDUINO_MQTT_CLIENT_H
+#define HOST_ARDUINO_MQTT_CLIENT_H
+
+#include <Arduino.h>
+#include <string>
+
+class MqttClient : public Print
+{
+  Client *_client;
+  std::string _id, _will_topic, _will, _topic, _tx, _rx, _payload, _message_topic;
+  bool _will_retain = false, _in_will = false, _retain = false, _connected = false;
+  uint8_t _will_qos = 0, _qos = 0;
+  uint16_t _packet_id = 0;
+  unsigned long _keepalive = 60000, _timeout = 30000, _last_tx = 0;
+  size_t _tx_size = 256, _read = 0;
+  int _connect_error = 0;
+  void receive();
+  bool send(const std::string &packet);
+
+public:
+  MqttClient(Client &client) : _client(&client) {}
+  void setId(const char *id) { _id = id; }
+  void setKeepAliveInterval(unsigned long msec) { _keepalive = msec; }
+  void setConnectionTimeout(unsigned long msec) { _timeout = msec; }
+  void setTxPayloadSize(unsigned short size) { _tx_size = size; }
+  int beginWill(const char *topic, bool retain, uint8_t qos);
+  int endWill() { _in_will = false; return 1; }
+  int connect(IPAddress ip, uint16_t port = 1883);
+  int connectError() { return _connect_error; }
+  int connected() { return _connected && _client->connected(); }
+  void stop();
+  void poll();
+  int beginMessage(const char *topic, bool retain = false, uint8_t qos = 0, bool dup = false);
+  int beginMessage(const char *topic, unsigned long size, bool retain = false, uint8_t qos = 0, bool dup = false)
+  {
+    return beginMessage(topic, retain, qos, dup);
+  }
+  int endMessage();
+  int parseMessage();
+  String messageTopic() { return String(_message_topic); }
+  int available() { return _payload.size() - _read; }
+  int read(uint8_t *buf, size_t size);
+  using Print::write;
+  size_t write(uint8_t b) { return write(&b, 1); }
+  size_t write(const uint8_t *buf, size_t size);
+};
+
+#endif // HOST_ARDUINO_MQTT_CLIENT_H
@@ -0,0 +1,36 @@
+/*
+  Host stand-in for EasyWiFi (diyp-controller/EasyWiFi.h): the credential file on the module is
+  nina_host().stored_ssid and stored_pass (see WiFiNINA.h)
+  (c) 2025 diyPresso - CC-BY-NC
+*/
+#include "../../diyp-controller/EasyWiFi.h"
+
+EasyWiFi::EasyWiFi() {}
+
+byte EasyWiFi::credentials(char *ssid, char *pass)
+{
+  NinaHost &host = nina_host();
+  if (host.stored_ssid.empty())
+    return 0;
+  strcpy(ssid, host.stored_ssid.c_str());
+  strcpy(pass, host.stored_pass.c_str());
+  return 1;
+}
+
+byte EasyWiFi::store(char *ssid, char *pass)
+{
+  NinaHost &host = nina_host();
+  host.stored_ssid = ssid;
+  host.stored_pass = pass;
+  host.stores++;
+  return 1;
+}
+
+byte EasyWiFi::erase()
+{
+  nina_host().stored_ssid.clear();
+  return 1;
+}
+
+void EasyWiFi::seed(int value) {}
+void EasyWiFi::led(boolean value) {}
@@ -0,0 +1,404 @@
+/*
+  Host stand-in for the WiFiNINA library (see WiFiNINA.h)
+  (c) 2025 diyPresso - CC-BY-NC
+*/
+#include <WiFiNINA.h>
+#include <utility/wifi_drv.h>
+#include <utility/spi_drv.h>
+#include <utility/server_drv.h>
+#include <utility/WiFiSocketBuffer.h>
+#include <algorithm>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+WiFiClass WiFi;
+WiFiSocketBufferClass WiFiSocketBuffer;
+
+NinaHost &nina_host()
+{
+  static NinaHost host;
+  return host;
+}
+
+int digitalRead(uint8_t pin)
+{
+  return pin == NINA_ACK && !nina_host().ready() ? HIGH : LOW;
+}
+
+void NinaHost::command()
+{
+  if (ready())
+    return;
+  blocked_calls++;
+  blocked_msec += busy_until - millis();
+  if (host_realtime())
+    usleep((busy_until - millis()) * 1000);
+  else
+    host_clock() = busy_until;
+}
+
+void NinaHost::reset()
+{
+  for (auto &s : sockets)
+    if (s.fd >= 0)
+      close(s.fd);
+  *this = NinaHost();
+}
+
+wl_status_t NinaHost::update()
+{
+  if (!present)
+    return status = WL_NO_SHIELD;
+  if (status == WL_NO_SHIELD) // the module is back, after its reset
+    status = WL_IDLE_STATUS;
+  if (status == WL_IDLE_STATUS && !ssid.empty() && millis() - since >= associate_msec)
+  {
+    status = WL_NO_SSID_AVAIL;
+    for (auto &n : networks)
+      if (n.ssid == ssid)
+        status = n.pass == pass ? WL_CONNECTED : WL_CONNECT_FAILED;
+  }
+  if (status == WL_CONNECTED && !link)
+    status = WL_CONNECTION_LOST;
+  if (status == WL_IDLE_STATUS && !ap.empty() && millis() - since >= ap_msec)
+    status = WL_AP_LISTENING;
+  return status;
+}
+
+int NinaHost::connect(const std::string &request)
+{
+  if (server_port == 0)
+    return -1;
+  for (int i = 0; i < MAX_SOCK_NUM; i++)
+    if (!sockets[i].used)
+    {
+      sockets[i] = NinaSocket();
+      sockets[i].used = sockets[i].open = true;
+      sockets[i].rx = request;
+      accepted.push_back(i);
+      return i;
+    }
+  return -1;
+}
+
+uint8_t WiFiClass::status()
+{
+  nina_host().command();
+  nina_host().status_calls++;
+  return nina_host().update();
+}
+
+int WiFiClass::disconnect()
+{
+  NinaHost &host = nina_host();
+  host.disconnects++;
+  host.ssid.clear();
+  if (host.present)
+    host.status = WL_DISCONNECTED;
+  return 1;
+}
+
+void WiFiClass::end()
+{
+  NinaHost &host = nina_host();
+  host.ssid.clear();
+  host.ap.clear();
+  host.server_port = host.udp_port = 0;
+  if (host.present)
+    host.status = WL_IDLE_STATUS;
+}
+
+const char *WiFiClass::SSID(uint8_t i)
+{
+  return i < nina_host().networks.size() ? nina_host().networks[i].ssid.c_str() : NULL;
+}
+
+uint8_t *WiFiClass::macAddress(uint8_t *mac)
+{
+  nina_host().command();
+  static const uint8_t host_mac[6] = {0x24, 0x0A, 0xC4, 0x00, 0xD1, 0x01};
+  memcpy(mac, host_mac, 6);
+  return mac;
+}
+
+int8_t WiFiDrv::wifiSetNetwork(const char *ssid, uint8_t ssid_len)
+{
+  return wifiSetPassphrase(ssid, ssid_len, "", 0);
+}
+
+int8_t WiFiDrv::wifiSetPassphrase(const char *ssid, uint8_t ssid_len, const char *passphrase, const uint8_t len)
+{
+  NinaHost &host = nina_host();
+  host.command();
+  host.associations++;
+  host.ssid.assign(ssid, ssid_len);
+  host.pass.assign(passphrase, len);
+  host.ap.clear();
+  host.since = millis();
+  host.status = WL_IDLE_STATUS;
+  return host.present;
+}
+
+int8_t WiFiDrv::wifiSetApNetwork(const char *ssid, uint8_t ssid_len, uint8_t channel)
+{
+  NinaHost &host = nina_host();
+  host.ap.assign(ssid, ssid_len);
+  host.ssid.clear();
+  host.since = millis();
+  host.status = WL_IDLE_STATUS;
+  return host.present;
+}
+
+int8_t WiFiDrv::startScanNetworks()
+{
+  nina_host().scans++;
+  return 1;
+}
+
+uint8_t WiFiDrv::getScanNetworks()
+{
+  return nina_host().networks.size();
+}
+
+// A client socket: move what the peer sent to rx, notice when it closed the connection
+static void receive(NinaSocket &s)
+{
+  char buf[4096];
+  while (s.fd >= 0 && s.open)
+  {
+    ssize_t n = recv(s.fd, buf, sizeof(buf), MSG_DONTWAIT);
+    if (n > 0)
+    {
+      s.rx.append(buf, n);
+      continue;
+    }
+    if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != ENOTCONN))
+      s.open = false;
+    return;
+  }
+}
+
+uint8_t WiFiClient::connected()
+{
+  if (_sock >= MAX_SOCK_NUM)
+    return 0;
+  nina_host().command();
+  NinaSocket &s = nina_host().sockets[_sock];
+  receive(s);
+  return s.used && (s.open || !s.rx.empty()); // like the module: connected while there is data to read
+}
+
+int WiFiClient::available()
+{
+  return connected() ? nina_host().sockets[_sock].rx.size() : 0;
+}
+
+int WiFiClient::read()
+{
+  uint8_t b;
+  return read(&b, 1) == 1 ? b : -1;
+}
+
+int WiFiClient::read(uint8_t *buf, size_t size)
+{
+  if (!available())
+    return -1;
+  std::string &rx = nina_host().sockets[_sock].rx;
+  size = std::min(size, rx.size());
+  memcpy(buf, rx.data(), size);
+  rx.erase(0, size);
+  return size;
+}
+
+int WiFiClient::peek()
+{
+  return available() ? (uint8_t)nina_host().sockets[_sock].rx[0] : -1;
+}
+
+size_t WiFiClient::write(const uint8_t *buf, size_t size)
+{
+  if (!connected())
+    return 0;
+  NinaSocket &s = nina_host().sockets[_sock];
+  size = std::min(size, s.write_limit);
+  if (s.fd >= 0)
+  {
+    ssize_t n = send(s.fd, buf, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+    return n > 0 ? n : 0;
+  }
+  s.tx.append((const char *)buf, size);
+  return size;
+}
+
+void WiFiClient::stop()
+{
+  if (_sock < MAX_SOCK_NUM && nina_host().sockets[_sock].fd >= 0)
+  {
+    close(nina_host().sockets[_sock].fd);
+    nina_host().sockets[_sock].fd = -1;
+  }
+  if (_sock < MAX_SOCK_NUM)
+    nina_host().sockets[_sock].used = false;
+  _sock = 255;
+}
+
+WiFiClient WiFiServer::available(uint8_t *status)
+{
+  NinaHost &host = nina_host();
+  if (host.server_port != _port || host.accepted.empty())
+    return WiFiClient();
+  uint8_t sock = host.accepted.front();
+  host.accepted.pop_front();
+  return WiFiClient(sock);
+}
+
+int WiFiUDP::parsePacket()
+{
+  NinaHost &host = nina_host();
+  if (host.udp_port == 0 || host.udp_rx.empty())
+    return 0;
+  _rx = host.udp_rx.front();
+  host.udp_rx.pop_front();
+  _pos = 0;
+  return _rx.data.size();
+}
+
+int WiFiUDP::read(unsigned char *buf, size_t size)
+{
+  size = std::min(size, _rx.data.size() - _pos);
+  memcpy(buf, _rx.data.data() + _pos, size);
+  _pos += size;
+  return size;
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port)
+{
+  _tx = {ip, port, ""};
+  return 1;
+}
+
+size_t WiFiUDP::write(const uint8_t *buf, size_t size)
+{
+  _tx.data.append((const char *)buf, size);
+  return size;
+}
+
+int WiFiUDP::endPacket()
+{
+  nina_host().udp_tx.push_back(_tx);
+  return 1;
+}
+
+void SpiDrv::sendCmd(uint8_t cmd, uint8_t numParam)
+{
+  NinaHost &host = nina_host();
+  host.command();
+  host.spi_cmd = cmd;
+  host.spi_param.clear();
+}
+
+void SpiDrv::sendParam(uint8_t *param, uint8_t param_len, uint8_t lastParam)
+{
+  nina_host().spi_param.assign((const char *)param, param_len);
+}
+
+// The end of a command: the module runs it
+void SpiDrv::spiSlaveDeselect()
+{
+  NinaHost &host = nina_host();
+  if (host.spi_cmd == REQ_HOST_BY_NAME_CMD && !host.spi_param.empty())
+  {
+    host.lookups++;
+    host.busy_until = millis() + host.dns_msec;
+    host.spi_param.clear();
+  }
+}
+
+int SpiDrv::waitResponseCmd(uint8_t cmd, uint8_t numParam, uint8_t *param, uint8_t *param_len)
+{
+  NinaHost &host = nina_host();
+  host.command(); // the reply is there once the module is ready
+  if (cmd != host.spi_cmd)
+    return 0;
+  if (cmd == REQ_HOST_BY_NAME_CMD)
+  {
+    param[0] = !host.dns_fail;
+    *param_len = 1;
+  }
+  else
+  {
+    IPAddress ip = host.dns_fail ? IPAddress(255, 255, 255, 255) : host.dns_ip;
+    for (int i = 0; i < 4; i++)
+      param[i] = ip[i];
+    *param_len = 4;
+  }
+  return 1;
+}
+
+uint8_t ServerDrv::getSocket()
+{
+  NinaHost &host = nina_host();
+  host.command();
+  for (int i = 0; i < MAX_SOCK_NUM; i++)
+    if (!host.sockets[i].used)
+      return i;
+  return NO_SOCKET_AVAIL;
+}
+
+void ServerDrv::startClient(uint32_t ipAddress, uint16_t port, uint8_t sock, uint8_t protMode)
+{
+  NinaHost &host = nina_host();
+  host.command();
+  NinaSocket &s = host.sockets[sock];
+  s = NinaSocket();
+  s.used = s.open = true;
+  if (host.syn_drop)
+  {
+    s.syn = true;
+    return;
+  }
+  s.fd = socket(AF_INET, SOCK_STREAM, 0);
+  int one = 1;
+  setsockopt(s.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  fcntl(s.fd, F_SETFL, O_NONBLOCK);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(host.tcp_port ? host.tcp_port : port);
+  if (connect(s.fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 && errno != EINPROGRESS)
+    s.open = false;
+}
+
+uint8_t ServerDrv::getClientState(uint8_t sock)
+{
+  NinaHost &host = nina_host();
+  host.command();
+  NinaSocket &s = host.sockets[sock];
+  if (s.syn)
+    return SYN_SENT;
+  if (s.fd < 0 || !s.open)
+    return CLOSED;
+  struct pollfd p = {s.fd, POLLOUT, 0};
+  if (poll(&p, 1, 0) <= 0)
+    return SYN_SENT;
+  int error = 0;
+  socklen_t len = sizeof(error);
+  getsockopt(s.fd, SOL_SOCKET, SO_ERROR, &error, &len);
+  return error ? CLOSED : ESTABLISHED;
+}
+
+void ServerDrv::stopClient(uint8_t sock)
+{
+  NinaHost &host = nina_host();
+  host.command();
+  NinaSocket &s = host.sockets[sock];
+  if (s.fd >= 0)
+    close(s.fd);
+  s = NinaSocket();
+}
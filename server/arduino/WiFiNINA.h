@@ -0,0 +1,168 @@
+/*
+  Host stand-in for the WiFiNINA library (the u-blox NINA Wifi module of the MKR WiFi 1010), to run the network
+  modules of the firmware (dp_wifi, dp_portal) in the server tools
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Only what those modules use. The module is emulated by NinaHost (nina_host()): the test puts the networks in range,
+  drops the link, takes the module out, connects clients to the WiFiServer and sends DNS packets to the WiFiUDP; the
+  emulation counts the calls of the firmware, so a test can check that it polls and does not wait. An association
+  and the start of the access point take their time on the clock of Arduino.h; no call blocks. The sockets of the
+  WiFiServer are scripted: what a client sends is in rx, what the firmware writes is collected in tx.
+
+  For dp_mqtt (server/mqtt_sim): a DNS lookup (REQ_HOST_BY_NAME of utility/spi_drv.h) keeps the module busy for
+  dns_msec; a command sent meanwhile waits for it, like the SPI bus of the real module, and the wait is added up in
+  blocked_msec. The client sockets of utility/server_drv.h are real non-blocking TCP connections to 127.0.0.1, to
+  tcp_port when it is set. The credential store of EasyWiFi is stored_ssid and stored_pass (arduino/EasyWiFi.cpp).
+*/
+#ifndef HOST_WIFININA_H
+#define HOST_WIFININA_H
+
+#include <Arduino.h>
+#include <string>
+#include <vector>
+#include <deque>
+
+#define MAX_SOCK_NUM 10
+#define NO_SOCKET_AVAIL 255
+#define NINA_ACK 100 // the ready line of the module, a pin of the board variant
+
+typedef enum
+{
+  WL_NO_SHIELD = 255,
+  WL_NO_MODULE = WL_NO_SHIELD,
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL,
+  WL_SCAN_COMPLETED,
+  WL_CONNECTED,
+  WL_CONNECT_FAILED,
+  WL_CONNECTION_LOST,
+  WL_DISCONNECTED,
+  WL_AP_LISTENING,
+  WL_AP_CONNECTED,
+  WL_AP_FAILED
+} wl_status_t;
+
+struct NinaNetwork
+{
+  std::string ssid, pass;
+};
+
+struct NinaSocket
+{
+  bool used = false, open = false; // open: the peer did not close the connection
+  std::string rx, tx;              // rx: sent by the peer and not read yet, tx: written by the firmware
+  size_t write_limit = 1 << 20;    // max bytes accepted by one write, 0: the socket is busy
+  int fd = -1;                     // a client socket of ServerDrv: the TCP connection
+  bool syn = false;                // a client socket that is never established (syn_drop)
+};
+
+struct NinaPacket
+{
+  IPAddress ip;
+  uint16_t port;
+  std::string data;
+};
+
+struct NinaHost
+{
+  // set by the test
+  bool present = true;                // false: WL_NO_SHIELD
+  std::vector<NinaNetwork> networks;  // in range
+  bool link = true;                   // false: the connected network dropped us
+  unsigned long associate_msec = 2000; // [msec] until an association succeeds or fails
+  unsigned long ap_msec = 300;        // [msec] until the access point listens
+  unsigned long dns_msec = 50;        // [msec] until the DNS server answers
+  bool dns_fail = false;              // the DNS server does not know the name
+  IPAddress dns_ip = IPAddress(127, 0, 0, 1); // the address of every name
+  uint16_t tcp_port = 0;              // the client connections go to 127.0.0.1 at this port, 0: the port asked
+  bool syn_drop = false;              // the client connections are never established
+  std::string stored_ssid, stored_pass; // the credential store of EasyWiFi
+
+  // the module
+  wl_status_t status = WL_IDLE_STATUS;
+  std::string ssid, pass, hostname, ap;
+  unsigned long since = 0;            // [msec] start of the association or of the access point
+  unsigned long status_calls = 0, associations = 0, scans = 0, disconnects = 0, lookups = 0, stores = 0;
+  unsigned long busy_until = 0;       // [msec] the module runs a DNS lookup until then
+  uint8_t spi_cmd = 0;                // the command sent on the SPI bus
+  std::string spi_param;
+  unsigned long blocked_msec = 0, blocked_calls = 0; // commands that waited for the module
+  NinaSocket sockets[MAX_SOCK_NUM];
+  uint16_t server_port = 0, udp_port = 0; // 0: not listening
+  std::deque<uint8_t> accepted;       // connections for WiFiServer::available()
+  std::deque<NinaPacket> udp_rx, udp_tx;
+
+  wl_status_t update();               // the status after the time passed
+  int connect(const std::string &request); // a client connects to the WiFiServer and sends request; -1: no socket
+  bool ready() { return millis() >= busy_until; } // the module takes a command
+  void command();                     // a command of the firmware: waits for the module
+  void reset();
+};
+
+NinaHost &nina_host();
+
+class WiFiClass
+{
+public:
+  uint8_t status();
+  int disconnect();
+  void end();
+  void setHostname(const char *name) { nina_host().hostname = name; }
+  void config(IPAddress local, IPAddress dns, IPAddress gateway, IPAddress subnet) {}
+  const char *SSID() { return nina_host().ssid.c_str(); }
+  const char *SSID(uint8_t i);
+  IPAddress localIP() { return nina_host().status == WL_CONNECTED ? IPAddress(192, 168, 1, 42) : IPAddress(); }
+  int32_t RSSI() { return -60; }
+  uint8_t *macAddress(uint8_t *mac);
+  unsigned long getTime() { return time(NULL); }
+};
+
+extern WiFiClass WiFi;
+
+class WiFiClient
+{
+  uint8_t _sock;
+
+public:
+  WiFiClient() : _sock(255) {}
+  WiFiClient(uint8_t sock) : _sock(sock) {}
+  uint8_t connected();
+  int available();
+  int read();
+  int read(uint8_t *buf, size_t size);
+  int peek();
+  size_t write(uint8_t b) { return write(&b, 1); }
+  size_t write(const uint8_t *buf, size_t size);
+  void flush() {}
+  void stop();
+  operator bool() { return _sock != 255; }
+};
+
+class WiFiServer
+{
+  uint16_t _port;
+
+public:
+  WiFiServer(uint16_t port) : _port(port) {}
+  void begin() { nina_host().server_port = _port; }
+  WiFiClient available(uint8_t *status = NULL);
+};
+
+class WiFiUDP
+{
+  NinaPacket _rx, _tx;
+  size_t _pos = 0;
+
+public:
+  uint8_t begin(uint16_t port) { nina_host().udp_port = port; return 1; }
+  void stop() { nina_host().udp_port = 0; }
+  int parsePacket();
+  IPAddress remoteIP() { return _rx.ip; }
+  uint16_t remotePort() { return _rx.port; }
+  int read(unsigned char *buf, size_t size);
+  int beginPacket(IPAddress ip, uint16_t port);
+  size_t write(const uint8_t *buf, size_t size);
+  int endPacket();
+};
+
+#endif // HOST_WIFININA_H
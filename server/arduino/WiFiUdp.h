@@ -0,0 +1,5 @@
+/*
+  Host stand-in for WiFiUdp.h of the WiFiNINA library: WiFiUDP is declared with the module in WiFiNINA.h
+  (c) 2025 diyPresso - CC-BY-NC
+*/
+#include <WiFiNINA.h>
@@ -0,0 +1,18 @@
+/*
+  Host stand-in for the receive buffers of the WiFiNINA library: the emulated sockets have none
+  (c) 2025 diyPresso - CC-BY-NC
+*/
+#ifndef HOST_WIFI_SOCKET_BUFFER_H
+#define HOST_WIFI_SOCKET_BUFFER_H
+
+#include <stdint.h>
+
+class WiFiSocketBufferClass
+{
+public:
+  void close(uint8_t sock) {}
+};
+
+extern WiFiSocketBufferClass WiFiSocketBuffer;
+
+#endif // HOST_WIFI_SOCKET_BUFFER_H
@@ -0,0 +1,30 @@
+/*
+  Host stand-in for the client sockets of the WiFiNINA library (see WiFiNINA.h): real TCP connections
+  (c) 2025 diyPresso - CC-BY-NC
+*/
+#ifndef HOST_SERVER_DRV_H
+#define HOST_SERVER_DRV_H
+
+#include <WiFiNINA.h>
+
+#define TCP_MODE 0
+
+enum wl_tcp_state
+{
+  CLOSED = 0,
+  LISTEN = 1,
+  SYN_SENT = 2,
+  SYN_RCVD = 3,
+  ESTABLISHED = 4,
+};
+
+class ServerDrv
+{
+public:
+  static uint8_t getSocket();
+  static void startClient(uint32_t ipAddress, uint16_t port, uint8_t sock, uint8_t protMode = TCP_MODE);
+  static uint8_t getClientState(uint8_t sock);
+  static void stopClient(uint8_t sock);
+};
+
+#endif // HOST_SERVER_DRV_H
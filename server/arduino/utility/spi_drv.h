@@ -0,0 +1,31 @@
+/*
+  Host stand-in for the SPI bus of the WiFiNINA library: the DNS lookup of the emulated module (see WiFiNINA.h)
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Only the commands REQ_HOST_BY_NAME_CMD and GET_HOST_BY_NAME_CMD. The request keeps the module busy for dns_msec:
+  the ready line (digitalRead(NINA_ACK)) is high until then, and a command that waits for the module adds the time
+  to blocked_msec.
+*/
+#ifndef HOST_SPI_DRV_H
+#define HOST_SPI_DRV_H
+
+#include <WiFiNINA.h>
+#include "wifi_spi.h"
+
+#define WAIT_FOR_SLAVE_SELECT() \
+  SpiDrv::waitForSlaveReady();  \
+  SpiDrv::spiSlaveSelect();
+
+class SpiDrv
+{
+public:
+  static void spiSlaveSelect() {}
+  static void spiSlaveDeselect();
+  static void waitForSlaveReady(bool const feed_watchdog = false) { nina_host().command(); }
+  static char readChar() { return 0; }
+  static void sendCmd(uint8_t cmd, uint8_t numParam);
+  static void sendParam(uint8_t *param, uint8_t param_len, uint8_t lastParam = NO_LAST_PARAM);
+  static int waitResponseCmd(uint8_t cmd, uint8_t numParam, uint8_t *param, uint8_t *param_len);
+};
+
+#endif // HOST_SPI_DRV_H
@@ -0,0 +1,20 @@
+/*
+  Host stand-in for the WiFiDrv commands of the WiFiNINA library (see WiFiNINA.h)
+  (c) 2025 diyPresso - CC-BY-NC
+*/
+#ifndef HOST_WIFI_DRV_H
+#define HOST_WIFI_DRV_H
+
+#include <WiFiNINA.h>
+
+class WiFiDrv
+{
+public:
+  static int8_t wifiSetNetwork(const char *ssid, uint8_t ssid_len);
+  static int8_t wifiSetPassphrase(const char *ssid, uint8_t ssid_len, const char *passphrase, const uint8_t len);
+  static int8_t wifiSetApNetwork(const char *ssid, uint8_t ssid_len, uint8_t channel);
+  static int8_t startScanNetworks();
+  static uint8_t getScanNetworks();
+};
+
+#endif // HOST_WIFI_DRV_H
@@ -0,0 +1,16 @@
+/*
+  Host stand-in for the SPI command codes of the WiFiNINA library (see WiFiNINA.h)
+  (c) 2025 diyPresso - CC-BY-NC
+*/
+#ifndef HOST_WIFI_SPI_H
+#define HOST_WIFI_SPI_H
+
+#define REQ_HOST_BY_NAME_CMD 0x34
+#define GET_HOST_BY_NAME_CMD 0x35
+
+#define PARAM_NUMS_0 0
+#define PARAM_NUMS_1 1
+#define NO_LAST_PARAM 0
+#define LAST_PARAM 1
+
+#endif // HOST_WIFI_SPI_H
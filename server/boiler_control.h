@@ -0,0 +1,56 @@
+/*
+  The boiler controller of the firmware on the host (server side)
+  (c) 2025 diyPresso - CC-BY-NC
+
+  The real DpPID (dp_pid.cpp, linked with the Arduino.h stand-in of server/arduino) with the limits and the feed
+  forward per boiler state of BoilerStateMachine. BoilerStateMachine itself needs the RTD and heater drivers.
+*/
+#ifndef BOILER_CONTROL_H
+#define BOILER_CONTROL_H
+
+#include "../diyp-controller/dp_pid.h"
+
+// Must match the boiler controller of the firmware (dp_boiler.h/.cpp)
+#define BOILER_WINDOW 10.0       // TEMP_WINDOW, heating <-> ready
+#define BOILER_WINDUP 7.0        // WINDUP_LIMIT_MIN/MAX
+#define BOILER_CONTROL_MSEC 1000 // sample time of the PID
+enum { BOIL_OFF, BOIL_HEATING, BOIL_READY, BOIL_BREW, BOIL_ERROR };
+enum { BREW_SLEEP = 3, BREW_IDLE = 5, BREW_PRE_INFUSE = 9, BREW_INFUSE, BREW_EXTRACT, BREW_FINISHED };
+
+typedef struct
+{
+  double p = 6.2, i = 0.08, d = 70.0, ff_heat = 6.0, ff_ready = 6.0, ff_brew = 35.0; // DpSettings defaults
+} control_settings_t;
+
+// The boiler controller: DpPID with the output and wind-up limits and the feed forward per boiler state
+struct controller_t
+{
+  DpPID pid;
+  double input = 0, output = 0, setpoint = 0;
+  int boil = -1;
+
+  void begin(const control_settings_t &s)
+  {
+    pid.begin(&input, &output, &setpoint, s.p, s.i, s.d, s.ff_ready, BOILER_CONTROL_MSEC);
+    pid.setOutputLimits(0, 100);
+    pid.setWindUpLimits(-BOILER_WINDUP, BOILER_WINDUP);
+  }
+  void reset(unsigned long msec)
+  {
+    host_clock() = msec;
+    pid.reset();
+  }
+  double compute(const control_settings_t &s, unsigned long msec, int state, double temp, double set)
+  {
+    if (state != boil) // ON_ENTRY() of the boiler states
+      pid.setFeedForward(state == BOIL_HEATING ? s.ff_heat : state == BOIL_READY ? s.ff_ready : state == BOIL_BREW ? s.ff_brew : 0);
+    boil = state;
+    host_clock() = msec;
+    input = temp;
+    setpoint = set;
+    pid.compute();
+    return boil == BOIL_OFF || boil == BOIL_ERROR ? 0 : output;
+  }
+};
+
+#endif // BOILER_CONTROL_H
@@ -0,0 +1,34 @@
+/*
+  Thermal model of the diyPresso boiler (server side)
+  (c) 2025 diyPresso - CC-BY-NC
+*/
+#include <math.h>
+#include "boiler_model.h"
+
+void BoilerModel::reset(double temp)
+{
+  _temp = _sensor = temp;
+  _time = 0;
+  _power = 0;
+  _delay.clear();
+}
+
+double BoilerModel::step(double power, double flow, double dt)
+{
+  _delay.push_back(std::make_pair(_time + dead, power));
+  while (dt > 0)
+  {
+    double h = dt > BOILER_MAX_STEP ? BOILER_MAX_STEP : dt;
+    _time += h;
+    dt -= h;
+    while (!_delay.empty() && _delay.front().first <= _time + 1e-9)
+    {
+      _power = _delay.front().second;
+      _delay.pop_front();
+    }
+    double watt = heater * _power / 100 - loss * (_temp - ambient) - flow * WATER_HEAT * (_temp - WATER_INLET);
+    _temp += watt / capacity * h;
+    _sensor = lag > 0 ? _sensor + (_temp - _sensor) * (1 - exp(-h / lag)) : _temp;
+  }
+  return _sensor;
+}
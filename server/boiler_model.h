@@ -0,0 +1,44 @@
+/*
+  Thermal model of the diyPresso boiler (server side)
+  (c) 2025 diyPresso - CC-BY-NC
+
+  A lumped heat capacity heated by the heater (power in % of HEATER_RATED_POWER), with a heat loss to the ambient
+  and the cooling by fresh water during a shot (flow in g/s, from the brew weight). The heater acts after a dead time
+  and the sensor can follow the boiler with a lag: a first order plus dead time model, or a second order one when
+  lag > 0. The defaults are the nominal machine, the same values as power_sim and arbiter_sim.
+*/
+#ifndef BOILER_MODEL_H
+#define BOILER_MODEL_H
+
+#include <deque>
+#include <utility>
+#include "../diyp-controller/dp_hardware.h"
+
+#define BOILER_CAPACITY 4200.0 // heat capacity [J/K]
+#define BOILER_LOSS 0.7        // heat loss [W/K]
+#define BOILER_AMBIENT 20.0    // [C]
+#define BOILER_DEAD_SEC 2.0    // dead time of the heater and the sensor [sec]
+#define WATER_HEAT 4.186       // specific heat of water [J/g/K]
+#define WATER_INLET 20.0       // temperature of the fresh water [C]
+#define BOILER_MAX_STEP 1.0    // max integration step [sec]
+
+class BoilerModel
+{
+public:
+  double heater = HEATER_RATED_POWER; // power at 100 % [W]
+  double capacity = BOILER_CAPACITY, loss = BOILER_LOSS, ambient = BOILER_AMBIENT;
+  double dead = BOILER_DEAD_SEC; // [sec]
+  double lag = 0;                // time constant of the sensor [sec], 0: first order model
+
+  void reset(double temp);
+  double step(double power, double flow, double dt); // power [%], flow [g/s], dt [sec]; returns the sensor [C]
+  double temp() { return _sensor; }   // at the sensor
+  double boiler() { return _temp; }   // of the water in the boiler
+  double gain() { return heater / capacity / 100; } // heating rate per % [C/sec]
+
+private:
+  double _temp = BOILER_AMBIENT, _sensor = BOILER_AMBIENT, _time = 0, _power = 0;
+  std::deque<std::pair<double, double>> _delay; // (time it acts, power)
+};
+
+#endif // BOILER_MODEL_H
@@ -0,0 +1,194 @@
+/*
+  Host round-trip test of the brown-out record of the firmware (diyp-controller/dp_brownout_record.h)
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Check:
+  - the CRC-32 (the check value of "123456789"), the layout of the record in flash (the offsets of version 1; the
+    size is a static_assert of the header);
+  - a record sealed, written to an emulated flash row and read back is valid and the same; any bit flipped, another
+    magic or version is not; an erased row has no record;
+  - the slots over boots, dips and power losses, with the logic of BrownOut (dp_brownout.cpp): at boot the newest
+    record is restored, the row erased and the state written to slot 0, a dip writes the next slot, a full row
+    refuses the save until the loop prepares it again. A power loss during a page write leaves a torn record: the
+    boot restores the one before it. The restored shot counter is the one of the last complete record.
+
+  The flash of the SAMD21: an erase sets all bits of the row, a page write can only clear bits.
+
+  usage: brownout_sim [events]
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "../diyp-controller/dp_brownout_record.h"
+#include "../diyp-controller/dp_crc.h"
+
+static int errors = 0;
+
+static void check(bool ok, const char *what, long got = 0, long expect = 0)
+{
+  if (!ok && errors++ < 20)
+    printf("FAIL %s: %ld, expected %ld\n", what, got, expect);
+}
+
+struct flash_t
+{
+  uint8_t row[BROWNOUT_ROW_SIZE];
+  void erase() { memset(row, 0xFF, sizeof(row)); }
+  void write(int slot, const brownout_record_t &r, int bytes = BROWNOUT_PAGE_SIZE) // bytes < page: torn
+  {
+    for (int i = 0; i < bytes; i++)
+      row[slot * BROWNOUT_PAGE_SIZE + i] &= ((const uint8_t *)&r)[i];
+  }
+  const brownout_record_t *slots() const { return (const brownout_record_t *)row; }
+};
+
+static void test_record()
+{
+  check(dp_crc32((const uint8_t *)"123456789", 9) == 0xCBF43926, "CRC-32 check value");
+  check(offsetof(brownout_record_t, magic) == 4 && offsetof(brownout_record_t, sequence) == 12 &&
+            offsetof(brownout_record_t, runtime) == 20 && offsetof(brownout_record_t, heaterEnergy) == 24 &&
+            offsetof(brownout_record_t, pumpEnergy) == 32 && offsetof(brownout_record_t, saveTime) == 40 &&
+            offsetof(brownout_record_t, cause) == 47 && offsetof(brownout_record_t, reserved) == 48,
+        "layout of version 1");
+
+  flash_t flash;
+  flash.erase();
+  check(brownout_newest(flash.slots(), BROWNOUT_SLOTS) == -1, "erased row");
+
+  brownout_record_t r, back;
+  memset(&r, 0, sizeof(r));
+  r.sequence = 7;
+  r.shotCounter = 1234;
+  r.runtime = 98765;
+  r.heaterEnergy = 123.456;
+  r.pumpEnergy = 7.5;
+  r.saveTime = 2400;
+  r.brewError = 3;
+  r.cause = BROWNOUT_CAUSE_POWER;
+  brownout_seal(&r);
+  flash.write(2, r);
+  memcpy(&back, flash.slots() + 2, sizeof(back));
+  check(brownout_valid(&back) && memcmp(&back, &r, sizeof(r)) == 0, "round trip");
+  check(back.heaterEnergy == 123.456 && back.shotCounter == 1234, "fields");
+  check(brownout_newest(flash.slots(), BROWNOUT_SLOTS) == 2, "the only valid slot", brownout_newest(flash.slots(), 4));
+
+  int flips = 0;
+  for (int bit = 0; bit < BROWNOUT_PAGE_SIZE * 8; bit++)
+  {
+    brownout_record_t bad = r;
+    ((uint8_t *)&bad)[bit / 8] ^= 1 << bit % 8;
+    flips += !brownout_valid(&bad);
+  }
+  check(flips == BROWNOUT_PAGE_SIZE * 8, "a bit flipped is invalid", flips, BROWNOUT_PAGE_SIZE * 8);
+  brownout_record_t other = r;
+  other.version = BROWNOUT_VERSION + 1;
+  other.crc = dp_crc32((const uint8_t *)&other + 4, sizeof(other) - 4);
+  check(!brownout_valid(&other), "another version");
+  other = r;
+  other.magic ^= 1;
+  other.crc = dp_crc32((const uint8_t *)&other + 4, sizeof(other) - 4);
+  check(!brownout_valid(&other), "another magic");
+}
+
+// The controller: the logic of BrownOut over the flash row
+struct controller_t
+{
+  flash_t flash;
+  uint32_t sequence = 0, shots = 0, saved_shots = 0; // saved_shots: of the last complete record
+  int slot = 0, saves = 0, full = 0;
+  void write(brownout_cause_t cause, int bytes = BROWNOUT_PAGE_SIZE)
+  {
+    brownout_record_t r;
+    memset(&r, 0, sizeof(r));
+    r.sequence = ++sequence;
+    r.shotCounter = shots;
+    r.cause = cause;
+    brownout_seal(&r);
+    flash.write(slot++, r, bytes);
+    if (bytes == BROWNOUT_PAGE_SIZE)
+      saved_shots = shots, saves++;
+  }
+  bool save(brownout_cause_t cause, int bytes = BROWNOUT_PAGE_SIZE)
+  {
+    if (slot >= BROWNOUT_SLOTS)
+      return full++, false;
+    write(cause, bytes);
+    return true;
+  }
+  void prepare(brownout_cause_t cause)
+  {
+    flash.erase();
+    slot = 0;
+    write(cause);
+  }
+  void boot() // init(): the RAM is gone
+  {
+    int newest = brownout_newest(flash.slots(), BROWNOUT_SLOTS);
+    sequence = newest < 0 ? 0 : flash.slots()[newest].sequence;
+    shots = newest < 0 ? 0 : flash.slots()[newest].shotCounter;
+    check(newest < 0 || shots == saved_shots, "restored shot counter", shots, saved_shots);
+    prepare(BROWNOUT_CAUSE_BOOT);
+  }
+  void run() // the loop
+  {
+    if (slot >= BROWNOUT_SLOTS)
+      prepare(BROWNOUT_CAUSE_RECYCLE);
+  }
+};
+
+static void test_slots(long events)
+{
+  controller_t c;
+  c.flash.erase();
+  c.boot();
+  long boots = 1, dips = 0, losses = 0, torn = 0, refused = 0;
+  srand(1);
+  for (long i = 0; i < events; i++)
+  {
+    switch (rand() % 8)
+    {
+    case 0: // a dip the controller survives, the loop runs after it
+      dips++;
+      check(c.save(BROWNOUT_CAUSE_POWER), "save of a dip", c.slot);
+      c.run();
+      break;
+    case 1: // two dips before the loop runs: the second may find the row full
+      dips += 2;
+      c.save(BROWNOUT_CAUSE_POWER);
+      refused += !c.save(BROWNOUT_CAUSE_POWER);
+      c.run();
+      break;
+    case 2: // power lost: the record is written, then the reset
+      losses++;
+      if (c.slot < BROWNOUT_SLOTS)
+        c.save(BROWNOUT_CAUSE_POWER);
+      c.boot();
+      boots++;
+      break;
+    case 3: // power lost during the page write
+      torn++;
+      if (c.slot < BROWNOUT_SLOTS)
+        c.save(BROWNOUT_CAUSE_POWER, rand() % BROWNOUT_PAGE_SIZE);
+      c.boot();
+      boots++;
+      break;
+    default: // shots
+      c.shots += 1 + rand() % 3;
+      c.run();
+    }
+    check(c.slot < BROWNOUT_SLOTS, "a free slot after the loop", c.slot, BROWNOUT_SLOTS - 1);
+  }
+  check(c.full == refused, "refused saves counted", c.full, refused);
+  printf("slots: %ld boots, %ld dips (%ld saves refused: the row was full), %ld power losses, %ld torn writes, "
+         "%d records\n",
+         boots, dips, refused, losses, torn, c.saves);
+}
+
+int main(int argc, char **argv)
+{
+  long events = argc > 1 ? atol(argv[1]) : 100000;
+  test_record();
+  test_slots(events);
+  printf("%d errors\n", errors);
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,51 @@
+/*
+  cbor2line: convert diyPresso CBOR telemetry messages to influxDB line protocol
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Usage: cbor2line [file ...]    (reads one message per file, or from stdin)
+  e.g.:  mosquitto_sub -h test.mosquitto.org -t 'diyPressoOne/+/cbor' -C 1 | ./cbor2line
+*/
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include "cbor_decoder.h"
+
+static int convert(FILE *f, const char *name)
+{
+  std::vector<uint8_t> data;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    data.insert(data.end(), buf, buf + n);
+
+  std::vector<telemetry_point_t> samples;
+  std::string error;
+  if (!telemetry_decode(data.data(), data.size(), samples, &error))
+  {
+    fprintf(stderr, "%s: %s\n", name, error.c_str());
+    return 1;
+  }
+  for (size_t i = 0; i < samples.size(); i++)
+    printf("%s\n", telemetry_line(samples[i]).c_str());
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  if (argc < 2)
+    return convert(stdin, "stdin");
+  int result = 0;
+  for (int i = 1; i < argc; i++)
+  {
+    FILE *f = fopen(argv[i], "rb");
+    if (!f)
+    {
+      perror(argv[i]);
+      result = 1;
+      continue;
+    }
+    result |= convert(f, argv[i]);
+    fclose(f);
+  }
+  return result;
+}
@@ -0,0 +1,294 @@
+/*
+  diyPresso telemetry CBOR decoder (server side)
+  (c) 2025 diyPresso
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "cbor_decoder.h"
+
+// Must match boiler_state_t, brew_state_t and the error enumerations and texts of the firmware
+static const char *boiler_states[] = {"off", "heating", "ready", "brew", "error"};
+static const char *brew_states[] = {"init", "fill", "purge", "sleep", "empty", "idle", "check", "done",
+                                    "warning_pre_brew", "pre_infuse", "infuse", "extract", "finished", "error"};
+static const char *boiler_errors[] = {"OK", "RTD_ERROR", "BREW_TIMEOUT", "TIMEOUT_HEATING", "READY_TIMEOUT",
+                                      "SSR_TIMEOUT", "OVER_TEMP", "UNDER_TEMP", "CONTROL_TIMEOUT", "UNKNOWN"};
+static const char *brew_errors[] = {"OK", "NO_PURGE", "NO_FILL", "TIMEOUT", "NO_WATER"};
+static const char *reservoir_errors[] = {"OK", "SENSOR_ERROR", "NO_READINGS", "OUT_OF_RANGE", "NEGATIVE_READING"};
+#define BOILER_STATE_ERROR 4
+#define BREW_STATE_ERROR 13
+
+#define NAME(table, i) ((i) >= 0 && (size_t)(i) < sizeof(table) / sizeof(table[0]) ? table[i] : "UNKNOWN")
+
+bool CborReader::next(item_t &item)
+{
+  item.indefinite = false;
+  item.data = NULL;
+  item.value = 0;
+  if (_pos >= _size)
+  {
+    item.type = END;
+    return false;
+  }
+  uint8_t b = _data[_pos++];
+  uint8_t major = b >> 5, info = b & 31;
+  if (b == 0xFF)
+  {
+    item.type = BREAK;
+    return true;
+  }
+  static const type_t types[] = {UINT, NINT, BYTES, TEXT, ARRAY, MAP, ERROR, SIMPLE};
+  item.type = types[major];
+  if (info < 24)
+    item.value = info;
+  else if (info <= 27)
+  {
+    size_t n = 1 << (info - 24);
+    if (_pos + n > _size)
+      return item.type = ERROR, false;
+    for (size_t i = 0; i < n; i++)
+      item.value = (item.value << 8) | _data[_pos++];
+  }
+  else if (info == 31 && (item.type == ARRAY || item.type == MAP))
+    item.indefinite = true;
+  else
+    return item.type = ERROR, false;
+  if (item.type == ERROR) // tags are not used
+    return false;
+  if (item.type == BYTES || item.type == TEXT)
+  {
+    if (item.value > _size - _pos)
+      return item.type = ERROR, false;
+    item.data = _data + _pos;
+    _pos += item.value;
+  }
+  return true;
+}
+
+bool CborReader::integer(int64_t &value)
+{
+  item_t item;
+  if (!next(item) || (item.type != UINT && item.type != NINT) || item.value > INT64_MAX)
+    return false;
+  value = item.type == UINT ? (int64_t)item.value : -1 - (int64_t)item.value;
+  return true;
+}
+
+bool CborReader::skip()
+{
+  item_t item;
+  if (!next(item) || item.type == BREAK)
+    return false;
+  if (item.type != ARRAY && item.type != MAP)
+    return true;
+  uint64_t n = item.type == MAP ? 2 * item.value : item.value;
+  if (item.indefinite)
+  {
+    for (;;)
+    {
+      size_t pos = _pos;
+      if (!next(item))
+        return false;
+      if (item.type == BREAK)
+        return true;
+      _pos = pos;
+      if (!skip())
+        return false;
+    }
+  }
+  for (uint64_t i = 0; i < n; i++)
+    if (!skip())
+      return false;
+  return true;
+}
+
+static bool fail(std::string *error, const char *text)
+{
+  if (error)
+    *error = text;
+  return false;
+}
+
+// Read the items of an array or map: returns false at the end (BREAK or count reached)
+static bool more(CborReader &cbor, const CborReader::item_t &container, uint64_t &i)
+{
+  if (!container.indefinite)
+    return i++ < container.value;
+  CborReader::item_t item;
+  CborReader peek = cbor;
+  if (!peek.next(item) || item.type == CborReader::BREAK)
+  {
+    cbor = peek;
+    return false;
+  }
+  i++;
+  return true;
+}
+
+static bool decode_samples(CborReader &cbor, uint64_t epoch_base, std::vector<telemetry_point_t> &samples, std::string *error)
+{
+  CborReader::item_t array, map;
+  if (!cbor.next(array) || array.type != CborReader::ARRAY)
+    return fail(error, "samples: array expected");
+  telemetry_point_t sample = {};
+  for (uint64_t i = 0; more(cbor, array, i);)
+  {
+    if (!cbor.next(map) || map.type != CborReader::MAP)
+      return fail(error, "sample: map expected");
+    for (uint64_t j = 0; more(cbor, map, j);)
+    {
+      int64_t key, value;
+      if (!cbor.integer(key) || !cbor.integer(value))
+        return fail(error, "sample: integer key and value expected");
+      if (key == 0)
+        sample.time = (uint32_t)value;
+      else if (key >= 1 && key <= TELEMETRY_FIELDS)
+        sample.value[key - 1] = (int32_t)value; // fields that are not present did not change
+    }
+    sample.epoch = epoch_base ? epoch_base + sample.time : 0;
+    samples.push_back(sample);
+  }
+  return true;
+}
+
+bool telemetry_decode(const uint8_t *data, size_t size, std::vector<telemetry_point_t> &samples, std::string *error)
+{
+  CborReader cbor(data, size);
+  CborReader::item_t map;
+  int64_t version = 0, epoch = 0;
+  if (!cbor.next(map) || map.type != CborReader::MAP)
+    return fail(error, "message: map expected");
+  for (uint64_t i = 0; more(cbor, map, i);)
+  {
+    int64_t key;
+    if (!cbor.integer(key))
+      return fail(error, "message: integer key expected");
+    if (key == 0)
+    {
+      if (!cbor.integer(version) || version != TELEMETRY_CBOR_VERSION)
+        return fail(error, "message: unsupported version");
+    }
+    else if (key == 1)
+    {
+      if (!cbor.integer(epoch))
+        return fail(error, "message: epoch expected");
+    }
+    else if (key == 2)
+    {
+      if (!decode_samples(cbor, epoch, samples, error))
+        return false;
+    }
+    else if (!cbor.skip()) // unknown keys are ignored, for compatibility with newer firmware
+      return fail(error, "message: invalid item");
+  }
+  return true;
+}
+
+std::string telemetry_line(const telemetry_point_t &sample, const char *measurement)
+{
+  std::string line = measurement;
+  char buf[64];
+  const char *sep = " ";
+  for (int i = 0; i < TELEMETRY_FIELDS; i++)
+  {
+    if (telemetry_fields[i].scale == 1)
+      snprintf(buf, sizeof(buf), "%s%s=%ld", sep, telemetry_fields[i].name, (long)sample.value[i]);
+    else if (telemetry_fields[i].scale > 1)
+      snprintf(buf, sizeof(buf), "%s%s=%.2f", sep, telemetry_fields[i].name,
+               (double)sample.value[i] / telemetry_fields[i].scale);
+    else
+      continue;
+    line += buf;
+    sep = ",";
+  }
+  line += ",boil=\"" + std::string(NAME(boiler_states, sample.value[TM_BOIL])) + "\"";
+  if (sample.value[TM_BOIL] == BOILER_STATE_ERROR)
+    line += ",boil_err=\"" + std::string(NAME(boiler_errors, sample.value[TM_BOIL_ERR])) + "\"";
+  line += ",brew=\"" + std::string(NAME(brew_states, sample.value[TM_BREW])) + "\"";
+  if (sample.value[TM_BREW] == BREW_STATE_ERROR)
+    line += ",brew_err=\"" + std::string(NAME(brew_errors, sample.value[TM_BREW_ERR])) + "\"";
+  if (sample.value[TM_RES_ERR] != 0)
+    line += ",res_err=\"" + std::string(NAME(reservoir_errors, sample.value[TM_RES_ERR])) + "\"";
+  snprintf(buf, sizeof(buf), ",msec=%lu", (unsigned long)sample.time);
+  line += buf;
+  if (sample.epoch)
+  {
+    snprintf(buf, sizeof(buf), " %llu000000", (unsigned long long)sample.epoch); // [nsec]
+    line += buf;
+  }
+  return line;
+}
+
+static int lookup(const char **table, size_t n, const std::string &name)
+{
+  for (size_t i = 0; i < n; i++)
+    if (name == table[i])
+      return (int)i;
+  return -1;
+}
+#define LOOKUP(table, name) lookup(table, sizeof(table) / sizeof(table[0]), name)
+
+bool telemetry_parse(const char *line, telemetry_point_t &sample, std::string *device)
+{
+  sample = telemetry_point_t();
+  const char *p = strchr(line, ' ');
+  if (!p || strncmp(line, "measurement", 11) != 0)
+    return false;
+  if (device)
+  {
+    const char *tag = strstr(line, ",device=");
+    *device = tag && tag < p ? std::string(tag + 8, p - tag - 8) : std::string();
+  }
+  int found = 0;
+  bool msec = false;
+  while (*p == ' ' || *p == ',')
+  {
+    const char *name = ++p, *eq = strchr(p, '=');
+    if (!eq)
+      break;
+    std::string key(name, eq - name), text;
+    p = eq + 1;
+    if (*p == '"')
+    {
+      const char *end = strchr(p + 1, '"');
+      if (!end)
+        return false;
+      text.assign(p + 1, end - p - 1);
+      p = end + 1;
+    }
+    char *end;
+    double value = text.empty() ? strtod(p, &end) : 0;
+    if (text.empty())
+      p = end;
+    if (*p == 'i') // integer suffix of the line protocol
+      p++;
+    if (key == "msec")
+      sample.time = (uint32_t)value, msec = true;
+    else if (key == "boil")
+      sample.value[TM_BOIL] = LOOKUP(boiler_states, text);
+    else if (key == "brew")
+      sample.value[TM_BREW] = LOOKUP(brew_states, text);
+    else if (key == "boil_err")
+      sample.value[TM_BOIL_ERR] = LOOKUP(boiler_errors, text);
+    else if (key == "brew_err")
+      sample.value[TM_BREW_ERR] = LOOKUP(brew_errors, text);
+    else if (key == "res_err")
+      sample.value[TM_RES_ERR] = LOOKUP(reservoir_errors, text);
+    else
+      for (int i = 0; i < TELEMETRY_FIELDS; i++)
+        if (telemetry_fields[i].scale && key == telemetry_fields[i].name)
+        {
+          sample.value[i] = (int32_t)lround(value * telemetry_fields[i].scale);
+          found++;
+        }
+    if (*p == ' ' && p[1] >= '0' && p[1] <= '9') // timestamp [nsec]
+    {
+      sample.epoch = strtoull(p + 1, NULL, 10) / 1000000;
+      break;
+    }
+  }
+  if (!msec && sample.epoch)
+    sample.time = (uint32_t)sample.epoch;
+  return found > 0;
+}
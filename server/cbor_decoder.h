@@ -0,0 +1,57 @@
+/*
+  diyPresso telemetry CBOR decoder (server side)
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Decodes the CBOR telemetry messages published on diyPressoOne/<mac>/cbor (see dp_telemetry.h of the firmware)
+  and converts them to influxDB line protocol, identical to the text messages of the firmware.
+*/
+#ifndef CBOR_DECODER_H
+#define CBOR_DECODER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "../diyp-controller/dp_telemetry_ring.h"
+
+// Generic CBOR reader, for the subset of types used by the firmware
+class CborReader
+{
+public:
+  typedef enum { UINT, NINT, BYTES, TEXT, ARRAY, MAP, SIMPLE, BREAK, END, ERROR } type_t;
+  typedef struct
+  {
+    type_t type;
+    uint64_t value;   // integer value, or the length of a string, array or map
+    bool indefinite;  // array or map of indefinite length (ends with a BREAK)
+    const uint8_t *data; // string data
+  } item_t;
+
+  CborReader(const uint8_t *data, size_t size) : _data(data), _size(size) {}
+  bool next(item_t &item);
+  bool integer(int64_t &value); // read a (negative) integer
+  bool skip();                  // skip one complete item (including nested items)
+  size_t position() { return _pos; }
+
+private:
+  const uint8_t *_data;
+  size_t _size, _pos = 0;
+};
+
+// A sample of the firmware (telemetry_sample_t of dp_telemetry_ring.h) with its wall clock time
+struct telemetry_point_t : telemetry_sample_t
+{
+  uint64_t epoch; // [msec] since 1970, 0 if the machine did not know the time
+};
+
+// Decode a CBOR telemetry message, returns false (and an error text) if the message is invalid
+bool telemetry_decode(const uint8_t *data, size_t size, std::vector<telemetry_point_t> &samples, std::string *error = NULL);
+
+// Convert a sample to an influxDB line, with the timestamp [nsec] if it is known
+std::string telemetry_line(const telemetry_point_t &sample, const char *measurement = "measurement");
+
+// Parse an influxDB line of the telemetry (the inverse of telemetry_line()), with the device tag if there is one.
+// Returns false if the line is not a telemetry line.
+bool telemetry_parse(const char *line, telemetry_point_t &sample, std::string *device = NULL);
+
+#endif // CBOR_DECODER_H
@@ -0,0 +1,267 @@
+/*
+  Host test of the rotary encoder decoder of the firmware (diyp-controller/dp_quadrature.h) with synthetic edges
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Check: detents both ways, contact bounce on every edge, missed edges (an interrupt late, after the next edge), half
+  turns back, chatter in the detent; presses with bounce, a glitch on the switch, a tap between two samples, the
+  start of a press from its edge. The same signals, sampled at 2.5 kHz, go through the polling decoder that
+  dp_encoder.cpp had: both count the same detents and presses.
+
+  ISR load: a session of turning and pressing, the interrupts of the polling timer (2.5 kHz, all pins) against the EIC
+  edges of A and B and the 500 Hz sampling of the switch. The cycles per interrupt are estimates for the SAMD21 at
+  48 MHz (the Arduino core handlers, digitalRead(), the decoders), not measurements: change them below.
+
+  usage: encoder_sim [seconds]
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+#include "../diyp-controller/dp_quadrature.h"
+
+#define POLL_USEC 400    // TIMER_PERIOD_US of the polling decoder
+#define BUTTON_USEC 2000 // BUTTON_PERIOD_US
+#define CPU_HZ 48e6
+#define POLL_CYCLES 220   // TC handler of uTimerLib, 3x digitalRead(), the deglitch filters
+#define EDGE_CYCLES 260   // EIC_Handler of the core (scans the callbacks), 2x digitalRead(), rotate()
+#define BUTTON_CYCLES 160 // TC handler, digitalRead(), micros(), button()
+
+static int errors = 0;
+
+static void check(bool ok, const char *what, long got = 0, long expect = 0)
+{
+  if (!ok && errors++ < 20)
+    printf("FAIL %s: %ld, expected %ld\n", what, got, expect);
+}
+
+typedef struct
+{
+  uint32_t t; // [usec]
+  uint8_t pin; // 0: A, 1: B, 2: switch
+  bool level;  // A, B: high; switch: pressed (the pin is low)
+} edge_t;
+
+// A signal of the encoder, built in time order
+struct signal_t
+{
+  std::vector<edge_t> edges;
+  bool level[3] = {true, true, false};
+  uint32_t t = 1000;
+  int bounce = 0; // max bounces per edge
+  void edge(int pin, bool level_, uint32_t after)
+  {
+    t += after;
+    for (int b = bounce ? rand() % (bounce + 1) : 0; b > 0; b--) // chatter: the new level, back, ...
+    {
+      edges.push_back({t, (uint8_t)pin, level_});
+      t += 1 + rand() % 200;
+      edges.push_back({t, (uint8_t)pin, !level_});
+      t += 1 + rand() % 200;
+    }
+    level[pin] = level_;
+    edges.push_back({t, (uint8_t)pin, level_});
+  }
+  void detent(int dir, uint32_t usec) // a full cycle, up: B falls first
+  {
+    int first = dir > 0 ? 1 : 0, second = 1 - first;
+    edge(first, false, usec / 4);
+    edge(second, false, usec / 4);
+    edge(first, true, usec / 4);
+    edge(second, true, usec / 4);
+  }
+  void press(uint32_t usec, uint32_t after)
+  {
+    edge(2, true, after);
+    edge(2, false, usec);
+  }
+};
+
+struct result_t
+{
+  long position, presses;
+  uint32_t first_press; // [usec] start of the first press, by the decoder
+  long interrupts;
+};
+
+// The EIC decoder: rotate() at the edges of A and B, button() sampled at BUTTON_USEC. An interrupt reads the levels
+// latency after its edge: an edge in between is missed, its interrupt is the same one.
+static result_t run_edges(const signal_t &s, uint32_t end, bool button_edges = false, uint32_t latency = 0)
+{
+  QuadratureDecoder q;
+  result_t r = {0, 0, 0, 0};
+  bool level[3] = {true, true, false};
+  q.begin(3, false, 0);
+  size_t i = 0;
+  for (uint32_t t = 0; t < end; t += BUTTON_USEC)
+  {
+    for (; i < s.edges.size() && s.edges[i].t < t; i++)
+    {
+      const edge_t &e = s.edges[i];
+      level[e.pin] = e.level;
+      if (e.pin < 2 && !(i + 1 < s.edges.size() && s.edges[i + 1].t - e.t < latency))
+      {
+        q.rotate((level[0] ? 1 : 0) | (level[1] ? 2 : 0));
+        r.interrupts++;
+      }
+      if (e.pin == 2 && button_edges)
+        q.button(level[2], e.t);
+    }
+    unsigned long before = q.presses();
+    q.button(level[2], t);
+    r.interrupts++;
+    if (q.presses() == 1 && before == 0)
+      r.first_press = t - q.press_time(t);
+  }
+  r.position = q.position();
+  r.presses = q.presses();
+  return r;
+}
+
+// The polling decoder of dp_encoder.cpp before the EIC: all pins sampled at POLL_USEC
+static result_t run_polling(const signal_t &s, uint32_t end)
+{
+  unsigned int cur = 3, prev = 3, enc_switch = 0, enc_prev_button = 0, enc_button;
+  int afilt = 0, bfilt = 0;
+  result_t r = {0, 0, 0, 0};
+  bool level[3] = {true, true, false};
+  size_t i = 0;
+  for (uint32_t t = 0; t < end; t += POLL_USEC)
+  {
+    for (; i < s.edges.size() && s.edges[i].t < t; i++)
+      level[s.edges[i].pin] = s.edges[i].level;
+    r.interrupts++;
+    enc_switch = (enc_switch << 1) | (level[2] ? 1 : 0);
+    enc_button = (enc_switch & 0xFFFFFFF) == 0xFFFFFFF ? 1 : 0;
+    if (enc_button && !enc_prev_button)
+      r.presses++;
+    enc_prev_button = enc_button;
+    afilt += level[0] ? 1 : -1;
+    if (afilt > 2) { afilt = 2; cur |= 1; }
+    if (afilt < -2) { afilt = -2; cur &= 2; }
+    bfilt += level[1] ? 1 : -1;
+    if (bfilt > 2) { bfilt = 2; cur |= 2; }
+    if (bfilt < -2) { bfilt = -2; cur &= 1; }
+    if ((prev & 1) == 1 && (cur & 1) == 0)
+      r.position += (cur & 2 ? -1 : 1);
+    prev = cur;
+  }
+  return r;
+}
+
+static void test_rotation()
+{
+  signal_t s;
+  for (int i = 0; i < 10; i++)
+    s.detent(1, 20000);
+  for (int i = 0; i < 7; i++)
+    s.detent(-1, 40000);
+  result_t r = run_edges(s, s.t + 10000), p = run_polling(s, s.t + 10000);
+  check(r.position == 3, "detents", r.position, 3);
+  check(p.position == 3, "detents, polling", p.position, 3);
+
+  signal_t half; // half a turn and back, chatter in the detent
+  half.edge(1, false, 5000);
+  half.edge(0, false, 5000);
+  half.edge(0, true, 5000);
+  half.edge(1, true, 5000);
+  for (int i = 0; i < 20; i++)
+    half.edge(0, i % 2, 300);
+  check(run_edges(half, half.t + 1000).position == 0, "half a turn back", run_edges(half, half.t + 1000).position);
+
+  srand(1);
+  signal_t bouncy;
+  bouncy.bounce = 4;
+  long expect = 0;
+  for (int i = 0; i < 2000; i++)
+  {
+    int dir = i % 50 < 30 ? 1 : -1;
+    bouncy.detent(dir, 8000 + rand() % 40000);
+    expect += dir;
+  }
+  r = run_edges(bouncy, bouncy.t + 10000);
+  check(r.position == expect, "bounce", r.position, expect);
+
+  long missed = 0;
+  for (size_t i = 0; i + 1 < bouncy.edges.size(); i++)
+    missed += bouncy.edges[i + 1].t - bouncy.edges[i].t < 10;
+  r = run_edges(bouncy, bouncy.t + 10000, false, 10);
+  check(missed > 0 && r.position == expect, "bounce and missed edges", r.position, expect);
+}
+
+static void test_button()
+{
+  signal_t s;
+  s.press(100000, 50000); // clean
+  s.bounce = 3;
+  for (int i = 0; i < 20; i++) // bouncing contacts
+    s.press(60000 + rand() % 200000, 100000);
+  s.bounce = 0;
+  s.press(1000, 100000); // a glitch
+  s.press(3000, 100000);
+  result_t r = run_edges(s, s.t + 100000), p = run_polling(s, s.t + 100000);
+  check(r.presses == 21, "presses", r.presses, 21);
+  check(p.presses == 21, "presses, polling", p.presses, 21);
+  check(r.first_press - 51000 < BUTTON_USEC, "start of the press, sampled", r.first_press, 51000);
+  r = run_edges(s, s.t + 100000, true);
+  check(r.presses == 21 && r.first_press == 51000, "start of the press, edges", r.first_press, 51000);
+
+  signal_t tap; // between two samples of a slow poll
+  tap.press(30000, 10000);
+  QuadratureDecoder q;
+  q.begin(3, false, 0);
+  for (const edge_t &e : tap.edges)
+    q.button(e.level, e.t);
+  q.button(false, 100000);
+  check(q.presses() == 1 && !q.pressed(), "a tap between two polls", q.presses(), 1);
+
+  q.begin(3, false, 0); // press time while held
+  q.button(true, 1000);
+  q.button(true, 500000);
+  check(q.pressed() && q.press_time(1500000) == 1499000, "press time", q.press_time(1500000), 1499000);
+}
+
+// A session: turns of a few detents and presses, with bounce; the interrupts per second
+static void load(double seconds)
+{
+  srand(2);
+  signal_t s;
+  s.bounce = 2;
+  long detents = 0, presses = 0;
+  while (s.t < seconds * 1e6)
+  {
+    if (rand() % 4 == 0)
+    {
+      s.press(100000 + rand() % 300000, 500000 + rand() % 2000000);
+      presses++;
+    }
+    else
+    {
+      s.t += 500000 + rand() % 3000000;
+      int n = 1 + rand() % 8, dir = rand() % 2 ? 1 : -1;
+      for (int i = 0; i < n; i++, detents++)
+        s.detent(dir, 20000 + rand() % 60000);
+    }
+  }
+  uint32_t end = s.t + 100000;
+  result_t r = run_edges(s, end), p = run_polling(s, end);
+  check(r.position == p.position && r.presses == presses && p.presses == presses, "session", r.presses,
+        presses);
+  double sec = end / 1e6, edges = r.interrupts - end / BUTTON_USEC;
+  double before = p.interrupts / sec * POLL_CYCLES / CPU_HZ * 100;
+  double after = (edges * EDGE_CYCLES + (r.interrupts - edges) * BUTTON_CYCLES) / sec / CPU_HZ * 100;
+  printf("session of %.0f sec: %ld detents, %ld presses, %.0f edges of A and B\n", sec, detents, presses, edges);
+  printf("polling 2.5 kHz: %8.0f interrupts/sec, %5.3f %% CPU\n", p.interrupts / sec, before);
+  printf("EIC + 500 Hz:    %8.0f interrupts/sec, %5.3f %% CPU (idle: %.3f %%)\n", r.interrupts / sec, after,
+         1e6 / BUTTON_USEC * BUTTON_CYCLES / CPU_HZ * 100);
+}
+
+int main(int argc, char **argv)
+{
+  double seconds = argc > 1 ? atof(argv[1]) : 600;
+  test_rotation();
+  test_button();
+  load(seconds);
+  printf("%d errors\n", errors);
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,254 @@
+/*
+  Host test of the input event queue of the firmware (diyp-controller/dp_events.h) under interleavings
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Check:
+  - the queue with a scripted schedule: bursts of the producer between the pops of the consumer, a full queue, the
+    indexes wrapping; every event accepted comes out once and in order, the rest is counted as dropped.
+  - the queue with a producer and a consumer thread running flat out, the producer trying again while it is full:
+    every event comes out in order, at whatever point of push() and pop() the other side runs (the interrupt can
+    only come in between the instructions of the loop, the threads run at the same time).
+  - the input of the loop: the timer interrupt of dp_encoder.cpp at 500 Hz (the decoder, the brew switch, both with
+    bounce) and a loop of 5..150 msec that drains the events and has two readers of the press, like the menus and the
+    brew process. Against the static counters that Display::button_pressed() had: the second reader saw nothing.
+    The start of a shot from the edge of the brew switch against the loop that read it.
+
+  usage: event_sim [events]
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <deque>
+#include <thread>
+#include "../diyp-controller/dp_events.h"
+#include "../diyp-controller/dp_quadrature.h"
+
+#define TIMER_USEC 2000       // BUTTON_PERIOD_US of dp_encoder.cpp
+#define LONG_PRESS_USEC 1000000
+#define BREW_DEBOUNCE_USEC 20000
+
+static int errors = 0;
+
+static void check(bool ok, const char *what, long got = 0, long expect = 0)
+{
+  if (!ok && errors++ < 20)
+    printf("FAIL %s: %ld, expected %ld\n", what, got, expect);
+}
+
+// The sequence number of an event in its time, the type and steps from it
+static bool push_seq(EventQueue &q, uint32_t seq)
+{
+  return q.push(EVENT_ROTATE + seq % 6, seq, (int8_t)(seq % 255 - 127));
+}
+
+static bool check_seq(const input_event_t &e, uint32_t seq)
+{
+  return e.time == seq && e.type == EVENT_ROTATE + seq % 6 && e.steps == (int8_t)(seq % 255 - 127);
+}
+
+static void test_schedule()
+{
+  EventQueue q;
+  input_event_t e;
+  std::deque<uint32_t> model; // the events accepted, not popped yet
+  uint32_t next = 0, dropped = 0, popped = 0;
+  check(!q.pop(&e) && q.count() == 0, "empty");
+  srand(1);
+  for (int step = 0; step < 200000; step++) // the interrupt between every two pops: none, one, a burst
+  {
+    int burst = rand() % 16 == 0 ? rand() % (EVENT_QUEUE_SIZE + 8) : rand() % 2;
+    for (int i = 0; i < burst; i++, next++)
+    {
+      bool full = model.size() == EVENT_QUEUE_SIZE;
+      if (push_seq(q, next))
+        model.push_back(next);
+      else
+        dropped++;
+      check(full == (model.empty() || model.back() != next), "full", model.size(), EVENT_QUEUE_SIZE);
+      check(q.count() == (int)model.size(), "count", q.count(), model.size());
+    }
+    for (int pops = rand() % 5; pops > 0; pops--)
+    {
+      bool ok = q.pop(&e);
+      check(ok == !model.empty(), "pop", ok, !model.empty());
+      if (!ok)
+        break;
+      check(check_seq(e, model.front()), "order", e.time, model.front());
+      model.pop_front();
+      popped++;
+    }
+  }
+  for (; q.pop(&e); popped++, model.pop_front())
+    check(check_seq(e, model.front()), "order", e.time, model.front());
+  check(model.empty() && popped + dropped == next, "all out", popped + dropped, next);
+  check(q.dropped() == dropped, "dropped", q.dropped(), dropped);
+  check(popped > 256 * 8, "indexes wrapped", popped, 256 * 8);
+  printf("schedule: %u events pushed, %u dropped (full), the others out once and in order\n", next, dropped);
+}
+
+// A producer thread and a consumer thread: the producer tries again while the queue is full, all events come out in
+// order; the drops are the tries
+static void test_threads(uint32_t events)
+{
+  EventQueue q;
+  uint32_t tries = 0;
+  std::thread producer([&]() {
+    for (uint32_t seq = 0; seq < events; seq++)
+      while (!push_seq(q, seq))
+        tries++, std::this_thread::yield(); // one core: let the consumer run
+  });
+  input_event_t e;
+  uint32_t next = 0, empty = 0;
+  while (next < events)
+  {
+    if (!q.pop(&e))
+    {
+      empty++;
+      std::this_thread::yield();
+      continue;
+    }
+    if (!check_seq(e, next))
+      check(false, "order", e.time, next);
+    next = e.time + 1;
+  }
+  producer.join();
+  check(!q.pop(&e) && q.count() == 0, "empty at the end");
+  check(q.dropped() == tries, "drops are the tries", q.dropped(), tries);
+  printf("threads: %u events out in order; the queue was full %u times, empty %u times\n", events, tries, empty);
+}
+
+// The firmware: the timer interrupt of dp_encoder.cpp and dp_brew_switch.cpp
+struct firmware_t
+{
+  EventQueue queue;
+  QuadratureDecoder decoder;
+  Debouncer brew = Debouncer(BREW_DEBOUNCE_USEC);
+  bool brew_pushed = false, long_pushed = false;
+  long pushed_position = 0;
+  void timer(uint32_t now, bool pressed, bool brew_up)
+  {
+    long steps = std::max(-127L, std::min(127L, decoder.position() - pushed_position));
+    if (steps && queue.push(EVENT_ROTATE, now, steps))
+      pushed_position += steps;
+    if (decoder.button(pressed, now))
+    {
+      queue.push(decoder.pressed() ? EVENT_PRESS : EVENT_RELEASE, decoder.edge());
+      long_pushed = false;
+    }
+    if (!long_pushed && decoder.press_time(now) >= LONG_PRESS_USEC)
+      long_pushed = queue.push(EVENT_LONG_PRESS, decoder.edge() + LONG_PRESS_USEC);
+    brew.update(brew_up, now);
+    if (brew.state() != brew_pushed)
+      if (queue.push(brew.state() ? EVENT_BREW_UP : EVENT_BREW_DOWN, brew.since()))
+        brew_pushed = brew.state();
+  }
+};
+
+// A contact: its changes with bounce, the level at a time
+struct contact_t
+{
+  uint32_t edges[64];
+  int n = 0;
+  bool level(uint32_t t) const
+  {
+    bool l = false;
+    for (int i = 0; i < n && edges[i] <= t; i++)
+      l = !l;
+    return l;
+  }
+  void change(uint32_t t, int bounce) // the new level at t, bounce: changes back and forth after it
+  {
+    edges[n++] = t;
+    for (int b = 0; b < bounce; b++)
+      edges[n++] = t + 300 + b * 700, edges[n++] = t + 600 + b * 700;
+  }
+};
+
+static const uint8_t cycle_up[4] = {1, 0, 2, 3}, cycle_down[4] = {2, 0, 1, 3}; // the Gray code, back to the detent
+
+static void test_loop()
+{
+  firmware_t fw;
+  fw.decoder.begin(3, false, 0);
+  fw.brew.begin(false, 0);
+  InputFrame frame;
+  srand(2);
+  long presses = 0, long_presses = 0, seen[2] = {0, 0}, old_seen[2] = {0, 0}, loops = 0, shots = 0;
+  long steps = 0, turned = 0;
+  double lag_event = 0, lag_loop = 0, max_event = 0, max_loop = 0; // [msec]
+  unsigned long old_count = 0;
+  for (int round = 0; round < 2000; round++)
+  {
+    // two seconds: a press (long or short), some detents, the brew switch up or down
+    uint32_t t = round * 2000000u, start = t + 100000;
+    contact_t button, lever;
+    bool long_press = rand() % 5 == 0, up = round % 2 == 0; // the lever goes up, or down
+    button.change(start + rand() % 400000, rand() % 4);
+    button.change(button.edges[0] + (long_press ? 1200000 : 60000 + rand() % 300000), rand() % 3);
+    presses++, long_presses += long_press;
+    uint32_t lever_edge = start + rand() % 1500000, loop_next = t;
+    lever.change(lever_edge, rand() % 5);
+    int turn = rand() % 11 - 5;
+    turned += turn;
+    bool event_seen = false, raw_seen = false;
+    for (; t < start + 1900000; t += TIMER_USEC)
+    {
+      if (turn && t >= start + 500000 && (t - start) % 40000 == 0) // a detent every 40 msec, the EIC
+      {
+        for (int i = 0; i < 4; i++)
+          fw.decoder.rotate(turn > 0 ? cycle_up[i] : cycle_down[i]);
+        turn += turn > 0 ? -1 : 1;
+      }
+      bool lever_up = lever.level(t) == up;
+      fw.timer(t, button.level(t), lever_up);
+      if (t < loop_next)
+        continue;
+      loops++; // the loop: drain, then the readers
+      frame.drain(fw.queue);
+      for (int reader = 0; reader < 2; reader++) // the menus and the brew process
+      {
+        seen[reader] += frame.presses;
+        old_seen[reader] += fw.decoder.presses() != old_count; // Display::button_pressed() before
+        old_count = fw.decoder.presses();
+      }
+      steps += frame.steps;
+      long_presses -= frame.long_presses;
+      if (up && !raw_seen && lever_up) // the shot started with a digitalRead() of the brew switch
+      {
+        double lag = (t - lever_edge) / 1000.0;
+        lag_loop += lag, max_loop = std::max(max_loop, lag), raw_seen = true;
+      }
+      if (up && !event_seen && frame.brew_changes && frame.brew_up) // with the event
+      {
+        double lag = (frame.brew_time - lever_edge) / 1000.0;
+        lag_event += lag, max_event = std::max(max_event, lag), event_seen = true, shots++;
+      }
+      loop_next = t + 5000 + rand() % 145000;
+    }
+    check(!up || (event_seen && raw_seen), "shot", round);
+    check(frame.brew_up == up, "brew switch", frame.brew_up, up);
+  }
+  frame.drain(fw.queue);
+  seen[0] += frame.presses, seen[1] += frame.presses, steps += frame.steps, long_presses -= frame.long_presses;
+  check(seen[0] == presses && seen[1] == presses, "presses, both readers", seen[1], presses);
+  check(old_seen[0] + old_seen[1] == presses, "presses, static counters", old_seen[0] + old_seen[1], presses);
+  check(long_presses == 0, "long presses", long_presses, 0);
+  check(steps == turned && steps == fw.decoder.position(), "steps", steps, turned);
+  check(fw.queue.dropped() == 0, "dropped", fw.queue.dropped(), 0);
+  check(max_event < 6, "shot start", max_event * 1000, 6000); // the last bounce, then the next sample
+  printf("loop: %ld loops, %ld presses; readers of the events: %ld, %ld; static counters: %ld, %ld\n", loops,
+         presses, seen[0], seen[1], old_seen[0], old_seen[1]);
+  printf("start of %ld shots after the edge of the brew switch: event %.2f msec (max %.2f), loop %.1f msec (max "
+         "%.1f)\n",
+         shots, lag_event / shots, max_event, lag_loop / shots, max_loop);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t events = argc > 1 ? atol(argv[1]) : 2000000;
+  test_schedule();
+  test_threads(events);
+  test_loop();
+  printf("%d errors\n", errors);
+  return errors ? 1 : 0;
+}
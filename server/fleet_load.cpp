@@ -0,0 +1,480 @@
+/*
+  fleet_load: load generator, simulates a fleet of diyPresso controllers publishing telemetry
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Every virtual machine has its own MQTT connection and topic (diyPressoOne/<mac>) and a simple model of the
+  machine: it warms up, is ready (idle) for a random time, makes a shot (pre-infuse, infuse, extract, finished) and
+  goes to sleep now and then. The samples are stored and published with the rate policy and batching of the firmware
+  (dp_telemetry_ring.h, linked from the firmware): 10 Hz while brewing, 1 Hz while heating, otherwise on a change
+  (the deadbands of telemetry_fields[]) or a heartbeat, and a message with up to 10 samples every 5 seconds. The
+  messages are the same as those of the firmware: influxDB lines as written by MqttDevice (telemetry_line() of
+  cbor_decoder.h) and/or CBOR written by TelemetryRing::cbor_begin() and cbor_sample().
+
+  A monitor connection subscribes to all machines and measures the latency from publish() to reception. Time can run
+  faster than real time (-s) to generate the load of a larger fleet or of higher telemetry rates.
+
+  Usage: fleet_load [-m broker[:port]] [-n machines] [-t threads] [-d duration sec] [-s speed] [-f formats 1|2|3]
+                    [-b batch samples] [-i drain msec] [-S mean sec between shots] [-c (cold start)] [-r seed]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <signal.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+#include "mqtt.h"
+#include "cbor_decoder.h"
+#include "../diyp-controller/dp_cbor.h"
+
+// boiler_state_t and brew_state_t of the firmware
+enum { BOIL_OFF, BOIL_HEATING, BOIL_READY, BOIL_BREW };
+enum { BREW_SLEEP = 3, BREW_IDLE = 5, BREW_PRE_INFUSE = 9, BREW_INFUSE, BREW_EXTRACT, BREW_FINISHED };
+
+#define TOPIC "diyPressoOne/"
+#define MAC_BASE 0xD1E500000000ULL
+#define STEP_MSEC 100     // model and sample step [msec simulated]
+#define SETPOINT 98.0
+#define AMBIENT 20.0
+#define HEAT_RATE 0.3     // warm up [C/sec]
+#define COOL_RATE 0.01    // cool down while sleeping [C/sec]
+
+struct machine_t
+{
+  int index;
+  std::string topic;
+  MqttConnection mqtt;
+  std::mt19937 random;
+  // model
+  int boil = BOIL_HEATING, brew = BREW_IDLE, shots = 0;
+  double temp = AMBIENT, weight = 0, end_weight = 0, target = 36, reservoir = 80, power = 100, average = 100;
+  uint32_t phase_end = 0;
+  // telemetry
+  telemetry_point_t last;
+  std::deque<telemetry_point_t> buffer;
+  uint32_t drain_time = 0;
+  unsigned long pushed = 0;
+  std::deque<std::pair<uint32_t, long>> sent[2]; // per format: time of the last sample in a message, publish [usec]
+  std::mutex *lock;                               // of the thread, guards sent[]
+};
+
+static std::string broker = "localhost";
+static int broker_port = 1883, machines = 100, threads = 0, duration = 60, formats = TELEMETRY_FORMAT_LINE;
+static int batch = TELEMETRY_DRAIN_BATCH, drain_msec = TELEMETRY_DRAIN_MSEC, shot_sec = 600, seed = 1;
+static double speed = 1;
+static bool cold = false;
+static std::atomic<bool> stopping(false), monitoring(true);
+static std::vector<machine_t *> fleet;
+static long start_usec;
+static uint64_t start_epoch; // [msec] since 1970
+
+static std::atomic<unsigned long long> messages(0), lines(0), bytes(0), received(0), lost(0), connect_errors(0);
+static std::mutex latency_lock;
+static std::vector<long> latencies; // [usec] of the current report interval
+
+static long now_usec()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint32_t sim_msec() { return (uint32_t)((now_usec() - start_usec) * speed / 1000); }
+
+static double uniform(machine_t &m, double a, double b) { return std::uniform_real_distribution<double>(a, b)(m.random); }
+static uint32_t exponential(machine_t &m, double mean_sec)
+{
+  return (uint32_t)(std::exponential_distribution<double>(1.0 / mean_sec)(m.random) * 1000);
+}
+
+// Advance the machine model one step
+static void step(machine_t &m, uint32_t t)
+{
+  double dt = STEP_MSEC / 1000.0;
+  switch (m.brew)
+  {
+  case BREW_SLEEP:
+    m.temp = std::max(AMBIENT, m.temp - COOL_RATE * dt * (m.temp - AMBIENT));
+    m.power = 0;
+    if (t >= m.phase_end)
+    {
+      m.brew = BREW_IDLE;
+      m.boil = BOIL_HEATING;
+    }
+    break;
+  case BREW_IDLE:
+    if (m.boil == BOIL_HEATING)
+    {
+      m.power = 100;
+      m.temp += HEAT_RATE * dt;
+      if (m.temp >= SETPOINT)
+      {
+        m.boil = BOIL_READY;
+        m.phase_end = t + exponential(m, shot_sec);
+      }
+      break;
+    }
+    m.temp += 0.8 * (SETPOINT - m.temp) * dt + uniform(m, -0.02, 0.02);
+    m.power = std::max(0.0, 8 + 20 * (SETPOINT - m.temp) + uniform(m, -3, 3));
+    if (t >= m.phase_end)
+    {
+      if (uniform(m, 0, 1) < 0.1) // no shot, goes to sleep
+      {
+        m.brew = BREW_SLEEP;
+        m.boil = BOIL_OFF;
+        m.phase_end = t + exponential(m, 6 * shot_sec);
+        break;
+      }
+      m.brew = BREW_PRE_INFUSE;
+      m.boil = BOIL_BREW;
+      m.weight = 0;
+      m.target = uniform(m, 30, 42);
+      m.phase_end = t + 3000;
+    }
+    break;
+  case BREW_PRE_INFUSE:
+  case BREW_INFUSE:
+  case BREW_EXTRACT:
+    m.power = 100;
+    m.temp -= 0.1 * dt;
+    if (m.brew == BREW_EXTRACT)
+      m.weight += m.target / 25.0 * dt * uniform(m, 0.8, 1.2);
+    else
+      m.weight += 0.05 * dt;
+    if (t >= m.phase_end || m.weight >= m.target)
+    {
+      m.brew++;
+      m.phase_end = t + (m.brew == BREW_INFUSE ? 4000 : m.brew == BREW_EXTRACT ? 30000 : 5000);
+    }
+    break;
+  case BREW_FINISHED:
+    m.power = 60;
+    if (t >= m.phase_end)
+    {
+      m.shots++;
+      m.end_weight = m.weight;
+      m.reservoir -= m.weight / 15;
+      if (m.reservoir < 10)
+        m.reservoir = 90; // refilled
+      m.brew = BREW_IDLE;
+      m.boil = BOIL_READY;
+      m.phase_end = t + exponential(m, shot_sec);
+    }
+    break;
+  }
+  m.average += (m.power - m.average) * dt / 60;
+}
+
+static void sample(machine_t &m, uint32_t t, telemetry_point_t &s)
+{
+  memset(&s, 0, sizeof(s));
+  s.time = t;
+  s.epoch = start_epoch + t;
+  s.value[TM_T_SET] = m.boil == BOIL_OFF ? 0 : lround(SETPOINT * 100);
+  s.value[TM_T_ACT] = lround(m.temp * 100);
+  s.value[TM_H_PWR] = lround(m.power * 10);
+  s.value[TM_H_AVG] = lround(m.average * 10);
+  s.value[TM_R_LVL] = lround(m.reservoir * 10);
+  s.value[TM_R_WGT] = lround(m.reservoir * 15 * 10);
+  s.value[TM_W_CUR] = lround(m.weight * 10);
+  s.value[TM_W_END] = lround(m.end_weight * 10);
+  s.value[TM_SHOTS] = m.shots;
+  s.value[TM_BOIL] = m.boil;
+  s.value[TM_BREW] = m.brew;
+}
+
+// Rate policy of the firmware: the sample interval of the state as Telemetry::interval(), TelemetryRing::due()
+static bool due(machine_t &m, const telemetry_point_t &s)
+{
+  if (m.pushed == 0)
+    return true;
+  uint32_t interval = s.value[TM_BOIL] == BOIL_HEATING ? TELEMETRY_ACTIVE_MSEC : 0;
+  switch (s.value[TM_BREW])
+  {
+  case BREW_PRE_INFUSE:
+  case BREW_INFUSE:
+  case BREW_EXTRACT:
+    interval = TELEMETRY_BUSY_MSEC;
+    break;
+  case BREW_FINISHED:
+    interval = TELEMETRY_ACTIVE_MSEC;
+    break;
+  }
+  return TelemetryRing::due(s, m.last, interval);
+}
+
+// Publish a batch like Telemetry::run()
+static void drain(machine_t &m, uint32_t t)
+{
+  if (m.buffer.empty() || t - m.drain_time < (uint32_t)(m.buffer.size() >= (size_t)batch ? TELEMETRY_BACKLOG_MSEC : drain_msec))
+    return;
+  m.drain_time = t;
+  int n = std::min((int)m.buffer.size(), batch);
+  uint32_t last = m.buffer[n - 1].time;
+  long now = now_usec();
+  if (formats & TELEMETRY_FORMAT_LINE)
+  {
+    std::string text;
+    for (int i = 0; i < n; i++)
+      text += (i ? "\n" : "") + telemetry_line(m.buffer[i]);
+    m.mqtt.publish(m.topic, text.data(), text.size());
+    bytes += text.size();
+    std::lock_guard<std::mutex> lock(*m.lock);
+    m.sent[0].push_back(std::make_pair(last, now));
+  }
+  if (formats & TELEMETRY_FORMAT_CBOR)
+  {
+    uint8_t buf[TELEMETRY_CBOR_SIZE];
+    CborWriter cbor(buf, sizeof(buf));
+    TelemetryRing::cbor_begin(cbor, start_epoch);
+    for (int i = 0; i < n; i++)
+      TelemetryRing::cbor_sample(cbor, m.buffer[i], i ? &m.buffer[i - 1] : NULL);
+    cbor.end();
+    m.mqtt.publish(m.topic + "/cbor", cbor.data(), cbor.size());
+    bytes += cbor.size();
+    std::lock_guard<std::mutex> lock(*m.lock);
+    m.sent[1].push_back(std::make_pair(last, now));
+  }
+  m.buffer.erase(m.buffer.begin(), m.buffer.begin() + n);
+  messages += (formats & TELEMETRY_FORMAT_LINE ? 1 : 0) + (formats & TELEMETRY_FORMAT_CBOR ? 1 : 0);
+  lines += n;
+}
+
+static void run_machines(std::vector<machine_t *> group)
+{
+  std::mutex lock;
+  for (machine_t *m : group)
+  {
+    m->lock = &lock;
+    char id[32];
+    snprintf(id, sizeof(id), "diyPresso-%s", m->topic.c_str() + strlen(TOPIC));
+    if (!m->mqtt.connect(broker, broker_port, id))
+      connect_errors++;
+  }
+  uint32_t t = 0;
+  long polled = now_usec();
+  while (!stopping)
+  {
+    uint32_t now = sim_msec();
+    for (; t + STEP_MSEC <= now; t += STEP_MSEC)
+      for (machine_t *m : group)
+      {
+        step(*m, t);
+        telemetry_point_t s;
+        sample(*m, t, s);
+        if (due(*m, s))
+        {
+          m->buffer.push_back(s);
+          m->last = s;
+          m->pushed++;
+        }
+        drain(*m, t);
+      }
+    bool poll = now_usec() - polled > 1000000; // keep alive, and the connections are read now and then
+    for (machine_t *m : group)
+    {
+      if (!m->mqtt.connected())
+        continue;
+      if (poll ? m->mqtt.poll(0) < 0 : !m->mqtt.flush())
+        m->mqtt.close();
+    }
+    if (poll)
+      polled = now_usec();
+    long wait = (long)((t + STEP_MSEC) / speed * 1000) - (now_usec() - start_usec);
+    if (wait > 0)
+      usleep(std::min(wait, 100000L));
+  }
+  for (machine_t *m : group)
+    m->mqtt.close();
+}
+
+// Match a received message with the publish of its machine
+static void on_message(const std::string &topic, const uint8_t *payload, size_t size)
+{
+  long now = now_usec();
+  if (topic.compare(0, strlen(TOPIC), TOPIC) != 0)
+    return;
+  unsigned long long mac = strtoull(topic.c_str() + strlen(TOPIC), NULL, 16);
+  if (mac < MAC_BASE || mac >= MAC_BASE + fleet.size())
+    return;
+  machine_t &m = *fleet[mac - MAC_BASE];
+  bool cbor = topic.size() > 5 && topic.compare(topic.size() - 5, 5, "/cbor") == 0;
+  uint32_t last;
+  if (cbor)
+  {
+    std::vector<telemetry_point_t> samples;
+    if (!telemetry_decode(payload, size, samples) || samples.empty())
+      return;
+    last = samples.back().time;
+  }
+  else
+  {
+    std::string text((const char *)payload, size);
+    size_t pos = text.rfind(",msec=");
+    if (pos == std::string::npos)
+      return;
+    last = strtoul(text.c_str() + pos + 6, NULL, 10);
+  }
+  received++;
+  long latency = -1;
+  {
+    std::lock_guard<std::mutex> lock(*m.lock);
+    std::deque<std::pair<uint32_t, long>> &sent = m.sent[cbor];
+    while (!sent.empty() && sent.front().first != last)
+    {
+      sent.pop_front(); // not received
+      lost++;
+    }
+    if (!sent.empty())
+    {
+      latency = now - sent.front().second;
+      sent.pop_front();
+    }
+  }
+  if (latency >= 0)
+  {
+    std::lock_guard<std::mutex> lock(latency_lock);
+    latencies.push_back(latency);
+  }
+}
+
+static void monitor()
+{
+  MqttConnection mqtt;
+  mqtt.on_message(on_message);
+  if (!mqtt.connect(broker, broker_port, "diyPresso-fleet-load-monitor") || !mqtt.subscribe(TOPIC "+") ||
+      !mqtt.subscribe(TOPIC "+/cbor"))
+  {
+    fprintf(stderr, "fleet_load: monitor cannot connect to %s:%d\n", broker.c_str(), broker_port);
+    return;
+  }
+  while (monitoring && mqtt.poll(100) >= 0)
+    ;
+}
+
+static void stop(int) { stopping = true; }
+
+static void report(double sec, unsigned long long m, unsigned long long l, unsigned long long b, unsigned long long r)
+{
+  std::vector<long> lat;
+  {
+    std::lock_guard<std::mutex> lock(latency_lock);
+    lat.swap(latencies);
+  }
+  std::sort(lat.begin(), lat.end());
+  auto pct = [&](double p) { return lat.empty() ? 0.0 : lat[std::min(lat.size() - 1, (size_t)(p * lat.size()))] / 1000.0; };
+  printf("%6.1f sec: %8.0f msg/s %9.0f lines/s %7.2f MB/s, received %8.0f msg/s, latency p50 %.2f p99 %.2f max %.2f "
+         "msec, lost %llu\n",
+         (now_usec() - start_usec) / 1e6, m / sec, l / sec, b / sec / 1e6, r / sec, pct(0.5), pct(0.99), pct(1),
+         (unsigned long long)lost);
+  fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+  int opt;
+  while ((opt = getopt(argc, argv, "m:n:t:d:s:f:b:i:S:cr:")) != -1)
+    switch (opt)
+    {
+    case 'm':
+    {
+      broker = optarg;
+      size_t colon = broker.rfind(':');
+      if (colon != std::string::npos)
+      {
+        broker_port = atoi(broker.c_str() + colon + 1);
+        broker.resize(colon);
+      }
+      break;
+    }
+    case 'n': machines = std::max(1, atoi(optarg)); break;
+    case 't': threads = std::max(1, atoi(optarg)); break;
+    case 'd': duration = std::max(1, atoi(optarg)); break;
+    case 's': speed = std::max(0.01, atof(optarg)); break;
+    case 'f': formats = atoi(optarg) & 3; break;
+    case 'b': batch = std::max(1, atoi(optarg)); break;
+    case 'i': drain_msec = std::max(1, atoi(optarg)); break;
+    case 'S': shot_sec = std::max(1, atoi(optarg)); break;
+    case 'c': cold = true; break;
+    case 'r': seed = atoi(optarg); break;
+    default:
+      fprintf(stderr, "usage: fleet_load [-m broker[:port]] [-n machines] [-t threads] [-d duration sec] [-s speed] "
+                      "[-f formats 1|2|3] [-b batch] [-i drain msec] [-S shot interval sec] [-c] [-r seed]\n");
+      return 1;
+    }
+  if (!threads)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  signal(SIGPIPE, SIG_IGN);
+  signal(SIGINT, stop);
+
+  // A mixed fleet: most machines are warm and ready, some warm up or sleep. With -c all start cold.
+  for (int i = 0; i < machines; i++)
+  {
+    machine_t *m = new machine_t();
+    char mac[16];
+    snprintf(mac, sizeof(mac), "%012llX", MAC_BASE + i);
+    m->index = i;
+    m->topic = std::string(TOPIC) + mac;
+    m->random.seed(seed * 100003 + i);
+    double r = uniform(*m, 0, 1);
+    if (!cold && r < 0.7)
+    {
+      m->boil = BOIL_READY;
+      m->temp = SETPOINT;
+      m->power = m->average = 8;
+      m->shots = (int)uniform(*m, 0, 5000);
+      m->phase_end = exponential(*m, shot_sec);
+    }
+    else if (!cold && r < 0.85)
+    {
+      m->brew = BREW_SLEEP;
+      m->boil = BOIL_OFF;
+      m->phase_end = exponential(*m, 6 * shot_sec);
+    }
+    else
+      m->temp = uniform(*m, AMBIENT, cold ? AMBIENT + 5 : SETPOINT);
+    fleet.push_back(m);
+  }
+
+  start_epoch = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+  start_usec = now_usec();
+  std::thread mon(monitor);
+  usleep(200000); // subscribed before the first message
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++)
+  {
+    std::vector<machine_t *> group;
+    for (int i = t; i < machines; i += threads)
+      group.push_back(fleet[i]);
+    workers.push_back(std::thread(run_machines, group));
+  }
+
+  unsigned long long pm = 0, pl = 0, pb = 0, pr = 0;
+  long last = now_usec(), end = now_usec() + duration * 1000000L;
+  while (!stopping && now_usec() < end)
+  {
+    usleep(100000);
+    if (now_usec() - last < 5000000 && now_usec() < end)
+      continue;
+    double sec = (now_usec() - last) / 1e6;
+    last = now_usec();
+    report(sec, messages - pm, lines - pl, bytes - pb, received - pr);
+    pm = messages, pl = lines, pb = bytes, pr = received;
+  }
+  stopping = true;
+  for (std::thread &w : workers)
+    w.join();
+  usleep(500000); // the last messages arrive
+  monitoring = false;
+  mon.join();
+  double sec = (now_usec() - start_usec) / 1e6;
+  printf("total: %d machines (%llu connect errors), %.0f sec x %.1f: %llu messages, %llu lines, %.1f MB, "
+         "%llu received, %llu lost\n",
+         machines, (unsigned long long)connect_errors, sec, speed, (unsigned long long)messages,
+         (unsigned long long)lines, bytes / 1e6, (unsigned long long)received, (unsigned long long)lost);
+  return 0;
+}
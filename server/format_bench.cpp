@@ -0,0 +1,225 @@
+/*
+  Correctness test and benchmark of the numeric formatter of the firmware (diyp-controller/dp_format.h)
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Test: format_float() against snprintf("%*.*f") for 0..3 decimals and every fixed point value in +-RANGE units,
+  with its neighbours (nextafter) and the ties halfway between two values with theirs, a sweep of random doubles over
+  the whole range, the range limit, inf and nan. snprintf() prints "-0.0" where format_float() prints "0.0", the
+  expected text is corrected for that. format_fixed() against the integer printed by snprintf("%ld") with the point
+  inserted. The old format_float() (sprintf and fmod, truncating) is checked the same way, to count its errors.
+
+  Benchmark: time per call of the values of the menus (temperature, power, weight, settings) for the old
+  format_float(), snprintf() and format_float(). Cycles are the time stamp counter of the host (x86), the SAMD21
+  (Cortex-M0+, no FPU, no divider) does the double arithmetic and the division in software.
+
+  usage: format_bench [calls]
+*/
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "../diyp-controller/dp_format.h"
+#ifdef __x86_64__
+#include <x86intrin.h>
+#endif
+
+#define RANGE 500000L // fixed point values tested exhaustively, per number of decimals
+
+// The format_float() of dp_display.cpp before dp_format.h
+static void format_float_old(char *dest, double f, int digits = 0, int len = 0)
+{
+  bool neg = f < 0;
+  if (neg)
+    f *= -1.0;
+  char sign[2] = {'-', 0};
+  if (!neg)
+    sign[0] = 0;
+  switch (digits)
+  {
+  case 1: sprintf(dest, "%s%d.%d", sign, (int)f, (int)fmod(10.0 * f, 10)); break;
+  case 2: sprintf(dest, "%s%d.%d%d", sign, (int)f, (int)fmod(10.0 * f, 10), (int)fmod(100.0 * f, 10)); break;
+  case 3:
+    sprintf(dest, "%s%d.%d%d%d", sign, (int)f, (int)fmod(10.0 * f, 10), (int)fmod(100.0 * f, 10),
+            (int)fmod(1000.0 * f, 10));
+    break;
+  default: sprintf(dest, "%s%d", sign, (int)f); break;
+  }
+  if (len)
+  {
+    int org = strlen(dest) - 1;
+    dest[len] = 0;
+    for (int i = len - 1; i >= 0; i--)
+      dest[i] = org >= 0 ? dest[org--] : ' ';
+  }
+}
+
+// snprintf("%*.*f") without the sign of a zero
+static void expected(char *dest, double f, int decimals, int len)
+{
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", decimals, f);
+  const char *s = buf;
+  if (*s == '-' && strspn(s + 1, "0.") == strlen(s + 1))
+    s++;
+  snprintf(dest, 64, "%*s", len, s);
+}
+
+struct check_t
+{
+  long tests = 0, errors = 0, old_tests = 0, old_errors = 0;
+
+  void value(double f, int decimals, int len)
+  {
+    char want[64], got[64];
+    expected(want, f, decimals, len);
+    int n = format_float(got, f, decimals, len);
+    tests++;
+    if (strcmp(want, got) != 0 || n != (int)strlen(got))
+    {
+      if (errors++ < 10)
+        printf("format_float(%.17g, %d, %d): \"%s\", expected \"%s\"\n", f, decimals, len, got, want);
+    }
+    if (fabs(f) < 2e9 && (int)strlen(want) >= len) // old: int range, not cut by len
+    {
+      format_float_old(got, f, decimals, len);
+      old_tests++;
+      old_errors += strcmp(want, got) != 0;
+    }
+  }
+
+  void fixed(long v, int decimals, int len)
+  {
+    static const long scale[] = {1, 10, 100, 1000};
+    char digits[64], want[64], got[64];
+    unsigned long u = v < 0 ? 0UL - (unsigned long)v : (unsigned long)v;
+    if (decimals)
+      snprintf(digits, sizeof(digits), "%s%lu.%0*lu", v < 0 ? "-" : "", u / scale[decimals], decimals,
+               u % scale[decimals]);
+    else
+      snprintf(digits, sizeof(digits), "%ld", v);
+    snprintf(want, sizeof(want), "%*s", len, digits);
+    int n = format_fixed(got, v, decimals, len);
+    tests++;
+    if (strcmp(want, got) != 0 || n != (int)strlen(got))
+    {
+      if (errors++ < 10)
+        printf("format_fixed(%ld, %d, %d): \"%s\", expected \"%s\"\n", v, decimals, len, got, want);
+    }
+  }
+
+  void overflow(double f, int decimals, int len)
+  {
+    char got[64];
+    format_float(got, f, decimals, len);
+    tests++;
+    if (strspn(got, "*") != strlen(got) || (int)strlen(got) != (len ? len : 1))
+    {
+      if (errors++ < 10)
+        printf("format_float(%.17g, %d, %d): \"%s\", expected '*'\n", f, decimals, len, got);
+    }
+  }
+};
+
+static double now_nsec()
+{
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static unsigned long long cycles()
+{
+#ifdef __x86_64__
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+struct menu_value_t
+{
+  double value;
+  int decimals, len;
+};
+
+static volatile char sink;
+
+template <typename F> static void bench(const char *name, F format, const menu_value_t *values, int n, long calls)
+{
+  char buf[64];
+  double t0 = now_nsec();
+  unsigned long long c0 = cycles();
+  for (long i = 0; i < calls; i++)
+  {
+    const menu_value_t &v = values[i % n];
+    format(buf, v.value, v.decimals, v.len);
+    sink = buf[0];
+  }
+  double nsec = (now_nsec() - t0) / calls;
+  printf("%-14s %8.1f %8.0f\n", name, nsec, (double)(cycles() - c0) / calls);
+}
+
+int main(int argc, char **argv)
+{
+  long calls = argc > 1 ? atol(argv[1]) : 5000000;
+  check_t check;
+  static const double scale[] = {1, 10, 100, 1000};
+
+  for (int d = 0; d <= FORMAT_MAX_DECIMALS; d++)
+    for (long n = -RANGE; n <= RANGE; n++)
+    {
+      int len = n & 7;
+      double f = n / scale[d], tie = (n + 0.5) / scale[d];
+      check.value(f, d, len);
+      check.value(nextafter(f, HUGE_VAL), d, len);
+      check.value(nextafter(f, -HUGE_VAL), d, len);
+      check.value(tie, d, len);
+      check.value(nextafter(tie, HUGE_VAL), d, len);
+      check.value(nextafter(tie, -HUGE_VAL), d, len);
+      check.fixed(n, d, len);
+    }
+  srand(1);
+  for (long i = 0; i < 4000000; i++)
+  {
+    int d = rand() % (FORMAT_MAX_DECIMALS + 1);
+    double f = ldexp((double)rand() / RAND_MAX, rand() % 42 - 10) * (rand() & 1 ? 1 : -1);
+    if (fabs(f) * scale[d] < 4294967295.0)
+      check.value(f, d, rand() % 12);
+  }
+  for (int d = 0; d <= FORMAT_MAX_DECIMALS; d++)
+  {
+    double limit = 4294967295.0 / scale[d];
+    check.value(nextafter(limit, 0), d, 0);
+    check.value(-nextafter(limit, 0), d, 0);
+    check.overflow(limit, d, 0);
+    check.overflow(-limit * 10, d, 6);
+    check.overflow(HUGE_VAL, d, 0);
+    check.overflow(-HUGE_VAL, d, 3);
+    check.overflow(NAN, d, 5);
+  }
+  check.fixed(2147483647L, 2, 0);
+  check.fixed(-2147483647L - 1, 3, 14);
+  printf("format_float, format_fixed: %ld tests, %ld errors\n", check.tests, check.errors);
+  printf("old format_float: %ld tests, %ld errors (%.1f%%)\n\n", check.old_tests, check.old_errors,
+         100.0 * check.old_errors / check.old_tests);
+
+  // the menus: dp_menu.cpp
+  menu_value_t values[1000];
+  int n = sizeof(values) / sizeof(values[0]);
+  for (int i = 0; i < n; i++)
+  {
+    switch (i % 5)
+    {
+    case 0: values[i] = {20 + 0.0973 * i, 1, 5}; break; // act_temp
+    case 1: values[i] = {98, 1, 0}; break;              // set_temp
+    case 2: values[i] = {0.1 * i, 0, 3}; break;         // power
+    case 3: values[i] = {812.4 - 0.9 * i, 0, 5}; break; // weight
+    case 4: values[i] = {0.01 * i, 2, 10}; break;       // setting
+    }
+  }
+  printf("%-14s %8s %8s\n", "", "nsec", "cycles");
+  bench("old", format_float_old, values, n, calls);
+  bench("snprintf", [](char *buf, double f, int d, int len) { snprintf(buf, 64, "%*.*f", len, d, f); }, values, n,
+        calls);
+  bench("format_float", format_float, values, n, calls);
+  return check.errors ? 1 : 0;
+}
@@ -0,0 +1,148 @@
+/*
+  Host test and benchmark of the compile-time GPIO of the firmware (diyp-controller/dp_fastpin.h)
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Runs HeaterDevice and PumpDevice of the firmware on the host backend of FastPin, which records the writes: the
+  software PWM of the heater SSR gives the power asked, one write per control(), the heater is off during the inrush
+  of the pump. The PORT bits of the pins are checked at compile time against the pin table of the MKR boards.
+
+  Times control() on the host, and a pin write like digitalWrite() of the SAMD core (the lookups in the pin table,
+  the check of the direction, the store) against the single store of FastPin. For the SAMD21 the cycles of the GPIO
+  per call of control() and of the interrupts of the encoder are estimates at 48 MHz (flash with a wait state, APB
+  and IOBUS accesses), not measurements: change them below.
+
+  usage: gpio_bench [calls]
+*/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "../diyp-controller/dp_fastpin.h"
+#include "../diyp-controller/dp_heater.h"
+#include "../diyp-controller/dp_pump.h"
+#include "../diyp-controller/dp_arbiter.h"
+
+#define DIGITALWRITE_CYCLES 36 // call, 3 loads from the pin table in flash, DIRSET, OUTSET over the APB
+#define DIGITALREAD_CYCLES 26  // call, 2 loads from the pin table, IN over the APB
+#define FASTWRITE_CYCLES 2     // the mask from a literal, OUTSET over the IOBUS
+#define FASTREAD_CYCLES 5      // the mask, IN over the APB
+#define CPU_HZ 48e6
+
+static_assert(FastPin<PIN_ENC_A>::group == 1 && FastPin<PIN_ENC_A>::mask == 1UL << 22, "PB22");
+static_assert(FastPin<PIN_ENC_S>::group == 0 && FastPin<PIN_ENC_S>::bit == 22, "PA22");
+static_assert(FastPin<PIN_SSR_HEATER>::group == 0 && FastPin<PIN_SSR_HEATER>::bit == 11, "PA11");
+
+static int errors = 0;
+
+static void check(bool ok, const char *what, double got = 0, double expect = 0)
+{
+  if (!ok && errors++ < 20)
+    printf("FAIL %s: %g, expected %g\n", what, got, expect);
+}
+
+static double usec(std::chrono::steady_clock::time_point start, long calls)
+{
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / calls;
+}
+
+// digitalWrite() of the SAMD core, on a table and registers in memory
+struct pin_description_t
+{
+  uint32_t port, pin, type;
+};
+
+struct port_group_t
+{
+  volatile uint32_t dir, outset, outclr;
+  volatile uint8_t pincfg[32];
+};
+
+static pin_description_t pin_table[FASTPIN_PINS];
+static port_group_t port[2];
+
+__attribute__((noinline)) static void core_digital_write(uint32_t pin, uint32_t value)
+{
+  if (pin_table[pin].type == 0xFF) // PIO_NOT_A_PIN
+    return;
+  uint32_t group = pin_table[pin].port, mask = 1UL << pin_table[pin].pin;
+  if ((port[group].dir & mask) == 0) // an input: the write sets the pull-up
+    port[group].pincfg[pin_table[pin].pin] = value ? 0x04 : 0;
+  if (value)
+    port[group].outset = mask;
+  else
+    port[group].outclr = mask;
+}
+
+static void test_devices()
+{
+  FastPinHost &host = fastpin_host();
+  check(host.output[PIN_SSR_HEATER] && host.output[PIN_SSR_PUMP], "the SSR pins are outputs");
+  check(!host.level[PIN_SSR_HEATER] && !host.level[PIN_SSR_PUMP], "off at the start");
+
+  host_clock() = 1000;
+  heaterDevice.power(30.0);
+  unsigned long writes = host.writes[PIN_SSR_HEATER], on = 0, calls = 0;
+  for (; host_clock() < 21000; host_clock() += 10, calls++) // 20 PWM periods, control() every 10 msec
+  {
+    heaterDevice.control();
+    on += host.level[PIN_SSR_HEATER];
+  }
+  check(host.writes[PIN_SSR_HEATER] - writes == calls, "a write per control()", host.writes[PIN_SSR_HEATER] - writes,
+        calls);
+  check(std::abs(100.0 * on / calls - 30.0) < 1.0, "duty of the heater SSR [%]", 100.0 * on / calls, 30.0);
+
+  heaterDevice.power(100.0);
+  check(host.level[PIN_SSR_HEATER], "heater on");
+  pumpDevice.on();
+  check(host.level[PIN_SSR_PUMP] && !host.level[PIN_SSR_HEATER], "the heater is off during the inrush of the pump");
+  host_clock() += ARBITER_INRUSH_MSEC + 10;
+  heaterDevice.control();
+  check(host.level[PIN_SSR_HEATER], "heater on after the inrush");
+  pumpDevice.off();
+  heaterDevice.off();
+  check(!host.level[PIN_SSR_PUMP] && !host.level[PIN_SSR_HEATER], "off");
+}
+
+static void bench(long calls)
+{
+  for (int i = 0; i < FASTPIN_PINS; i++)
+    pin_table[i] = {(uint32_t)fastpin_map[i] >> 5, (uint32_t)fastpin_map[i] & 31, 0};
+  port[0].dir = FastPin<PIN_SSR_HEATER>::mask;
+
+  heaterDevice.power(40.0);
+  auto start = std::chrono::steady_clock::now();
+  for (long i = 0; i < calls; i++)
+  {
+    host_clock() += 1;
+    heaterDevice.control();
+  }
+  double control = usec(start, calls);
+
+  start = std::chrono::steady_clock::now();
+  for (long i = 0; i < calls; i++)
+    core_digital_write(PIN_SSR_HEATER, i & 1);
+  double core = usec(start, calls);
+  start = std::chrono::steady_clock::now();
+  for (long i = 0; i < calls; i++) // what FastPin::write() is on the SAMD21: a store of the mask
+    *(i & 1 ? &port[0].outset : &port[0].outclr) = FastPin<PIN_SSR_HEATER>::mask;
+  double fast = usec(start, calls);
+  heaterDevice.off();
+
+  printf("host: the write of the pin: like digitalWrite() %.2f nsec, FastPin %.2f nsec\n", core * 1000, fast * 1000);
+  printf("host: control() %.1f nsec/call, with digitalWrite() %.1f nsec\n", control * 1000,
+         (control + core - fast) * 1000);
+  printf("SAMD21 (estimates), GPIO cycles per call       before  after\n");
+  printf("  HeaterDevice::control(), 1 write             %6d %6d\n", DIGITALWRITE_CYCLES, FASTWRITE_CYCLES);
+  printf("  encoder edge interrupt, A and B              %6d %6d\n", 2 * DIGITALREAD_CYCLES, 2 * FASTREAD_CYCLES);
+  printf("  encoder timer interrupt, switch, brew switch %6d %6d\n", 2 * DIGITALREAD_CYCLES, 2 * FASTREAD_CYCLES);
+  printf("  timer interrupt at 500 Hz: %.4f %% -> %.4f %% CPU for the pins\n",
+         500 * 2 * DIGITALREAD_CYCLES / CPU_HZ * 100, 500 * 2 * FASTREAD_CYCLES / CPU_HZ * 100);
+}
+
+int main(int argc, char **argv)
+{
+  long calls = argc > 1 ? atol(argv[1]) : 10000000;
+  test_devices();
+  bench(calls);
+  printf("%d errors\n", errors);
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,170 @@
+/*
+  influxDB v2 write client (server side)
+  (c) 2025 diyPresso - CC-BY-NC
+*/
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <zlib.h>
+#include "mqtt.h"
+#include "influx.h"
+
+#define INFLUX_TIMEOUT_MSEC 10000
+
+std::string gzip(const std::string &data, int level)
+{
+  z_stream z;
+  memset(&z, 0, sizeof(z));
+  if (deflateInit2(&z, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) // +16: gzip header
+    return std::string();
+  std::string out(deflateBound(&z, data.size()), '\0');
+  z.next_in = (Bytef *)data.data();
+  z.avail_in = data.size();
+  z.next_out = (Bytef *)&out[0];
+  z.avail_out = out.size();
+  deflate(&z, Z_FINISH);
+  out.resize(z.total_out);
+  deflateEnd(&z);
+  return out;
+}
+
+bool gunzip(const std::string &data, std::string &out)
+{
+  z_stream z;
+  memset(&z, 0, sizeof(z));
+  if (inflateInit2(&z, 15 + 32) != Z_OK) // +32: detect the gzip header
+    return false;
+  z.next_in = (Bytef *)data.data();
+  z.avail_in = data.size();
+  char buf[65536];
+  int result;
+  do
+  {
+    z.next_out = (Bytef *)buf;
+    z.avail_out = sizeof(buf);
+    result = inflate(&z, Z_NO_FLUSH);
+    out.append(buf, sizeof(buf) - z.avail_out);
+  } while (result == Z_OK);
+  inflateEnd(&z);
+  return result == Z_STREAM_END;
+}
+
+bool InfluxWriter::url(const std::string &url)
+{
+  std::string u = url;
+  if (u.compare(0, 7, "http://") == 0)
+    u = u.substr(7);
+  else if (u.find("://") != std::string::npos)
+    return false; // only plain http
+  size_t slash = u.find('/');
+  if (slash != std::string::npos)
+    u = u.substr(0, slash);
+  size_t colon = u.rfind(':');
+  _host = u.substr(0, colon);
+  _port = colon == std::string::npos ? 80 : atoi(u.c_str() + colon + 1);
+  return !_host.empty() && _port > 0;
+}
+
+void InfluxWriter::target(const std::string &org, const std::string &bucket, const std::string &token)
+{
+  _path = "/api/v2/write?org=" + org + "&bucket=" + bucket + "&precision=ns";
+  _token = token;
+}
+
+void InfluxWriter::close()
+{
+  if (_fd >= 0)
+    ::close(_fd);
+  _fd = -1;
+}
+
+bool InfluxWriter::send_all(const std::string &data)
+{
+  size_t pos = 0;
+  while (pos < data.size())
+  {
+    ssize_t n = send(_fd, data.data() + pos, data.size() - pos, MSG_NOSIGNAL);
+    if (n > 0)
+      pos += n;
+    else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+      struct pollfd p = {_fd, POLLOUT, 0};
+      if (poll(&p, 1, INFLUX_TIMEOUT_MSEC) <= 0)
+        return false;
+    }
+    else
+      return false;
+  }
+  return true;
+}
+
+// Read the status line, the headers and the body (Content-Length or chunked)
+int InfluxWriter::read_response()
+{
+  std::string in;
+  size_t header_end = std::string::npos, body_size = 0;
+  int status = -1;
+  bool chunked = false;
+  long end = now_msec() + INFLUX_TIMEOUT_MSEC;
+  for (;;)
+  {
+    if (header_end == std::string::npos && (header_end = in.find("\r\n\r\n")) != std::string::npos)
+    {
+      std::string headers = in.substr(0, header_end);
+      for (char &c : headers)
+        c = tolower(c);
+      status = atoi(headers.c_str() + headers.find(' ') + 1);
+      size_t cl = headers.find("content-length:");
+      if (cl != std::string::npos)
+        body_size = atol(headers.c_str() + cl + 15);
+      chunked = headers.find("transfer-encoding: chunked") != std::string::npos;
+      header_end += 4;
+    }
+    if (header_end != std::string::npos)
+    {
+      if (chunked && in.find("0\r\n\r\n", header_end) != std::string::npos)
+        break;
+      if (!chunked && in.size() >= header_end + body_size)
+        break;
+    }
+    struct pollfd p = {_fd, POLLIN, 0};
+    if (poll(&p, 1, end - now_msec()) <= 0)
+      return -1;
+    char buf[4096];
+    ssize_t n = recv(_fd, buf, sizeof(buf), 0);
+    if (n > 0)
+      in.append(buf, n);
+    else if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+      return -1;
+  }
+  _response = in.substr(header_end);
+  return status;
+}
+
+int InfluxWriter::write(const std::string &lines, bool compress)
+{
+  std::string body = compress ? gzip(lines) : lines;
+  std::string request = "POST " + _path + " HTTP/1.1\r\n"
+                        "Host: " + _host + ":" + std::to_string(_port) + "\r\n"
+                        "Authorization: Token " + _token + "\r\n"
+                        "Content-Type: text/plain; charset=utf-8\r\n"
+                        "Accept: application/json\r\n" +
+                        (compress ? "Content-Encoding: gzip\r\n" : "") +
+                        "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+  _response.clear();
+  for (int attempt = 0; attempt < 2; attempt++) // a kept alive connection may have been closed by the server
+  {
+    if (_fd < 0 && (_fd = tcp_connect(_host, _port)) < 0)
+      return -1;
+    int status = -1;
+    if (send_all(request) && send_all(body))
+      status = read_response();
+    if (status > 0)
+      return status;
+    close();
+  }
+  return -1;
+}
@@ -0,0 +1,34 @@
+/*
+  influxDB v2 write client (server side)
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Posts line protocol to /api/v2/write over plain HTTP/1.1 with keep alive, optionally gzip compressed. The same
+  settings as influxdb.py: organisation, bucket, token and nanosecond precision.
+*/
+#ifndef INFLUX_H
+#define INFLUX_H
+
+#include <string>
+
+// gzip (RFC 1952) compression with zlib
+std::string gzip(const std::string &data, int level = 6);
+bool gunzip(const std::string &data, std::string &out);
+
+class InfluxWriter
+{
+public:
+  ~InfluxWriter() { close(); }
+  bool url(const std::string &url); // e.g. http://localhost:8086
+  void target(const std::string &org, const std::string &bucket, const std::string &token);
+  int write(const std::string &lines, bool compress); // returns the HTTP status, or -1 if there was no response
+  const std::string &response() { return _response; }    // body of the last response (the error)
+  void close();
+
+private:
+  std::string _host, _path, _token, _response;
+  int _port = 8086, _fd = -1;
+  bool send_all(const std::string &data);
+  int read_response();
+};
+
+#endif // INFLUX_H
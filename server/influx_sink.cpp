@@ -0,0 +1,153 @@
+/*
+  influx_sink: stand-in for the influxDB write API, for local tests and benchmarks
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Accepts POST requests (keep alive, optionally gzip compressed), counts the lines and answers 204. A percentage of
+  the requests can be answered with 503 to test the retries of a client. With a file name the received lines are
+  appended to that file.
+
+  Usage: influx_sink [port] [fail percent] [file]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <string>
+#include <vector>
+#include "mqtt.h"
+#include "influx.h"
+
+struct connection_t
+{
+  int fd;
+  std::string in;
+};
+
+static unsigned long long requests = 0, failed = 0, lines = 0, bytes = 0, raw_bytes = 0;
+static int fail_percent = 0;
+static FILE *out = NULL;
+
+// Handle the complete requests in the input buffer, returns false to close the connection
+static bool handle(connection_t &c)
+{
+  for (;;)
+  {
+    size_t header_end = c.in.find("\r\n\r\n");
+    if (header_end == std::string::npos)
+      return true;
+    std::string headers = c.in.substr(0, header_end);
+    for (char &ch : headers)
+      ch = tolower(ch);
+    size_t cl = headers.find("content-length:");
+    size_t size = cl == std::string::npos ? 0 : atol(headers.c_str() + cl + 15);
+    if (c.in.size() < header_end + 4 + size)
+      return true;
+    std::string body = c.in.substr(header_end + 4, size);
+    c.in.erase(0, header_end + 4 + size);
+
+    requests++;
+    std::string reply = "HTTP/1.1 204 No Content\r\n\r\n";
+    if (rand() % 100 < fail_percent)
+    {
+      failed++;
+      reply = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n";
+    }
+    else
+    {
+      std::string text;
+      if (headers.find("content-encoding: gzip") != std::string::npos)
+      {
+        if (!gunzip(body, text))
+          reply = "HTTP/1.1 400 Bad Request\r\nContent-Length: 0\r\n\r\n";
+      }
+      else
+        text = body;
+      bytes += body.size();
+      raw_bytes += text.size();
+      for (char ch : text)
+        lines += ch == '\n';
+      if (!text.empty() && text.back() != '\n')
+        lines++;
+      if (out) // flushed per request: the lines are in the file once they are acknowledged (see ingest_sim)
+      {
+        fwrite(text.data(), 1, text.size(), out);
+        fflush(out);
+      }
+    }
+    if (send(c.fd, reply.data(), reply.size(), MSG_NOSIGNAL) != (ssize_t)reply.size())
+      return false;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  int port = argc > 1 ? atoi(argv[1]) : 8086;
+  fail_percent = argc > 2 ? atoi(argv[2]) : 0;
+  if (argc > 3 && !(out = fopen(argv[3], "a")))
+  {
+    perror(argv[3]);
+    return 1;
+  }
+  signal(SIGPIPE, SIG_IGN);
+
+  int lfd = socket(AF_INET6, SOCK_STREAM, 0), one = 1, zero = 0;
+  setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  setsockopt(lfd, IPPROTO_IPV6, IPV6_V6ONLY, &zero, sizeof(zero));
+  struct sockaddr_in6 addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin6_family = AF_INET6;
+  addr.sin6_addr = in6addr_any;
+  addr.sin6_port = htons(port);
+  if (bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(lfd, 64) < 0)
+  {
+    perror("influx_sink");
+    return 1;
+  }
+  fprintf(stderr, "influx_sink: listening on port %d\n", port);
+
+  std::vector<connection_t> connections;
+  long report = now_msec();
+  for (;;)
+  {
+    std::vector<struct pollfd> fds(1 + connections.size());
+    fds[0] = {lfd, POLLIN, 0};
+    for (size_t i = 0; i < connections.size(); i++)
+      fds[i + 1] = {connections[i].fd, POLLIN, 0};
+    poll(fds.data(), fds.size(), 1000);
+
+    for (size_t i = connections.size(); i > 0; i--) // backwards: closed connections are removed
+    {
+      if (!fds[i].revents)
+        continue;
+      connection_t &c = connections[i - 1];
+      char buf[65536];
+      ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+      if (n > 0)
+        c.in.append(buf, n);
+      if (n <= 0 || !handle(c))
+      {
+        close(c.fd);
+        connections.erase(connections.begin() + i - 1);
+      }
+    }
+    if (fds[0].revents)
+    {
+      int fd = accept(lfd, NULL, NULL);
+      if (fd >= 0)
+        connections.push_back({fd, std::string()});
+    }
+
+    if (now_msec() - report >= 10000)
+    {
+      report = now_msec();
+      fprintf(stderr, "influx_sink: %llu requests (%llu failed), %llu lines, %llu bytes (%llu uncompressed)\n",
+              requests, failed, lines, bytes, raw_bytes);
+    }
+  }
+}
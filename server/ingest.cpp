@@ -0,0 +1,297 @@
+/*
+  ingest: forward diyPresso telemetry from MQTT to influxDB (replaces mqtt_fwd.py)
+  (c) 2025 diyPresso - CC-BY-NC
+
+  One thread keeps a subscription on the broker (reconnecting with a backoff) and converts the messages to line
+  protocol, tagged with the device: "measurement,device=<mac> ...". Both the text topic diyPressoOne/<mac> and the
+  CBOR topic diyPressoOne/<mac>/cbor are accepted.
+  The lines are kept in a bounded queue (the oldest messages are dropped when it is full). A second thread writes
+  them in batches (max lines, or after max time), gzip compressed, and retries failed writes with a backoff.
+
+  Usage: ingest [-m broker[:port]] [-i influx url] [-o org] [-b bucket] [-n batch lines] [-t batch msec]
+                [-q queue MB] [-Z (no gzip)] [-v]
+  The influxDB token is read from the environment variable INFLUX_TOKEN.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include "mqtt.h"
+#include "influx.h"
+#include "cbor_decoder.h"
+
+#define TOPIC_PREFIX "diyPressoOne/"
+#define BACKOFF_MIN_MSEC 100
+#define BACKOFF_MAX_MSEC 30000
+#define REPORT_MSEC 10000
+#define STOP_POLL_MSEC 100 // max time to notice a stop in a backoff
+
+static std::string broker = "localhost", influx_url = "http://localhost:8086", org = "peter", bucket = "diyPresso";
+static int broker_port = 1883, batch_lines = 5000, batch_msec = 1000;
+static size_t queue_max = 64 << 20;
+static bool compress = true, verbose = false;
+static volatile sig_atomic_t signaled = 0; // set by the signal handler, the main thread sets stopping
+static std::atomic<bool> stopping(false);
+
+// Bounded queue of line blocks (one per MQTT message)
+static std::mutex queue_mutex;
+static std::condition_variable queue_cv;
+static std::deque<std::string> queue;
+static size_t queue_bytes = 0, queue_lines = 0;
+
+static std::atomic<unsigned long long> messages(0), invalid(0), queued_lines(0), dropped_lines(0), written_lines(0),
+    batches(0), raw_bytes(0), retries(0), rejected_lines(0);
+
+static unsigned long count_lines(const std::string &s)
+{
+  unsigned long n = 0;
+  for (char c : s)
+    n += c == '\n';
+  return n;
+}
+
+static void enqueue(std::string &&lines)
+{
+  unsigned long n = count_lines(lines);
+  std::lock_guard<std::mutex> lock(queue_mutex);
+  while (!queue.empty() && queue_bytes + lines.size() > queue_max)
+  {
+    unsigned long dropped = count_lines(queue.front());
+    dropped_lines += dropped;
+    queue_lines -= dropped;
+    queue_bytes -= queue.front().size();
+    queue.pop_front();
+  }
+  queue_bytes += lines.size();
+  queue_lines += n;
+  queue.push_back(std::move(lines));
+  queued_lines += n;
+  queue_cv.notify_one();
+}
+
+// Convert a telemetry message to tagged lines
+static void on_message(const std::string &topic, const uint8_t *payload, size_t size)
+{
+  messages++;
+  if (topic.compare(0, strlen(TOPIC_PREFIX), TOPIC_PREFIX) != 0)
+    return;
+  std::string device = topic.substr(strlen(TOPIC_PREFIX));
+  bool cbor = device.size() > 5 && device.compare(device.size() - 5, 5, "/cbor") == 0;
+  if (cbor)
+    device.resize(device.size() - 5);
+  if (device.empty() || device.find('/') != std::string::npos)
+    return;
+  std::string measurement = "measurement,device=" + device;
+  std::string out;
+
+  if (cbor)
+  {
+    std::vector<telemetry_point_t> samples;
+    if (!telemetry_decode(payload, size, samples))
+    {
+      invalid++;
+      return;
+    }
+    for (const telemetry_point_t &sample : samples)
+      out += telemetry_line(sample, measurement.c_str()) + "\n";
+  }
+  else
+  {
+    const char *p = (const char *)payload, *end = p + size;
+    while (p < end)
+    {
+      const char *eol = (const char *)memchr(p, '\n', end - p);
+      if (!eol)
+        eol = end;
+      const char *space = (const char *)memchr(p, ' ', eol - p);
+      if (space && space > p)
+      {
+        out += measurement; // replaces the measurement name of the firmware
+        out.append(space, eol - space);
+        out += '\n';
+      }
+      else if (eol > p)
+        invalid++;
+      p = eol + 1;
+    }
+  }
+  if (!out.empty())
+    enqueue(std::move(out));
+}
+
+// Sleep in slices, returns false as soon as the daemon stops
+static bool sleep_msec(long msec)
+{
+  for (long end = now_msec() + msec; !stopping && now_msec() < end;)
+    usleep(std::max(1L, std::min(end - now_msec(), (long)STOP_POLL_MSEC)) * 1000);
+  return !stopping;
+}
+
+static void receiver()
+{
+  MqttConnection mqtt;
+  mqtt.on_message(on_message);
+  long backoff = BACKOFF_MIN_MSEC;
+  std::string id = "diyPresso-ingest-" + std::to_string(getpid());
+  while (!stopping)
+  {
+    if (!mqtt.connect(broker, broker_port, id) || !mqtt.subscribe(TOPIC_PREFIX "+") ||
+        !mqtt.subscribe(TOPIC_PREFIX "+/cbor"))
+    {
+      fprintf(stderr, "ingest: cannot connect to %s:%d, retry in %ld msec\n", broker.c_str(), broker_port, backoff);
+      mqtt.close();
+      sleep_msec(backoff);
+      backoff = std::min(2 * backoff, (long)BACKOFF_MAX_MSEC);
+      continue;
+    }
+    fprintf(stderr, "ingest: subscribed on %s:%d\n", broker.c_str(), broker_port);
+    backoff = BACKOFF_MIN_MSEC;
+    while (!stopping && mqtt.poll(200) >= 0)
+      ;
+  }
+}
+
+// Take a batch from the queue: wait until there are enough lines, or the oldest line waited long enough
+static bool take(std::string &batch)
+{
+  std::unique_lock<std::mutex> lock(queue_mutex);
+  long deadline = now_msec() + batch_msec;
+  while (!stopping)
+  {
+    if (!queue.empty() && (queue_lines >= (size_t)batch_lines || now_msec() >= deadline))
+      break;
+    queue_cv.wait_for(lock, std::chrono::milliseconds(queue.empty() ? batch_msec : std::max(1L, deadline - now_msec())));
+    if (queue.empty())
+      deadline = now_msec() + batch_msec;
+  }
+  size_t n = 0;
+  while (!queue.empty() && n < (size_t)batch_lines)
+  {
+    unsigned long lines = count_lines(queue.front());
+    n += lines;
+    queue_lines -= lines;
+    batch += queue.front();
+    queue_bytes -= queue.front().size();
+    queue.pop_front();
+  }
+  return !batch.empty();
+}
+
+static void writer()
+{
+  InfluxWriter influx;
+  const char *token = getenv("INFLUX_TOKEN");
+  influx.url(influx_url);
+  influx.target(org, bucket, token ? token : "");
+  std::string batch;
+  while (take(batch) || !stopping)
+  {
+    if (batch.empty())
+      continue;
+    long backoff = BACKOFF_MIN_MSEC;
+    for (;;)
+    {
+      int status = influx.write(batch, compress);
+      if (status >= 200 && status < 300)
+      {
+        written_lines += count_lines(batch);
+        batches++;
+        raw_bytes += batch.size();
+        break;
+      }
+      if (status >= 400 && status < 500 && status != 429) // the data is rejected, a retry will not help
+      {
+        fprintf(stderr, "ingest: write rejected (%d): %s\n", status, influx.response().c_str());
+        rejected_lines += count_lines(batch);
+        break;
+      }
+      retries++;
+      if (verbose)
+        fprintf(stderr, "ingest: write failed (%d), retry in %ld msec\n", status, backoff);
+      if (!sleep_msec(backoff))
+        break;
+      backoff = std::min(2 * backoff, (long)BACKOFF_MAX_MSEC);
+    }
+    batch.clear();
+  }
+}
+
+// Only async-signal-safe: the main thread notices the flag and stops the threads
+static void stop(int)
+{
+  signaled = 1;
+}
+
+int main(int argc, char **argv)
+{
+  int opt;
+  while ((opt = getopt(argc, argv, "m:i:o:b:n:t:q:Zv")) != -1)
+    switch (opt)
+    {
+    case 'm':
+    {
+      broker = optarg;
+      size_t colon = broker.rfind(':');
+      if (colon != std::string::npos)
+      {
+        broker_port = atoi(broker.c_str() + colon + 1);
+        broker.resize(colon);
+      }
+      break;
+    }
+    case 'i': influx_url = optarg; break;
+    case 'o': org = optarg; break;
+    case 'b': bucket = optarg; break;
+    case 'n': batch_lines = std::max(1, atoi(optarg)); break;
+    case 't': batch_msec = std::max(1, atoi(optarg)); break;
+    case 'q': queue_max = (size_t)std::max(1, atoi(optarg)) << 20; break;
+    case 'Z': compress = false; break;
+    case 'v': verbose = true; break;
+    default:
+      fprintf(stderr, "usage: ingest [-m broker[:port]] [-i influx url] [-o org] [-b bucket] [-n batch lines] "
+                      "[-t batch msec] [-q queue MB] [-Z] [-v]\n");
+      return 1;
+    }
+  signal(SIGPIPE, SIG_IGN);
+  signal(SIGINT, stop);
+  signal(SIGTERM, stop);
+
+  std::thread rx(receiver), tx(writer);
+  long start = now_msec(), report = start;
+  unsigned long long prev = 0;
+  while (!signaled)
+  {
+    usleep(100000);
+    if (now_msec() - report < REPORT_MSEC)
+      continue;
+    double sec = (now_msec() - report) / 1000.0;
+    report = now_msec();
+    size_t depth;
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex);
+      depth = queue_bytes;
+    }
+    fprintf(stderr, "ingest: %llu messages, %llu lines written (%.0f/sec), %llu batches (%llu bytes), %llu dropped, "
+                    "%llu rejected, %llu retries, %llu invalid, queue %zu bytes\n",
+            (unsigned long long)messages, (unsigned long long)written_lines, (written_lines - prev) / sec,
+            (unsigned long long)batches, (unsigned long long)raw_bytes, (unsigned long long)dropped_lines, (unsigned long long)rejected_lines,
+            (unsigned long long)retries, (unsigned long long)invalid, depth);
+    prev = written_lines;
+  }
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex); // a writer between its check of stopping and its wait is notified
+    stopping = true;
+  }
+  queue_cv.notify_all();
+  rx.join();
+  tx.join();
+  fprintf(stderr, "ingest: %llu lines written in %.1f sec, %llu dropped\n", (unsigned long long)written_lines,
+          (now_msec() - start) / 1000.0, (unsigned long long)dropped_lines);
+  return 0;
+}
@@ -0,0 +1,313 @@
+/*
+  Host test and benchmark of ingest: mqtt_broker -> ingest -> influx_sink
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Starts mqtt_broker, influx_sink (writing the lines to a file) and ingest on local ports, and publishes the telemetry
+  of a fleet like the firmware: messages of TELEMETRY_DRAIN_BATCH samples, alternately line protocol and CBOR. Check:
+  - every sample arrives at the sink exactly once, tagged with the device of its topic;
+  - the same when 20 % of the writes are answered with 503: the batches are retried, none is written twice;
+  - SIGTERM while the writer is in its retry backoff (the sink is down) and while the receiver is in its reconnect
+    backoff (the broker is down): ingest exits cleanly within STOP_MSEC.
+
+  Benchmark: messages and lines per second from the publisher to the sink, and the CPU time of ingest per line.
+
+  usage: ingest_sim [broker port] [messages]
+*/
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "mqtt.h"
+#include "cbor_decoder.h"
+#include "../diyp-controller/dp_cbor.h"
+
+#define DEVICES 100
+#define SAMPLE_MSEC 100           // time between the samples of a device [msec]
+#define EPOCH_MSEC 1735689600000ULL
+#define LOAD_TIMEOUT_MSEC 60000   // max time for the samples to arrive at the sink [msec]
+#define BACKOFF_WAIT_MSEC 4000    // time in a backoff before the stop, the backoff is 1.6 sec or more by then [msec]
+#define STOP_MSEC 500             // max time for ingest to exit after SIGTERM [msec]
+
+static int errors = 0;
+
+static void check(bool ok, const char *what, long got = 0, long expect = 0)
+{
+  if (!ok && errors++ < 20)
+    printf("FAIL %s: %ld, expected %ld\n", what, got, expect);
+}
+
+static int broker_port, sink_port;
+static std::string sink_file;
+
+// Start a tool of this directory, its messages are discarded
+static pid_t spawn(std::vector<std::string> args)
+{
+  pid_t pid = fork();
+  if (pid == 0)
+  {
+    freopen("/dev/null", "w", stderr);
+    std::vector<char *> argv;
+    for (std::string &arg : args)
+      argv.push_back(&arg[0]);
+    argv.push_back(NULL);
+    execv(("./" + args[0]).c_str(), argv.data());
+    _exit(1);
+  }
+  return pid;
+}
+
+static void wait_listen(int port, const char *what)
+{
+  for (int i = 0; i < 200; i++)
+  {
+    int fd = tcp_connect("127.0.0.1", port);
+    if (fd >= 0)
+    {
+      close(fd);
+      return;
+    }
+    usleep(10000);
+  }
+  check(false, what);
+}
+
+static pid_t start_broker()
+{
+  pid_t pid = spawn({"mqtt_broker", std::to_string(broker_port), "256"}); // ingest must not lose messages
+  wait_listen(broker_port, "mqtt_broker listens");
+  return pid;
+}
+
+static pid_t start_sink(int fail_percent)
+{
+  pid_t pid = spawn({"influx_sink", std::to_string(sink_port), std::to_string(fail_percent), sink_file});
+  wait_listen(sink_port, "influx_sink listens");
+  return pid;
+}
+
+static pid_t start_ingest()
+{
+  return spawn({"ingest", "-m", "127.0.0.1:" + std::to_string(broker_port),
+                "-i", "http://127.0.0.1:" + std::to_string(sink_port), "-n", "1000", "-t", "100"});
+}
+
+static void kill_wait(pid_t pid)
+{
+  kill(pid, SIGKILL);
+  waitpid(pid, NULL, 0);
+}
+
+// Stop ingest, returns the time until it exited [msec], -1 if it did not exit cleanly
+static long stop(pid_t pid)
+{
+  long start = now_msec();
+  kill(pid, SIGTERM);
+  int status;
+  waitpid(pid, &status, 0);
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? now_msec() - start : -1;
+}
+
+// CPU time of a process [msec] (Linux)
+static long cpu_msec(pid_t pid)
+{
+  FILE *f = fopen(("/proc/" + std::to_string(pid) + "/stat").c_str(), "r");
+  unsigned long user = 0, system = 0;
+  if (f)
+  {
+    if (fscanf(f, "%*d %*s %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &user, &system) != 2)
+      user = system = 0;
+    fclose(f);
+  }
+  return (user + system) * 1000 / sysconf(_SC_CLK_TCK);
+}
+
+// The lines at the sink
+static FILE *sink_in;
+static std::string partial;
+static std::map<std::string, std::vector<int>> seen; // per device of the run: arrivals per sample
+static unsigned long received = 0, foreign = 0, probes = 0;
+
+// Read the lines the sink appended since the last call
+static void read_sink()
+{
+  char buf[65536];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), sink_in)) > 0)
+    partial.append(buf, n);
+  clearerr(sink_in);
+  size_t pos = 0, eol;
+  while ((eol = partial.find('\n', pos)) != std::string::npos)
+  {
+    partial[eol] = 0;
+    telemetry_point_t sample;
+    std::string device;
+    bool ok = telemetry_parse(&partial[pos], sample, &device);
+    pos = eol + 1;
+    if (ok && device == "probe")
+    {
+      probes++;
+      continue;
+    }
+    auto it = seen.find(device);
+    size_t index = sample.time / SAMPLE_MSEC;
+    if (ok && it != seen.end() && sample.time % SAMPLE_MSEC == 0 && index < it->second.size())
+      it->second[index]++, received++;
+    else
+      foreign++;
+  }
+  partial.erase(0, pos);
+}
+
+static telemetry_point_t make_sample(size_t index)
+{
+  telemetry_point_t sample = {};
+  sample.time = index * SAMPLE_MSEC;
+  sample.epoch = EPOCH_MSEC + sample.time;
+  sample.value[TM_T_SET] = 9300;
+  sample.value[TM_T_ACT] = 9280 + index % 40;
+  sample.value[TM_H_PWR] = index % 1000;
+  sample.value[TM_H_AVG] = 120;
+  sample.value[TM_R_LVL] = 800 - index / 100 % 100;
+  sample.value[TM_SHOTS] = index / 1000;
+  return sample;
+}
+
+// A message of the firmware with TELEMETRY_DRAIN_BATCH samples from index on
+static std::string message(size_t index, bool cbor)
+{
+  std::string out;
+  if (!cbor)
+  {
+    for (size_t i = index; i < index + TELEMETRY_DRAIN_BATCH; i++)
+      out += (i > index ? "\n" : "") + telemetry_line(make_sample(i), "diyPresso");
+    return out;
+  }
+  uint8_t buf[TELEMETRY_CBOR_SIZE];
+  CborWriter writer(buf, sizeof(buf));
+  TelemetryRing::cbor_begin(writer, EPOCH_MSEC);
+  telemetry_point_t prev;
+  for (size_t i = index; i < index + TELEMETRY_DRAIN_BATCH; i++)
+  {
+    telemetry_point_t s = make_sample(i);
+    TelemetryRing::cbor_sample(writer, s, i > index ? &prev : NULL);
+    prev = s;
+  }
+  writer.end();
+  check(writer.ok(), "CBOR message fits");
+  return std::string((const char *)writer.data(), writer.size());
+}
+
+// Publish probes until one arrives at the sink: ingest is subscribed
+static void wait_subscribed()
+{
+  MqttConnection mqtt;
+  unsigned long before = probes;
+  std::string probe = message(0, false);
+  for (long start = now_msec(); probes == before && now_msec() - start < 10000; usleep(50000))
+  {
+    if (!mqtt.connected())
+      mqtt.connect("127.0.0.1", broker_port, "ingest_sim-probe");
+    mqtt.publish("diyPressoOne/probe", probe.data(), probe.size());
+    mqtt.flush();
+    read_sink();
+  }
+  check(probes > before, "ingest subscribed");
+}
+
+// Publish messages round robin over the devices, each device alternates line protocol and CBOR
+static void publish(const std::string &run, long count)
+{
+  seen.clear();
+  received = foreign = 0;
+  for (int d = 0; d < DEVICES; d++)
+    seen[run + std::to_string(d)].assign((count / DEVICES + (d < count % DEVICES)) * TELEMETRY_DRAIN_BATCH, 0);
+  MqttConnection mqtt;
+  if (!mqtt.connect("127.0.0.1", broker_port, "ingest_sim"))
+  {
+    check(false, "publisher connects");
+    return;
+  }
+  for (long k = 0; k < count; k++)
+  {
+    long m = k / DEVICES;
+    std::string topic = "diyPressoOne/" + run + std::to_string(k % DEVICES), payload = message(m * TELEMETRY_DRAIN_BATCH, m % 2);
+    mqtt.publish(m % 2 ? topic + "/cbor" : topic, payload.data(), payload.size());
+  }
+  check(mqtt.flush(), "published");
+}
+
+// Publish, wait for the samples at the sink and check them
+static void test_load(const char *run, long count, pid_t ingest)
+{
+  long start = now_msec(), cpu = cpu_msec(ingest);
+  publish(run, count);
+  long published = now_msec() - start;
+  unsigned long expect = count * TELEMETRY_DRAIN_BATCH;
+  while (received < expect && now_msec() - start < LOAD_TIMEOUT_MSEC)
+  {
+    usleep(20000);
+    read_sink();
+  }
+  long msec = std::max(1L, now_msec() - start);
+  cpu = cpu_msec(ingest) - cpu;
+  usleep(200000); // late duplicates
+  read_sink();
+
+  long missing = 0, twice = 0;
+  for (auto &device : seen)
+    for (int n : device.second)
+      missing += n == 0, twice += n > 1;
+  check(received == expect, "samples at the sink", received, expect);
+  check(missing == 0, "samples missing", missing, 0);
+  check(twice == 0, "samples written twice", twice, 0);
+  check(foreign == 0, "lines of no sample", foreign, 0);
+  printf("%s: %ld messages (%lu samples) of %d devices published in %ld msec, at the sink in %ld msec: "
+         "%.0f messages/sec, %.0f lines/sec, ingest %.2f usec CPU per line\n",
+         run, count, expect, DEVICES, published, msec, count * 1000.0 / msec, expect * 1000.0 / msec,
+         cpu * 1000.0 / std::max(1UL, expect));
+}
+
+int main(int argc, char **argv)
+{
+  broker_port = argc > 1 ? atoi(argv[1]) : 18840;
+  sink_port = broker_port + 1;
+  long count = argc > 2 ? atol(argv[2]) : 20000;
+  sink_file = "/tmp/ingest_sim." + std::to_string(getpid());
+  fclose(fopen(sink_file.c_str(), "w"));
+  sink_in = fopen(sink_file.c_str(), "r");
+  signal(SIGPIPE, SIG_IGN);
+
+  pid_t broker = start_broker(), sink = start_sink(0), ingest = start_ingest();
+  wait_subscribed();
+  test_load("load", count, ingest);
+
+  kill_wait(sink);
+  sink = start_sink(20);
+  test_load("retry", count / 4, ingest);
+
+  kill_wait(sink); // the writer retries with a backoff
+  publish("backoff", DEVICES);
+  usleep(BACKOFF_WAIT_MSEC * 1000);
+  long write_stop = stop(ingest);
+  check(write_stop >= 0 && write_stop <= STOP_MSEC, "stop in the write backoff [msec]", write_stop, STOP_MSEC);
+
+  sink = start_sink(0);
+  ingest = start_ingest();
+  wait_subscribed();
+  kill_wait(broker); // the receiver reconnects with a backoff
+  usleep(BACKOFF_WAIT_MSEC * 1000);
+  long t = stop(ingest);
+  check(t >= 0 && t <= STOP_MSEC, "stop in the reconnect backoff [msec]", t, STOP_MSEC);
+  printf("stop: %ld msec in the write backoff, %ld msec in the reconnect backoff\n", write_stop, t);
+
+  kill_wait(sink);
+  fclose(sink_in);
+  unlink(sink_file.c_str());
+  printf("%d errors\n", errors);
+  return errors ? 1 : 0;
+}
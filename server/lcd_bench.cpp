@@ -0,0 +1,274 @@
+/*
+  Benchmark of the LCD updates: full rewrite vs. the shadow framebuffer (diyp-controller/dp_framebuffer.h) and the
+  asynchronous transport (diyp-controller/dp_lcd_bus.h)
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Renders the main, settings and brew screens of dp_menu.cpp with changing values at the frame rate cap of
+  Display::show() (DISPLAY_FRAME_MSEC), and counts what goes to the LCD per frame:
+  - full: every frame 4x setCursor + 20 characters through the hd44780 library, like show() did before. An LCD byte
+    (character or command) is a transaction of 5 I2C bytes, as hd44780_I2Cexp sends it to the PCF8574 in 4 bit
+    mode: the address and per nibble the data with E high and E low. The loop waits for all of it;
+  - diff: the runs of changed characters of FrameBuffer::update(), encoded by LcdFrame and sent by a mock of LcdBus:
+    busy for the time on the bus, show() skips the screen while it is. The loop does not wait.
+  Times are at WIRECLOCK (400 kHz, 9 bits per byte plus start and stop). The I2C bytes of LcdFrame go through an
+  emulated PCF8574 and HD44780 (4 bit mode, DDRAM address counter), every frame is checked to end up on the glass.
+
+  usage: lcd_bench [seconds per scenario]
+*/
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <string>
+#include "../diyp-controller/dp_lcd_bus.h"
+
+#define FRAME_MSEC 50       // DISPLAY_FRAME_MSEC
+#define ANIMATION_MSEC 100  // ANIMATION_REFRESH_RATE_MS
+#define I2C_PER_LCD_BYTE 5  // hd44780_I2Cexp: a transaction per LCD byte
+#define I2C_HZ 400000.0
+#define I2C_MSEC(bytes, transactions) (((bytes) * 9 + (transactions) * 2) / I2C_HZ * 1000)
+
+// The screens of dp_menu.cpp
+static const char *screen_main = "Boiler #####/#####\337C"
+                                 "Power    ### % ## # "
+                                 "############# #####s"
+                                 "Weight ##### gram # ";
+static const char *screen_setting = "SETTINGS     [##/##]"
+                                    "################### "
+                                    "  ########## #######"
+                                    "             [PRESS]";
+static const char *screen_modify = "MODIFY       [##/##]"
+                                   "################### "
+                                   "  ########## #######"
+                                   "              [TURN]";
+static const char *screen_brew = "STATE ############  "
+                                 "STEP-T ######## sec "
+                                 "BREW-T ######## sec "
+                                 "                    ";
+
+static const char *settings_names[] = {"Temperature", "Pre-infusion time", "Infusion time", "Extraction time",
+                                       "Extraction weight", "P-Gain", "I-Gain", "D-Gain", "FF-heat Value",
+                                       "FF-ready Value", "FF-brew Value", "Shot counter"};
+static const char *settings_units[] = {"\337C", "sec", "sec", "sec", "gram", "%/\337C", "%/\337C/s", "%s", "%", "%", "%",
+                                       "shots"};
+static const double settings_vals[] = {98, 3, 4, 25, 36, 6.2, 0.08, 70, 6, 6, 35, 1234};
+
+// Fill the placeholders, like Display::show() did (now View, dp_view.h)
+static void compose(const char *screen, const std::string *args, char *buf)
+{
+  int idx = 0;
+  size_t a = 0;
+  bool in_arg = false;
+  for (int i = 0; i < FB_SIZE; i++, screen++)
+  {
+    if (*screen != '#')
+    {
+      if (in_arg)
+        in_arg = false, idx++, a = 0;
+      buf[i] = *screen;
+    }
+    else
+    {
+      in_arg = true;
+      buf[i] = a < args[idx].size() ? args[idx][a++] : ' ';
+    }
+  }
+}
+
+static std::string num(double v, int decimals, int len = 0) // format_float()
+{
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%*.*f", len, decimals, v);
+  return buf;
+}
+
+// PCF8574 + HD44780 in 4 bit mode: a nibble on the falling edge of E, the DDRAM address counter
+struct lcd_t
+{
+  char ddram[128];
+  int address = 0, nibbles = 0;
+  uint8_t pins = 0, value = 0;
+  void receive(uint8_t b) // an I2C data byte to the expander
+  {
+    if ((pins & DISPLAY_PCF_EN) && !(b & DISPLAY_PCF_EN))
+    {
+      value = value << 4 | b >> 4;
+      if (++nibbles == 2)
+      {
+        nibbles = 0;
+        if (b & DISPLAY_PCF_RS)
+        {
+          ddram[address] = value;
+          address = address == 0x27 ? 0x40 : address == 0x67 ? 0x00 : address + 1;
+        }
+        else if (value & 0x80)
+          address = value & 0x7F;
+      }
+    }
+    pins = b;
+  }
+  bool shows(const char *buf)
+  {
+    static const int offsets[] = {0x00, 0x40, 0x14, 0x54};
+    for (int row = 0; row < FB_ROWS; row++)
+      if (memcmp(&ddram[offsets[row]], &buf[row * FB_COLS], FB_COLS) != 0)
+        return false;
+    return true;
+  }
+};
+
+// LcdBus: busy while the frame is on the bus
+struct mock_bus_t
+{
+  LcdFrame frame;
+  double until = 0; // [msec]
+  bool busy(double now) { return now < until; }
+  double send(double now) // returns the time on the bus [msec]
+  {
+    int transactions = (frame.length() + LCD_BUS_CHUNK - 1) / LCD_BUS_CHUNK;
+    double msec = I2C_MSEC(frame.length() + transactions, transactions);
+    until = now + msec;
+    return msec;
+  }
+};
+
+struct result_t
+{
+  long frames = 0, busy = 0, full = 0, diff = 0, i2c = 0;
+  double bus = 0, bus_max = 0; // [msec]
+};
+
+static bool frame(FrameBuffer &fb, mock_bus_t &bus, lcd_t &lcd, double now, const char *screen,
+                  const std::string *args, result_t &r)
+{
+  r.full += FB_ROWS * (FB_COLS + 1);
+  r.frames++;
+  if (bus.busy(now))
+  {
+    r.busy++;
+    return true;
+  }
+  char buf[FB_SIZE];
+  compose(screen, args, buf);
+  fb_run_t runs[FB_MAX_RUNS];
+  int n = fb.update(buf, runs);
+  bus.frame.clear();
+  for (int i = 0; i < n; i++)
+  {
+    if (runs[i].move)
+      bus.frame.cursor(runs[i].col, runs[i].row);
+    bus.frame.write(fb.glass() + runs[i].pos, runs[i].len);
+    r.diff += runs[i].len + runs[i].move;
+  }
+  if (n)
+  {
+    double msec = bus.send(now);
+    r.bus += msec;
+    r.bus_max = std::max(r.bus_max, msec);
+    r.i2c += bus.frame.length() + (bus.frame.length() + LCD_BUS_CHUNK - 1) / LCD_BUS_CHUNK;
+  }
+  for (int i = 0; i < bus.frame.length(); i++)
+    lcd.receive(bus.frame.bytes()[i]);
+  return lcd.shows(buf);
+}
+
+static void report(const char *name, const result_t &r)
+{
+  double full = (double)r.full / r.frames, diff = (double)r.diff / r.frames, i2c = (double)r.i2c / r.frames;
+  printf("%-14s %6ld %7.1f %6.0f %6.2f %7.1f %6.1f %6.3f %6.2f %5ld\n", name, r.frames, full, full * I2C_PER_LCD_BYTE,
+         I2C_MSEC(full * I2C_PER_LCD_BYTE, full), diff, i2c, r.bus / r.frames, r.bus_max, r.busy);
+}
+
+int main(int argc, char **argv)
+{
+  double seconds = argc > 1 ? atof(argv[1]) : 60;
+  long frames = (long)(seconds * 1000 / FRAME_MSEC);
+  bool ok = true;
+  printf("%-14s %6s %7s %6s %6s %7s %6s %6s %6s %5s\n", "", "", "full", "", "wait", "diff", "", "bus", "max", "busy");
+  printf("%-14s %6s %7s %6s %6s %7s %6s %6s %6s %5s\n", "scenario", "frames", "lcd B", "i2c B", "msec", "lcd B",
+         "i2c B", "msec", "msec", "skips");
+  for (int scenario = 0; scenario < 5; scenario++)
+  {
+    FrameBuffer fb;
+    mock_bus_t bus;
+    lcd_t lcd;
+    memset(lcd.ddram, ' ', sizeof(lcd.ddram));
+    result_t r;
+    const char *name = "";
+    srand(scenario + 1);
+    for (long f = 0; f < frames; f++)
+    {
+      double t = f * FRAME_MSEC / 1000.0;
+      long anim = f * FRAME_MSEC / ANIMATION_MSEC;
+      std::string args[10];
+      const char *screen = screen_main;
+      switch (scenario)
+      {
+      case 0: // main menu, ready: the temperature wobbles, the heater pulses at a few %
+      {
+        name = "main idle";
+        double power = 6 + 3 * sin(t / 20);
+        args[0] = num(98 + 0.15 * sin(t / 7) + 0.02 * (rand() % 3 - 1), 1, 5);
+        args[1] = num(98, 1);
+        args[2] = num(power, 0, 3);
+        args[3] = fmod(t, 1.0) < power / 100 ? "ON" : "";
+        args[5] = "idle";
+        args[6] = num(0, 1, 5);
+        args[7] = num(812 + (rand() % 20 == 0), 0, 5);
+        args[8] = "\5";
+        break;
+      }
+      case 1: // main menu during a shot: pump spinner, brew time, weight
+      {
+        name = "main shot";
+        double s = fmod(t, 40);
+        bool brew = s < 30;
+        args[0] = num(98 - (brew ? 2.5 * sin(s / 30 * M_PI) : 0), 1, 5);
+        args[1] = num(98, 1);
+        args[2] = num(brew ? 100 : 8, 0, 3);
+        args[3] = brew || fmod(t, 1.0) < 0.08 ? "ON" : "";
+        args[4] = brew && anim % 8 ? std::string(1, (char)(anim % 8)) : "";
+        args[5] = !brew ? "finished" : s < 3 ? "pre_infuse" : s < 7 ? "infuse" : "extract";
+        args[6] = num(brew ? s : 30, 1, 5);
+        args[7] = num(brew && s > 7 ? (s - 7) * 1.5 : 0, 0, 5);
+        args[8] = "\5";
+        break;
+      }
+      case 2: // settings: turn to the next item every second
+      case 3: // modify: turn the value every 250 msec
+      {
+        name = scenario == 2 ? "settings" : "settings mod.";
+        int n = sizeof(settings_vals) / sizeof(settings_vals[0]);
+        int idx = scenario == 2 ? (int)t % n : 0;
+        double value = settings_vals[idx] + (scenario == 3 ? 0.5 * (long)(t * 4) : 0);
+        screen = scenario == 2 ? screen_setting : screen_modify;
+        args[0] = num(idx + 1, 0, 2);
+        args[1] = num(20, 0);
+        args[2] = settings_names[idx];
+        args[3] = num(value, 2, 10);
+        args[4] = settings_units[idx];
+        break;
+      }
+      case 4: // brew screen
+      {
+        name = "brew";
+        double s = fmod(t, 40);
+        screen = screen_brew;
+        args[0] = s < 3 ? "pre_infuse" : s < 7 ? "infuse" : s < 30 ? "extract" : "finished";
+        args[1] = num(s < 3 ? s : s < 7 ? s - 3 : s < 30 ? s - 7 : s - 30, 1);
+        args[2] = num(s < 30 ? s : 30, 1);
+        break;
+      }
+      }
+      if (!frame(fb, bus, lcd, f * FRAME_MSEC, screen, args, r))
+      {
+        printf("%s: frame %ld is not on the glass\n", name, f);
+        ok = false;
+        break;
+      }
+    }
+    report(name, r);
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,260 @@
+/*
+  Host test of the declarative screens of the firmware (diyp-controller/dp_view.h) with a fake encoder
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Check: the values of the fields end up in their placeholders (aligned, padded, truncated), '#' without a field and a
+  short layout; the navigation of the settings list with the encoder (wraparound both ways, modify, read only items);
+  a screen with nothing new is not drawn and formats nothing.
+
+  Simulation: the main screen of dp_menu.cpp polled at the frame rate cap of the display (DISPLAY_FRAME_MSEC), idle
+  and while brewing, counts the frames drawn, the numbers formatted and the characters sent (FrameBuffer), against
+  the menus before: every field formatted and the screen drawn every poll.
+
+  usage: menu_sim [seconds per scenario]
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "../diyp-controller/dp_view.h"
+#include "../diyp-controller/dp_format.h"
+
+#define FRAME_MSEC 50      // DISPLAY_FRAME_MSEC
+#define ANIMATION_MSEC 100 // ANIMATION_REFRESH_RATE_MS
+
+static int errors = 0;
+
+static void check(bool ok, const char *what, const char *detail = "")
+{
+  if (!ok && errors++ < 20)
+    printf("FAIL %s %s\n", what, detail);
+}
+
+// The state of the fake machine
+static unsigned long now; // msec
+static double act = 93.04, set = 98, power = 0, brew = 0, weight = 1234.4;
+static bool heater, pump, busy;
+static const char *state = "idle";
+
+static double act_temp() { return act; }
+static double set_temp() { return set; }
+static double heater_power() { return power; }
+static const char *heater_on() { return heater ? "ON" : ""; }
+static const char *pump_spinner()
+{
+  static char s[2];
+  s[0] = pump ? "/-\\|"[now / ANIMATION_MSEC % 4] : 0;
+  return s;
+}
+static const char *brew_state() { return state; }
+static double brew_time() { return brew; }
+static double main_weight() { return weight; }
+static const char *level() { return "5"; }
+
+static const view_field_t main_fields[] = {
+    {act_temp, NULL, 1, 5}, {set_temp, NULL, 1, 0}, {heater_power, NULL, 0, 3}, {NULL, heater_on}, {NULL, pump_spinner},
+    {NULL, brew_state}, {brew_time, NULL, 1, 5}, {main_weight, NULL, 0, 5}, {NULL, level}};
+static const view_screen_t screen_main = {
+    // 01234567890123456789
+    "Boiler #####/#####\337C"
+    "Power    ### % ## # "
+    "############# #####s"
+    "Weight ##### gram # ",
+    main_fields, sizeof(main_fields) / sizeof(view_field_t)};
+
+// The settings list of dp_menu.cpp, in short
+static const char *labels[] = {"Temperature", "P-Gain", "Shot counter", "<EXIT>", "<SAVE>"};
+static const double steps[] = {0.5, 0.2, 0, 0, 0}; // 0: read only or a function
+static double values[] = {98, 6.2, 12, 0, 0};
+static ViewList nav(5);
+
+static double setting_number() { return nav.index() + 1; }
+static double setting_count() { return nav.count(); }
+static const char *setting_label() { return labels[nav.index()]; }
+static double setting_value() { return values[nav.index()]; }
+
+static const view_field_t setting_fields[] = {
+    {setting_number, NULL, 0, 2}, {setting_count, NULL, 0, 0}, {NULL, setting_label}, {setting_value, NULL, 2, 10}};
+static const view_screen_t screen_setting = {
+    // 01234567890123456789
+    "SETTINGS     [##/##]"
+    "################### "
+    "  ##########        "
+    "             [PRESS]",
+    setting_fields, sizeof(setting_fields) / sizeof(view_field_t)};
+
+// The input handling of menu_settings()
+static void settings_input(long encoder, bool pressed)
+{
+  int n = nav.turn(encoder);
+  if (n)
+    values[nav.index()] += steps[nav.index()] * n;
+  if (pressed && steps[nav.index()] != 0)
+    nav.press();
+}
+
+static void check_row(View &view, int row, const char *expect, const char *what)
+{
+  char got[FB_COLS + 1];
+  memcpy(got, view.text() + row * FB_COLS, FB_COLS);
+  got[FB_COLS] = 0;
+  check(!strcmp(got, expect), what, got);
+}
+
+static void test_fields()
+{
+  View view;
+  view.show(&screen_main);
+  check(view.update(), "first update draws");
+  check_row(view, 0, "Boiler  93.0/98.0 \337C", "main row 0");
+  check_row(view, 1, "Power      0 %      ", "main row 1");
+  check_row(view, 2, "idle            0.0s", "main row 2");
+  check_row(view, 3, "Weight  1234 gram 5 ", "main row 3");
+  view.drawn();
+
+  state = "a very long state name";
+  heater = true;
+  power = 100;
+  check(view.update(), "changed values are drawn");
+  check_row(view, 1, "Power    100 % ON   ", "main row 1 on");
+  check_row(view, 2, "a very long s   0.0s", "truncated text");
+  state = "idle";
+  heater = false;
+  power = 0;
+
+  static const view_field_t one[] = {{NULL, level}};
+  static const view_screen_t screen_short = {"## ##", one, 1};
+  view.show(&screen_short);
+  view.update();
+  check_row(view, 0, "5  ##               ", "'#' without a field");
+  check_row(view, 3, "                    ", "short layout");
+  check(strlen(view.text()) == FB_SIZE, "terminated");
+}
+
+static void test_navigation()
+{
+  View view;
+  long encoder = 0;
+  view.show(&screen_setting);
+  view.update();
+  check_row(view, 0, "SETTINGS     [ 1/5 ]", "item number");
+
+  for (int i = 0; i < 7; i++)
+    settings_input(++encoder, false);
+  check(nav.index() == 2, "turn right wraps around");
+  encoder -= 4;
+  settings_input(encoder, false);
+  check(nav.index() == 3, "turn left wraps around");
+  settings_input(encoder, true);
+  check(!nav.modify(), "a function is not modified");
+
+  encoder -= 3;
+  settings_input(encoder, false); // Temperature
+  settings_input(encoder, true);
+  check(nav.modify(), "press modifies");
+  encoder += 3;
+  settings_input(encoder, false);
+  check(nav.index() == 0 && values[0] == 99.5, "turn modifies");
+  view.update();
+  check_row(view, 1, "Temperature         ", "label");
+  check_row(view, 2, "       99.50        ", "value");
+  settings_input(encoder, true);
+  check(!nav.modify(), "press again selects");
+  settings_input(++encoder, false);
+  check(nav.index() == 1 && values[0] == 99.5, "turn selects");
+  view.update();
+  check_row(view, 0, "SETTINGS     [ 2/5 ]", "item number changed");
+  check_row(view, 1, "P-Gain              ", "next label");
+}
+
+static void test_lazy()
+{
+  View view;
+  view.show(&screen_main);
+  view.update();
+  view.drawn();
+  unsigned long renders = view.renders();
+  int drawn = 0;
+  for (int i = 0; i < 1000; i++)
+  {
+    act = 93.04 + (i % 2) * 0.001; // below the shown precision
+    drawn += view.update();
+  }
+  check(!drawn && view.renders() == renders, "idle: nothing drawn or formatted");
+  view.invalidate();
+  check(!view.update() && view.renders() == renders + 5, "invalidate formats the numbers, the text is the same");
+
+  brew = 0.15; // 0.1499999...: "0.1", not a tie
+  view.update();
+  brew = 0.2;
+  view.update();
+  check_row(view, 2, "idle            0.2s", "a value next to a tie");
+  brew = 0;
+  view.update();
+  view.drawn();
+  view.show(&screen_main);
+  check(!view.update(), "the same screen again: nothing new");
+}
+
+typedef struct
+{
+  unsigned long polls, drawn, formats, chars;
+} stats_t;
+
+// The main screen polled every frame for seconds, idle or brewing
+static stats_t simulate(double seconds, bool brewing, bool lazy)
+{
+  stats_t st = {0, 0, 0, 0};
+  View view;
+  FrameBuffer fb;
+  fb_run_t runs[FB_MAX_RUNS];
+  srand(1);
+  busy = pump = heater = brewing;
+  state = brewing ? "extracting" : "ready";
+  act = 98, power = 0, brew = 0, weight = brewing ? 0 : 1234;
+  view.show(&screen_main);
+  for (now = 0; now < seconds * 1000; now += FRAME_MSEC)
+  {
+    act = set + (rand() % 3 - 1) * (brewing ? 0.3 : 0.01); // noise of the sensor
+    if (brewing)
+    {
+      brew = now / 1000.0;
+      weight = brew * 1.5;
+      power = 35 + rand() % 10;
+      heater = now / 500 % 2;
+    }
+    st.polls++;
+    if (!lazy)
+      view.invalidate(); // format every field, draw every poll
+    if (view.update() || !lazy)
+    {
+      int n = fb.update(view.text(), runs);
+      for (int i = 0; i < n; i++)
+        st.chars += runs[i].len;
+      view.drawn();
+      st.drawn++;
+    }
+  }
+  st.formats = view.renders();
+  return st;
+}
+
+static void report(const char *name, double seconds, bool brewing)
+{
+  stats_t before = simulate(seconds, brewing, false), after = simulate(seconds, brewing, true);
+  printf("%-8s polls %6lu | every poll: drawn %6lu formats %7lu | lazy: drawn %6lu formats %7lu chars %6lu\n", name,
+         after.polls, before.drawn, before.formats, after.drawn, after.formats, after.chars);
+  check(after.chars == before.chars, "the same characters on the glass", name);
+  check(after.drawn < before.drawn && after.formats < before.formats, "lazy renders less", name);
+}
+
+int main(int argc, char **argv)
+{
+  double seconds = argc > 1 ? atof(argv[1]) : 600;
+  test_fields();
+  test_navigation();
+  test_lazy();
+  printf("checks: %d errors\n", errors);
+  report("idle", seconds, false);
+  report("brewing", seconds, true);
+  return errors ? 1 : 0;
+}
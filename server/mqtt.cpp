@@ -0,0 +1,295 @@
+/*
+  Minimal MQTT 3.1.1 client and packet codec (server side)
+  (c) 2025 diyPresso - CC-BY-NC
+*/
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include "mqtt.h"
+
+long now_msec()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+void mqtt_header(std::string &out, uint8_t type, uint8_t flags, size_t size)
+{
+  out += (char)((type << 4) | flags);
+  do // remaining length: 7 bits per byte, high bit set if more bytes follow
+  {
+    uint8_t b = size & 0x7F;
+    size >>= 7;
+    out += (char)(size ? b | 0x80 : b);
+  } while (size);
+}
+
+void mqtt_string(std::string &out, const std::string &s)
+{
+  out += (char)(s.size() >> 8);
+  out += (char)(s.size() & 0xFF);
+  out += s;
+}
+
+void mqtt_publish(std::string &out, const std::string &topic, const void *payload, size_t size)
+{
+  mqtt_header(out, MQTT_PUBLISH, 0, 2 + topic.size() + size);
+  mqtt_string(out, topic);
+  out.append((const char *)payload, size);
+}
+
+long mqtt_parse(const uint8_t *data, size_t size, mqtt_packet_t &packet)
+{
+  size_t length = 0, pos = 1;
+  for (int shift = 0;; shift += 7)
+  {
+    if (pos >= size)
+      return 0;
+    if (shift > 21)
+      return -1;
+    uint8_t b = data[pos++];
+    length |= (size_t)(b & 0x7F) << shift;
+    if (!(b & 0x80))
+      break;
+  }
+  if (pos + length > size)
+    return 0;
+  packet.type = data[0] >> 4;
+  packet.flags = data[0] & 0x0F;
+  packet.body = data + pos;
+  packet.size = length;
+  return pos + length;
+}
+
+bool mqtt_read_string(const mqtt_packet_t &packet, size_t &pos, std::string &s)
+{
+  if (pos + 2 > packet.size)
+    return false;
+  size_t n = (packet.body[pos] << 8) | packet.body[pos + 1];
+  if (pos + 2 + n > packet.size)
+    return false;
+  s.assign((const char *)packet.body + pos + 2, n);
+  pos += 2 + n;
+  return true;
+}
+
+bool mqtt_match(const std::string &filter, const std::string &topic)
+{
+  size_t f = 0, t = 0;
+  while (f < filter.size())
+  {
+    if (filter[f] == '#')
+      return true;
+    if (filter[f] == '+')
+    {
+      while (t < topic.size() && topic[t] != '/')
+        t++;
+      f++;
+      continue;
+    }
+    if (t >= topic.size() || filter[f] != topic[t])
+      return false;
+    f++;
+    t++;
+  }
+  return t == topic.size();
+}
+
+int tcp_connect(const std::string &host, int port)
+{
+  struct addrinfo hints, *result;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0)
+    return -1;
+  int fd = -1;
+  for (struct addrinfo *a = result; a; a = a->ai_next)
+  {
+    fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+    if (fd < 0)
+      continue;
+    if (::connect(fd, a->ai_addr, a->ai_addrlen) == 0)
+      break;
+    ::close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(result);
+  if (fd >= 0)
+  {
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  }
+  return fd;
+}
+
+bool MqttConnection::connect(const std::string &host, int port, const std::string &client_id, int keepalive)
+{
+  close();
+  if ((_fd = tcp_connect(host, port)) < 0)
+    return false;
+  _keepalive = keepalive;
+  std::string body("\x00\x04MQTT\x04\x02", 8); // protocol name and level, clean session
+  body += (char)(keepalive >> 8);
+  body += (char)(keepalive & 0xFF);
+  mqtt_string(body, client_id);
+  mqtt_header(_tx, MQTT_CONNECT, 0, body.size());
+  _tx += body;
+  return flush() && wait(MQTT_CONNACK, 5000);
+}
+
+bool MqttConnection::subscribe(const std::string &topic)
+{
+  std::string body;
+  _packet_id++;
+  body += (char)(_packet_id >> 8);
+  body += (char)(_packet_id & 0xFF);
+  mqtt_string(body, topic);
+  body += (char)0; // QoS 0
+  mqtt_header(_tx, MQTT_SUBSCRIBE, 2, body.size());
+  _tx += body;
+  return flush() && wait(MQTT_SUBACK, 5000);
+}
+
+bool MqttConnection::publish(const std::string &topic, const void *payload, size_t size)
+{
+  if (_fd < 0)
+    return false;
+  mqtt_publish(_tx, topic, payload, size);
+  if (_tx.size() > 65536)
+    return flush();
+  return true;
+}
+
+// Write the buffered packets, waits while the socket buffer is full
+bool MqttConnection::flush()
+{
+  size_t pos = 0;
+  while (_fd >= 0 && pos < _tx.size())
+  {
+    ssize_t n = send(_fd, _tx.data() + pos, _tx.size() - pos, MSG_NOSIGNAL);
+    if (n > 0)
+    {
+      pos += n;
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+      struct pollfd p = {_fd, POLLOUT, 0};
+      ::poll(&p, 1, 1000);
+      continue;
+    }
+    close();
+    return false;
+  }
+  if (pos)
+    _last_tx = now_msec();
+  _tx.erase(0, pos);
+  return _fd >= 0;
+}
+
+// Read what is available and dispatch the messages, returns -1 if the connection is lost
+int MqttConnection::receive(uint8_t wait_type)
+{
+  uint8_t buf[65536];
+  int messages = 0;
+  for (;;)
+  {
+    ssize_t n = recv(_fd, buf, sizeof(buf), 0);
+    if (n > 0)
+    {
+      _rx.insert(_rx.end(), buf, buf + n);
+      if (n == sizeof(buf))
+        continue;
+      break;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      break;
+    close();
+    return -1;
+  }
+
+  bool seen = false;
+  mqtt_packet_t packet;
+  long n;
+  while ((n = mqtt_parse(_rx.data() + _rx_pos, _rx.size() - _rx_pos, packet)) > 0)
+  {
+    _rx_pos += n;
+    if (packet.type == wait_type)
+      seen = true;
+    if (packet.type == MQTT_CONNACK && (packet.size < 2 || packet.body[1] != 0))
+    {
+      close(); // connection refused
+      return -1;
+    }
+    if (packet.type != MQTT_PUBLISH)
+      continue;
+    size_t pos = 0;
+    std::string topic;
+    if (!mqtt_read_string(packet, pos, topic))
+      continue;
+    if (packet.flags & 0x06)
+      pos += 2; // packet id of QoS 1 and 2, we only subscribe with QoS 0
+    if (_handler && pos <= packet.size)
+      _handler(topic, packet.body + pos, packet.size - pos);
+    messages++;
+  }
+  if (n < 0)
+  {
+    close();
+    return -1;
+  }
+  _rx.erase(_rx.begin(), _rx.begin() + _rx_pos);
+  _rx_pos = 0;
+  if (wait_type)
+    return seen ? 1 : 0;
+  return messages;
+}
+
+bool MqttConnection::wait(uint8_t type, int timeout_msec)
+{
+  long end = now_msec() + timeout_msec;
+  while (_fd >= 0 && now_msec() < end)
+  {
+    struct pollfd p = {_fd, POLLIN, 0};
+    if (::poll(&p, 1, 100) > 0 && receive(type) > 0)
+      return true;
+  }
+  return false;
+}
+
+int MqttConnection::poll(int timeout_msec)
+{
+  if (_fd < 0 || !flush())
+    return -1;
+  if (now_msec() - _last_tx > _keepalive * 500L)
+  {
+    mqtt_header(_tx, MQTT_PINGREQ, 0, 0);
+    if (!flush())
+      return -1;
+  }
+  struct pollfd p = {_fd, POLLIN, 0};
+  if (::poll(&p, 1, timeout_msec) <= 0)
+    return 0;
+  return receive();
+}
+
+void MqttConnection::close()
+{
+  if (_fd < 0)
+    return;
+  ::close(_fd);
+  _fd = -1;
+  _tx.clear();
+  _rx.clear();
+  _rx_pos = 0;
+}
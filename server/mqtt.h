@@ -0,0 +1,75 @@
+/*
+  Minimal MQTT 3.1.1 client and packet codec (server side)
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Only what the server tools need: QoS 0 publish and subscribe over plain TCP, keep alive. The connection keeps one
+  socket open; published messages are buffered and written by flush() or poll(). The packet codec is shared with the
+  stand-in broker (mqtt_broker.cpp).
+*/
+#ifndef MQTT_H
+#define MQTT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include <functional>
+
+enum { MQTT_CONNECT = 1, MQTT_CONNACK, MQTT_PUBLISH, MQTT_PUBACK, MQTT_PUBREC, MQTT_PUBREL, MQTT_PUBCOMP,
+       MQTT_SUBSCRIBE, MQTT_SUBACK, MQTT_UNSUBSCRIBE, MQTT_UNSUBACK, MQTT_PINGREQ, MQTT_PINGRESP, MQTT_DISCONNECT };
+
+typedef struct
+{
+  uint8_t type, flags;
+  const uint8_t *body; // variable header and payload
+  size_t size;
+} mqtt_packet_t;
+
+// Append a packet with a fixed header to out
+void mqtt_header(std::string &out, uint8_t type, uint8_t flags, size_t size);
+void mqtt_string(std::string &out, const std::string &s);
+void mqtt_publish(std::string &out, const std::string &topic, const void *payload, size_t size);
+
+// Parse one packet from the start of data, returns its total size, 0 if it is incomplete or -1 if it is invalid
+long mqtt_parse(const uint8_t *data, size_t size, mqtt_packet_t &packet);
+
+// Read a string at pos of a packet body, false if it does not fit
+bool mqtt_read_string(const mqtt_packet_t &packet, size_t &pos, std::string &s);
+
+// Topic filter with + and # wildcards
+bool mqtt_match(const std::string &filter, const std::string &topic);
+
+int tcp_connect(const std::string &host, int port); // returns the socket or -1
+
+class MqttConnection
+{
+public:
+  typedef std::function<void(const std::string &topic, const uint8_t *payload, size_t size)> handler_t;
+
+  ~MqttConnection() { close(); }
+  bool connect(const std::string &host, int port, const std::string &client_id, int keepalive = 30);
+  bool subscribe(const std::string &topic);
+  bool publish(const std::string &topic, const void *payload, size_t size); // buffered, see flush()
+  bool flush();
+  int poll(int timeout_msec); // flush, receive and dispatch messages; returns the number of messages, -1 if lost
+  void close();
+  bool connected() { return _fd >= 0; }
+  void on_message(handler_t handler) { _handler = handler; }
+  size_t pending() { return _tx.size(); } // buffered bytes
+  int fd() { return _fd; }
+
+private:
+  int _fd = -1, _keepalive = 30;
+  uint16_t _packet_id = 0;
+  std::string _tx;
+  std::vector<uint8_t> _rx;
+  size_t _rx_pos = 0;
+  long _last_tx = 0;
+  handler_t _handler;
+  bool wait(uint8_t type, int timeout_msec); // wait for a CONNACK or SUBACK
+  int receive(uint8_t wait_type = 0);
+};
+
+long now_msec(); // monotonic time [msec]
+
+#endif // MQTT_H
@@ -0,0 +1,260 @@
+/*
+  mqtt_broker: minimal stand-in MQTT broker for local tests and benchmarks
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Single threaded (epoll), QoS 0 only, no retained messages, no authentication. Subscriptions support the + and #
+  wildcards. Messages for a subscriber that does not keep up are dropped when its send buffer exceeds the limit.
+
+  Usage: mqtt_broker [port] [max send buffer MB]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <map>
+#include <set>
+#include "mqtt.h"
+
+struct client_t
+{
+  int fd;
+  std::vector<uint8_t> rx;
+  std::string tx;
+  std::vector<std::string> filters;
+  bool writing = false, closed = false;
+};
+
+static std::map<int, client_t *> clients;
+static std::set<client_t *> subscribers;
+static int epfd;
+static size_t max_tx = 256 << 20;
+static unsigned long long published = 0, delivered = 0, dropped = 0;
+
+static std::vector<client_t *> closing; // deleted after the events of one epoll_wait() are handled
+
+static void drop(client_t *c)
+{
+  if (c->closed)
+    return;
+  epoll_ctl(epfd, EPOLL_CTL_DEL, c->fd, NULL);
+  close(c->fd);
+  subscribers.erase(c);
+  clients.erase(c->fd);
+  c->closed = true;
+  closing.push_back(c);
+}
+
+static void watch(client_t *c, int op, uint32_t events)
+{
+  struct epoll_event ev;
+  ev.events = events;
+  ev.data.ptr = c;
+  epoll_ctl(epfd, op, c->fd, &ev);
+}
+
+// Write as much as possible, wait for EPOLLOUT if the socket buffer is full
+static bool write_out(client_t *c)
+{
+  size_t pos = 0;
+  while (pos < c->tx.size())
+  {
+    ssize_t n = send(c->fd, c->tx.data() + pos, c->tx.size() - pos, MSG_NOSIGNAL);
+    if (n > 0)
+      pos += n;
+    else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      break;
+    else
+      return false;
+  }
+  c->tx.erase(0, pos);
+  bool writing = !c->tx.empty();
+  if (writing != c->writing)
+  {
+    watch(c, EPOLL_CTL_MOD, EPOLLIN | (writing ? EPOLLOUT : 0));
+    c->writing = writing;
+  }
+  return true;
+}
+
+static void route(const std::string &topic, const mqtt_packet_t &packet, size_t payload)
+{
+  published++;
+  for (client_t *s : subscribers)
+    for (const std::string &filter : s->filters)
+      if (mqtt_match(filter, topic))
+      {
+        if (s->tx.size() > max_tx)
+        {
+          dropped++;
+          break;
+        }
+        mqtt_publish(s->tx, topic, packet.body + payload, packet.size - payload);
+        delivered++;
+        break;
+      }
+}
+
+// Handle a packet of a client, returns false to close the connection
+static bool handle(client_t *c, const mqtt_packet_t &packet)
+{
+  size_t pos = 0;
+  std::string s;
+  switch (packet.type)
+  {
+  case MQTT_CONNECT:
+    c->tx += std::string("\x20\x02\x00\x00", 4);
+    return true;
+  case MQTT_SUBSCRIBE:
+  {
+    if (packet.size < 2)
+      return false;
+    std::string ack(packet.body, packet.body + 2); // packet id
+    pos = 2;
+    while (mqtt_read_string(packet, pos, s) && pos < packet.size)
+    {
+      c->filters.push_back(s);
+      pos++; // requested QoS
+      ack += (char)0;
+    }
+    mqtt_header(c->tx, MQTT_SUBACK, 0, ack.size());
+    c->tx += ack;
+    subscribers.insert(c);
+    return true;
+  }
+  case MQTT_PUBLISH:
+    if (!mqtt_read_string(packet, pos, s))
+      return false;
+    if (packet.flags & 0x06)
+      pos += 2;
+    if (pos > packet.size)
+      return false;
+    route(s, packet, pos);
+    if ((packet.flags & 0x06) == 0x02) // QoS 1: acknowledge
+    {
+      mqtt_header(c->tx, MQTT_PUBACK, 0, 2);
+      c->tx.append((const char *)packet.body + pos - 2, 2);
+    }
+    return true;
+  case MQTT_PINGREQ:
+    mqtt_header(c->tx, MQTT_PINGRESP, 0, 0);
+    return true;
+  case MQTT_DISCONNECT:
+    return false;
+  default:
+    return true;
+  }
+}
+
+static bool read_in(client_t *c)
+{
+  uint8_t buf[65536];
+  bool open = true;
+  for (;;)
+  {
+    ssize_t n = recv(c->fd, buf, sizeof(buf), 0);
+    if (n > 0)
+    {
+      c->rx.insert(c->rx.end(), buf, buf + n);
+      continue;
+    }
+    open = n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    break;
+  }
+  size_t pos = 0; // the packets before a close are handled: a client may publish and disconnect at once
+  mqtt_packet_t packet;
+  long n;
+  while ((n = mqtt_parse(c->rx.data() + pos, c->rx.size() - pos, packet)) > 0)
+  {
+    pos += n;
+    if (!handle(c, packet))
+      return false;
+  }
+  if (n < 0)
+    return false;
+  c->rx.erase(c->rx.begin(), c->rx.begin() + pos);
+  return open;
+}
+
+int main(int argc, char **argv)
+{
+  int port = argc > 1 ? atoi(argv[1]) : 1883;
+  if (argc > 2)
+    max_tx = (size_t)atoi(argv[2]) << 20;
+  signal(SIGPIPE, SIG_IGN);
+
+  int lfd = socket(AF_INET6, SOCK_STREAM, 0), one = 1, zero = 0;
+  setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  setsockopt(lfd, IPPROTO_IPV6, IPV6_V6ONLY, &zero, sizeof(zero));
+  struct sockaddr_in6 addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin6_family = AF_INET6;
+  addr.sin6_addr = in6addr_any;
+  addr.sin6_port = htons(port);
+  if (bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(lfd, 4096) < 0)
+  {
+    perror("mqtt_broker");
+    return 1;
+  }
+  fcntl(lfd, F_SETFL, O_NONBLOCK);
+  epfd = epoll_create1(0);
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.ptr = NULL;
+  epoll_ctl(epfd, EPOLL_CTL_ADD, lfd, &ev);
+  fprintf(stderr, "mqtt_broker: listening on port %d\n", port);
+
+  long report = now_msec();
+  struct epoll_event events[256];
+  for (;;)
+  {
+    int n = epoll_wait(epfd, events, 256, 1000);
+    for (int i = 0; i < n; i++)
+    {
+      client_t *c = (client_t *)events[i].data.ptr;
+      if (c && c->closed)
+        continue;
+      if (!c) // new connections
+      {
+        int fd;
+        while ((fd = accept(lfd, NULL, NULL)) >= 0)
+        {
+          fcntl(fd, F_SETFL, O_NONBLOCK);
+          setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+          c = new client_t;
+          c->fd = fd;
+          clients[fd] = c;
+          watch(c, EPOLL_CTL_ADD, EPOLLIN);
+        }
+        continue;
+      }
+      if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !read_in(c))
+      {
+        drop(c);
+        continue;
+      }
+      if (!write_out(c))
+        drop(c);
+    }
+    // deliver the routed messages
+    for (client_t *s : std::set<client_t *>(subscribers))
+      if (!s->tx.empty() && !s->writing && !write_out(s))
+        drop(s);
+    for (client_t *c : closing)
+      delete c;
+    closing.clear();
+
+    if (now_msec() - report >= 10000)
+    {
+      report = now_msec();
+      fprintf(stderr, "mqtt_broker: %zu clients, %llu published, %llu delivered, %llu dropped\n", clients.size(),
+              published, delivered, dropped);
+    }
+  }
+}
@@ -0,0 +1,42 @@
+# Send a command to a diyPresso on the MQTT command topic and print the response and the round trip time
+# usage: python3 mqtt_cmd.py <mac> "GET info" [repeat]
+import sys
+import time
+import paho.mqtt.client as mqtt
+
+broker = "test.mosquitto.org"
+topic = "diyPressoOne/" + sys.argv[1].replace(":", "").upper()
+command = sys.argv[2]
+repeat = int(sys.argv[3]) if len(sys.argv) > 3 else 1
+
+reply = {}
+
+def on_message(client, userdata, msg):
+	lines = msg.payload.decode().splitlines()
+	if lines and lines[0].startswith("id="):
+		reply[lines[0][3:]] = (time.time(), lines[1:])
+
+client = mqtt.Client()
+client.on_message = on_message
+client.connect(broker, 1883)
+client.subscribe(topic + "/reply")
+client.loop_start()
+time.sleep(1) # wait for the SUBACK
+
+times = []
+for id in range(1, repeat + 1):
+	start = time.time()
+	client.publish(topic + "/cmd", "%d %s" % (id, command))
+	while str(id) not in reply and time.time() - start < 5:
+		time.sleep(0.001)
+	if str(id) not in reply:
+		print("%d: no reply" % id)
+		continue
+	end, lines = reply[str(id)]
+	times.append((end - start) * 1000)
+	if id == 1:
+		print("\n".join(lines))
+
+if times:
+	print("round trip: %d replies, min %.1f, avg %.1f, max %.1f msec" % (len(times), min(times), sum(times) / len(times), max(times)))
+client.loop_stop()
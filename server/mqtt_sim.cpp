@@ -0,0 +1,439 @@
+/*
+  Fault-injection host test of the MQTT session of the firmware (diyp-controller/dp_mqtt.cpp) against mqtt_broker
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Runs WifiManager and MqttDevice of the firmware on the emulated NINA module of arduino/WiFiNINA.h in real time: the
+  DNS lookup of the module is emulated, the TCP connections are real and go through a proxy to a mqtt_broker started
+  by the test. The proxy injects the network faults; a monitor client on the broker sees the status messages.
+  Check, with the loop of the firmware running every msec:
+  - a failed DNS lookup is retried after the backoff, a slow one (3 sec) does not stop the loop;
+  - a CONNACK held back by 2 sec, one that never comes (the CONNACK timeout), a refused connection;
+  - a SUBACK held back by 2 sec and one that never comes: the session starts at once, the missing one is counted
+    after MQTT_SUBACK_TIMEOUT_MSEC; commands get their reply, an unknown one "unknown command";
+  - a connection that is never established (SYN dropped: the connect timeout);
+  - the session cut by the network, the broker killed and restarted, the Wifi link lost;
+  each ends in a new session ("online" at the monitor), and no run() takes longer than MQTT_POLL_MSEC: no command is
+  sent to the module while its DNS lookup runs (blocked_msec stays 0) and no step waits for the broker.
+
+  Benchmark: the round trip of a command (GET version) from a client of the broker to the reply it receives, with
+  the firmware loop passing every msec.
+
+  usage: mqtt_sim [broker port] [commands]
+*/
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include "mqtt.h"
+#include "../diyp-controller/dp_wifi.h"
+#include "../diyp-controller/dp_mqtt.h"
+#include "../diyp-controller/dp_serial.h"
+
+#define PROXY_FOREVER 1000000000L // [msec] a delay of the proxy that does not end
+
+static int errors = 0;
+
+static void check(bool ok, const char *what, long got = 0, long expect = 0)
+{
+  if (!ok && errors++ < 20)
+    printf("FAIL %s: %ld, expected %ld\n", what, got, expect);
+}
+
+// The serial commands (dp_serial.cpp), as far as the MQTT commands need them
+DpSerial dpSerial(115200);
+DpSerial::DpSerial(unsigned long baudRate) : _baudRate(baudRate) {}
+bool DpSerial::execute(const String &command, Print &out)
+{
+  if (!(command == "GET version"))
+    return false;
+  out.println("version=" SOFTWARE_VERSION);
+  return true;
+}
+
+// The broker
+static int broker_port;
+static pid_t broker = 0;
+
+static void start_broker()
+{
+  broker = fork();
+  if (broker == 0)
+  {
+    freopen("/dev/null", "w", stderr);
+    execl("./mqtt_broker", "mqtt_broker", std::to_string(broker_port).c_str(), (char *)NULL);
+    _exit(1);
+  }
+  for (int i = 0; i < 200; i++) // until it listens
+  {
+    int fd = tcp_connect("127.0.0.1", broker_port);
+    if (fd >= 0)
+    {
+      close(fd);
+      return;
+    }
+    usleep(10000);
+  }
+  check(false, "mqtt_broker listens");
+}
+
+static void stop_broker()
+{
+  kill(broker, SIGTERM);
+  waitpid(broker, NULL, 0);
+  broker = 0;
+}
+
+// The network between the device and the broker
+static std::atomic<long> delay_msec(0); // data of the broker is passed on after this delay
+static std::atomic<long> delay_from(0); // the first bytes of a connection are not delayed (4: the CONNACK)
+static std::atomic<int> refuse(0);      // answer a new connection with a CONNACK with this code
+static std::atomic<int> cuts(0);        // cut the connections
+static std::atomic<bool> proxy_stop(false);
+
+struct link_t
+{
+  int dev, brk;
+  std::vector<std::pair<long, std::string>> held; // data of the broker, due at
+  long received;                                  // bytes of the broker
+};
+
+static void proxy(int lfd)
+{
+  std::vector<link_t> links;
+  int cut = 0;
+  while (!proxy_stop)
+  {
+    std::vector<struct pollfd> fds = {{lfd, POLLIN, 0}};
+    for (link_t &l : links)
+    {
+      fds.push_back({l.dev, POLLIN, 0});
+      fds.push_back({l.brk, POLLIN, 0});
+    }
+    poll(fds.data(), fds.size(), 1);
+    if (fds[0].revents & POLLIN)
+    {
+      int dev = accept(lfd, NULL, NULL);
+      if (refuse)
+      {
+        uint8_t connack[4] = {0x20, 0x02, 0x00, (uint8_t)refuse};
+        send(dev, connack, 4, MSG_NOSIGNAL);
+        shutdown(dev, SHUT_WR);
+        links.push_back({dev, -1, {}, 0});
+      }
+      else
+      {
+        int brk = tcp_connect("127.0.0.1", broker_port);
+        if (brk >= 0)
+          links.push_back({dev, brk, {}, 0});
+        else // the broker is down
+          close(dev);
+      }
+    }
+    bool cutting = cut != cuts;
+    cut = cuts;
+    long now = now_msec();
+    for (size_t i = 0; i < links.size(); i++)
+    {
+      link_t &l = links[i];
+      char buf[4096];
+      bool closed = cutting;
+      ssize_t n = -1;
+      while (!closed && (n = recv(l.dev, buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+        if (l.brk >= 0) // refused: the data is dropped until the device closes
+          send(l.brk, buf, n, MSG_NOSIGNAL);
+      closed |= n == 0;
+      while (!closed && l.brk >= 0 && (n = recv(l.brk, buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+      {
+        long direct = std::max(0L, std::min((long)n, delay_from - l.received));
+        if (direct)
+          l.held.push_back({now, std::string(buf, direct)});
+        if (n > direct)
+          l.held.push_back({now + delay_msec, std::string(buf + direct, n - direct)});
+        l.received += n;
+      }
+      closed |= n == 0;
+      while (!closed && !l.held.empty() && l.held.front().first <= now) // in order
+      {
+        send(l.dev, l.held.front().second.data(), l.held.front().second.size(), MSG_NOSIGNAL);
+        l.held.erase(l.held.begin());
+      }
+      if (closed)
+      {
+        close(l.dev);
+        if (l.brk >= 0)
+          close(l.brk);
+        links.erase(links.begin() + i--);
+      }
+    }
+  }
+}
+
+// The monitor: subscribed to the topics of the device
+static MqttConnection monitor;
+static int online = 0, offline = 0;
+static std::string reply; // the last message on the reply topic
+static long reply_usec = 0;
+
+static void monitor_poll()
+{
+  if (!monitor.connected())
+  {
+    if (!broker || !monitor.connect("127.0.0.1", broker_port, "mqtt_sim-monitor"))
+      return;
+    monitor.on_message([](const std::string &topic, const uint8_t *payload, size_t size) {
+      std::string text((const char *)payload, size);
+      if (topic.size() > 7 && topic.compare(topic.size() - 7, 7, "/status") == 0)
+        text == "online" ? online++ : offline++;
+      if (topic.size() > 6 && topic.compare(topic.size() - 6, 6, MQTT_REPLY_TOPIC) == 0)
+        reply = text, reply_usec = host_usec();
+    });
+    monitor.subscribe(MQTT_TOPIC "#");
+  }
+  monitor.poll(0);
+}
+
+// The loop of the firmware
+static NinaHost &nina = nina_host();
+static unsigned long max_run_usec = 0;
+
+static void step()
+{
+  unsigned long long start = host_usec();
+  wifiManager.run();
+  mqttDevice.run();
+  max_run_usec = std::max(max_run_usec, (unsigned long)(host_usec() - start));
+  monitor_poll();
+  usleep(1000);
+}
+
+// Run the loop until the state is reached, returns the time it took [msec] or -1
+static long run_until(const char *state, long max_msec)
+{
+  unsigned long start = millis();
+  while (millis() - start <= (unsigned long)max_msec)
+  {
+    if (strcmp(mqttDevice.get_state_name(), state) == 0)
+      return millis() - start;
+    step();
+  }
+  printf("  still %s after %ld msec, expected %s\n", mqttDevice.get_state_name(), max_msec, state);
+  return -1;
+}
+
+// Run the loop until the monitor saw the next "online", returns the time it took [msec] or -1
+static long run_online(long max_msec)
+{
+  unsigned long start = millis();
+  int seen = online;
+  while (millis() - start <= (unsigned long)max_msec)
+  {
+    if (online > seen)
+      return millis() - start;
+    step();
+  }
+  printf("  no session after %ld msec, in state %s\n", max_msec, mqttDevice.get_state_name());
+  return -1;
+}
+
+static void test_dns()
+{
+  nina.dns_fail = true;
+  mqttDevice.begin();
+  check(run_until("backoff", 5000) >= 0, "DNS failure: backoff");
+  check(nina.lookups == 1 && mqttDevice.connect_errors() == 1, "DNS failure: one lookup, one error", nina.lookups, 1);
+  nina.dns_fail = false;
+  nina.dns_msec = 3000;
+  check(run_until("resolve", 2000) >= 0, "retry");
+  long t = run_until("connect", 5000);
+  check(t >= 2900, "slow DNS: the lookup takes [msec]", t, nina.dns_msec);
+  check(run_online(2000) >= 0, "session after the slow DNS");
+  nina.dns_msec = 50;
+}
+
+static void test_connack()
+{
+  delay_msec = 2000;
+  cuts++;
+  check(run_until("connack", 5000) >= 0, "CONNACK held: waiting for it");
+  long t = run_online(5000);
+  check(t >= 1900, "CONNACK held by 2 sec [msec]", t, 2000);
+  check(mqttDevice.connect_duration() >= 2000, "connect duration [msec]", mqttDevice.connect_duration(), 2000);
+
+  unsigned long connect_errors = mqttDevice.connect_errors();
+  delay_msec = PROXY_FOREVER;
+  cuts++;
+  check(run_until("connack", 5000) >= 0, "no CONNACK: waiting for it");
+  t = run_until("backoff", MQTT_CONNACK_TIMEOUT_MSEC + 1000);
+  check(t >= MQTT_CONNACK_TIMEOUT_MSEC - 100, "CONNACK timeout [msec]", t, MQTT_CONNACK_TIMEOUT_MSEC);
+  check(mqttDevice.connect_errors() == connect_errors + 1, "CONNACK timeout counted");
+  delay_msec = 0;
+  check(run_online(5000) >= 0, "session after the CONNACK timeout");
+
+  connect_errors = mqttDevice.connect_errors();
+  refuse = 5; // not authorized
+  cuts++;
+  check(run_until("connack", 5000) >= 0 && run_until("backoff", 1000) >= 0, "refused");
+  check(mqttDevice.connect_errors() == connect_errors + 1, "refusal counted");
+  refuse = 0;
+  check(run_online(5000) >= 0, "session after the refusal");
+}
+
+static void test_suback()
+{
+  unsigned long subscribe_errors = mqttDevice.subscribe_errors();
+  delay_from = 4 + 4; // the CONNACK and the PUBACK of "online"
+  delay_msec = 2000;
+  cuts++;
+  check(run_online(5000) >= 0, "SUBACK held: the session is up");
+  for (int i = 0; i < 3000; i++)
+    step();
+  check(mqttDevice.subscribe_errors() == subscribe_errors, "SUBACK after 2 sec: subscribed");
+
+  delay_msec = PROXY_FOREVER;
+  cuts++;
+  long t = run_online(5000);
+  check(t >= 0, "no SUBACK: the session is up");
+  unsigned long start = millis();
+  while (mqttDevice.subscribe_errors() == subscribe_errors && millis() - start < MQTT_SUBACK_TIMEOUT_MSEC + 1000)
+    step();
+  t = millis() - start;
+  check(mqttDevice.subscribe_errors() == subscribe_errors + 1, "SUBACK timeout counted");
+  check(t >= MQTT_SUBACK_TIMEOUT_MSEC - 100, "SUBACK timeout [msec]", t, MQTT_SUBACK_TIMEOUT_MSEC);
+  delay_msec = 0;
+  delay_from = 0;
+  cuts++;
+  check(run_online(5000) >= 0, "session after the SUBACK timeout");
+}
+
+// Send a command from the monitor and run the loop until the reply came, returns the round trip [usec] or -1
+static long command(const std::string &id, const std::string &cmd)
+{
+  std::string text = id + " " + cmd, topic = std::string(mqttDevice.topic()) + MQTT_CMD_TOPIC;
+  reply.clear();
+  long start = host_usec();
+  monitor.publish(topic, text.data(), text.size());
+  monitor.flush();
+  while (host_usec() - start < 1000000)
+  {
+    step();
+    if (reply.compare(0, 3 + id.size() + 2, "id=" + id + "\r\n") == 0)
+      return reply_usec - start;
+  }
+  return -1;
+}
+
+static void test_commands(int count)
+{
+  for (int i = 0; i < 200; i++) // the subscription of the command topic
+    step();
+  std::vector<long> usec;
+  for (int i = 0; i < count; i++)
+  {
+    long t = command(std::to_string(i), "GET version");
+    check(t >= 0 && reply.find("version=" SOFTWARE_VERSION) != std::string::npos, "reply", i);
+    if (t >= 0)
+      usec.push_back(t);
+  }
+  check(command("x", "GET nothing") >= 0 && reply.find("unknown command") != std::string::npos, "unknown command");
+  if (usec.empty())
+    return;
+  std::sort(usec.begin(), usec.end());
+  printf("command round trip [msec]: min %.2f, median %.2f, 99%% %.2f, max %.2f (%zu commands, device loop every "
+         "1 msec, device execution %lu usec)\n",
+         usec.front() / 1000.0, usec[usec.size() / 2] / 1000.0, usec[usec.size() * 99 / 100] / 1000.0,
+         usec.back() / 1000.0, usec.size(), mqttDevice.command_usec());
+}
+
+static void test_syn_drop()
+{
+  nina.syn_drop = true;
+  cuts++;
+  check(run_until("connect", 5000) >= 0, "connecting");
+  long t = run_until("backoff", MQTT_CONNECT_TIMEOUT_MSEC + 1000);
+  check(t >= MQTT_CONNECT_TIMEOUT_MSEC - 100, "connect timeout [msec]", t, MQTT_CONNECT_TIMEOUT_MSEC);
+  nina.syn_drop = false;
+  check(run_online(5000) >= 0, "session after the connect timeout");
+}
+
+static void test_broker_restart()
+{
+  unsigned long drops = mqttDevice.drops();
+  stop_broker();
+  monitor.close();
+  check(run_until("backoff", 5000) >= 0, "broker killed: session lost");
+  check(mqttDevice.drops() == drops + 1, "drop counted");
+  for (int i = 0; i < 2000; i++) // attempts while the broker is down
+    step();
+  start_broker();
+  check(run_online(20000) >= 0, "session after the broker restart");
+}
+
+static void test_wifi_drop()
+{
+  nina.link = false;
+  check(run_until("backoff", WIFI_CHECK_MSEC + 1000) >= 0, "Wifi link lost: session lost");
+  nina.link = true;
+  check(run_online(20000) >= 0, "session after the Wifi link came back");
+}
+
+int main(int argc, char **argv)
+{
+  broker_port = argc > 1 ? atoi(argv[1]) : 18830;
+  int commands = argc > 2 ? atoi(argv[2]) : 500;
+  signal(SIGPIPE, SIG_IGN);
+  host_realtime() = true;
+  start_broker();
+
+  int lfd = socket(AF_INET, SOCK_STREAM, 0), one = 1;
+  setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(broker_port + 1);
+  if (bind(lfd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(lfd, 16) < 0)
+  {
+    perror("mqtt_sim: proxy");
+    stop_broker();
+    return 1;
+  }
+  std::thread network(proxy, lfd);
+  nina.tcp_port = broker_port + 1;
+  nina.associate_msec = 200;
+  nina.networks = {{"home", "secret"}};
+  nina.stored_ssid = "home";
+  nina.stored_pass = "secret";
+  wifiManager.begin();
+  for (int i = 0; i < 5000 && !wifiManager.is_connected(); i++)
+    step();
+  check(wifiManager.is_connected(), "Wifi connected");
+
+  test_dns();
+  test_commands(commands);
+  test_connack();
+  test_suback();
+  test_syn_drop();
+  test_broker_restart();
+  test_wifi_drop();
+  check(nina.blocked_msec == 0, "commands that waited for the DNS lookup [msec]", nina.blocked_msec, 0);
+  check(max_run_usec <= MQTT_POLL_MSEC * 1000, "longest run() [usec]", max_run_usec, MQTT_POLL_MSEC * 1000);
+  printf("%lu sessions, %lu connect errors, %lu drops, %lu DNS lookups, longest run() %lu usec, %lu msec blocked\n",
+         mqttDevice.connects(), mqttDevice.connect_errors(), mqttDevice.drops(), nina.lookups, max_run_usec,
+         nina.blocked_msec);
+
+  mqttDevice.end();
+  proxy_stop = true;
+  network.join();
+  stop_broker();
+  printf("%d errors\n", errors);
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,272 @@
+/*
+  Host test of the DNS and HTTP handling of the configuration portal of the firmware (diyp-controller/dp_portal.cpp)
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Runs ConfigPortal on the scripted sockets of the stand-in Wifi module (arduino/WiFiNINA.h). Check:
+  - DNS: an A query is answered with the portal address (same id, the question, one answer), other types without an
+    answer; short, truncated, oversized (more than PORTAL_DNS_SIZE) and compressed queries, responses and our own
+    queries are dropped; one packet per run(); random packets do not write outside the packet;
+  - HTTP: a request that arrives byte by byte gives the response of the request that arrives at once; a run() reads
+    at most PORTAL_READ_CHUNK and writes at most PORTAL_WRITE_CHUNK bytes, a busy socket delays the response but does
+    not cut it; the root gives the form, other paths the redirect;
+  - oversized request lines and headers are truncated, a body longer than PORTAL_BODY_SIZE is cut; a client that
+    closes in the middle of a request, or stalls, is dropped (after PORTAL_CLIENT_TIMEOUT_MSEC) without a response
+    and the next client is served;
+  - the form: url decoding, fields in any order, too long values cut to the size of the stored credentials, a post
+    without a network name gives the form again.
+
+  usage: portal_sim [random DNS packets]
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "../diyp-controller/dp_portal.h"
+
+#define STEP_MSEC 10 // loop period
+
+static int errors = 0;
+
+static void check(bool ok, const char *what, long got = 0, long expect = 0)
+{
+  if (!ok && errors++ < 20)
+    printf("FAIL %s: %ld, expected %ld\n", what, got, expect);
+}
+
+static NinaHost &nina = nina_host();
+static const IPAddress phone(192, 168, 11, 2);
+static size_t max_read = 0, max_write = 0;
+
+// One pass of the main loop, measures the bytes the portal read from and wrote to the sockets
+static void step()
+{
+  size_t rx[MAX_SOCK_NUM], tx[MAX_SOCK_NUM];
+  for (int i = 0; i < MAX_SOCK_NUM; i++)
+    rx[i] = nina.sockets[i].rx.size(), tx[i] = nina.sockets[i].tx.size();
+  host_clock() += STEP_MSEC;
+  configPortal.run();
+  for (int i = 0; i < MAX_SOCK_NUM; i++)
+  {
+    max_read = std::max(max_read, rx[i] - std::min(rx[i], nina.sockets[i].rx.size()));
+    max_write = std::max(max_write, nina.sockets[i].tx.size() - tx[i]);
+  }
+}
+
+static void open_portal()
+{
+  configPortal.end();
+  configPortal.begin("diyPresso-One");
+  for (int i = 0; i < 1000 && strcmp(configPortal.get_state_name(), "listen") != 0; i++)
+    step();
+  check(strcmp(configPortal.get_state_name(), "listen") == 0, "the portal listens");
+}
+
+/*** DNS ***/
+
+static std::string dns_name(const char *name)
+{
+  std::string s;
+  for (const char *label = name; *label;)
+  {
+    const char *dot = strchr(label, '.');
+    size_t len = dot ? dot - label : strlen(label);
+    s += char(len);
+    s.append(label, len);
+    label += len + (dot ? 1 : 0);
+  }
+  return s + '\0';
+}
+
+static std::string dns_query(uint16_t id, const char *name, uint8_t type = 1)
+{
+  std::string q = {char(id >> 8), char(id), 1, 0, 0, 1, 0, 0, 0, 0, 0, 0};
+  return q + dns_name(name) + std::string("\0", 1) + char(type) + std::string("\0\1", 2);
+}
+
+// Send a packet and run once, returns the answer or "" if there is none
+static std::string dns(const std::string &packet, IPAddress from = phone)
+{
+  nina.udp_rx.push_back({from, 5353, packet});
+  nina.udp_tx.clear();
+  step();
+  if (nina.udp_tx.empty())
+    return "";
+  check(nina.udp_tx.front().ip == from && nina.udp_tx.front().port == 5353, "answer to the sender");
+  return nina.udp_tx.front().data;
+}
+
+static void test_dns(long packets)
+{
+  std::string q = dns_query(0xBEEF, "captive.apple.com"), a = dns(q);
+  const char answer[] = "\xC0\x0C\0\1\0\1\0\0\0\x3C\0\4\xC0\xA8\x0B\x01";
+  check(a.size() == q.size() + 16, "A answer size", a.size(), q.size() + 16);
+  check(a.compare(0, 2, q, 0, 2) == 0 && (uint8_t)a[2] == 0x81 && a[7] == 1, "header: id, response, 1 answer");
+  check(a.compare(12, q.size() - 12, q, 12, q.size() - 12) == 0, "the question");
+  check(a.compare(q.size(), 16, answer, 16) == 0, "the answer: the portal, TTL 60");
+  a = dns(dns_query(7, "captive.apple.com", 28)); // AAAA
+  check(a.size() == q.size() && a[7] == 0, "AAAA: no answer record", a.size(), q.size());
+
+  check(dns(q.substr(0, 11)) == "", "shorter than a header");
+  check(dns(q.substr(0, q.size() - 3)) == "", "truncated question");
+  check(dns(q.substr(0, 16)) == "", "truncated name");
+  std::string none = q;
+  none[5] = 0;
+  check(dns(none) == "", "no question");
+  std::string response = q;
+  response[2] |= 0x80;
+  check(dns(response) == "", "a response");
+  check(dns(q, IPAddress(PORTAL_IP)) == "", "our own query");
+  std::string compressed = q.substr(0, 12) + "\xC0\x0C" + std::string("\0\1\0\1", 4);
+  check(dns(compressed) == "", "compression in the question");
+
+  // a name up to the end of the buffer: no room for the answer
+  std::string name;
+  while (name.size() < PORTAL_DNS_SIZE - 12 - 30)
+    name += "abcdefghijklmnopqrstuvwxyzabcde.";
+  name += "com";
+  std::string big = dns_query(1, name.c_str());
+  check(big.size() > PORTAL_DNS_SIZE - 16 && big.size() <= PORTAL_DNS_SIZE, "big query size", big.size());
+  check(dns(big) == "", "no room for the answer");
+  std::string oversized = dns_query(2, (name + "." + name).c_str());
+  check(dns(oversized) == "", "larger than PORTAL_DNS_SIZE");
+  a = dns(q);
+  check(a.size() == q.size() + 16, "an answer after the oversized packet");
+
+  for (int i = 0; i < 3; i++)
+    nina.udp_rx.push_back({phone, 5353, q});
+  nina.udp_tx.clear();
+  step();
+  check(nina.udp_tx.size() == 1, "one packet per run()", nina.udp_tx.size(), 1);
+  while (!nina.udp_rx.empty())
+    step();
+
+  // random packets, mostly with a valid header and a mutated question
+  unsigned long answered = 0, before = configPortal.dns_count();
+  srand(1);
+  for (long i = 0; i < packets; i++)
+  {
+    std::string p = rand() % 4 ? q : std::string();
+    p.resize(rand() % 4 ? p.size() + rand() % 64 : rand() % 600, char(rand()));
+    for (int n = rand() % 4; n > 0 && !p.empty(); n--)
+      p[rand() % p.size()] = char(rand());
+    std::string r = dns(p);
+    answered += !r.empty();
+    check(r.empty() || (r.size() >= 17 && r.size() <= PORTAL_DNS_SIZE && r.compare(0, 2, p, 0, 2) == 0),
+          "answer of a random packet", r.size());
+  }
+  check(configPortal.dns_count() - before == answered, "answers counted");
+  printf("dns: %ld random packets, %lu answered\n", packets, answered);
+}
+
+/*** HTTP ***/
+
+// Send a request in pieces of chunk bytes (0: at once) and run until the portal closed the connection
+static std::string http(const std::string &request, size_t chunk = 0, bool close = false, long max_msec = 10000)
+{
+  int sock = nina.connect(chunk ? "" : request);
+  if (sock < 0)
+    return "";
+  NinaSocket &s = nina.sockets[sock];
+  size_t sent = chunk ? 0 : request.size();
+  for (long t = 0; t < max_msec && s.used; t += STEP_MSEC)
+  {
+    if (sent < request.size() && s.rx.empty())
+    {
+      s.rx = request.substr(sent, chunk);
+      sent += s.rx.size();
+    }
+    if (sent == request.size() && close)
+      s.open = false; // the client closes after the request
+    step();
+  }
+  check(!s.used, "the portal closed the connection");
+  return s.tx;
+}
+
+static std::string post(const std::string &body, long length = -1)
+{
+  return "POST / HTTP/1.1\r\nHost: 192.168.11.1\r\nContent-Type: application/x-www-form-urlencoded\r\n"
+         "Content-Length: " + std::to_string(length < 0 ? body.size() : length) + "\r\n\r\n" + body;
+}
+
+static bool is(const std::string &response, const char *what)
+{
+  return response.find(what) != std::string::npos;
+}
+
+static void test_http()
+{
+  const std::string get = "GET / HTTP/1.1\r\nHost: 192.168.11.1\r\nAccept: text/html\r\n\r\n";
+  std::string form = http(get);
+  check(is(form, "HTTP/1.1 200 OK") && is(form, "</form></body></html>"), "the form");
+  check(form.size() > PORTAL_WRITE_CHUNK, "the form takes more than one write", form.size(), PORTAL_WRITE_CHUNK);
+  check(http(get, 1) == form, "the request byte by byte");
+  check(http(get, 7) == form, "the request in pieces");
+  check(max_read <= PORTAL_READ_CHUNK && max_write <= PORTAL_WRITE_CHUNK, "bytes per run()", max_write);
+
+  int sock = nina.connect(get);
+  NinaSocket &s = nina.sockets[sock];
+  for (int i = 0; s.used && i < 1000; i++)
+  {
+    s.write_limit = i % 5 ? 0 : 100; // mostly busy, sometimes room for 100 bytes
+    step();
+  }
+  check(!s.used && s.tx == form, "a busy socket: the complete form");
+
+  check(is(http("GET /generate_204 HTTP/1.1\r\n\r\n"), "Location: " PORTAL_URL), "redirect");
+  check(is(http("GET /?lang=en HTTP/1.1\r\n\r\n"), "<form"), "the root with a query");
+  check(is(http("GET / HTTP/1.0\n\n"), "<form"), "LF line endings");
+  check(is(http("GET /" + std::string(3000, 'a') + " HTTP/1.1\r\n\r\n"), "302 Found"), "oversized request line");
+  std::string headers = "GET / HTTP/1.1\r\n";
+  for (int i = 0; i < 50; i++)
+    headers += "X-Header-" + std::to_string(i) + ": " + std::string(200, 'h') + "\r\n";
+  check(http(headers + "\r\n", 64) == form, "oversized headers");
+
+  // requests that do not complete
+  unsigned long count = configPortal.http_count();
+  check(http(get.substr(0, 20), 0, true) == "", "truncated request, closed by the client");
+  check(http(get.substr(0, 30), 0, false, 2 * PORTAL_CLIENT_TIMEOUT_MSEC) == "", "truncated request, stalled");
+  check(http(post("XXID=home", 100), 0, false, 2 * PORTAL_CLIENT_TIMEOUT_MSEC) == "", "truncated body, stalled");
+  check(configPortal.http_count() == count + 3 && !configPortal.received(), "no credentials");
+  check(http(get) == form, "the next client");
+}
+
+static void test_form()
+{
+  std::string r = http(post("action=Submit&XXPS=p%26ss+word"));
+  check(is(r, "<form") && !configPortal.received(), "no network name: the form again");
+
+  std::string body = "XXID=my+net%21%4" + std::string("&XXPS=") + std::string(60, 'p') + "&action=Submit";
+  r = http(post(body), 5);
+  check(is(r, "Thank you") && configPortal.received(), "credentials");
+  check(strcmp(configPortal.ssid(), "my net!%4") == 0, "url decoded name");
+  check(strlen(configPortal.pass()) == PORTAL_PASS_SIZE - 1, "password cut", strlen(configPortal.pass()),
+        PORTAL_PASS_SIZE - 1);
+
+  open_portal();
+  body = "XXPS=secret&XXID=" + std::string(100, 'n') + "&pad=" + std::string(1000, 'x');
+  r = http(post(body), 64);
+  check(is(r, "Thank you") && strlen(configPortal.ssid()) == PORTAL_SSID_SIZE - 1, "body larger than the buffer");
+  check(strcmp(configPortal.pass(), "secret") == 0, "fields in any order");
+
+  open_portal();
+  r = http(post("XXID=" + std::string(PORTAL_BODY_SIZE, 'n') + "&XXPS=late"), 64);
+  check(is(r, "Thank you") && configPortal.pass()[0] == 0, "fields after the body buffer are lost");
+}
+
+int main(int argc, char **argv)
+{
+  long packets = argc > 1 ? atol(argv[1]) : 100000;
+  host_clock() = 1000;
+  nina.networks = {{"home", "secret"}, {"cafe", ""}};
+  open_portal();
+  test_dns(packets);
+  test_http();
+  test_form();
+  configPortal.end();
+  check(!configPortal.is_open() && nina.udp_port == 0 && nina.server_port == 0, "closed");
+  printf("http: %u requests, max %zu bytes read and %zu written per run()\n", configPortal.http_count(), max_read,
+         max_write);
+  printf("%d errors\n", errors);
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,146 @@
+/*
+  Simulation of machines sharing a mains power budget (diyp-controller/dp_lease.h)
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Several nodes run the lease algorithm of the firmware against a simulated broker with a delay. Every node has a
+  simple boiler model, warms up from cold at the same time and makes a shot now and then. One node can lose the
+  broker for a while, it then falls back to its failsafe power like dp_power.cpp does.
+
+  usage: power_sim [nodes] [budget W] [failsafe W] [broker delay msec] [outage node] [seed]
+*/
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <vector>
+#include "../diyp-controller/dp_lease.h"
+
+#define HEATER_W 1000.0   // rated heater power
+#define CAPACITY 4200.0   // heat capacity of a boiler [J/K]
+#define LOSS 0.7          // heat loss [W/K]
+#define AMBIENT 20.0
+#define SETPOINT 98.0
+#define SHOT_LOAD 700.0   // cooling by the fresh water during a shot [W]
+#define SHOT_MSEC 30000
+#define SIM_MSEC (60 * 60 * 1000UL)
+#define STEP_MSEC 10
+
+struct message
+{
+  unsigned long time;
+  int from;
+  uint8_t priority;
+  uint16_t demand, claim;
+};
+
+struct node
+{
+  PowerLeases leases;
+  double temp = AMBIENT, power = 0, demand_max = 0;
+  unsigned long tick = 0, echo = 0, shot_end = 0, warm = 0;
+  bool failsafe = true;
+  double shot_dev = 0; // max temperature deviation during shots
+  int shots = 0;
+};
+
+int main(int argc, char **argv)
+{
+  int n = argc > 1 ? atoi(argv[1]) : 4;
+  unsigned int budget = argc > 2 ? atoi(argv[2]) : 2500, failsafe = argc > 3 ? atoi(argv[3]) : 400;
+  unsigned long delay = argc > 4 ? atoi(argv[4]) : 50;
+  int outage = argc > 5 ? atoi(argv[5]) : -1; // this node loses the broker from 20 to 25 minutes
+  int seed = argc > 6 ? atoi(argv[6]) : 1;
+
+  for (int coordinated = 0; coordinated < 2; coordinated++)
+  {
+    std::vector<node> nodes(n);
+    std::deque<message> broker;
+    double peak = 0, over = 0;
+    srand(seed); // the same shots in both runs
+    for (int i = 0; i < n; i++)
+    {
+      nodes[i].leases.id(1000 + i);
+      nodes[i].leases.budget(budget, failsafe);
+      nodes[i].tick = rand() % POWER_TICK_MSEC; // the nodes tick unsynchronized
+    }
+
+    for (unsigned long t = 0; t < SIM_MSEC; t += STEP_MSEC)
+    {
+      // deliver the announcements
+      while (!broker.empty() && broker.front().time <= t)
+      {
+        message m = broker.front();
+        broker.pop_front();
+        for (int i = 0; i < n; i++)
+          if (i == m.from)
+            nodes[i].echo = t;
+          else if (!(i == outage && t > 1200000 && t < 1500000))
+            nodes[i].leases.receive(1000 + m.from, m.priority, m.demand, m.claim, t);
+      }
+
+      double total = 0;
+      for (int i = 0; i < n; i++)
+      {
+        node &d = nodes[i];
+        bool connected = !(i == outage && t > 1200000 && t < 1500000);
+        if (d.warm && d.shot_end + 60000 < t && rand() % 20000 == 0) // a shot every ~4 minutes after warm-up
+          d.shot_end = t + SHOT_MSEC;
+        bool brewing = t < d.shot_end;
+
+        // proportional control with feed forward of the losses, like the boiler PID
+        double want = (SETPOINT - d.temp) * 200.0 + LOSS * (d.temp - AMBIENT) + (brewing ? SHOT_LOAD : 0);
+        want = want < 0 ? 0 : want > HEATER_W ? HEATER_W : want;
+        d.demand_max = want > d.demand_max ? want : d.demand_max;
+
+        // dp_power.cpp: tick, failsafe and the heater limit
+        if (coordinated && t >= d.tick)
+        {
+          d.tick += POWER_TICK_MSEC;
+          uint8_t priority = brewing ? POWER_PRIORITY_BREWING : d.temp > SETPOINT - 2 ? POWER_PRIORITY_READY : POWER_PRIORITY_HEATING;
+          uint16_t claim = d.leases.tick(priority, d.demand_max, t);
+          if (d.failsafe && claim < failsafe)
+            claim = failsafe;
+          if (connected)
+            broker.push_back({t + delay, i, priority, (uint16_t)d.demand_max, claim});
+          d.demand_max = want;
+        }
+        if (coordinated)
+        {
+          d.failsafe = !(d.echo && t - d.echo < POWER_LEASE_MSEC);
+          double limit = d.failsafe ? failsafe : d.leases.grant();
+          d.power = want < limit ? want : limit;
+        }
+        else
+          d.power = want;
+
+        d.temp += (d.power - LOSS * (d.temp - AMBIENT) - (brewing ? SHOT_LOAD : 0)) * STEP_MSEC / 1000.0 / CAPACITY;
+        if (!d.warm && d.temp > SETPOINT - 1)
+          d.warm = t;
+        if (brewing)
+        {
+          double dev = SETPOINT - d.temp;
+          d.shot_dev = dev > d.shot_dev ? dev : d.shot_dev;
+          if (t + STEP_MSEC >= d.shot_end)
+            d.shots++;
+        }
+        total += d.power;
+      }
+      peak = total > peak ? total : peak;
+      if (total > budget)
+        over += STEP_MSEC;
+    }
+
+    unsigned long warm = 0;
+    double dev = 0;
+    int shots = 0;
+    for (int i = 0; i < n; i++)
+    {
+      warm = nodes[i].warm > warm ? nodes[i].warm : warm;
+      dev = nodes[i].shot_dev > dev ? nodes[i].shot_dev : dev;
+      shots += nodes[i].shots;
+    }
+    printf("%-13s nodes %d, budget %u W: peak %.0f W, over budget %.1f sec, all warm after %.0f sec, "
+           "%d shots, max shot deviation %.2f C\n",
+           coordinated ? "coordinated" : "independent", n, budget, peak, over / 1000, warm / 1000.0, shots, dev);
+  }
+  return 0;
+}
@@ -0,0 +1,163 @@
+/*
+  Round trip check and benchmark of the settings table of the firmware (diyp-controller/dp_settings_table.h)
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Check: every key and alias is found, unknown keys and prefixes are not; the defaults are in range; random
+  settings with 3 decimals (the serialization) survive settings_serialize() and settings_deserialize() bit for bit,
+  any other value the second time; values out of range are clamped; PUT strings with bad syntax or unknown keys fail.
+
+  Benchmark: key lookup of a PUT of all settings with the perfect hash and with the chain of String compares that
+  DpSettings::deserialize() had (here std::string: a copy of the key per lookup, like String::substring()).
+
+  usage: settings_bench [lookups]
+*/
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "../diyp-controller/dp_settings_table.h"
+#include "../diyp-controller/dp_format.h"
+
+static const char *keys[] = {"temperature", "preInfusionTime", "infusionTime", "extractionTime", "extractionWeight",
+                             "p", "i", "d", "ff_heat", "ff_ready", "ff_brew", "tareWeight", "trimWeight",
+                             "commissioningDone", "shotCounter", "wifiMode", "mainsLimit",
+                             "telemetryFormat"};
+
+// The if-else chain of DpSettings::deserialize() before the table
+static int find_chain(const std::string &key)
+{
+  if (key == "temperature") return SET_TEMPERATURE;
+  else if (key == "p" || key == "P") return SET_P;
+  else if (key == "i" || key == "I") return SET_I;
+  else if (key == "d" || key == "D") return SET_D;
+  else if (key == "ff_heat") return SET_FF_HEAT;
+  else if (key == "ff_ready") return SET_FF_READY;
+  else if (key == "ff_brew") return SET_FF_BREW;
+  else if (key == "tareWeight") return SET_TARE_WEIGHT;
+  else if (key == "trimWeight") return SET_TRIM_WEIGHT;
+  else if (key == "preInfusionTime") return SET_PRE_INFUSION_TIME;
+  else if (key == "infusionTime" || key == "infuseTime") return SET_INFUSION_TIME;
+  else if (key == "extractionTime" || key == "extractTime") return SET_EXTRACTION_TIME;
+  else if (key == "extractionWeight") return SET_EXTRACTION_WEIGHT;
+  else if (key == "commissioningDone") return SET_COMMISSIONING_DONE;
+  else if (key == "shotCounter") return SET_SHOT_COUNTER;
+  else if (key == "wifiMode") return SET_WIFI_MODE;
+  else if (key == "mainsLimit") return SET_MAINS_LIMIT;
+  else if (key == "telemetryFormat") return SET_TELEMETRY_FORMAT;
+  return -1;
+}
+
+static int errors = 0;
+
+static void check(bool ok, const char *what, const char *detail = "")
+{
+  if (!ok && errors++ < 20)
+    printf("FAIL %s %s\n", what, detail);
+}
+
+static double now_nsec()
+{
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static volatile int sink;
+
+int main(int argc, char **argv)
+{
+  long lookups = argc > 1 ? atol(argv[1]) : 2000000;
+  int n = sizeof(keys) / sizeof(keys[0]);
+  check(n == SETTINGS_COUNT, "keys");
+
+  // lookup
+  for (int id = 0; id < SETTINGS_COUNT; id++)
+  {
+    check(settings_find(keys[id], strlen(keys[id])) == id, "find", keys[id]);
+    check(!strcmp(settings_desc(id)->key, keys[id]), "key", keys[id]);
+    check(find_chain(keys[id]) == id, "chain", keys[id]);
+  }
+  const char *aliases[] = {"P", "I", "D", "infuseTime", "extractTime"};
+  for (int i = 0; i < 5; i++)
+    check(settings_find(aliases[i], strlen(aliases[i])) == find_chain(aliases[i]), "alias", aliases[i]);
+  const char *unknown[] = {"", "x", "temperatur", "temperaturee", "Temperature", "version", "crc", "ff_", "wifi"};
+  for (int i = 0; i < 9; i++)
+    check(settings_find(unknown[i], strlen(unknown[i])) == -1, "unknown", unknown[i]);
+  check(settings_find("temperature=98", 11) == SET_TEMPERATURE, "find in a string");
+
+  // defaults and clamping
+  settings_t s, t;
+  memset(&s, 0, sizeof(s));
+  settings_defaults(&s);
+  for (int id = 0; id < SETTINGS_COUNT; id++)
+  {
+    const setting_desc_t *d = settings_desc(id);
+    check(settings_get(&s, id) == d->def, "default", d->key);
+    check(settings_set(&t, id, d->max + 1000) == d->max && settings_get(&t, id) == d->max, "clamp max", d->key);
+    check(settings_set(&t, id, d->min - 1000) == d->min && settings_get(&t, id) == d->min, "clamp min", d->key);
+  }
+  check(s.version == SETTINGS_VERSION && s.temperature == 98 && s.i == 0.08 && s.wifiMode == 0, "defaults");
+
+  // round trip
+  char text[SETTINGS_TEXT_SIZE], text2[SETTINGS_TEXT_SIZE];
+  int longest = 0;
+  srand(1);
+  for (int k = 0; k < 100000; k++)
+  {
+    memset(&s, 0, sizeof(s));
+    memset(&t, 0, sizeof(t));
+    for (int id = 0; id < SETTINGS_COUNT; id++)
+    {
+      const setting_desc_t *d = settings_desc(id);
+      double r = (double)rand() / RAND_MAX, value = d->min + r * (d->max - d->min);
+      if (k % 2 == 0 && d->type == SETTING_DOUBLE) // what a PUT or the menu steps give: 3 decimals
+        value = round(value * 1000) / 1000 + 0.0; // not -0, that is serialized as 0
+      settings_set(&s, id, value);
+    }
+    int len = settings_serialize(&s, text);
+    check(len == (int)strlen(text) && len < SETTINGS_TEXT_SIZE, "serialize length");
+    longest = len > longest ? len : longest;
+    check(settings_deserialize(&t, text) == 0, "deserialize", text);
+    if (k % 2 == 0)
+      check(memcmp(&s, &t, sizeof(s)) == 0, "round trip", text);
+    settings_serialize(&t, text2);
+    check(!strcmp(text, text2), "round trip text", text2);
+  }
+
+  // PUT strings
+  memset(&s, 0, sizeof(s));
+  check(settings_deserialize(&s, "temperature=98.50,P=7.00,I=0.30,D=80.00,ff_heat=3.00,ff_ready=10.00,ff_brew=80.00,"
+                                 "tareWeight=0.00,trimWeight=0.00,preInfusionTime=3.00,infuseTime=1.00,"
+                                 "extractTime=25.00,extractionWeight=0.00,commissioningDone=1,shotCounter=5,"
+                                 "wifiMode=0") == 0,
+        "PUT example");
+  check(s.temperature == 98.5 && s.p == 7 && s.i == 0.3 && s.d == 80 && s.infusionTime == 1 &&
+            s.extractionTime == 25 && s.commissioningDone == 1 && s.shotCounter == 5,
+        "PUT example values");
+  check(settings_deserialize(&s, "") == 0, "empty");
+  check(settings_deserialize(&s, "temperature=93,") == 0 && s.temperature == 93, "trailing comma");
+  check(settings_deserialize(&s, "temperature=-5") == 0 && s.temperature == 0, "clamped");
+  check(settings_deserialize(&s, "temperature") == -1, "no value");
+  check(settings_deserialize(&s, "temperature=") == -1, "empty value");
+  check(settings_deserialize(&s, "temperature=9x") == -1, "bad value");
+  check(settings_deserialize(&s, "temp=93") == -2, "unknown key");
+  check(settings_deserialize(&s, "version=1") == -2, "version");
+
+  printf("settings table: %d keys, serialized %d bytes max (buffer %d), %d errors\n", SETTINGS_COUNT, longest,
+         SETTINGS_TEXT_SIZE, errors);
+
+  // lookup of the keys of a PUT of all settings
+  double t0 = now_nsec();
+  for (long i = 0; i < lookups; i++)
+  {
+    const char *key = keys[i % n];
+    sink = settings_find(key, strlen(key));
+  }
+  double hash = (now_nsec() - t0) / lookups;
+  t0 = now_nsec();
+  for (long i = 0; i < lookups; i++)
+    sink = find_chain(keys[i % n]); // the String of the key is made per lookup, like substring() did
+  double chain = (now_nsec() - t0) / lookups;
+  printf("key lookup [nsec]: perfect hash %.1f, String compare chain %.1f\n", hash, chain);
+  return errors ? 1 : 0;
+}
@@ -0,0 +1,161 @@
+/*
+  Host renderer of the sparkline graphs of the firmware (diyp-controller/dp_sparkline.h) in the custom characters
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Feeds the warm-up of the boiler, an idle boiler and a shot to a Sparkline at the sample rates of dp_menu.h, renders
+  every sample, takes the changed rows with CharRam (dp_framebuffer.h) and encodes them with LcdFrame like
+  Display::show(). The I2C bytes go through an emulated PCF8574 and HD44780 (CGRAM address counter), every update is
+  checked to end up in the CGRAM. Counts the LCD and I2C bytes per update against loading all 8 characters: with
+  createChar() of the hd44780 library (a command and 8 rows per character, 5 I2C bytes per LCD byte) or in one run.
+
+  The frames are printed as pixels for a visual check: the last of each scenario, with -v all of them.
+
+  usage: spark_render [-v]
+*/
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include "../diyp-controller/dp_sparkline.h"
+#include "../diyp-controller/dp_lcd_bus.h"
+
+#define TEMPERATURE_SAMPLE_SEC 10 // GRAPH_TEMPERATURE_SAMPLE_MS
+#define SHOT_SAMPLE_SEC 1         // GRAPH_SHOT_SAMPLE_MS
+#define I2C_PER_LCD_BYTE 5        // hd44780_I2Cexp: a transaction per LCD byte
+
+static int errors = 0;
+
+static void check(bool ok, const char *what)
+{
+  if (!ok && errors++ < 20)
+    printf("FAIL %s\n", what);
+}
+
+// PCF8574 + HD44780 in 4 bit mode: a nibble on the falling edge of E, the address counter of the CGRAM
+struct lcd_t
+{
+  uint8_t cgram[CG_SIZE];
+  int address = 0, nibbles = 0;
+  bool cg = false; // the address is in the CGRAM
+  uint8_t pins = 0, value = 0;
+  void receive(uint8_t b) // an I2C data byte to the expander
+  {
+    if ((pins & DISPLAY_PCF_EN) && !(b & DISPLAY_PCF_EN))
+    {
+      value = value << 4 | b >> 4;
+      if (++nibbles == 2)
+      {
+        nibbles = 0;
+        if (b & DISPLAY_PCF_RS)
+        {
+          if (cg)
+            cgram[address] = value & 0x1F, address = (address + 1) % CG_SIZE;
+        }
+        else if (value & 0x80)
+          cg = false;
+        else if (value & 0x40)
+          cg = true, address = value & 0x3F;
+      }
+    }
+    pins = b;
+  }
+};
+
+struct result_t
+{
+  long updates = 0, lcd = 0, i2c = 0, max_i2c = 0;
+};
+
+static void print(const uint8_t *chars)
+{
+  for (int row = 0; row < SPARK_HEIGHT; row++)
+  {
+    printf("  |");
+    for (int c = 0; c < SPARK_CHARS; c++)
+    {
+      for (int bit = 0x10; bit; bit >>= 1)
+        putchar(chars[c * 8 + row] & bit ? '#' : '.');
+      putchar('|');
+    }
+    putchar('\n');
+  }
+}
+
+// A new sample: render, send the changed rows, check the CGRAM
+static void update(Sparkline &line, double value, CharRam &ram, lcd_t &lcd, result_t &r, bool verbose)
+{
+  uint8_t chars[CG_SIZE];
+  line.add(value);
+  line.render(chars);
+  fb_run_t runs[CG_MAX_RUNS];
+  int n = ram.update(chars, runs);
+  LcdFrame frame;
+  for (int i = 0; i < n; i++)
+  {
+    frame.cgram(runs[i].pos);
+    frame.write((const char *)ram.rows() + runs[i].pos, runs[i].len);
+    r.lcd += 1 + runs[i].len;
+  }
+  for (int i = 0; i < frame.length(); i++)
+    lcd.receive(frame.bytes()[i]);
+  check(memcmp(lcd.cgram, chars, CG_SIZE) == 0, "CGRAM");
+  r.updates++;
+  r.i2c += frame.length();
+  r.max_i2c = std::max(r.max_i2c, (long)frame.length());
+  if (verbose)
+  {
+    double lo, hi;
+    line.scale(&lo, &hi);
+    printf("sample %ld: %.2f, scale %.2f..%.2f, %d runs, %d I2C bytes\n", r.updates, value, lo, hi, n,
+           frame.length());
+    print(chars);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  bool verbose = argc > 1 && !strcmp(argv[1], "-v");
+  const int library = CG_CHARS * (1 + 8), run = 1 + CG_SIZE; // LCD bytes to load all characters
+  printf("%-10s %7s %9s %9s %9s | all: createChar %d I2C B, one run %d I2C B\n", "scenario", "samples", "lcd B",
+         "i2c B", "i2c max", library * I2C_PER_LCD_BYTE, run * 4);
+  for (int scenario = 0; scenario < 3; scenario++)
+  {
+    const char *name[] = {"warm-up", "idle", "shot"};
+    Sparkline line(scenario == 2 ? 5.0 : 1.0);
+    CharRam ram;
+    lcd_t lcd;
+    result_t r;
+    uint8_t chars[CG_SIZE];
+    srand(scenario + 1);
+    memset(lcd.cgram, 0xFF, sizeof(lcd.cgram));
+    for (int i = 0; i < 360; i++)
+    {
+      double noise = (rand() % 21 - 10) / 100.0, t, value;
+      if (scenario == 0) // first order to the set point with an overshoot, 10 sec per sample, one hour
+      {
+        t = i * TEMPERATURE_SAMPLE_SEC;
+        value = 98 - 78 * exp(-t / 300) + 3 * exp(-pow((t - 900) / 200, 2)) + noise / 2;
+      }
+      else if (scenario == 1) // on temperature
+        value = 98 + noise;
+      else // a shot: pre-infusion, extraction at 1.6 g/s and the drip after it, 1 sec per sample
+      {
+        t = (i % 60) * SHOT_SAMPLE_SEC;
+        if (i % 60 == 0)
+          line.clear();
+        value = t < 5 ? t * 0.1 : t < 30 ? 0.5 + (t - 5) * 1.6 + noise * 2 : 40.5 + 2 * (1 - exp(-(t - 30) / 3));
+      }
+      update(line, value, ram, lcd, r, verbose);
+    }
+    printf("%-10s %7ld %9.1f %9.1f %9ld\n", name[scenario], r.updates, (double)r.lcd / r.updates,
+           (double)r.i2c / r.updates, r.max_i2c);
+    if (!verbose)
+    {
+      line.render(chars);
+      print(chars);
+    }
+  }
+  printf("%d errors\n", errors);
+  return errors ? 1 : 0;
+}
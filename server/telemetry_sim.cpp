@@ -0,0 +1,457 @@
+/*
+  Host test and benchmark of the telemetry ring of the firmware (diyp-controller/dp_telemetry_ring.h)
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Check:
+  - codec: samples of a machine model (idle and shots) pushed and drained with publish failures and broker outages
+    long enough to overflow the ring: every sample read is the one pushed, in order, after any rollback or drop;
+    pushed = published + dropped + pending;
+  - formats: batches published as lines and as CBOR, each format failing at random, with the drain of
+    Telemetry::run(): no sample is published twice in a format, the samples in both formats are the ones published,
+    a sample missing in a format was dropped;
+  - switch: the formats switched at random while batches are drained and formats fail: a sample is published once per
+    format at most, and in every format that is selected when it is removed from the ring;
+  - CBOR: a batch of brewing samples converted back by ./cbor2line gives the lines of the text format.
+  Benchmark:
+  - codec: the idle records that fill the ring, their size and the time they span at one sample per 5 sec, the
+    encode and decode time per sample;
+  - rate: one hour with the loop at 100 Hz, the rate policy with the intervals of Telemetry::interval() and the
+    drain timing of Telemetry::run(): samples and messages per hour when idle (ready) and with a 10 min heat-up and
+    4 shots, samples per shot; before the rate policy every 5 sec was one sample and one message;
+  - formats: size and encode time of a brewing batch of 1 and of 10 samples, as text lines (format_float(), like
+    MqttDevice::write()) and as CBOR.
+
+  usage: telemetry_sim [samples]
+*/
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "../diyp-controller/dp_telemetry_ring.h"
+#include "../diyp-controller/dp_format.h"
+
+// states of dp_boiler.h and dp_brew.h, with the names of get_state_name()
+enum { BOIL_HEATING = 1, BOIL_READY = 2, BOIL_BREW = 3 };
+enum { BREW_FILL = 1, BREW_IDLE = 5, BREW_PRE_INFUSE = 9, BREW_INFUSE = 10, BREW_EXTRACT = 11, BREW_FINISHED = 12 };
+static const char *boiler_states[] = {"off", "heating", "ready", "brew", "error"};
+static const char *brew_states[] = {"init", "fill", "purge", "sleep", "empty", "idle", "check", "done",
+                                    "warning_pre_brew", "pre_infuse", "infuse", "extract", "finished", "error"};
+
+#define FORMATS (TELEMETRY_FORMAT_LINE | TELEMETRY_FORMAT_CBOR)
+#define SAMPLE_MSEC 5000 // the sample interval of the codec test
+#define BEFORE_MSEC 5000 // the fixed sample and message interval before the rate policy
+
+static int errors = 0;
+
+static void check(bool ok, const char *what, long got = 0, long expect = 0)
+{
+  if (!ok && errors++ < 20)
+    printf("FAIL %s: %ld, expected %ld\n", what, got, expect);
+}
+
+static double usec()
+{
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static uint32_t seed = 1;
+static int32_t noise(int32_t range) // -range..range
+{
+  seed = seed * 1103515245 + 12345;
+  return (int32_t)((seed >> 8) % (2 * range + 1)) - range;
+}
+
+// The machine: a shot every shot_msec from first_shot (0: none), heating until heat_msec
+struct Machine
+{
+  uint32_t heat_msec = 0, first_shot = 0, shot_msec = 0, shots = 0;
+  telemetry_sample_t s = {};
+
+  Machine()
+  {
+    s.value[TM_T_SET] = 9800;
+    s.value[TM_T_ACT] = 9800;
+    s.value[TM_H_AVG] = 80;
+    s.value[TM_R_LVL] = 800;
+    s.value[TM_R_WGT] = 12000;
+    s.value[TM_SHOTS] = 1234;
+  }
+
+  // The state at time t [msec], a step of the main loop
+  const telemetry_sample_t &at(uint32_t t)
+  {
+    int32_t *v = s.value;
+    uint32_t shot = 0; // [msec] into the shot, 0: no shot
+    if (shot_msec && t >= first_shot && shots < 4)
+      shot = (t - first_shot) % shot_msec;
+    if (shot && shot < 92000)
+    {
+      int brew = shot < 3000 ? BREW_PRE_INFUSE : shot < 7000 ? BREW_INFUSE : shot < 32000 ? BREW_EXTRACT : BREW_FINISHED;
+      if (brew == BREW_FINISHED && v[TM_BREW] == BREW_EXTRACT)
+      {
+        v[TM_W_END] = v[TM_W_CUR];
+        v[TM_SHOTS]++;
+      }
+      if (brew == BREW_PRE_INFUSE && v[TM_BREW] != BREW_PRE_INFUSE)
+        v[TM_W_CUR] = 0;
+      if (brew == BREW_EXTRACT)
+        v[TM_W_CUR] += 2 + noise(1); // ~1.4 g/sec at 100 Hz
+      v[TM_BREW] = brew;
+      v[TM_BOIL] = brew == BREW_FINISHED ? BOIL_READY : BOIL_BREW;
+      v[TM_T_ACT] -= brew != BREW_FINISHED && t % 1000 == 0; // ~3 C during the shot
+      v[TM_H_PWR] = brew == BREW_FINISHED ? 300 + noise(200) : 1000;
+      v[TM_R_WGT] -= brew == BREW_EXTRACT ? 2 : 0;
+    }
+    else
+    {
+      if (v[TM_BREW] == BREW_FINISHED)
+        shots++;
+      v[TM_BREW] = BREW_IDLE;
+      v[TM_BOIL] = t < heat_msec ? BOIL_HEATING : BOIL_READY;
+      int32_t target = t < heat_msec ? 2000 + (int64_t)7800 * t / heat_msec : v[TM_T_SET];
+      v[TM_T_ACT] += (target - v[TM_T_ACT]) / 200 + (noise(50) == 0 ? noise(3) : 0); // PID settling, RTD noise
+      v[TM_H_PWR] = t < heat_msec ? 1000 : 80 + noise(60);
+      v[TM_R_WGT] += noise(100) == 0 ? noise(20) : 0; // load cell drift
+    }
+    v[TM_H_AVG] += (v[TM_H_PWR] - v[TM_H_AVG]) / 500;
+    v[TM_R_LVL] = v[TM_R_WGT] / 15;
+    s.time = t;
+    return s;
+  }
+};
+
+// The sample interval of Telemetry::interval() (dp_telemetry.cpp)
+static uint32_t interval(const telemetry_sample_t &s)
+{
+  switch (s.value[TM_BREW])
+  {
+  case BREW_PRE_INFUSE:
+  case BREW_INFUSE:
+  case BREW_EXTRACT:
+    return TELEMETRY_BUSY_MSEC;
+  case BREW_FILL:
+  case BREW_FINISHED:
+    return TELEMETRY_ACTIVE_MSEC;
+  }
+  return s.value[TM_BOIL] == BOIL_HEATING ? TELEMETRY_ACTIVE_MSEC : 0;
+}
+
+static bool same(const telemetry_sample_t &a, const telemetry_sample_t &b)
+{
+  return memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+// A sample as a line of Telemetry::publish(): MqttDevice::write() of every field and end_line()
+static std::string line(const telemetry_sample_t &s, uint64_t epoch_msec)
+{
+  std::string text = "measurement ";
+  char buf[32];
+  for (int i = 0; i < TELEMETRY_FIELDS; i++)
+  {
+    int32_t scale = telemetry_fields[i].scale;
+    if (scale == 1)
+      snprintf(buf, sizeof(buf), "%ld", (long)s.value[i]);
+    else if (scale > 1)
+      format_float(buf, (double)s.value[i] / scale, 2);
+    else
+      continue;
+    text += std::string(i ? "," : "") + telemetry_fields[i].name + "=" + buf;
+  }
+  text += ",boil=\"" + std::string(boiler_states[s.value[TM_BOIL]]) + "\"";
+  text += ",brew=\"" + std::string(brew_states[s.value[TM_BREW]]) + "\"";
+  snprintf(buf, sizeof(buf), ",msec=%lu", (unsigned long)s.time);
+  text += buf;
+  if (epoch_msec)
+  {
+    uint64_t msec = epoch_msec + s.time;
+    snprintf(buf, sizeof(buf), " %lu%03u000000", (unsigned long)(msec / 1000), (unsigned)(msec % 1000));
+    text += buf;
+  }
+  return text;
+}
+
+// A batch as a CBOR message of Telemetry::run()
+static size_t cbor_message(uint8_t *buf, size_t size, const std::vector<telemetry_sample_t> &batch, uint64_t epoch_msec)
+{
+  CborWriter cbor(buf, size);
+  TelemetryRing::cbor_begin(cbor, epoch_msec);
+  for (size_t i = 0; i < batch.size(); i++)
+    TelemetryRing::cbor_sample(cbor, batch[i], i ? &batch[i - 1] : NULL);
+  cbor.end();
+  return cbor.ok() ? cbor.size() : 0;
+}
+
+static TelemetryRing ring;
+
+// Push samples every 5 sec, with outages and failing formats; check what is read and published
+static void test_codec(long count)
+{
+  Machine machine;
+  machine.shot_msec = 1800000; // a shot per half hour
+  machine.first_shot = 600000;
+  std::vector<telemetry_sample_t> pushed;  // by index, the time is the index
+  std::vector<long> last(FORMATS + 1, -1); // last index published per format
+  std::vector<char> in[FORMATS + 1];       // published per format, by index
+  in[TELEMETRY_FORMAT_LINE].assign(count, 0);
+  in[TELEMETRY_FORMAT_CBOR].assign(count, 0);
+  long outage = 0, reads = 0, rollbacks = 0, partial = 0;
+  for (long i = 0; i < count; i++)
+  {
+    telemetry_sample_t s = machine.at(i * SAMPLE_MSEC);
+    s.time = i; // the index
+    pushed.push_back(s);
+    ring.push(s);
+    if (outage > 0 && outage--)
+      continue;
+    if (noise(1000) == 0)
+      outage = 1000 + noise(500); // the ring holds ~900 idle samples: most outages overflow it
+
+    uint8_t formats = FORMATS & ~ring.batch_sent(), sent = 0;
+    int batch = ring.batch_records() ? ring.batch_records() : TELEMETRY_DRAIN_BATCH, n = 0;
+    std::vector<long> read;
+    telemetry_sample_t r;
+    while (n < batch && ring.next(r))
+    {
+      check(r.time < pushed.size() && same(r, pushed[r.time]), "sample read is the one pushed", r.time);
+      read.push_back(r.time);
+      n++;
+    }
+    check(!ring.batch_records() || n == ring.batch_records(), "kept batch read again", n, ring.batch_records());
+    reads += n;
+    for (uint8_t f = TELEMETRY_FORMAT_LINE; f <= TELEMETRY_FORMAT_CBOR; f <<= 1)
+      if ((formats & f) && noise(5) != 0) // published
+      {
+        sent |= f;
+        for (long t : read)
+        {
+          check(t > last[f], "published in order, once per format", t, last[f] + 1);
+          last[f] = t;
+          in[f][t] = 1;
+        }
+      }
+    rollbacks += sent != FORMATS && n;
+    partial += sent && (sent | ring.batch_sent()) != FORMATS;
+    ring.drained(sent, FORMATS);
+  }
+  telemetry_sample_t r;
+  for (int k = 0; ring.next(r); k++) // the rest, the kept batch only in the formats it misses
+    for (uint8_t f = TELEMETRY_FORMAT_LINE; f <= TELEMETRY_FORMAT_CBOR; f <<= 1)
+      if (!(k < ring.batch_records() && (ring.batch_sent() & f)))
+      {
+        check(same(r, pushed[r.time]) && (long)r.time > last[f], "rest in order, once per format", r.time);
+        last[f] = r.time;
+        in[f][r.time] = 1;
+      }
+  ring.drained(FORMATS, FORMATS);
+
+  long both = 0, one = 0;
+  for (long i = 0; i < count; i++)
+  {
+    both += in[TELEMETRY_FORMAT_LINE][i] && in[TELEMETRY_FORMAT_CBOR][i];
+    one += in[TELEMETRY_FORMAT_LINE][i] != in[TELEMETRY_FORMAT_CBOR][i];
+  }
+  check(ring.pushed() == (unsigned long)count, "pushed", ring.pushed(), count);
+  check(ring.pending() == 0, "pending after the drain", ring.pending(), 0);
+  check(ring.published() + ring.dropped() == ring.pushed(), "published + dropped", ring.published() + ring.dropped(),
+        ring.pushed());
+  check(both == (long)ring.published(), "published in both formats", both, ring.published());
+  check(count - both == (long)ring.dropped(), "the samples not in both formats were dropped", count - both,
+        ring.dropped());
+  check(count < 20000 || (ring.dropped() > 0 && partial > 0), "outages overflowed the ring, formats failed alone");
+  printf("codec: %lu samples, %ld read, %ld rollbacks (%ld with one format published), %lu dropped (%ld after one "
+         "format published them)\n", ring.pushed(), reads, rollbacks, partial, ring.dropped(), one);
+}
+
+static TelemetryRing switched;
+
+// Drain while the formats are switched at random, like by the telemetryFormat setting, with failing formats; check
+// that a sample is published once per format at most, and in every format selected when it is removed from the ring
+static void test_switch(long count)
+{
+  Machine machine;
+  std::vector<uint8_t> in(count, 0); // formats that published the sample, by index
+  uint8_t formats = TELEMETRY_FORMAT_LINE;
+  long switches = 0, kept = 0;
+  for (long i = 0; i < count; i++)
+  {
+    telemetry_sample_t s = machine.at(i * SAMPLE_MSEC);
+    s.time = i;
+    switched.push(s);
+    if (noise(20) == 0)
+    {
+      formats = 2 + noise(1); // LINE, CBOR, LINE+CBOR
+      switches++;
+    }
+
+    uint8_t todo = formats & ~switched.batch_sent(), sent = 0;
+    int batch = switched.batch_records() ? switched.batch_records() : TELEMETRY_DRAIN_BATCH, n = 0;
+    std::vector<long> read;
+    telemetry_sample_t r;
+    while (n++ < batch && switched.next(r))
+      read.push_back(r.time);
+    for (uint8_t f = TELEMETRY_FORMAT_LINE; f <= TELEMETRY_FORMAT_CBOR; f <<= 1)
+      if ((todo & f) && noise(3) != 0)
+      {
+        sent |= f;
+        for (long t : read)
+        {
+          check(!(in[t] & f), "published once per format", t, f);
+          in[t] |= f;
+        }
+      }
+    unsigned long published = switched.published();
+    switched.drained(sent, formats);
+    if (switched.published() == published)
+      kept += !read.empty();
+    else
+      for (long t : read)
+        check((in[t] & formats) == formats, "removed when published in the selected formats", in[t], formats);
+  }
+  check(switched.dropped() == 0, "dropped", switched.dropped(), 0);
+  check(switched.published() + switched.pending() == (unsigned long)count, "published + pending",
+        switched.published() + switched.pending(), count);
+  printf("switch: %ld samples, %ld format switches, %ld batches kept for a failed format\n", count, switches, kept);
+}
+
+// Fill the ring with idle samples until the first drop, time the encode and the decode
+static void bench_codec()
+{
+  Machine machine;
+  std::vector<telemetry_sample_t> samples;
+  for (long i = 0; i < 20000; i++)
+    samples.push_back(machine.at(i * SAMPLE_MSEC));
+  ring.clear();
+  TelemetryRing fresh;
+  long fill = 0;
+  while (fresh.dropped() == 0)
+    fresh.push(samples[fill++]);
+  fill--;
+
+  double start = usec();
+  for (auto &s : samples)
+    ring.push(s);
+  double encode = (usec() - start) / samples.size();
+  std::vector<telemetry_sample_t> read(TELEMETRY_BLOCKS * TELEMETRY_BLOCK_SIZE);
+  start = usec();
+  long n = 0;
+  while (ring.next(read[n]))
+    n++;
+  double decode = (usec() - start) / n;
+  ring.commit();
+  for (long i = 0; i < n; i++)
+    check(same(read[i], samples[samples.size() - n + i]), "the newest samples are in the ring", i);
+  check(n > fill - 2 * fill / TELEMETRY_BLOCKS, "idle samples in the ring (the head block is filling)", n, fill);
+  printf("codec: %ld idle samples fill %d bytes, %.1f bytes per sample (with the keyframes), %.0f min at %d sec; "
+         "encode %.3f usec, decode %.3f usec per sample\n", fill, TELEMETRY_BLOCKS * TELEMETRY_BLOCK_SIZE,
+         (double)TELEMETRY_BLOCKS * TELEMETRY_BLOCK_SIZE / fill, fill * (SAMPLE_MSEC / 1000.0) / 60,
+         SAMPLE_MSEC / 1000, encode, decode);
+}
+
+// One hour of the main loop at 100 Hz
+static void bench_rate(const char *name, Machine &machine)
+{
+  TelemetryRing *hour = new TelemetryRing();
+  seed = 1; // the same noise, whatever ran before
+  unsigned long messages = 0, brewing = 0, drain_time = 0;
+  for (uint32_t t = 10; t <= 3600000; t += 10)
+  {
+    const telemetry_sample_t &s = machine.at(t);
+    if (hour->due(s, interval(s)))
+    {
+      hour->push(s);
+      brewing += s.value[TM_BREW] >= BREW_PRE_INFUSE && s.value[TM_BREW] <= BREW_EXTRACT;
+    }
+    if (hour->pending() && t - drain_time >= hour->drain_interval())
+    {
+      telemetry_sample_t r;
+      for (int n = 0; n < TELEMETRY_DRAIN_BATCH && hour->next(r); n++)
+        ;
+      hour->commit();
+      drain_time = t;
+      messages++;
+    }
+  }
+  check(hour->dropped() == 0, "nothing dropped while connected", hour->dropped(), 0);
+  printf("rate: %s: %lu messages, %lu samples per hour", name, messages, hour->pushed());
+  if (machine.shots)
+    printf(", %lu samples per shot of %d sec", brewing / machine.shots, 32);
+  printf(" (before: %d and %d)\n", 3600000 / BEFORE_MSEC, 3600000 / BEFORE_MSEC);
+  delete hour;
+}
+
+// Text and CBOR of a brewing batch: size, encode time, and the lines of ./cbor2line
+static void bench_formats()
+{
+  Machine machine;
+  machine.first_shot = 1000;
+  machine.shot_msec = 600000;
+  std::vector<telemetry_sample_t> batch;
+  for (uint32_t t = 10; batch.size() < TELEMETRY_DRAIN_BATCH; t += 10)
+    if (t >= 10000 && t % TELEMETRY_BUSY_MSEC == 0)
+      batch.push_back(machine.at(t));
+    else
+      machine.at(t);
+  uint64_t epoch_msec = 1750000000000ULL;
+  uint8_t buf[1024];
+  const int runs = 10000;
+  for (size_t n = 1; n <= TELEMETRY_DRAIN_BATCH; n += TELEMETRY_DRAIN_BATCH - 1)
+  {
+    std::vector<telemetry_sample_t> part(batch.begin(), batch.begin() + n);
+    std::string text;
+    double start = usec();
+    for (int i = 0; i < runs; i++)
+    {
+      text.clear();
+      for (size_t j = 0; j < n; j++)
+        text += (j ? "\n" : "") + line(part[j], epoch_msec);
+    }
+    double text_usec = (usec() - start) / runs;
+    size_t size = 0;
+    start = usec();
+    for (int i = 0; i < runs; i++)
+      size = cbor_message(buf, sizeof(buf), part, epoch_msec);
+    double cbor_usec = (usec() - start) / runs;
+    printf("formats: %2zu samples: text %4zu bytes %5.2f usec, cbor %3zu bytes %5.2f usec\n", n, text.size(), text_usec,
+           size, cbor_usec);
+  }
+
+  // the way back: the server converts the CBOR message to the lines of the text format
+  size_t size = cbor_message(buf, sizeof(buf), batch, epoch_msec);
+  char name[] = "/tmp/telemetry_simXXXXXX";
+  int fd = mkstemp(name);
+  check(fd >= 0 && write(fd, buf, size) == (ssize_t)size, "CBOR message written");
+  close(fd);
+  FILE *f = popen((std::string("./cbor2line ") + name).c_str(), "r");
+  check(f != NULL, "./cbor2line runs");
+  char text[4096];
+  size_t i = 0;
+  while (f && fgets(text, sizeof(text), f))
+  {
+    text[strcspn(text, "\n")] = 0;
+    check(i < batch.size() && line(batch[i], epoch_msec) == text, "cbor2line gives the text line", i);
+    i++;
+  }
+  check(f && pclose(f) == 0 && i == batch.size(), "cbor2line lines", i, batch.size());
+  unlink(name);
+}
+
+int main(int argc, char **argv)
+{
+  long count = argc > 1 ? atol(argv[1]) : 20000;
+  test_codec(count);
+  test_switch(count);
+  bench_codec();
+  Machine idle;
+  bench_rate("idle, ready", idle);
+  Machine shots;
+  shots.heat_msec = 600000;
+  shots.first_shot = 900000;
+  shots.shot_msec = 600000;
+  bench_rate("10 min heat-up, 4 shots", shots);
+  bench_formats();
+  printf("%d errors\n", errors);
+  return errors ? 1 : 0;
+}
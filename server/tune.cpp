@@ -0,0 +1,540 @@
+/*
+  tune: identify the thermal model of a boiler from recorded data and recommend PID and feed forward settings
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Input: telemetry lines (ingest, influx_sink or twin -g) or serial logs of print_state() ("setpoint:98.00,
+  power:..."), optionally with the timestamps of the Arduino serial monitor ("12:34:56.789 -> "). Every device is
+  fitted on its own, a serial log is device "serial".
+
+  The data is resampled to 1 second and split at gaps, reboots and when the boiler is off. The model is the one of
+  boiler_model.h, the heater power acting after a dead time and a sensor lag (0: first order plus dead time, FOPDT,
+  else second order, SOPDT):
+      C dTb/dt = heater * P(t - dead) / 100 - loss * (Tb - ambient) - flow * 4.186 * (Tb - inlet)
+      lag dTs/dt = Tb - Ts
+  For every dead time and lag of a grid the heating rate, loss and 1/C follow from linear least squares on the 1 second
+  steps of the boiler temperature (the sensor lag inverted on the smoothed temperature); the best candidates are
+  simulated on 10 minute windows of the data and the one with the smallest RMS error is chosen (output error).
+
+  Settings (SIMC rules for an integrating process with dead time and lag, the loss is slow compared to the control,
+  converted to the parallel form of DpPID):
+      Kc = 1 / (rate * (tc + dead)), Ti = 4 * (tc + dead), Td = lag
+      P = Kc * (1 + Td / Ti), I = Kc / Ti, D = Kc * Td
+      ff_ready = power to hold the setpoint, ff_heat = ff_ready, ff_brew = ff_ready + power for the brew flow
+  The integral is limited to +-7 % (WINDUP_LIMIT), so the feed forward has to be right: settled periods in ready enter
+  the least squares as steady state (dT/dt = 0 on average), which pins the loss.
+  The current settings (-p) and the recommended ones are compared in a simulation of the identified model: heat up
+  from ambient and three shots.
+
+  Usage: tune [-p P,I,D,ff_heat,ff_ready,ff_brew (current)] [-c closed loop time constant sec] [-s setpoint]
+              [-a ambient] [-i serial log interval msec] [file ...]
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+#include "cbor_decoder.h"
+#include "boiler_model.h"
+#include "boiler_control.h"
+
+#define GAP_SEC 120.0       // split the data at larger gaps
+#define DENSE_SEC 2.0       // intervals up to this are used for the regression
+#define SMOOTH 4            // half width of the moving average of the temperature for the sensor lag [samples]
+#define MAX_DEAD 30         // dead times of the grid [sec]
+#define CANDIDATES 3        // dead times simulated per lag
+#define WINDOW_SEC 600      // length of the simulation windows
+#define MIN_POINTS 600      // min points of a device for a fit
+#define DEFAULT_FLOW 1.5    // brew flow when there are no shots in the data [g/s]
+#define SETTLE_SEC 300      // in ready this long: settled
+static const double lags[] = {5, 10, 15, 20, 30, 45, 60, 90}; // sensor lags of the grid [sec]
+
+struct point_t
+{
+  double temp, power, flow;
+  bool dense;
+};
+
+typedef std::vector<point_t> segment_t; // 1 second steps
+
+struct data_t
+{
+  std::vector<segment_t> segments;
+  double flow = DEFAULT_FLOW;                            // mean brew flow [g/s]
+  double ready_sec = 0, ready_power = 0, ready_temp = 0; // settled in ready: duration, mean power and temperature
+};
+
+struct model_t
+{
+  int delay = 0; // dead time [sec]
+  double lag = 0, rate = 0, loss = 0, capacity = 0, fit = 0, rms = -1; // rate: [C/sec per %]
+};
+
+static control_settings_t current;
+static double tc = 60, setpoint = 98, ambient = BOILER_AMBIENT, serial_msec = 500;
+
+static double seconds(uint32_t msec) { return msec / 1000.0; }
+
+// Convert a serial log line of print_state() to a telemetry line
+static bool serial_line(const char *line, std::string &out, uint32_t &msec)
+{
+  int h, m;
+  double s;
+  const char *arrow = strstr(line, " -> ");
+  if (arrow && sscanf(line, "%d:%d:%lf", &h, &m, &s) == 3)
+  {
+    msec = (uint32_t)((h * 3600 + m * 60 + s) * 1000);
+    line = arrow + 4;
+  }
+  else
+    msec += serial_msec;
+  double set, power, average, act, weight, end_weight, level;
+  char boil[32], error[32], brew[32];
+  if (sscanf(line, "setpoint:%lf, power:%lf, average:%lf, act_temp:%lf, boiler-state:%31[^,], boiler-error:%31[^,], "
+                   "brew-state:%31[^,], weight:%lf, end_weight:%lf, reservoir_level:%lf",
+             &set, &power, &average, &act, boil, error, brew, &weight, &end_weight, &level) != 10)
+    return false;
+  char buf[512];
+  snprintf(buf, sizeof(buf), "measurement t_set=%.2f,t_act=%.2f,h_pwr=%.2f,h_avg=%.2f,r_lvl=%.2f,w_cur=%.2f,w_end=%.2f,"
+                             "boil=\"%s\",boil_err=\"%s\",brew=\"%s\",msec=%lu",
+           set, act, power, average, level, weight, end_weight, boil, error, brew, (unsigned long)msec);
+  out = buf;
+  return true;
+}
+
+static bool brewing(const telemetry_point_t &s) { return s.value[TM_BREW] >= BREW_PRE_INFUSE && s.value[TM_BREW] <= BREW_EXTRACT; }
+
+// Resample the samples of a device to 1 second, split in segments
+static void resample(const std::vector<telemetry_point_t> &samples, data_t &d)
+{
+  double brew_weight = 0, brew_time = 0, grid = 0;
+  uint32_t ready_since = 0;
+  segment_t seg;
+  for (size_t i = 1; i < samples.size(); i++)
+  {
+    const telemetry_point_t &a = samples[i - 1], &b = samples[i];
+    double dt = seconds(b.time - a.time);
+    bool off = a.value[TM_BOIL] == BOIL_OFF || a.value[TM_BOIL] == BOIL_ERROR;
+    if ((int32_t)(b.time - a.time) <= 0 || dt > GAP_SEC || off)
+    {
+      if (seg.size() > 1)
+        d.segments.push_back(seg);
+      seg.clear();
+      continue;
+    }
+    if (a.value[TM_BOIL] != BOIL_READY)
+      ready_since = b.time;
+    else if (a.time - ready_since >= SETTLE_SEC * 1000)
+    {
+      d.ready_sec += dt;
+      d.ready_power += a.value[TM_H_AVG] / 10.0 * dt; // the average, telemetry in ready is sparse
+      d.ready_temp += (a.value[TM_T_ACT] + b.value[TM_T_ACT]) / 200.0 * dt;
+    }
+    double rate = brewing(a) ? std::max(0.0, (b.value[TM_W_CUR] - a.value[TM_W_CUR]) / 10.0 / dt) : 0;
+    if (a.value[TM_BREW] == BREW_EXTRACT)
+    {
+      brew_weight += rate * dt;
+      brew_time += dt;
+    }
+    if (seg.empty()) // the 1 second grid starts at the first sample of a segment
+      grid = seconds(a.time);
+    while (grid < seconds(b.time))
+    {
+      double f = (grid - seconds(a.time)) / dt;
+      point_t p;
+      p.temp = (a.value[TM_T_ACT] + f * (b.value[TM_T_ACT] - a.value[TM_T_ACT])) / 100.0;
+      p.power = a.value[TM_H_PWR] / 10.0;
+      p.flow = rate;
+      p.dense = dt <= DENSE_SEC;
+      seg.push_back(p);
+      grid += 1;
+    }
+  }
+  if (seg.size() > 1)
+    d.segments.push_back(seg);
+  if (brew_time > 10)
+    d.flow = brew_weight / brew_time;
+  if (d.ready_sec > 0)
+  {
+    d.ready_power /= d.ready_sec;
+    d.ready_temp /= d.ready_sec;
+  }
+}
+
+// Solve the 3x3 normal equations, false if singular
+static bool solve(const double (&ata)[3][3], const double (&atb)[3], double x[3])
+{
+  double a[3][3], b[3];
+  memcpy(a, ata, sizeof(a));
+  memcpy(b, atb, sizeof(b));
+  for (int c = 0; c < 3; c++)
+  {
+    int pivot = c;
+    for (int r = c + 1; r < 3; r++)
+      if (fabs(a[r][c]) > fabs(a[pivot][c]))
+        pivot = r;
+    if (fabs(a[pivot][c]) < 1e-12)
+      return false;
+    std::swap(a[c], a[pivot]);
+    std::swap(b[c], b[pivot]);
+    for (int r = 0; r < 3; r++)
+      if (r != c)
+      {
+        double f = a[r][c] / a[c][c];
+        for (int k = 0; k < 3; k++)
+          a[r][k] -= f * a[c][k];
+        b[r] -= f * b[c];
+      }
+  }
+  for (int c = 0; c < 3; c++)
+    x[c] = b[c] / a[c][c];
+  return true;
+}
+
+// Boiler temperature from the sensor: the inverse of the sensor lag of BoilerModel with 1 second steps
+static std::vector<double> boiler_temp(const segment_t &seg, double lag)
+{
+  std::vector<double> t(seg.size());
+  for (size_t k = 0; k < seg.size(); k++)
+    t[k] = seg[k].temp;
+  if (lag <= 0)
+    return t;
+  std::vector<double> smooth(seg.size()); // the inverse amplifies the noise (0.01 C resolution) by the lag
+  for (size_t k = 0; k < seg.size(); k++)
+  {
+    double sum = 0;
+    int n = 0;
+    for (long j = (long)k - SMOOTH; j <= (long)k + SMOOTH; j++)
+      if (j >= 0 && j < (long)seg.size())
+        sum += seg[j].temp, n++;
+    smooth[k] = sum / n;
+  }
+  double a = 1 - exp(-1 / lag);
+  for (size_t k = 1; k < seg.size(); k++)
+    t[k] = smooth[k - 1] + (smooth[k] - smooth[k - 1]) / a;
+  t[0] = t.size() > 1 ? t[1] : t[0];
+  return t;
+}
+
+struct runs_t
+{
+  std::vector<int> run;       // length of the dense run up to a point
+  std::vector<size_t> points; // k with k and k + 1 dense, most of the time in ready is not
+};
+
+// Points k that can be used: k - delay .. k + 1 and the smoothing around them are dense
+static bool usable(const std::vector<int> &run, size_t k, int delay, double lag)
+{
+  int margin = lag > 0 ? SMOOTH + 1 : 0;
+  size_t last = k + 1 + margin;
+  long first = (long)k - std::max(delay, margin);
+  return first >= 0 && last < run.size() && run[last] > (long)last - first;
+}
+
+// Least squares for a delay and lag, with the 1 second steps of BoilerModel (Euler):
+//   Tb[k+1] - Tb[k] = rate * P[k - delay] - loss * (Tb[k] - ambient) - flow[k] * 4.186 * (Tb[k] - inlet) / C
+static bool regress(const data_t &d, const std::vector<runs_t> &runs, const std::vector<std::vector<double>> &tb,
+                    int delay, double lag, model_t &m)
+{
+  const std::vector<segment_t> &segments = d.segments;
+  double a[3][3] = {}, b[3] = {}, yy = 0;
+  long n = 0;
+  for (size_t s = 0; s < segments.size(); s++)
+  {
+    const segment_t &seg = segments[s];
+    const std::vector<double> &T = tb[s];
+    for (size_t k : runs[s].points)
+    {
+      if (!usable(runs[s].run, k, delay, lag))
+        continue;
+      double y = T[k + 1] - T[k];
+      double x[3] = {seg[k - delay].power, -(T[k] - ambient), -seg[k].flow * WATER_HEAT * (T[k] - WATER_INLET)};
+      for (int i = 0; i < 3; i++)
+      {
+        for (int j = 0; j < 3; j++)
+          a[i][j] += x[i] * x[j];
+        b[i] += x[i] * y;
+      }
+      yy += y * y;
+      n++;
+    }
+  }
+  if (d.ready_sec > 0) // settled: dT/dt = 0 on average, for every second; pins the loss that transients hardly excite
+  {
+    double x[2] = {d.ready_power, -(d.ready_temp - ambient)};
+    for (int i = 0; i < 2; i++)
+      for (int j = 0; j < 2; j++)
+        a[i][j] += d.ready_sec * x[i] * x[j];
+  }
+  double theta[3];
+  if (n < MIN_POINTS || !solve(a, b, theta) || theta[0] <= 0 || theta[1] < 0)
+    return false;
+  m.delay = delay;
+  m.lag = lag;
+  m.rate = theta[0];
+  m.loss = theta[1];
+  // 1/C is poorly determined without shots: then the nominal heater power is assumed
+  m.capacity = theta[2] > 1e-6 && theta[2] < 1 ? 1 / theta[2] : HEATER_RATED_POWER / (m.rate * 100);
+  double sse = yy; // y'y - theta' X'y
+  for (int i = 0; i < 3; i++)
+    sse -= theta[i] * b[i];
+  m.fit = sse / n;
+  return true;
+}
+
+// Simulate the model on windows of the dense data (an open loop simulation of days drifts away), RMS error
+static double simulate(const data_t &d, const std::vector<runs_t> &runs, const std::vector<std::vector<double>> &tb,
+                       const model_t &m)
+{
+  const std::vector<segment_t> &segments = d.segments;
+  double sum = 0, a = m.lag > 0 ? 1 - exp(-1 / m.lag) : 1;
+  long n = 0;
+  for (size_t s = 0; s < segments.size(); s++)
+  {
+    const segment_t &seg = segments[s];
+    double boiler = 0, sensor = 0;
+    size_t start = 0, last = 0;
+    bool running = false;
+    for (size_t k : runs[s].points)
+    {
+      if (!usable(runs[s].run, k, m.delay, m.lag))
+      {
+        running = false;
+        continue;
+      }
+      if (!running || k != last + 1 || k - start >= WINDOW_SEC)
+      {
+        running = true;
+        start = k;
+        boiler = tb[s][k];
+        sensor = seg[k].temp;
+      }
+      boiler += m.rate * seg[k - m.delay].power - m.loss * (boiler - ambient) -
+                seg[k].flow * WATER_HEAT * (boiler - WATER_INLET) / m.capacity;
+      sensor += (boiler - sensor) * a;
+      sum += (sensor - seg[k + 1].temp) * (sensor - seg[k + 1].temp);
+      n++;
+      last = k;
+    }
+  }
+  return n ? sqrt(sum / n) : -1;
+}
+
+static model_t identify(const data_t &d, bool second_order)
+{
+  const std::vector<segment_t> &segments = d.segments;
+  std::vector<runs_t> runs;
+  for (const segment_t &seg : segments)
+  {
+    runs_t r;
+    r.run.resize(seg.size());
+    for (size_t k = 0; k < seg.size(); k++)
+    {
+      r.run[k] = seg[k].dense ? (k ? r.run[k - 1] : 0) + 1 : 0;
+      if (k && r.run[k] > 1)
+        r.points.push_back(k - 1);
+    }
+    runs.push_back(r);
+  }
+  model_t best;
+  size_t nlags = second_order ? sizeof(lags) / sizeof(lags[0]) : 1;
+  for (size_t l = 0; l < nlags; l++)
+  {
+    double lag = second_order ? lags[l] : 0;
+    std::vector<std::vector<double>> tb;
+    for (const segment_t &seg : segments)
+      tb.push_back(boiler_temp(seg, lag));
+    std::vector<model_t> candidates;
+    for (int delay = 0; delay <= MAX_DEAD; delay++)
+    {
+      model_t m;
+      if (regress(d, runs, tb, delay, lag, m))
+        candidates.push_back(m);
+    }
+    // the equation error ranks the delays, the simulation the candidates and the lags
+    std::sort(candidates.begin(), candidates.end(), [](const model_t &a, const model_t &b) { return a.fit < b.fit; });
+    for (size_t i = 0; i < candidates.size() && i < CANDIDATES; i++)
+    {
+      candidates[i].rms = simulate(d, runs, tb, candidates[i]);
+      if (candidates[i].rms >= 0 && (best.rms < 0 || candidates[i].rms < best.rms))
+        best = candidates[i];
+    }
+  }
+  return best;
+}
+
+static control_settings_t recommend(const model_t &m, double flow)
+{
+  control_settings_t s;
+  double kc = 1 / (m.rate * (tc + m.delay)), ti = 4 * (tc + m.delay); // SIMC, series form with td = lag
+  s.p = kc * (1 + m.lag / ti);
+  s.i = kc / ti;
+  s.d = kc * m.lag;
+  s.ff_ready = std::min(100.0, m.loss * (setpoint - ambient) / m.rate);
+  s.ff_heat = s.ff_ready;
+  s.ff_brew = std::min(100.0, s.ff_ready + flow * WATER_HEAT * (setpoint - WATER_INLET) / m.capacity / m.rate);
+  return s;
+}
+
+struct result_t
+{
+  double heatup = -1, overshoot = 0, rms = 0, drop = 0, recovery = 0;
+};
+
+// Heat up from ambient, then 3 shots of 36 g at the brew flow, 10 minutes apart (like the brew process)
+static result_t compare(const model_t &m, const control_settings_t &s, double flow)
+{
+  result_t r;
+  BoilerModel b;
+  b.heater = m.rate * m.capacity * 100;
+  b.capacity = m.capacity;
+  b.loss = m.loss * m.capacity;
+  b.ambient = ambient;
+  b.dead = m.delay + 1; // BoilerModel applies the power of a step after the next step (1 second steps)
+  b.lag = m.lag;
+  b.reset(ambient);
+  controller_t c;
+  c.begin(s);
+  c.reset(0);
+  int boil = BOIL_HEATING, brew = BREW_IDLE, shots = 0;
+  double weight = 0, phase_end = 0, shot_at = 1200, recovered_at = -1, brew_end = -1, sum = 0;
+  long n = 0;
+  for (int t = 0; t < 1200 + 3 * 600; t++)
+  {
+    double temp = b.temp(), f = 0;
+    if (r.heatup < 0 && fabs(temp - setpoint) < 0.5)
+      r.heatup = t;
+    if (r.heatup >= 0 && shots == 0)
+      r.overshoot = std::max(r.overshoot, temp - setpoint);
+    if (boil == BOIL_HEATING && fabs(setpoint - temp) < BOILER_WINDOW)
+      boil = BOIL_READY;
+    if (brew == BREW_IDLE && t >= shot_at)
+      brew = BREW_PRE_INFUSE, boil = BOIL_BREW, weight = 0, phase_end = t + 3;
+    if (brew == BREW_PRE_INFUSE)
+      f = 1.0;
+    if (brew == BREW_EXTRACT)
+      f = flow;
+    weight += f;
+    if (brew == BREW_PRE_INFUSE && t >= phase_end)
+      brew = BREW_INFUSE, phase_end = t + 4;
+    else if (brew == BREW_INFUSE && t >= phase_end)
+      brew = BREW_EXTRACT;
+    else if (brew == BREW_EXTRACT && weight >= 36)
+      brew = BREW_IDLE, boil = BOIL_HEATING, shots++, shot_at = t + 600, brew_end = t, recovered_at = -1;
+    if (shots > 0 || brew != BREW_IDLE)
+      r.drop = std::max(r.drop, setpoint - temp);
+    if (brew_end >= 0 && recovered_at < 0 && fabs(temp - setpoint) < 0.5)
+      recovered_at = t, r.recovery = std::max(r.recovery, t - brew_end);
+    if (t > 900 && shots == 0) // settled before the first shot
+      sum += (temp - setpoint) * (temp - setpoint), n++;
+    double out = c.compute(s, t * 1000UL, boil, temp, setpoint);
+    b.step(out, f, 1.0);
+  }
+  if (brew_end >= 0 && recovered_at < 0)
+    r.recovery = -1; // did not recover
+  r.rms = n ? sqrt(sum / n) : 0;
+  return r;
+}
+
+static void print_result(const char *name, const control_settings_t &s, const result_t &r)
+{
+  printf("  %-11s P=%.2f I=%.3f D=%.1f ff=%.1f/%.1f/%.1f: heat up %s, overshoot %.2f C, settled %.2f C RMS, "
+         "shot drop %.2f C, recovery %s\n",
+         name, s.p, s.i, s.d, s.ff_heat, s.ff_ready, s.ff_brew,
+         r.heatup < 0 ? "never" : (std::to_string((int)r.heatup) + " s").c_str(), r.overshoot, r.rms, r.drop,
+         r.recovery < 0 ? "never" : (std::to_string((int)r.recovery) + " s").c_str());
+}
+
+static void tune(const std::string &device, const std::vector<telemetry_point_t> &samples)
+{
+  data_t d;
+  resample(samples, d);
+  model_t fo = identify(d, false), so = identify(d, true);
+  printf("%s: %zu samples, %zu segments, %.1f h settled in ready\n", device.c_str(), samples.size(), d.segments.size(),
+         d.ready_sec / 3600);
+  if (fo.rms < 0)
+  {
+    printf("  not enough data with heater power changes\n");
+    return;
+  }
+  printf("  FOPDT: heater %.0f W, capacity %.0f J/K, loss %.2f W/K, dead %d s: RMS %.3f C\n",
+         fo.rate * fo.capacity * 100, fo.capacity, fo.loss * fo.capacity, fo.delay, fo.rms);
+  if (so.rms >= 0)
+    printf("  SOPDT: heater %.0f W, capacity %.0f J/K, loss %.2f W/K, dead %d s, lag %.0f s: RMS %.3f C\n",
+           so.rate * so.capacity * 100, so.capacity, so.loss * so.capacity, so.delay, so.lag, so.rms);
+  const model_t &m = so.rms >= 0 && so.rms < 0.9 * fo.rms ? so : fo; // the second order model if clearly better
+  printf("  model: %s, brew flow %.2f g/s\n", &m == &so ? "SOPDT" : "FOPDT", d.flow);
+  control_settings_t rec = recommend(m, d.flow);
+  print_result("current", current, compare(m, current, d.flow));
+  print_result("recommended", rec, compare(m, rec, d.flow));
+  printf("PUT settings P=%.2f,I=%.3f,D=%.2f,ff_heat=%.2f,ff_ready=%.2f,ff_brew=%.2f\n", rec.p, rec.i, rec.d, rec.ff_heat,
+         rec.ff_ready, rec.ff_brew);
+}
+
+static void read_file(FILE *f, std::map<std::string, std::vector<telemetry_point_t>> &devices)
+{
+  char line[4096];
+  std::string device, text;
+  telemetry_point_t sample;
+  uint32_t msec = 0;
+  while (fgets(line, sizeof(line), f))
+  {
+    if (telemetry_parse(line, sample, &device))
+      devices[device.empty() ? "telemetry" : device].push_back(sample);
+    else if (serial_line(line, text, msec) && telemetry_parse(text.c_str(), sample))
+      devices["serial"].push_back(sample);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  int opt;
+  while ((opt = getopt(argc, argv, "p:c:s:a:i:")) != -1)
+    switch (opt)
+    {
+    case 'p':
+      if (sscanf(optarg, "%lf,%lf,%lf,%lf,%lf,%lf", &current.p, &current.i, &current.d, &current.ff_heat,
+                 &current.ff_ready, &current.ff_brew) < 3)
+      {
+        fprintf(stderr, "tune: -p P,I,D[,ff_heat,ff_ready,ff_brew]\n");
+        return 1;
+      }
+      break;
+    case 'c': tc = std::max(1.0, atof(optarg)); break;
+    case 's': setpoint = atof(optarg); break;
+    case 'a': ambient = atof(optarg); break;
+    case 'i': serial_msec = std::max(1.0, atof(optarg)); break;
+    default:
+      fprintf(stderr, "usage: tune [-p P,I,D,ff_heat,ff_ready,ff_brew] [-c tc sec] [-s setpoint] [-a ambient] "
+                      "[-i serial log msec] [file ...]\n");
+      return 1;
+    }
+  auto start = std::chrono::steady_clock::now();
+  std::map<std::string, std::vector<telemetry_point_t>> devices;
+  if (optind == argc)
+    read_file(stdin, devices);
+  for (int i = optind; i < argc; i++)
+  {
+    FILE *f = fopen(argv[i], "r");
+    if (!f)
+    {
+      perror(argv[i]);
+      return 1;
+    }
+    read_file(f, devices);
+    fclose(f);
+  }
+  size_t samples = 0;
+  for (auto &d : devices)
+  {
+    tune(d.first, d.second);
+    samples += d.second.size();
+  }
+  fprintf(stderr, "tune: %zu devices, %zu samples in %.2f sec\n", devices.size(), samples,
+          std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+  return 0;
+}
@@ -0,0 +1,546 @@
+/*
+  twin: digital twin of every machine, flags machines whose thermal response diverges from the expected
+  (c) 2025 diyPresso - CC-BY-NC
+
+  For every machine (device tag) the telemetry (t_set, t_act, h_pwr, boiler and brew state, brew weight) is run
+  through the firmware controller (the real DpPID of dp_pid.cpp, with the feed forward of the boiler state like
+  BoilerStateMachine) and a model of the nominal boiler (boiler_model.h):
+  - twin: the controller and the nominal boiler in a closed loop, with the setpoint, the boiler state and the water
+    flow of the machine. It starts from the machine at every boiler state change and follows it through the
+    transient (heating up, a shot and the recovery) if the machine behaves like a nominal one.
+  - shadow: the controller on the measured temperature, its output should match the reported heater power.
+  - plant: the heating rate per % of heater power and the heat loss, estimated (recursive least squares) from the
+    measured temperature change and the reported heater power.
+  Flags (with hysteresis, after TWIN_MIN_SAMPLES samples):
+    HEATER    the heating rate is below 80 % of the nominal: heater element or SSR degrading
+    RESPONSE  the twin diverges from the machine in transients, more than 1.5 % of the temperature change on
+              average: heater, scale, sensor or a different boiler
+    TUNING    the temperature error when settled is more than 0.5 C RMS: bad P/I/D for this machine
+    CONTROL   the heater power differs from the controller output: other settings than assumed (-p), or firmware
+  Every worker thread of the pool owns the machines that hash to it, the samples are dispatched in blocks.
+
+  Usage: twin [-t threads] [-p P,I,D,ff_heat,ff_ready,ff_brew] [-q] [file ...]   recorded lines (ingest/influx_sink)
+         twin -m broker[:port] [-t threads] [-p ...] [-q]                          live telemetry
+         twin -g machines [-d hours] [-r seed]                                     write a synthetic trace to stdout
+  The synthetic trace runs the same controller on boilers of which some are worn: every 10th machine from the
+  second has a weak heater (70 %), from the third other settings (P 25, I 0.5, D 0) and from the fourth scale or a
+  slow sensor (dead time 15 sec, sensor lag 40 sec).
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <signal.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include "mqtt.h"
+#include "cbor_decoder.h"
+#include "boiler_model.h"
+#include "boiler_control.h"
+
+#define TWIN_GAP_MSEC 120000     // a larger gap between samples restarts the twin
+#define TWIN_HORIZON_MSEC 60000  // the twin restarts from the machine after this time when settled
+#define TWIN_MIN_RISE 5.0        // min temperature change of a transient to judge the divergence [C]
+#define TWIN_MIN_SAMPLES 300
+#define TWIN_FORGET 0.9995       // forgetting factor of the plant estimate (per sample)
+#define TWIN_MAX_RLS_MSEC 10000  // longer intervals are not used for the plant estimate
+#define TWIN_EXCITATION 2e5      // min information (sum of power^2) before HEATER is judged
+#define TWIN_BLOCK 1024          // samples per dispatch to a worker
+#define TWIN_SETTLE_MSEC 300000  // ready this long after heating or a shot: settled
+
+enum { FLAG_HEATER = 1, FLAG_RESPONSE = 2, FLAG_TUNING = 4, FLAG_CONTROL = 8 };
+static const char *flag_names[] = {"HEATER", "RESPONSE", "TUNING", "CONTROL"};
+
+struct machine_t
+{
+  std::string device;
+  telemetry_point_t prev;
+  bool started = false;
+  controller_t twin, shadow;
+  BoilerModel model;
+  unsigned long twin_time = 0, horizon = 0, ready_time = 0; // start of the twin run and of the ready state
+  double theta[2], cov[2][2], excitation = 0; // plant estimate: heating rate per %, loss rate
+  unsigned long samples = 0, resyncs = 0;
+  double divergence = 0, control = 0, ready_sq = 0, start_temp = 0;
+  unsigned flags = 0;
+};
+
+static control_settings_t settings;
+static int threads = 0;
+static bool quiet = false;
+static std::mutex print_lock;
+static std::atomic<unsigned long long> total_samples(0);
+
+static double temp(const telemetry_point_t &s, int field) { return s.value[field] / 100.0; }
+static double power(const telemetry_point_t &s) { return s.value[TM_H_PWR] / 10.0; }
+static bool brewing(const telemetry_point_t &s) { return s.value[TM_BREW] >= BREW_PRE_INFUSE && s.value[TM_BREW] <= BREW_EXTRACT; }
+
+static void ewma(double &avg, double value, double alpha) { avg += alpha * (value - avg); }
+
+// Start a twin run from the state of the machine, with the integral of the controller of the machine
+static void restart(machine_t &m, const telemetry_point_t &s)
+{
+  m.model.reset(temp(s, TM_T_ACT));
+  m.twin.reset(s.time);
+  m.twin.pid.setIntegral(m.shadow.pid.I());
+  m.twin_time = m.horizon = s.time;
+  m.start_temp = temp(s, TM_T_ACT);
+}
+
+static void resync(machine_t &m, const telemetry_point_t &s)
+{
+  m.shadow.reset(s.time);
+  restart(m, s);
+  m.resyncs++;
+}
+
+// Recursive least squares: dT/dt + flow load = gain * power - loss * (T - ambient)
+static void estimate(machine_t &m, double x0, double x1, double y)
+{
+  double p0 = m.cov[0][0] * x0 + m.cov[0][1] * x1, p1 = m.cov[1][0] * x0 + m.cov[1][1] * x1;
+  double denom = TWIN_FORGET + x0 * p0 + x1 * p1;
+  double k0 = p0 / denom, k1 = p1 / denom;
+  double e = y - (m.theta[0] * x0 + m.theta[1] * x1);
+  m.theta[0] += k0 * e;
+  m.theta[1] += k1 * e;
+  double c00 = m.cov[0][0] - k0 * p0, c01 = m.cov[0][1] - k0 * p1, c11 = m.cov[1][1] - k1 * p1;
+  m.cov[0][0] = c00 / TWIN_FORGET;
+  m.cov[0][1] = m.cov[1][0] = c01 / TWIN_FORGET;
+  m.cov[1][1] = c11 / TWIN_FORGET;
+  m.excitation = m.excitation * TWIN_FORGET + x0 * x0;
+}
+
+static void flag(machine_t &m, int flag, bool set, bool clear, const telemetry_point_t &s, const char *detail)
+{
+  bool was = m.flags & flag;
+  if (was ? !clear : !set)
+    return;
+  m.flags ^= flag;
+  if (quiet)
+    return;
+  int bit = 0;
+  while (!(flag & (1 << bit)))
+    bit++;
+  std::lock_guard<std::mutex> lock(print_lock);
+  printf("%s %c%s %s (msec %lu)\n", m.device.c_str(), was ? '-' : '+', flag_names[bit], detail, (unsigned long)s.time);
+}
+
+static void process(machine_t &m, const telemetry_point_t &s)
+{
+  if (!m.started)
+  {
+    m.started = true;
+    m.twin.begin(settings);
+    m.shadow.begin(settings);
+    m.theta[0] = m.model.gain();
+    m.theta[1] = m.model.loss / m.model.capacity;
+    m.cov[0][0] = 1e-6;
+    m.cov[1][1] = 1e-8;
+    m.cov[0][1] = m.cov[1][0] = 0;
+    m.prev = s;
+    resync(m, s);
+    return;
+  }
+  const telemetry_point_t &p = m.prev;
+  int32_t dt = (int32_t)(s.time - p.time);
+  if (dt <= 0 && dt > -1000)
+    return; // same time: no information
+  m.samples++;
+  if (dt < 0 || dt > TWIN_GAP_MSEC || s.value[TM_BOIL] == BOIL_OFF || s.value[TM_BOIL] == BOIL_ERROR)
+  {
+    resync(m, s); // restart, gap or controller off
+    m.prev = s;
+    return;
+  }
+  double sec = dt / 1000.0;
+  double flow = brewing(p) ? std::max(0.0, (s.value[TM_W_CUR] - p.value[TM_W_CUR]) / 10.0 / sec) : 0;
+
+  // twin: the controller and the nominal boiler, in the control steps of the firmware
+  while (m.twin_time + BOILER_CONTROL_MSEC <= s.time)
+  {
+    m.twin_time += BOILER_CONTROL_MSEC;
+    double out = m.twin.compute(settings, m.twin_time, p.value[TM_BOIL], m.model.temp(), temp(p, TM_T_SET));
+    m.model.step(out, flow, BOILER_CONTROL_MSEC / 1000.0);
+  }
+  double error = m.model.temp() - temp(s, TM_T_ACT);
+  int boil = s.value[TM_BOIL];
+  if (boil == BOIL_READY && p.value[TM_BOIL] != BOIL_READY)
+    m.ready_time = s.time;
+  bool settled = boil == BOIL_READY && s.time - m.ready_time >= TWIN_SETTLE_MSEC;
+
+  // shadow: the controller on the measured temperature
+  double out = m.shadow.compute(settings, s.time, boil, temp(s, TM_T_ACT), temp(s, TM_T_SET));
+
+  // A twin run lasts a transient (heating up, a shot and the recovery), or a minute when settled
+  if (boil != p.value[TM_BOIL] || (settled && s.time - m.horizon >= TWIN_HORIZON_MSEC))
+  {
+    double rise = fabs(temp(s, TM_T_ACT) - m.start_temp);
+    if (!settled && rise >= TWIN_MIN_RISE)
+      ewma(m.divergence, fabs(error) / rise * 100, 0.3);
+    restart(m, s);
+  }
+  if (boil == BOIL_READY && dt <= 2 * BOILER_CONTROL_MSEC)
+    ewma(m.control, fabs(power(s) - out), 0.02);
+  if (settled)
+    ewma(m.ready_sq, pow(temp(s, TM_T_ACT) - temp(s, TM_T_SET), 2), 0.005);
+
+  // plant: heating rate and loss
+  if (dt <= TWIN_MAX_RLS_MSEC)
+  {
+    double t0 = temp(p, TM_T_ACT);
+    double y = (temp(s, TM_T_ACT) - t0) / sec + flow * WATER_HEAT * (t0 - WATER_INLET) / m.model.capacity;
+    estimate(m, power(p), -(t0 - m.model.ambient), y);
+  }
+  m.prev = s;
+
+  if (m.samples < TWIN_MIN_SAMPLES)
+    return;
+  char detail[64];
+  double ratio = m.theta[0] / m.model.gain();
+  snprintf(detail, sizeof(detail), "heating rate %.0f %%", ratio * 100);
+  flag(m, FLAG_HEATER, m.excitation > TWIN_EXCITATION && ratio < 0.80, ratio > 0.85, s, detail);
+  snprintf(detail, sizeof(detail), "divergence %.2f %%", m.divergence);
+  flag(m, FLAG_RESPONSE, m.divergence > 1.5, m.divergence < 1.0, s, detail);
+  double rms = sqrt(m.ready_sq);
+  snprintf(detail, sizeof(detail), "ready error %.2f C RMS", rms);
+  flag(m, FLAG_TUNING, rms > 0.5, rms < 0.35, s, detail);
+  snprintf(detail, sizeof(detail), "power differs %.1f %%", m.control);
+  flag(m, FLAG_CONTROL, m.control > 10, m.control < 7, s, detail);
+}
+
+typedef std::pair<std::string, telemetry_point_t> job_t;
+
+class Worker
+{
+public:
+  void start() { _thread = std::thread(&Worker::run, this); }
+  void push(std::vector<job_t> &jobs)
+  {
+    std::lock_guard<std::mutex> lock(_lock);
+    _queue.push_back(std::vector<job_t>());
+    _queue.back().swap(jobs);
+    _cv.notify_one();
+  }
+  void stop()
+  {
+    {
+      std::lock_guard<std::mutex> lock(_lock);
+      _done = true;
+      _cv.notify_one();
+    }
+    _thread.join();
+  }
+  // Call after stop(), or while the worker is idle
+  std::unordered_map<std::string, std::unique_ptr<machine_t>> &machines() { return _machines; }
+
+private:
+  std::thread _thread;
+  std::mutex _lock;
+  std::condition_variable _cv;
+  std::deque<std::vector<job_t>> _queue;
+  std::unordered_map<std::string, std::unique_ptr<machine_t>> _machines;
+  bool _done = false;
+
+  void run()
+  {
+    for (;;)
+    {
+      std::vector<job_t> jobs;
+      {
+        std::unique_lock<std::mutex> lock(_lock);
+        _cv.wait(lock, [this] { return _done || !_queue.empty(); });
+        if (_queue.empty())
+          return;
+        jobs.swap(_queue.front());
+        _queue.pop_front();
+      }
+      for (job_t &job : jobs)
+      {
+        std::unique_ptr<machine_t> &m = _machines[job.first];
+        if (!m)
+        {
+          m.reset(new machine_t());
+          m->device = job.first;
+        }
+        process(*m, job.second);
+      }
+      total_samples += jobs.size();
+    }
+  }
+};
+
+static std::vector<Worker *> workers;
+static std::vector<std::vector<job_t>> blocks;
+static std::hash<std::string> hasher;
+
+static void dispatch(const std::string &device, const telemetry_point_t &sample)
+{
+  size_t w = hasher(device) % workers.size();
+  blocks[w].push_back(job_t(device, sample));
+  if (blocks[w].size() >= TWIN_BLOCK)
+    workers[w]->push(blocks[w]);
+}
+
+static void flush()
+{
+  for (size_t w = 0; w < workers.size(); w++)
+    if (!blocks[w].empty())
+      workers[w]->push(blocks[w]);
+}
+
+static void report()
+{
+  std::map<std::string, machine_t *> all;
+  for (Worker *w : workers)
+    for (auto &m : w->machines())
+      all[m.first] = m.second.get();
+  printf("%-16s %8s %7s %7s %7s %7s %7s %7s  %s\n", "device", "samples", "resyncs", "heating", "loss", "diverge", "ready",
+         "control", "flags");
+  for (auto &i : all)
+  {
+    machine_t &m = *i.second;
+    printf("%-16s %8lu %7lu %6.0f%% %6.0f%% %7.2f %7.2f %7.1f ", m.device.c_str(), m.samples, m.resyncs,
+           m.theta[0] / m.model.gain() * 100, m.theta[1] / (m.model.loss / m.model.capacity) * 100, m.divergence,
+           sqrt(m.ready_sq), m.control);
+    for (int f = 0; f < 4; f++)
+      if (m.flags & (1 << f))
+        printf(" %s", flag_names[f]);
+    printf("\n");
+  }
+}
+
+static int read_file(FILE *f)
+{
+  char line[4096];
+  std::string device;
+  telemetry_point_t sample;
+  int n = 0;
+  while (fgets(line, sizeof(line), f))
+    if (telemetry_parse(line, sample, &device))
+    {
+      dispatch(device, sample);
+      n++;
+    }
+  return n;
+}
+
+static std::atomic<bool> stopping(false);
+static void stop(int) { stopping = true; }
+
+static void live(const std::string &host, int port)
+{
+  MqttConnection mqtt;
+  mqtt.on_message([](const std::string &topic, const uint8_t *payload, size_t size) {
+    std::string device = topic.substr(strlen("diyPressoOne/"));
+    bool cbor = device.size() > 5 && device.compare(device.size() - 5, 5, "/cbor") == 0;
+    if (cbor)
+    {
+      device.resize(device.size() - 5);
+      std::vector<telemetry_point_t> samples;
+      if (telemetry_decode(payload, size, samples))
+        for (const telemetry_point_t &s : samples)
+          dispatch(device, s);
+      return;
+    }
+    std::string text((const char *)payload, size);
+    telemetry_point_t s;
+    for (size_t pos = 0; pos < text.size();)
+    {
+      size_t eol = text.find('\n', pos);
+      if (eol == std::string::npos)
+        eol = text.size();
+      std::string line = text.substr(pos, eol - pos);
+      if (telemetry_parse(line.c_str(), s))
+        dispatch(device, s);
+      pos = eol + 1;
+    }
+  });
+  while (!stopping)
+  {
+    if (!mqtt.connect(host, port, "diyPresso-twin-" + std::to_string(getpid())) || !mqtt.subscribe("diyPressoOne/+") ||
+        !mqtt.subscribe("diyPressoOne/+/cbor"))
+    {
+      fprintf(stderr, "twin: cannot connect to %s:%d\n", host.c_str(), port);
+      mqtt.close();
+      sleep(5);
+      continue;
+    }
+    long flushed = now_msec();
+    while (!stopping && mqtt.poll(100) >= 0)
+      if (now_msec() - flushed > 1000) // live samples do not fill a block
+      {
+        flush();
+        flushed = now_msec();
+      }
+  }
+  flush();
+}
+
+// Synthetic trace: the firmware controller on a boiler model, with the telemetry rate policy (simplified)
+static void generate(int machines, double hours, int seed)
+{
+  for (int i = 0; i < machines; i++)
+  {
+    std::mt19937 random(seed * 1000003 + i);
+    std::uniform_real_distribution<double> uniform(0, 1);
+    control_settings_t s;
+    BoilerModel model;
+    model.heater *= 0.95 + 0.1 * uniform(random);
+    model.loss *= 0.9 + 0.2 * uniform(random);
+    if (i % 10 == 1)
+      model.heater *= 0.7;
+    if (i % 10 == 2)
+      s.p = 25, s.i = 0.5, s.d = 0;
+    if (i % 10 == 3)
+      model.dead = 15, model.lag = 40;
+    char device[32];
+    snprintf(device, sizeof(device), "measurement,device=D1E5%08X", i);
+    controller_t c;
+    c.begin(s);
+    model.reset(BOILER_AMBIENT);
+    c.reset(0);
+    int boil = BOIL_HEATING, brew = BREW_IDLE, shots = 0;
+    double weight = 0, end_weight = 0, shot_at = 600 + 1200 * uniform(random), phase_end = 0;
+    telemetry_point_t last = {};
+    bool first = true;
+    for (unsigned long msec = 0; msec < hours * 3600000; msec += BOILER_CONTROL_MSEC)
+    {
+      double t = msec / 1000.0, flow = 0;
+      double act = model.temp();
+      if (boil == BOIL_HEATING && fabs(98 - act) < BOILER_WINDOW)
+        boil = BOIL_READY;
+      if (boil == BOIL_READY && brew == BREW_IDLE && t >= shot_at)
+      {
+        brew = BREW_PRE_INFUSE, boil = BOIL_BREW, weight = 0, phase_end = t + 3;
+      }
+      if (brew == BREW_PRE_INFUSE)
+        flow = 1.0;
+      if (brew == BREW_EXTRACT)
+        flow = 1.5;
+      weight += flow;
+      if (brew == BREW_PRE_INFUSE && t >= phase_end)
+        brew = BREW_INFUSE, phase_end = t + 4;
+      else if (brew == BREW_INFUSE && t >= phase_end)
+        brew = BREW_EXTRACT;
+      else if (brew == BREW_EXTRACT && weight >= 36)
+        brew = BREW_FINISHED, boil = BOIL_HEATING, end_weight = weight, shots++, phase_end = t + 5;
+      else if (brew == BREW_FINISHED && t >= phase_end)
+        brew = BREW_IDLE, shot_at = t + 600 + 1200 * uniform(random);
+      double out = c.compute(s, msec, boil, act, 98.0);
+      model.step(out, flow, BOILER_CONTROL_MSEC / 1000.0);
+
+      telemetry_point_t sample = {};
+      sample.time = msec;
+      sample.value[TM_T_SET] = 9800;
+      sample.value[TM_T_ACT] = lround(model.temp() * 100);
+      sample.value[TM_H_PWR] = lround(out * 10);
+      sample.value[TM_H_AVG] = sample.value[TM_H_PWR];
+      sample.value[TM_R_LVL] = 800;
+      sample.value[TM_W_CUR] = lround(weight * 10);
+      sample.value[TM_W_END] = lround(end_weight * 10);
+      sample.value[TM_SHOTS] = shots;
+      sample.value[TM_BOIL] = boil;
+      sample.value[TM_BREW] = brew;
+      bool due = first || boil != last.value[TM_BOIL] || brew != last.value[TM_BREW] || boil != BOIL_READY ||
+                 abs(sample.value[TM_T_ACT] - last.value[TM_T_ACT]) > 20 || msec - last.time >= 60000;
+      if (!due)
+        continue;
+      printf("%s\n", telemetry_line(sample, device).c_str());
+      last = sample;
+      first = false;
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  std::string broker;
+  int broker_port = 1883, generate_machines = 0, seed = 1;
+  double hours = 6;
+  int opt;
+  while ((opt = getopt(argc, argv, "m:t:p:qg:d:r:")) != -1)
+    switch (opt)
+    {
+    case 'm':
+    {
+      broker = optarg;
+      size_t colon = broker.rfind(':');
+      if (colon != std::string::npos)
+      {
+        broker_port = atoi(broker.c_str() + colon + 1);
+        broker.resize(colon);
+      }
+      break;
+    }
+    case 't': threads = std::max(1, atoi(optarg)); break;
+    case 'p':
+      if (sscanf(optarg, "%lf,%lf,%lf,%lf,%lf,%lf", &settings.p, &settings.i, &settings.d, &settings.ff_heat,
+                 &settings.ff_ready, &settings.ff_brew) < 3)
+      {
+        fprintf(stderr, "twin: -p P,I,D[,ff_heat,ff_ready,ff_brew]\n");
+        return 1;
+      }
+      break;
+    case 'q': quiet = true; break;
+    case 'g': generate_machines = std::max(1, atoi(optarg)); break;
+    case 'd': hours = atof(optarg); break;
+    case 'r': seed = atoi(optarg); break;
+    default:
+      fprintf(stderr, "usage: twin [-t threads] [-p P,I,D,ff_heat,ff_ready,ff_brew] [-q] [file ...]\n"
+                      "       twin -m broker[:port] [-t threads] [-p ...] [-q]\n"
+                      "       twin -g machines [-d hours] [-r seed]\n");
+      return 1;
+    }
+  if (generate_machines)
+  {
+    generate(generate_machines, hours, seed);
+    return 0;
+  }
+  if (!threads)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  for (int i = 0; i < threads; i++)
+  {
+    workers.push_back(new Worker());
+    workers.back()->start();
+  }
+  blocks.resize(threads);
+
+  long start = now_msec();
+  if (!broker.empty())
+  {
+    signal(SIGINT, stop);
+    signal(SIGTERM, stop);
+    live(broker, broker_port);
+  }
+  else if (optind == argc)
+    read_file(stdin);
+  else
+    for (int i = optind; i < argc; i++)
+    {
+      FILE *f = fopen(argv[i], "r");
+      if (!f)
+      {
+        perror(argv[i]);
+        return 1;
+      }
+      read_file(f);
+      fclose(f);
+    }
+  flush();
+  for (Worker *w : workers)
+    w->stop();
+  report();
+  fprintf(stderr, "twin: %llu samples in %.2f sec, %d threads\n", (unsigned long long)total_samples,
+          (now_msec() - start) / 1000.0, threads);
+  return 0;
+}
@@ -0,0 +1,272 @@
+/*
+  Host test of the Wifi connection manager of the firmware (diyp-controller/dp_wifi.cpp) on a stand-in Wifi module
+  (c) 2025 diyPresso - CC-BY-NC
+
+  Runs WifiManager and ConfigPortal of the firmware on the emulated NINA module of arduino/WiFiNINA.h, with the
+  stand-in for the credential store of EasyWiFi (arduino/EasyWiFi.cpp), on the simulated clock. Check:
+  - no module: begin() does nothing;
+  - wrong stored credentials and never connected: the attempts are retried after 1, 2 and 4 sec, the fourth failure
+    opens the configuration portal;
+  - the portal answers DNS with its own address and serves the form; the credentials posted are stored, the portal
+    closes and the machine connects;
+  - a dropped link is noticed within WIFI_CHECK_MSEC and reconnected after the backoff;
+  - a network out of range: every attempt ends by the timeout, the backoff doubles up to WIFI_BACKOFF_MAX_MSEC, and
+    the portal is not opened once a connection was made;
+  - STOP returns to idle from every state; during a DNS lookup it disconnects once the module answered, and when the
+    module does not answer it gives up after WIFI_RESOLVE_TIMEOUT_MSEC;
+  - a storm of starts, stops, dropped links and lookups: the manager connects again afterwards;
+  - every run() makes at most one status poll of the module, and polls at most every WIFI_POLL_MSEC while it connects;
+  - no loop pass waits for the module: the time of every run() on the clock, which a command that waits for the
+    module advances, is at most PASS_MSEC.
+
+  usage: wifi_sim
+*/
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "../diyp-controller/dp_wifi.h"
+#include "../diyp-controller/dp_portal.h"
+
+#define STEP_MSEC 10 // loop period
+#define PASS_MSEC 1  // max duration of a run() [msec]
+#define DNS_SLOW_MSEC 3000
+#define DNS_HUNG_MSEC 60000
+
+static int errors = 0;
+
+static void check(bool ok, const char *what, long got = 0, long expect = 0)
+{
+  if (!ok && errors++ < 20)
+    printf("FAIL %s: %ld, expected %ld\n", what, got, expect);
+}
+
+static NinaHost &nina = nina_host();
+static unsigned long max_polls = 0, polls_connecting = 0, msec_connecting = 0, max_pass = 0;
+
+// One pass of the main loop
+static void step()
+{
+  host_clock() += STEP_MSEC;
+  unsigned long polls = nina.status_calls, start = millis();
+  wifiManager.run();
+  max_polls = std::max(max_polls, nina.status_calls - polls);
+  max_pass = std::max(max_pass, millis() - start);
+  if (strcmp(wifiManager.get_state_name(), "connecting") == 0)
+    polls_connecting += nina.status_calls - polls, msec_connecting += STEP_MSEC;
+}
+
+// Run the loop until the state is reached, returns the time it took [msec] or -1
+static long run_until(const char *state, long max_msec)
+{
+  for (long t = 0; t <= max_msec; t += STEP_MSEC)
+  {
+    if (strcmp(wifiManager.get_state_name(), state) == 0)
+      return t;
+    step();
+  }
+  printf("  still %s after %ld msec, expected %s\n", wifiManager.get_state_name(), max_msec, state);
+  return -1;
+}
+
+// A DNS query of an A record
+static std::string dns_query(uint16_t id, const char *name)
+{
+  std::string q = {char(id >> 8), char(id), 1, 0, 0, 1, 0, 0, 0, 0, 0, 0};
+  for (const char *label = name; *label;)
+  {
+    const char *dot = strchr(label, '.');
+    size_t len = dot ? dot - label : strlen(label);
+    q += char(len);
+    q.append(label, len);
+    label += len + (dot ? 1 : 0);
+  }
+  q += std::string("\0\0\1\0\1", 5);
+  return q;
+}
+
+// Send a request to the portal and run the loop until it answered, returns the response
+static std::string http(const std::string &request)
+{
+  int sock = nina.connect(request);
+  check(sock >= 0, "the portal listens");
+  if (sock < 0)
+    return "";
+  for (int i = 0; i < 100 && nina.sockets[sock].used; i++)
+    step();
+  check(!nina.sockets[sock].used, "the portal closed the connection");
+  return nina.sockets[sock].tx;
+}
+
+static void test_no_module()
+{
+  nina.present = false;
+  wifiManager.begin();
+  check(run_until("idle", 0) == 0, "no module: idle");
+  for (int i = 0; i < 100; i++)
+    step();
+  check(nina.associations == 0, "no module: no association");
+  nina.present = true;
+}
+
+static void test_portal()
+{
+  nina.stored_ssid = "home";
+  nina.stored_pass = "wrong";
+  nina.networks = {{"home", "secret"}, {"cafe <free>", ""}};
+  wifiManager.begin();
+  unsigned long start[WIFI_PORTAL_FAILURES];
+  for (int i = 0; i < WIFI_PORTAL_FAILURES; i++)
+  {
+    check(run_until("connecting", 10000) >= 0, "attempt");
+    start[i] = millis();
+    check(run_until(i + 1 < WIFI_PORTAL_FAILURES ? "backoff" : "portal", 10000) >= 0, "attempt failed");
+  }
+  for (int i = 1; i < WIFI_PORTAL_FAILURES; i++) // association, poll and backoff
+  {
+    long gap = start[i] - start[i - 1], expect = nina.associate_msec + (WIFI_BACKOFF_MIN_MSEC << (i - 1));
+    check(gap >= expect && gap <= expect + WIFI_POLL_MSEC + 2 * STEP_MSEC, "retry after the backoff", gap, expect);
+  }
+  check(nina.associations == WIFI_PORTAL_FAILURES, "attempts", nina.associations, WIFI_PORTAL_FAILURES);
+  check(wifiManager.is_portal(), "portal after the failures");
+
+  for (int i = 0; i < 500 && strcmp(configPortal.get_state_name(), "listen") != 0; i++)
+    step();
+  check(nina.scans == 1 && nina.ap == "diyPresso-One", "access point");
+  nina.udp_rx.push_back({IPAddress(192, 168, 11, 2), 5353, dns_query(0x1234, "connectivitycheck.gstatic.com")});
+  step();
+  std::string answer = nina.udp_tx.empty() ? "" : nina.udp_tx.front().data;
+  check(answer.size() > 4 && answer.compare(answer.size() - 4, 4, "\xC0\xA8\x0B\x01") == 0, "DNS answer: the portal");
+  std::string form = http("GET / HTTP/1.1\r\nHost: diyPresso\r\n\r\n");
+  check(form.find("<option value=\"cafe &lt;free&gt;\">") != std::string::npos, "the form lists the networks");
+  std::string body = "XXID=home&XXPS=secret&action=Submit";
+  std::string thanks = http("POST / HTTP/1.1\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body);
+  check(thanks.find("Thank you") != std::string::npos, "confirmation page");
+  check(run_until("connected", 10000) >= 0, "connected with the credentials of the portal");
+  check(nina.stores == 1 && nina.stored_pass == "secret", "credentials stored");
+  check(!configPortal.is_open(), "portal closed");
+}
+
+static void test_drop()
+{
+  unsigned long attempts = wifiManager.attempts();
+  nina.link = false;
+  long t = run_until("backoff", 5000);
+  check(t >= 0 && t <= WIFI_CHECK_MSEC + STEP_MSEC, "link loss noticed [msec]", t, WIFI_CHECK_MSEC);
+  nina.link = true;
+  t = run_until("connected", 10000);
+  check(t >= 0 && t <= WIFI_BACKOFF_MIN_MSEC + (long)nina.associate_msec + WIFI_POLL_MSEC + 2 * STEP_MSEC,
+        "reconnected [msec]", t, WIFI_BACKOFF_MIN_MSEC + nina.associate_msec);
+  check(wifiManager.drops() == 1 && wifiManager.attempts() == attempts + 1, "one drop, one attempt");
+}
+
+// STOP while the module runs a DNS lookup, which the DNS server answers late and not at all
+static void test_stop_lookup()
+{
+  unsigned long disconnects = nina.disconnects;
+  nina.dns_msec = DNS_SLOW_MSEC;
+  check(wifiManager.resolve("broker.local"), "lookup started");
+  step();
+  wifiManager.end();
+  long t = run_until("idle", WIFI_RESOLVE_TIMEOUT_MSEC + 100);
+  check(t >= 0 && t <= DNS_SLOW_MSEC, "stop during a lookup: after the answer [msec]", t, DNS_SLOW_MSEC);
+  check(nina.disconnects == disconnects + 1 && nina.status == WL_DISCONNECTED, "disconnected after the lookup");
+  check(!wifiManager.busy(), "not busy after the stop");
+
+  wifiManager.begin();
+  check(run_until("connected", 10000) >= 0, "connected");
+  nina.dns_msec = DNS_HUNG_MSEC;
+  check(wifiManager.resolve("broker.local"), "lookup started");
+  step();
+  wifiManager.end();
+  t = run_until("idle", WIFI_RESOLVE_TIMEOUT_MSEC + 100);
+  check(t >= WIFI_RESOLVE_TIMEOUT_MSEC - STEP_MSEC, "stop during a hung lookup: the timeout [msec]", t,
+        WIFI_RESOLVE_TIMEOUT_MSEC);
+  check(nina.disconnects == disconnects + 1 && !wifiManager.busy(), "left without a command");
+  while (!nina.ready()) // the module gives up by itself, idle sends it nothing
+    step();
+  nina.dns_msec = 50;
+  wifiManager.begin();
+  check(run_until("connected", 10000) >= 0, "connected after a hung lookup");
+  printf("stop during a lookup: %ld msec when the module does not answer\n", t);
+}
+
+static void test_out_of_range()
+{
+  wifiManager.end();
+  check(run_until("idle", 0) == 0 && nina.status == WL_DISCONNECTED, "stop when connected");
+  nina.networks.clear();
+  wifiManager.begin();
+  check(run_until("connecting", 100) >= 0, "connecting");
+  long t = run_until("backoff", WIFI_CONNECT_TIMEOUT_MSEC + 100);
+  check(t >= WIFI_CONNECT_TIMEOUT_MSEC, "attempt ends by the timeout [msec]", t, WIFI_CONNECT_TIMEOUT_MSEC);
+  for (int i = 0; i < 600000 / STEP_MSEC; i++)
+  {
+    step();
+    check(!wifiManager.is_portal(), "no portal once connected");
+  }
+  check(wifiManager.backoff() == WIFI_BACKOFF_MAX_MSEC, "backoff limited", wifiManager.backoff(), WIFI_BACKOFF_MAX_MSEC);
+  check(run_until("backoff", WIFI_CONNECT_TIMEOUT_MSEC + WIFI_BACKOFF_MAX_MSEC) >= 0, "backoff");
+  wifiManager.end();
+  check(run_until("idle", 0) == 0, "stop in backoff");
+  wifiManager.begin();
+  check(run_until("connecting", 100) >= 0, "connecting");
+  wifiManager.end();
+  check(run_until("idle", 0) == 0, "stop when connecting");
+  wifiManager.portal();
+  check(run_until("idle", 0) == 0, "no portal from idle");
+}
+
+// Starts, stops, dropped links and lookups at random for 10 minutes
+static void test_storm()
+{
+  unsigned long attempts = wifiManager.attempts(), stops = 0, lookups = 0;
+  srand(1);
+  nina.networks = {{"home", "secret"}};
+  for (int i = 0; i < 600000 / STEP_MSEC; i++)
+  {
+    int r = rand() % 1000;
+    if (r < 5)
+    {
+      stops += wifiManager.busy();
+      wifiManager.end();
+    }
+    else if (r < 10)
+      wifiManager.begin();
+    else if (r < 13)
+      nina.link = !nina.link;
+    else if (r < 30)
+    {
+      nina.dns_msec = rand() % DNS_SLOW_MSEC;
+      lookups += wifiManager.resolve("broker.local");
+    }
+    step();
+  }
+  nina.link = true;
+  wifiManager.end();
+  check(run_until("idle", WIFI_RESOLVE_TIMEOUT_MSEC + 100) >= 0, "idle after the storm");
+  wifiManager.begin();
+  check(run_until("connected", WIFI_CONNECT_TIMEOUT_MSEC) >= 0, "connected after the storm");
+  printf("storm: %lu attempts, %lu lookups, %lu stops during a lookup\n", wifiManager.attempts() - attempts, lookups,
+         stops);
+}
+
+int main(int argc, char **argv)
+{
+  host_clock() = 1000;
+  test_no_module();
+  test_portal();
+  test_drop();
+  test_stop_lookup();
+  test_out_of_range();
+  test_storm();
+  check(max_polls <= 1, "status polls per run()", max_polls, 1);
+  check(max_pass <= PASS_MSEC, "duration of a run() [msec]", max_pass, PASS_MSEC);
+  check(polls_connecting <= msec_connecting / WIFI_POLL_MSEC + wifiManager.attempts(), "polls while connecting",
+        polls_connecting, msec_connecting / WIFI_POLL_MSEC);
+  printf("%u attempts, %u drops, %lu status polls in %.0f sec (%lu polls in %.0f sec connecting), run() max %lu msec\n",
+         wifiManager.attempts(), wifiManager.drops(), nina.status_calls, millis() / 1000.0, polls_connecting,
+         msec_connecting / 1000.0, max_pass);
+  printf("%d errors\n", errors);
+  return errors ? 1 : 0;
+}